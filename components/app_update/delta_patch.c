@@ -0,0 +1,177 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include "delta_patch.h"
+
+#define DELTA_MIN(a,b) ((a) <= (b) ? (a) : (b))
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+esp_err_t delta_patch_parse_header(const uint8_t *data, delta_patch_header_t *out_header)
+{
+    if (get_le32(data) != DELTA_PATCH_MAGIC || data[4] != DELTA_PATCH_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    out_header->flags = data[5];
+    out_header->old_size = get_le32(data + 8);
+    out_header->old_crc = get_le32(data + 12);
+    out_header->new_size = get_le32(data + 16);
+    return ESP_OK;
+}
+
+void delta_patch_init(delta_patch_t *patch, const delta_patch_header_t *header,
+                      delta_patch_read_old_t read_old, delta_patch_write_new_t write_new, void *ctx)
+{
+    memset(patch, 0, sizeof(delta_patch_t));
+    patch->read_old = read_old;
+    patch->write_new = write_new;
+    patch->ctx = ctx;
+    patch->old_size = header->old_size;
+    patch->new_size = header->new_size;
+    patch->state = (header->new_size == 0) ? DELTA_PATCH_STATE_DONE : DELTA_PATCH_STATE_CONTROL;
+}
+
+/* Called once a full control record has been buffered */
+static esp_err_t start_record(delta_patch_t *patch)
+{
+    patch->diff_left = get_le32(patch->control);
+    patch->extra_left = get_le32(patch->control + 4);
+    patch->seek = (int32_t)get_le32(patch->control + 8);
+    patch->control_fill = 0;
+
+    uint32_t new_left = patch->new_size - patch->new_pos;
+    if (patch->diff_left > new_left || patch->extra_left > new_left - patch->diff_left
+        || patch->diff_left > patch->old_size - DELTA_MIN(patch->old_pos, patch->old_size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    patch->state = DELTA_PATCH_STATE_DIFF;
+    return ESP_OK;
+}
+
+/* Called when the diff and extra parts of the current record are both consumed */
+static esp_err_t finish_record(delta_patch_t *patch)
+{
+    int64_t old_pos = (int64_t)patch->old_pos + patch->seek;
+    if (old_pos < 0 || old_pos > patch->old_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    patch->old_pos = (uint32_t)old_pos;
+    patch->state = (patch->new_pos == patch->new_size) ? DELTA_PATCH_STATE_DONE : DELTA_PATCH_STATE_CONTROL;
+    return ESP_OK;
+}
+
+esp_err_t delta_patch_feed(delta_patch_t *patch, const uint8_t *data, size_t len)
+{
+    esp_err_t err = ESP_OK;
+
+    while (len > 0 && err == ESP_OK) {
+        size_t n;
+        switch (patch->state) {
+        case DELTA_PATCH_STATE_CONTROL:
+            n = DELTA_MIN(len, DELTA_PATCH_CONTROL_SIZE - patch->control_fill);
+            memcpy(patch->control + patch->control_fill, data, n);
+            patch->control_fill += n;
+            if (patch->control_fill == DELTA_PATCH_CONTROL_SIZE) {
+                err = start_record(patch);
+            }
+            break;
+
+        case DELTA_PATCH_STATE_DIFF:
+            n = DELTA_MIN(len, DELTA_MIN(patch->diff_left, DELTA_PATCH_BUF_SIZE));
+            if (n > 0) {
+                err = patch->read_old(patch->ctx, patch->old_pos, patch->buf, n);
+                if (err != ESP_OK) {
+                    break;
+                }
+                for (size_t i = 0; i < n; i++) {
+                    patch->buf[i] += data[i];
+                }
+                err = patch->write_new(patch->ctx, patch->buf, n);
+                patch->old_pos += n;
+                patch->new_pos += n;
+                patch->diff_left -= n;
+            }
+            if (patch->diff_left == 0) {
+                patch->state = DELTA_PATCH_STATE_EXTRA;
+                if (patch->extra_left == 0 && err == ESP_OK) {
+                    err = finish_record(patch);
+                }
+            }
+            break;
+
+        case DELTA_PATCH_STATE_EXTRA:
+            /* extra bytes go straight from the input to the new image */
+            n = DELTA_MIN(len, patch->extra_left);
+            err = patch->write_new(patch->ctx, data, n);
+            patch->new_pos += n;
+            patch->extra_left -= n;
+            if (patch->extra_left == 0 && err == ESP_OK) {
+                err = finish_record(patch);
+            }
+            break;
+
+        case DELTA_PATCH_STATE_DONE:
+        default:
+            return ESP_ERR_INVALID_STATE;
+        }
+        data += n;
+        len -= n;
+    }
+
+    return err;
+}
+
+void delta_patch_inflate_init(delta_patch_inflate_t *inflate, uint8_t *dict)
+{
+    memset(inflate, 0, sizeof(delta_patch_inflate_t));
+    inflate->dict = dict;
+    tinfl_init(&inflate->inflator);
+}
+
+esp_err_t delta_patch_feed_compressed(delta_patch_t *patch, delta_patch_inflate_t *inflate,
+                                      const uint8_t *data, size_t len)
+{
+    tinfl_status status = TINFL_STATUS_HAS_MORE_OUTPUT;
+    while (len > 0 || status == TINFL_STATUS_HAS_MORE_OUTPUT) {
+        if (inflate->done) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        size_t in_bytes = len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - inflate->dict_ofs;
+        status = tinfl_decompress(&inflate->inflator, data, &in_bytes, inflate->dict, inflate->dict + inflate->dict_ofs,
+                                  &out_bytes, TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        data += in_bytes;
+        len -= in_bytes;
+        if (status < TINFL_STATUS_DONE) {
+            return ESP_ERR_INVALID_CRC;
+        }
+        if (out_bytes > 0) {
+            esp_err_t err = delta_patch_feed(patch, inflate->dict + inflate->dict_ofs, out_bytes);
+            if (err != ESP_OK) {
+                return err;
+            }
+            inflate->dict_ofs = (inflate->dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+        if (status == TINFL_STATUS_DONE) {
+            inflate->done = true;
+        } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) {
+            break;
+        }
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,158 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+/* Streaming decoder for the delta patch format produced by gen_ota_delta.py.
+
+   This part has no dependency on flash or FreeRTOS, so it can be built on the host.
+
+   Patch layout (all fields little endian):
+
+   Header (DELTA_PATCH_HEADER_SIZE bytes, never compressed):
+     uint32_t magic       DELTA_PATCH_MAGIC
+     uint8_t  version     DELTA_PATCH_VERSION
+     uint8_t  flags       DELTA_PATCH_FLAG_xxx
+     uint16_t reserved
+     uint32_t old_size    Length of the base image the patch was made against
+     uint32_t old_crc     crc32_le(0, base image, old_size)
+     uint32_t new_size    Length of the image produced by the patch
+
+   Body (zlib stream if DELTA_PATCH_FLAG_ZLIB is set), a sequence of records:
+     uint32_t diff_len    Number of bytes produced by adding the diff bytes below to the base image
+     uint32_t extra_len   Number of bytes copied verbatim to the new image
+     int32_t  seek        Adjustment applied to the base image position after the record
+     uint8_t  diff[diff_len]
+     uint8_t  extra[extra_len]
+
+   Each record produces new[n + i] = old[o + i] + diff[i] for i < diff_len, then the extra bytes. The base
+   position advances by diff_len + seek. The body ends when new_size bytes have been produced.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "rom/miniz.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DELTA_PATCH_MAGIC          0x44505345  /* "ESPD" */
+#define DELTA_PATCH_VERSION        1
+#define DELTA_PATCH_HEADER_SIZE    20
+#define DELTA_PATCH_CONTROL_SIZE   12
+
+#define DELTA_PATCH_FLAG_ZLIB      (1 << 0)
+
+#define DELTA_PATCH_BUF_SIZE       256
+
+typedef struct {
+    uint8_t flags;
+    uint32_t old_size;
+    uint32_t old_crc;
+    uint32_t new_size;
+} delta_patch_header_t;
+
+/* Read 'len' bytes at 'offset' from the base image */
+typedef esp_err_t (*delta_patch_read_old_t)(void *ctx, size_t offset, void *buf, size_t len);
+
+/* Append 'len' bytes to the new image */
+typedef esp_err_t (*delta_patch_write_new_t)(void *ctx, const void *buf, size_t len);
+
+typedef enum {
+    DELTA_PATCH_STATE_CONTROL,
+    DELTA_PATCH_STATE_DIFF,
+    DELTA_PATCH_STATE_EXTRA,
+    DELTA_PATCH_STATE_DONE,
+} delta_patch_state_t;
+
+typedef struct {
+    delta_patch_read_old_t read_old;
+    delta_patch_write_new_t write_new;
+    void *ctx;
+
+    delta_patch_state_t state;
+    uint32_t old_size;
+    uint32_t new_size;
+    uint32_t old_pos;
+    uint32_t new_pos;
+    uint32_t diff_left;
+    uint32_t extra_left;
+    int32_t seek;
+
+    uint8_t control[DELTA_PATCH_CONTROL_SIZE];
+    size_t control_fill;
+    uint8_t buf[DELTA_PATCH_BUF_SIZE];
+} delta_patch_t;
+
+/**
+ * Parse and validate a patch header.
+ *
+ * @param data Pointer to DELTA_PATCH_HEADER_SIZE bytes
+ * @param out_header Filled in on success
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_VERSION if magic or version doesn't match.
+ */
+esp_err_t delta_patch_parse_header(const uint8_t *data, delta_patch_header_t *out_header);
+
+/**
+ * Prepare a decoder for the (uncompressed) body of a patch with the given header.
+ */
+void delta_patch_init(delta_patch_t *patch, const delta_patch_header_t *header,
+                      delta_patch_read_old_t read_old, delta_patch_write_new_t write_new, void *ctx);
+
+/**
+ * Feed the next 'len' bytes of the uncompressed patch body into the decoder.
+ *
+ * Any error returned by the callbacks is passed through.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the patch refers outside the base or new image,
+ *         or ESP_ERR_INVALID_STATE if data is fed after the new image is complete.
+ */
+esp_err_t delta_patch_feed(delta_patch_t *patch, const uint8_t *data, size_t len);
+
+/* Inflate state for the body of a DELTA_PATCH_FLAG_ZLIB patch */
+typedef struct {
+    tinfl_decompressor inflator;
+    bool done;
+    size_t dict_ofs;
+    uint8_t *dict;              /* TINFL_LZ_DICT_SIZE bytes, owned by the caller */
+} delta_patch_inflate_t;
+
+/**
+ * Prepare to inflate a compressed patch body, using 'dict' (TINFL_LZ_DICT_SIZE bytes) as the output window.
+ */
+void delta_patch_inflate_init(delta_patch_inflate_t *inflate, uint8_t *dict);
+
+/**
+ * Inflate the next 'len' bytes of a compressed patch body and feed the output into the decoder.
+ *
+ * @return As delta_patch_feed(), or ESP_ERR_INVALID_CRC if the zlib stream is corrupt.
+ *         ESP_ERR_INVALID_STATE is also returned for data after the end of the zlib stream.
+ */
+esp_err_t delta_patch_feed_compressed(delta_patch_t *patch, delta_patch_inflate_t *inflate,
+                                      const uint8_t *data, size_t len);
+
+/**
+ * Return true once the whole new image has been produced.
+ */
+static inline bool delta_patch_is_done(const delta_patch_t *patch)
+{
+    return patch->state == DELTA_PATCH_STATE_DONE;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,241 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "esp_ota_ops.h"
+#include "esp_ota_delta.h"
+#include "rom/crc.h"
+
+#include "delta_patch.h"
+
+#define DELTA_WRITE_BUF_SIZE SPI_FLASH_SEC_SIZE
+
+struct esp_ota_delta_ctx {
+    esp_ota_handle_t ota_handle;
+    const esp_partition_t *base;
+
+    uint8_t header_buf[DELTA_PATCH_HEADER_SIZE];
+    size_t header_fill;
+    delta_patch_header_t header;
+
+    const uint8_t *base_ptr;            /* base image, mapped once the header is known */
+    spi_flash_mmap_handle_t base_mmap;
+    bool base_mapped;
+
+    delta_patch_t patch;
+
+    delta_patch_inflate_t inflate;
+    uint8_t *dict;                      /* TINFL_LZ_DICT_SIZE bytes, only allocated for compressed patches */
+
+    size_t write_fill;
+    uint8_t write_buf[DELTA_WRITE_BUF_SIZE];
+};
+
+static const char *TAG = "esp_ota_delta";
+
+static esp_err_t read_base(void *ctx, size_t offset, void *buf, size_t len)
+{
+    struct esp_ota_delta_ctx *d = (struct esp_ota_delta_ctx *)ctx;
+    /* delta_patch checks bounds against header.old_size, which was mapped in full */
+    memcpy(buf, d->base_ptr + offset, len);
+    return ESP_OK;
+}
+
+static esp_err_t flush_new(struct esp_ota_delta_ctx *d)
+{
+    esp_err_t err = ESP_OK;
+    if (d->write_fill > 0) {
+        err = esp_ota_write(d->ota_handle, d->write_buf, d->write_fill);
+        d->write_fill = 0;
+    }
+    return err;
+}
+
+/* Collect output into sector sized writes, to avoid one flash operation per patch chunk */
+static esp_err_t write_new(void *ctx, const void *buf, size_t len)
+{
+    struct esp_ota_delta_ctx *d = (struct esp_ota_delta_ctx *)ctx;
+    const uint8_t *bytes = (const uint8_t *)buf;
+    while (len > 0) {
+        size_t n = DELTA_WRITE_BUF_SIZE - d->write_fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(d->write_buf + d->write_fill, bytes, n);
+        d->write_fill += n;
+        bytes += n;
+        len -= n;
+        if (d->write_fill == DELTA_WRITE_BUF_SIZE) {
+            esp_err_t err = flush_new(d);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+/* Header is complete: check the patch matches the base image, and set up the decoder */
+static esp_err_t start_patch(struct esp_ota_delta_ctx *d)
+{
+    esp_err_t err = delta_patch_parse_header(d->header_buf, &d->header);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "invalid delta patch header");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+    if (d->header.old_size == 0 || d->header.old_size > d->base->size) {
+        ESP_LOGE(TAG, "base image size 0x%x doesn't fit partition", d->header.old_size);
+        return ESP_ERR_OTA_DELTA_BASE_MISMATCH;
+    }
+
+    err = esp_partition_mmap(d->base, 0, d->header.old_size, SPI_FLASH_MMAP_DATA,
+                             (const void **)&d->base_ptr, &d->base_mmap);
+    if (err != ESP_OK) {
+        return err;
+    }
+    d->base_mapped = true;
+
+    uint32_t crc = crc32_le(0, d->base_ptr, d->header.old_size);
+    if (crc != d->header.old_crc) {
+        ESP_LOGE(TAG, "base image CRC 0x%08x doesn't match patch (0x%08x)", crc, d->header.old_crc);
+        return ESP_ERR_OTA_DELTA_BASE_MISMATCH;
+    }
+
+    if (d->header.flags & DELTA_PATCH_FLAG_ZLIB) {
+        d->dict = malloc(TINFL_LZ_DICT_SIZE);
+        if (d->dict == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        delta_patch_inflate_init(&d->inflate, d->dict);
+    }
+
+    ESP_LOGD(TAG, "applying patch: base 0x%x bytes, new image 0x%x bytes%s", d->header.old_size,
+             d->header.new_size, d->dict ? ", compressed" : "");
+    delta_patch_init(&d->patch, &d->header, read_base, write_new, d);
+    return ESP_OK;
+}
+
+static esp_err_t feed_body(struct esp_ota_delta_ctx *d, const uint8_t *data, size_t size)
+{
+    esp_err_t err;
+
+    if (d->dict == NULL) {
+        err = delta_patch_feed(&d->patch, data, size);
+    } else {
+        err = delta_patch_feed_compressed(&d->patch, &d->inflate, data, size);
+        if (err == ESP_ERR_INVALID_CRC) {
+            ESP_LOGE(TAG, "patch decompression failed");
+        }
+    }
+    if (err == ESP_ERR_INVALID_SIZE || err == ESP_ERR_INVALID_STATE || err == ESP_ERR_INVALID_CRC) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    return err;
+}
+
+esp_err_t esp_ota_delta_begin(const esp_partition_t *base, esp_ota_handle_t ota_handle, esp_ota_delta_handle_t *out_handle)
+{
+    if (out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (base == NULL) {
+        base = esp_ota_get_running_partition();
+    } else {
+        base = esp_partition_verify(base);
+    }
+    if (base == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    struct esp_ota_delta_ctx *d = calloc(1, sizeof(struct esp_ota_delta_ctx));
+    if (d == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    d->ota_handle = ota_handle;
+    d->base = base;
+    *out_handle = d;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_delta_write(esp_ota_delta_handle_t handle, const void *data, size_t size)
+{
+    const uint8_t *data_bytes = (const uint8_t *)data;
+    esp_err_t err;
+
+    if (handle == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (handle->header_fill < DELTA_PATCH_HEADER_SIZE) {
+        size_t n = DELTA_PATCH_HEADER_SIZE - handle->header_fill;
+        if (n > size) {
+            n = size;
+        }
+        memcpy(handle->header_buf + handle->header_fill, data_bytes, n);
+        handle->header_fill += n;
+        data_bytes += n;
+        size -= n;
+        if (handle->header_fill < DELTA_PATCH_HEADER_SIZE) {
+            return ESP_OK;
+        }
+        err = start_patch(handle);
+        if (err != ESP_OK) {
+            /* don't try to parse the rest of a patch which doesn't apply */
+            if (handle->base_mapped) {
+                spi_flash_munmap(handle->base_mmap);
+                handle->base_mapped = false;
+            }
+            handle->header_fill = 0;
+            return err;
+        }
+    }
+
+    if (size == 0) {
+        return ESP_OK;
+    }
+    return feed_body(handle, data_bytes, size);
+}
+
+esp_err_t esp_ota_delta_end(esp_ota_delta_handle_t handle)
+{
+    esp_err_t err = ESP_OK;
+
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (handle->header_fill < DELTA_PATCH_HEADER_SIZE || !delta_patch_is_done(&handle->patch)) {
+        ESP_LOGE(TAG, "patch incomplete");
+        err = ESP_ERR_OTA_VALIDATE_FAILED;
+    } else {
+        err = flush_new(handle);
+    }
+
+    if (handle->base_mapped) {
+        spi_flash_munmap(handle->base_mmap);
+    }
+    free(handle->dict);
+    free(handle);
+    return err;
+}
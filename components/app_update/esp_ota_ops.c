@@ -248,6 +248,11 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
     }
 #endif
 
+#ifdef CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE
+    /* Not an error if this fails, the bootloader will verify the image in full instead */
+    esp_image_mark_verified(&part_pos, &data);
+#endif
+
  cleanup:
     LIST_REMOVE(it, entries);
     free(it);
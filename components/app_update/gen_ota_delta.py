@@ -0,0 +1,209 @@
+#!/usr/bin/env python
+#
+# ESP32 delta OTA patch generation tool
+#
+# Produces a patch which esp_ota_delta_write() applies on the device to turn the
+# currently running app image into a new app image. See delta_patch.h for the format.
+#
+# Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http:#www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from __future__ import print_function, division
+import argparse
+import struct
+import sys
+import zlib
+
+__version__ = '1.0'
+
+PATCH_MAGIC = 0x44505345  # "ESPD"
+PATCH_VERSION = 1
+FLAG_ZLIB = 0x01
+
+KEY_LEN = 8           # length of the byte strings used to find candidate matches in the base image
+MIN_SCORE = 24        # minimum (matching - mismatching) byte count for a region to be encoded as a diff
+MAX_MISMATCH_RUN = 64 # stop extending a region once its score falls this far below the best seen
+
+quiet = False
+
+
+def status(msg):
+    """ Print status message to stderr """
+    if not quiet:
+        sys.stderr.write(msg)
+        sys.stderr.write('\n')
+
+
+def build_index(old):
+    """ Map each KEY_LEN byte string in the base image to the offset of its first occurrence """
+    index = {}
+    for i in range(len(old) - KEY_LEN + 1):
+        index.setdefault(old[i:i + KEY_LEN], i)
+    return index
+
+
+def extend_forward(old, new, o, n, limit):
+    """ Return the length of the best approximate match of new[n:] against old[o:]
+
+    Like bsdiff, the region is extended as far as matching bytes outnumber mismatching ones.
+    Returns (length, score).
+    """
+    limit = min(limit, len(old) - o, len(new) - n)
+    score = best = length = 0
+    for i in range(limit):
+        score += 1 if old[o + i] == new[n + i] else -1
+        if score > best:
+            best = score
+            length = i + 1
+        elif best - score > MAX_MISMATCH_RUN:
+            break
+    return length, best
+
+
+def extend_backward(old, new, o, n, limit):
+    """ As extend_forward(), but for the bytes preceding old[o] and new[n] """
+    limit = min(limit, o, n)
+    score = best = length = 0
+    for i in range(1, limit + 1):
+        score += 1 if old[o - i] == new[n - i] else -1
+        if score > best:
+            best = score
+            length = i
+        elif best - score > MAX_MISMATCH_RUN:
+            break
+    return length
+
+
+def find_regions(old, new):
+    """ Return a list of (new_offset, old_offset, length) regions of new which are encoded against old """
+    old_bytes = bytes(old)
+    new_bytes = bytes(new)
+    index = build_index(old_bytes)
+    regions = []
+    scan = 0
+    last_end = 0     # end of the previous region in new
+    last_delta = 0   # old_offset - new_offset of the previous region
+
+    while scan <= len(new) - KEY_LEN:
+        # prefer continuing at the alignment of the previous region, to keep seeks at zero
+        candidates = [scan + last_delta]
+        key = new_bytes[scan:scan + KEY_LEN]
+        if key in index:
+            candidates.append(index[key])
+        best = None
+        for o in candidates:
+            if o < 0 or o + KEY_LEN > len(old) or old_bytes[o:o + KEY_LEN] != key:
+                continue
+            length, score = extend_forward(old, new, o, scan, len(new))
+            if score >= MIN_SCORE and (best is None or score > best[2]):
+                best = (o, length, score)
+        if best is None:
+            scan += 1
+            continue
+
+        o, length, _ = best
+        back = extend_backward(old, new, o, scan, scan - last_end)
+        regions.append((scan - back, o - back, length + back))
+        scan += length
+        last_end = scan
+        last_delta = o - (scan - length)
+    return regions
+
+
+def make_patch(old, new, compress=True):
+    old = bytearray(old)
+    new = bytearray(new)
+    regions = find_regions(old, new)
+
+    body = bytearray()
+    # a leading record with no diff bytes covers any literal data before the first region
+    records = [(0, 0, 0)] + regions
+    for k, (n, o, length) in enumerate(records):
+        if k + 1 < len(records):
+            next_n, next_o, _ = records[k + 1]
+        else:
+            next_n, next_o = len(new), o + length
+        extra = new[n + length:next_n]
+        body += struct.pack('<IIi', length, len(extra), next_o - (o + length))
+        body += bytearray((new[n + i] - old[o + i]) & 0xFF for i in range(length))
+        body += extra
+
+    flags = 0
+    if compress:
+        body = bytearray(zlib.compress(bytes(body), 9))
+        flags |= FLAG_ZLIB
+    header = struct.pack('<IBBHIII', PATCH_MAGIC, PATCH_VERSION, flags, 0,
+                         len(old), zlib.crc32(bytes(old)) & 0xFFFFFFFF, len(new))
+    return header + bytes(body), len(regions)
+
+
+def apply_patch(old, patch):
+    """ Reference implementation of the device side, used to self-check generated patches """
+    old = bytearray(old)
+    magic, version, flags, _, old_size, old_crc, new_size = struct.unpack('<IBBHIII', patch[:20])
+    if magic != PATCH_MAGIC or version != PATCH_VERSION:
+        raise InputError("not a delta patch")
+    if old_size != len(old) or old_crc != zlib.crc32(bytes(old)) & 0xFFFFFFFF:
+        raise InputError("patch does not apply to this base image")
+    body = patch[20:]
+    if flags & FLAG_ZLIB:
+        body = zlib.decompress(body)
+    body = bytearray(body)
+    new = bytearray()
+    pos = 0
+    old_pos = 0
+    while len(new) < new_size:
+        diff_len, extra_len, seek = struct.unpack('<IIi', bytes(body[pos:pos + 12]))
+        pos += 12
+        new += bytearray((body[pos + i] + old[old_pos + i]) & 0xFF for i in range(diff_len))
+        pos += diff_len
+        new += body[pos:pos + extra_len]
+        pos += extra_len
+        old_pos += diff_len + seek
+    return bytes(new)
+
+
+class InputError(RuntimeError):
+    def __init__(self, e):
+        super(InputError, self).__init__(e)
+
+
+def main():
+    global quiet
+    parser = argparse.ArgumentParser(description='ESP32 delta OTA patch generator')
+    parser.add_argument('--quiet', '-q', help="Don't print status messages to stderr", action='store_true')
+    parser.add_argument('--uncompressed', help="Don't zlib compress the patch body", action='store_true')
+    parser.add_argument('--verify', help="Apply the generated patch and check the result", action='store_true')
+    parser.add_argument('old', help='App image currently running on the device', type=argparse.FileType('rb'))
+    parser.add_argument('new', help='New app image', type=argparse.FileType('rb'))
+    parser.add_argument('output', help='Path to write the patch to', type=argparse.FileType('wb'))
+
+    args = parser.parse_args()
+    quiet = args.quiet
+
+    old = args.old.read()
+    new = args.new.read()
+    patch, regions = make_patch(old, new, not args.uncompressed)
+    if args.verify and apply_patch(old, patch) != new:
+        raise InputError("generated patch failed to verify")
+    args.output.write(patch)
+    status("Patch %d bytes (%d regions) for new image %d bytes, base image %d bytes" %
+           (len(patch), regions, len(new), len(old)))
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except InputError as e:
+        print(e, file=sys.stderr)
+        sys.exit(2)
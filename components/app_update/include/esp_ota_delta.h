@@ -0,0 +1,95 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _OTA_DELTA_H
+#define _OTA_DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define ESP_ERR_OTA_DELTA_BASE_MISMATCH          (ESP_ERR_OTA_BASE + 0x04)  /*!< Error if the delta patch was not made against the image in the base partition */
+
+/**
+ * @brief Opaque handle for a delta (binary diff) OTA update
+ */
+typedef struct esp_ota_delta_ctx *esp_ota_delta_handle_t;
+
+/**
+ * @brief   Commence applying a delta patch on top of an OTA update.
+ *
+ * Patches are produced on the host by components/app_update/gen_ota_delta.py from the
+ * image currently running on the device and the new image.
+ *
+ * The base image is read from the base partition, and the new image is written via
+ * esp_ota_write() to the OTA update handle. The caller calls esp_ota_end() on
+ * the OTA handle as usual after esp_ota_delta_end() succeeds.
+ *
+ * On success, this function allocates memory (about 48KB, most of it for decompression)
+ * that remains in use until esp_ota_delta_end() is called with the returned handle.
+ *
+ * @param base Partition holding the image the patch was generated against. If NULL, the currently running partition is used.
+ * @param ota_handle Handle obtained from esp_ota_begin() for the partition receiving the new image.
+ * @param out_handle On success, returns a handle which should be used for subsequent esp_ota_delta_write() and esp_ota_delta_end() calls.
+ *
+ * @return
+ *    - ESP_OK: Delta update commenced successfully.
+ *    - ESP_ERR_INVALID_ARG: out_handle was NULL.
+ *    - ESP_ERR_NOT_FOUND: Base partition not found.
+ *    - ESP_ERR_NO_MEM: Cannot allocate memory for the delta update.
+ */
+esp_err_t esp_ota_delta_begin(const esp_partition_t *base, esp_ota_handle_t ota_handle, esp_ota_delta_handle_t *out_handle);
+
+/**
+ * @brief   Feed the next part of the patch data.
+ *
+ * This function can be called multiple times as patch data is received, with buffers of any size.
+ *
+ * @param handle Handle obtained from esp_ota_delta_begin()
+ * @param data   Patch data buffer
+ * @param size   Size of data buffer in bytes
+ *
+ * @return
+ *    - ESP_OK: Data was processed successfully.
+ *    - ESP_ERR_INVALID_ARG: handle or data is NULL.
+ *    - ESP_ERR_OTA_DELTA_BASE_MISMATCH: Patch was generated against a different base image.
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: Patch data is corrupt, or more data was received than the patch describes.
+ *    - Any error returned by esp_ota_write().
+ */
+esp_err_t esp_ota_delta_write(esp_ota_delta_handle_t handle, const void *data, size_t size);
+
+/**
+ * @brief Finish applying the delta patch and free the handle.
+ *
+ * @note The handle is no longer valid after this call, regardless of result.
+ *
+ * @return
+ *    - ESP_OK: The complete new image was written to the OTA handle.
+ *    - ESP_ERR_INVALID_ARG: handle is NULL.
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: The patch ended before the new image was complete.
+ */
+esp_err_t esp_ota_delta_end(esp_ota_delta_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OTA_DELTA_H */
@@ -8,10 +8,15 @@
 #include <unity.h>
 #include <test_utils.h>
 #include <esp_ota_ops.h>
+#include <esp_ota_delta.h>
+#include <rom/crc.h>
+#include <rom/miniz.h>
+#include "../delta_patch.h"
 
 
-/* These OTA tests currently don't assume an OTA partition exists
-   on the device, so they're a bit limited
+/* These OTA tests don't do full OTA updates. The update partition logic
+   test expects the unit test app's partition table (factory, ota_0, ota_1);
+   tests which write to an OTA slot skip themselves if there isn't one.
 */
 
 TEST_CASE("esp_ota_begin() verifies arguments", "[ota]")
@@ -84,3 +89,113 @@ TEST_CASE("esp_ota_get_next_update_partition logic", "[ota]")
     TEST_ASSERT_EQUAL_PTR(ota_0, p);
 }
 
+
+TEST_CASE("esp_ota_delta rejects a patch for a different base image", "[ota]")
+{
+    const esp_partition_t *ota_0 = esp_partition_find_first(ESP_PARTITION_TYPE_APP,
+                                                            ESP_PARTITION_SUBTYPE_APP_OTA_0, NULL);
+    if (ota_0 == NULL || ota_0 == esp_ota_get_running_partition()) {
+        TEST_IGNORE_MESSAGE("no OTA 0 partition to write to, skipping esp_ota_delta test");
+    }
+
+    esp_ota_handle_t ota_handle;
+    esp_ota_delta_handle_t delta_handle;
+    TEST_ESP_OK(esp_ota_begin(ota_0, 0x10000, &ota_handle));
+    TEST_ESP_OK(esp_ota_delta_begin(NULL, ota_handle, &delta_handle));
+
+    /* "ESPD" v1, uncompressed, base image 0x1000 bytes with a CRC which won't match */
+    const uint8_t header[] = { 'E', 'S', 'P', 'D', 1, 0, 0, 0,
+                               0x00, 0x10, 0, 0, 0xEF, 0xBE, 0xAD, 0xDE, 0x00, 0x10, 0, 0 };
+    /* feeding the header in two parts, so the first part is only buffered */
+    TEST_ESP_OK(esp_ota_delta_write(delta_handle, header, 5));
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_OTA_DELTA_BASE_MISMATCH, esp_ota_delta_write(delta_handle, header + 5, sizeof(header) - 5));
+
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_OTA_VALIDATE_FAILED, esp_ota_delta_end(delta_handle));
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_ota_end(ota_handle));
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+TEST_CASE("esp_ota_delta applies a compressed patch against the running app", "[ota]")
+{
+    /* more than the inflate window, so the decoder's output wraps around it */
+    const size_t old_size = 36 * 1024;
+    const uint8_t extra[] = "appended by the delta patch test";
+    const size_t new_size = old_size + sizeof(extra);
+
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *ota_0 = esp_partition_find_first(ESP_PARTITION_TYPE_APP,
+                                                            ESP_PARTITION_SUBTYPE_APP_OTA_0, NULL);
+    if (ota_0 == NULL || ota_0 == running) {
+        TEST_IGNORE_MESSAGE("no OTA 0 partition to write to, skipping esp_ota_delta test");
+    }
+
+    const uint8_t *base;
+    spi_flash_mmap_handle_t base_mmap;
+    TEST_ESP_OK(esp_partition_mmap(running, 0, old_size, SPI_FLASH_MMAP_DATA, (const void **)&base, &base_mmap));
+
+    /* one record: the base image with a few bytes changed, then some extra bytes */
+    const size_t body_size = DELTA_PATCH_CONTROL_SIZE + old_size + sizeof(extra);
+    uint8_t *body = calloc(1, body_size);
+    uint8_t *expected = malloc(new_size);
+    TEST_ASSERT_NOT_NULL(body);
+    TEST_ASSERT_NOT_NULL(expected);
+    put_le32(body, old_size);
+    put_le32(body + 4, sizeof(extra));
+    put_le32(body + 8, 0);
+    uint8_t *diff = body + DELTA_PATCH_CONTROL_SIZE;
+    for (size_t i = 1000; i < old_size; i += 3001) {
+        diff[i] = i & 0xFF;
+    }
+    memcpy(diff + old_size, extra, sizeof(extra));
+    for (size_t i = 0; i < old_size; i++) {
+        expected[i] = base[i] + diff[i];
+    }
+    memcpy(expected + old_size, extra, sizeof(extra));
+
+    uint8_t patch_header[DELTA_PATCH_HEADER_SIZE] = { 'E', 'S', 'P', 'D', DELTA_PATCH_VERSION, DELTA_PATCH_FLAG_ZLIB };
+    put_le32(patch_header + 8, old_size);
+    put_le32(patch_header + 12, crc32_le(0, base, old_size));
+    put_le32(patch_header + 16, new_size);
+    spi_flash_munmap(base_mmap);
+
+    tdefl_compressor *comp = malloc(sizeof(tdefl_compressor));
+    uint8_t *compressed = malloc(body_size);
+    TEST_ASSERT_NOT_NULL(comp);
+    TEST_ASSERT_NOT_NULL(compressed);
+    size_t in_bytes = body_size;
+    size_t compressed_size = body_size;
+    TEST_ASSERT_EQUAL(TDEFL_STATUS_OKAY, tdefl_init(comp, NULL, NULL, TDEFL_WRITE_ZLIB_HEADER | 128));
+    TEST_ASSERT_EQUAL(TDEFL_STATUS_DONE, tdefl_compress(comp, body, &in_bytes, compressed, &compressed_size, TDEFL_FINISH));
+    TEST_ASSERT_EQUAL(body_size, in_bytes);
+    free(comp);
+    free(body);
+
+    esp_ota_handle_t ota_handle;
+    esp_ota_delta_handle_t delta_handle;
+    TEST_ESP_OK(esp_ota_begin(ota_0, new_size, &ota_handle));
+    TEST_ESP_OK(esp_ota_delta_begin(NULL, ota_handle, &delta_handle));
+    TEST_ESP_OK(esp_ota_delta_write(delta_handle, patch_header, sizeof(patch_header)));
+    /* odd sized pieces, so input boundaries don't line up with anything */
+    for (size_t pos = 0; pos < compressed_size; pos += 97) {
+        size_t n = (compressed_size - pos < 97) ? compressed_size - pos : 97;
+        TEST_ESP_OK(esp_ota_delta_write(delta_handle, compressed + pos, n));
+    }
+    free(compressed);
+    TEST_ESP_OK(esp_ota_delta_end(delta_handle));
+    /* the result is only the start of an app, so it doesn't validate as a whole image */
+    esp_ota_end(ota_handle);
+
+    uint8_t *written = malloc(new_size);
+    TEST_ASSERT_NOT_NULL(written);
+    TEST_ESP_OK(esp_partition_read(ota_0, 0, written, new_size));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, written, new_size);
+    free(written);
+    free(expected);
+}
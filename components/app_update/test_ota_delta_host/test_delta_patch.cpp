@@ -0,0 +1,293 @@
+#include "catch.hpp"
+#include "delta_patch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <random>
+
+typedef std::vector<uint8_t> bytes_t;
+
+struct PatchTarget {
+    const bytes_t *old_image;
+    bytes_t new_image;
+    size_t reads = 0;
+};
+
+static esp_err_t read_old(void *ctx, size_t offset, void *buf, size_t len)
+{
+    PatchTarget *t = static_cast<PatchTarget *>(ctx);
+    REQUIRE(offset + len <= t->old_image->size());
+    memcpy(buf, t->old_image->data() + offset, len);
+    t->reads++;
+    return ESP_OK;
+}
+
+static esp_err_t write_new(void *ctx, const void *buf, size_t len)
+{
+    PatchTarget *t = static_cast<PatchTarget *>(ctx);
+    const uint8_t *p = static_cast<const uint8_t *>(buf);
+    t->new_image.insert(t->new_image.end(), p, p + len);
+    return ESP_OK;
+}
+
+static void write_file(const char *path, const bytes_t &data)
+{
+    FILE *f = fopen(path, "wb");
+    REQUIRE(f != NULL);
+    REQUIRE(fwrite(data.data(), 1, data.size(), f) == data.size());
+    fclose(f);
+}
+
+static bytes_t read_file(const char *path)
+{
+    bytes_t data;
+    FILE *f = fopen(path, "rb");
+    REQUIRE(f != NULL);
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(f);
+    return data;
+}
+
+/* Run the host tool on a pair of images, return the patch */
+static bytes_t gen_patch(const bytes_t &old_image, const bytes_t &new_image, bool compressed)
+{
+    write_file("delta_test_old.bin", old_image);
+    write_file("delta_test_new.bin", new_image);
+    std::string cmd = "python ../gen_ota_delta.py --quiet ";
+    if (!compressed) {
+        cmd += "--uncompressed ";
+    }
+    cmd += "delta_test_old.bin delta_test_new.bin delta_test_patch.bin";
+    REQUIRE(system(cmd.c_str()) == 0);
+    return read_file("delta_test_patch.bin");
+}
+
+/* Apply a patch, feeding it to the decoder 'chunk' bytes at a time */
+static esp_err_t apply_patch(const bytes_t &old_image, const bytes_t &patch, size_t chunk, bytes_t &out)
+{
+    delta_patch_header_t header;
+    REQUIRE(patch.size() >= DELTA_PATCH_HEADER_SIZE);
+    REQUIRE(delta_patch_parse_header(patch.data(), &header) == ESP_OK);
+    CHECK(header.old_size == old_image.size());
+
+    PatchTarget target;
+    target.old_image = &old_image;
+    delta_patch_t decoder;
+    delta_patch_init(&decoder, &header, read_old, write_new, &target);
+
+    bool compressed = (header.flags & DELTA_PATCH_FLAG_ZLIB) != 0;
+    bytes_t dict(TINFL_LZ_DICT_SIZE);
+    delta_patch_inflate_t inflate;
+    delta_patch_inflate_init(&inflate, dict.data());
+
+    esp_err_t err = ESP_OK;
+    for (size_t pos = DELTA_PATCH_HEADER_SIZE; pos < patch.size() && err == ESP_OK; pos += chunk) {
+        size_t n = std::min(chunk, patch.size() - pos);
+        if (compressed) {
+            err = delta_patch_feed_compressed(&decoder, &inflate, patch.data() + pos, n);
+        } else {
+            err = delta_patch_feed(&decoder, patch.data() + pos, n);
+        }
+    }
+    if (err == ESP_OK && !delta_patch_is_done(&decoder)) {
+        err = ESP_FAIL;
+    }
+    out = target.new_image;
+    return err;
+}
+
+/* Something shaped like an app image: 0xE9 header, then "code" with 32-bit addresses sprinkled through it */
+static bytes_t make_image(std::mt19937 &gen, size_t len)
+{
+    bytes_t image(len);
+    for (size_t i = 0; i < len; i++) {
+        image[i] = gen() & 0xFF;
+    }
+    image[0] = 0xE9;
+    for (size_t i = 64; i + 4 <= len; i += 16) {
+        uint32_t addr = 0x400D0000 + (gen() % len);
+        memcpy(&image[i], &addr, 4);
+    }
+    return image;
+}
+
+/* Insert 'count' bytes at 'at' and relocate every address after it, as relinking a modified app would */
+static bytes_t relink(const bytes_t &image, size_t at, size_t count)
+{
+    bytes_t res = image;
+    for (size_t i = 64; i + 4 <= res.size(); i += 16) {
+        uint32_t addr;
+        memcpy(&addr, &res[i], 4);
+        if (addr >= 0x400D0000 + at) {
+            addr += count;
+            memcpy(&res[i], &addr, 4);
+        }
+    }
+    res.insert(res.begin() + at, count, 0x5A);
+    return res;
+}
+
+TEST_CASE("delta patch header is validated", "[delta]")
+{
+    uint8_t header[DELTA_PATCH_HEADER_SIZE] = { 'E', 'S', 'P', 'D', DELTA_PATCH_VERSION, DELTA_PATCH_FLAG_ZLIB, 0, 0,
+                                                0x00, 0x10, 0, 0, 0x78, 0x56, 0x34, 0x12, 0x00, 0x20, 0, 0 };
+    delta_patch_header_t parsed;
+    CHECK(delta_patch_parse_header(header, &parsed) == ESP_OK);
+    CHECK(parsed.flags == DELTA_PATCH_FLAG_ZLIB);
+    CHECK(parsed.old_size == 0x1000);
+    CHECK(parsed.old_crc == 0x12345678);
+    CHECK(parsed.new_size == 0x2000);
+
+    header[4] = DELTA_PATCH_VERSION + 1;
+    CHECK(delta_patch_parse_header(header, &parsed) == ESP_ERR_INVALID_VERSION);
+    header[4] = DELTA_PATCH_VERSION;
+    header[0] = 0xE9;
+    CHECK(delta_patch_parse_header(header, &parsed) == ESP_ERR_INVALID_VERSION);
+}
+
+TEST_CASE("delta patch round trips a relinked image", "[delta]")
+{
+    std::mt19937 gen(1234);
+    bytes_t old_image = make_image(gen, 256 * 1024);
+    bytes_t new_image = relink(relink(old_image, 100 * 1024, 300), 20 * 1024, 17);
+    for (size_t i = 180 * 1024; i < 182 * 1024; i++) {
+        new_image[i] = gen() & 0xFF;
+    }
+
+    bytes_t patch = gen_patch(old_image, new_image, false);
+    for (size_t chunk : { (size_t)1, (size_t)7, (size_t)1000, (size_t)4096, patch.size() }) {
+        bytes_t result;
+        CHECK(apply_patch(old_image, patch, chunk, result) == ESP_OK);
+        CHECK(result == new_image);
+    }
+
+    bytes_t compressed = gen_patch(old_image, new_image, true);
+    printf("relinked image %zu bytes, patch %zu bytes (%zu uncompressed)\n", new_image.size(), compressed.size(), patch.size());
+    CHECK(compressed.size() < new_image.size() / 4);
+}
+
+TEST_CASE("compressed delta patch round trips a relinked image", "[delta]")
+{
+    std::mt19937 gen(4321);
+    /* bigger than the inflate window, so the output wraps around it */
+    bytes_t old_image = make_image(gen, 200 * 1024);
+    bytes_t new_image = relink(old_image, 50 * 1024, 1000);
+    for (size_t i = 120 * 1024; i < 150 * 1024; i++) {
+        new_image[i] = gen() & 0xFF;
+    }
+
+    bytes_t patch = gen_patch(old_image, new_image, true);
+    delta_patch_header_t header;
+    REQUIRE(delta_patch_parse_header(patch.data(), &header) == ESP_OK);
+    CHECK((header.flags & DELTA_PATCH_FLAG_ZLIB) != 0);
+
+    for (size_t chunk : { (size_t)1, (size_t)13, (size_t)4096, patch.size() }) {
+        bytes_t result;
+        CHECK(apply_patch(old_image, patch, chunk, result) == ESP_OK);
+        CHECK(result == new_image);
+    }
+}
+
+TEST_CASE("corrupt compressed delta patch is rejected", "[delta]")
+{
+    std::mt19937 gen(77);
+    bytes_t old_image = make_image(gen, 16384);
+    bytes_t new_image = relink(old_image, 4000, 64);
+    bytes_t patch = gen_patch(old_image, new_image, true);
+    bytes_t result;
+
+    /* bad zlib header */
+    bytes_t bad = patch;
+    bad[DELTA_PATCH_HEADER_SIZE] ^= 0xFF;
+    CHECK(apply_patch(old_image, bad, 64, result) == ESP_ERR_INVALID_CRC);
+
+    /* adler32 at the end of the stream doesn't match */
+    bad = patch;
+    bad.back() ^= 0x01;
+    CHECK(apply_patch(old_image, bad, 64, result) == ESP_ERR_INVALID_CRC);
+
+    /* trailing data after the zlib stream */
+    bad = patch;
+    bad.push_back(0);
+    CHECK(apply_patch(old_image, bad, 64, result) == ESP_ERR_INVALID_STATE);
+
+    /* truncated */
+    bad = patch;
+    bad.resize(bad.size() - 8);
+    CHECK(apply_patch(old_image, bad, 64, result) == ESP_FAIL);
+}
+
+TEST_CASE("delta patch round trips unrelated and empty images", "[delta]")
+{
+    std::mt19937 gen(42);
+    bytes_t old_image = make_image(gen, 8192);
+    bytes_t new_image = make_image(gen, 10000);
+    bytes_t result;
+
+    bytes_t patch = gen_patch(old_image, new_image, false);
+    CHECK(apply_patch(old_image, patch, 100, result) == ESP_OK);
+    CHECK(result == new_image);
+
+    patch = gen_patch(old_image, old_image, false);
+    CHECK(apply_patch(old_image, patch, 100, result) == ESP_OK);
+    CHECK(result == old_image);
+}
+
+TEST_CASE("corrupt delta patch is rejected", "[delta]")
+{
+    std::mt19937 gen(99);
+    bytes_t old_image = make_image(gen, 16384);
+    bytes_t new_image = relink(old_image, 4000, 64);
+    bytes_t patch = gen_patch(old_image, new_image, false);
+    bytes_t result;
+
+    /* diff length pointing past the end of the base image */
+    bytes_t bad = patch;
+    uint32_t huge = 0x7FFFFFFF;
+    memcpy(&bad[DELTA_PATCH_HEADER_SIZE], &huge, 4);
+    CHECK(apply_patch(old_image, bad, 64, result) == ESP_ERR_INVALID_SIZE);
+
+    /* seek before the start of the base image */
+    bad = patch;
+    int32_t seek = -1000000;
+    memcpy(&bad[DELTA_PATCH_HEADER_SIZE + 8], &seek, 4);
+    CHECK(apply_patch(old_image, bad, 64, result) == ESP_ERR_INVALID_SIZE);
+
+    /* trailing data after the new image is complete */
+    bad = patch;
+    bad.push_back(0);
+    CHECK(apply_patch(old_image, bad, 64, result) == ESP_ERR_INVALID_STATE);
+
+    /* truncated */
+    bad = patch;
+    bad.resize(bad.size() - 1);
+    CHECK(apply_patch(old_image, bad, 64, result) == ESP_FAIL);
+}
+
+TEST_CASE("delta patch round trips real app images", "[delta]")
+{
+    const char *old_path = getenv("OLD_IMAGE");
+    const char *new_path = getenv("NEW_IMAGE");
+    if (old_path == NULL || new_path == NULL || strlen(old_path) == 0 || strlen(new_path) == 0) {
+        WARN("OLD_IMAGE / NEW_IMAGE not set, skipping");
+        return;
+    }
+    bytes_t old_image = read_file(old_path);
+    bytes_t new_image = read_file(new_path);
+    bytes_t patch = gen_patch(old_image, new_image, false);
+    bytes_t result;
+    CHECK(apply_patch(old_image, patch, 4096, result) == ESP_OK);
+    CHECK(result == new_image);
+
+    bytes_t compressed = gen_patch(old_image, new_image, true);
+    printf("new image %zu bytes, patch %zu bytes\n", new_image.size(), compressed.size());
+    CHECK(apply_patch(old_image, compressed, 4096, result) == ESP_OK);
+    CHECK(result == new_image);
+}
@@ -0,0 +1,53 @@
+/* Host stand-in for the tinfl_decompress() in ROM, on top of zlib.
+
+   Only what delta_patch_feed_compressed() uses: a zlib header, a wrapping
+   output buffer and input supplied in pieces. Only one stream at a time. */
+
+#include <stdbool.h>
+#include <string.h>
+#include <zlib.h>
+#include "rom/miniz.h"
+
+static z_stream s_stream;
+static bool s_stream_open;
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size,
+                              mz_uint8 *pOut_buf_start, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size,
+                              const mz_uint32 decomp_flags)
+{
+    (void)pOut_buf_start;
+    if ((decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) == 0) {
+        return TINFL_STATUS_BAD_PARAM;
+    }
+    if (r->m_state == 0) {
+        /* tinfl_init() was called since the last stream */
+        if (s_stream_open) {
+            inflateEnd(&s_stream);
+        }
+        memset(&s_stream, 0, sizeof(s_stream));
+        if (inflateInit(&s_stream) != Z_OK) {
+            return TINFL_STATUS_FAILED;
+        }
+        s_stream_open = true;
+        r->m_state = 1;
+    }
+
+    s_stream.next_in = (Bytef *)pIn_buf_next;
+    s_stream.avail_in = *pIn_buf_size;
+    s_stream.next_out = pOut_buf_next;
+    s_stream.avail_out = *pOut_buf_size;
+    int res = inflate(&s_stream, Z_NO_FLUSH);
+    *pIn_buf_size -= s_stream.avail_in;
+    *pOut_buf_size -= s_stream.avail_out;
+
+    if (res == Z_STREAM_END) {
+        return TINFL_STATUS_DONE;
+    }
+    if (res != Z_OK && res != Z_BUF_ERROR) {
+        return TINFL_STATUS_FAILED;
+    }
+    if (s_stream.avail_out == 0) {
+        return TINFL_STATUS_HAS_MORE_OUTPUT;
+    }
+    return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
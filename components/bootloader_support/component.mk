@@ -42,4 +42,17 @@ COMPONENT_EXTRA_CLEAN += $(SECURE_BOOT_VERIFICATION_KEY)
 
 COMPONENT_EMBED_FILES := $(SECURE_BOOT_VERIFICATION_KEY)
 
+ifdef CONFIG_SECURE_BOOT_VERIFY_FAST
+# multiples of the verification key, for esp_uecc_verify()
+SECURE_BOOT_VERIFICATION_TABLE := $(abspath signature_verification_key_table.bin)
+
+$(SECURE_BOOT_VERIFICATION_TABLE): $(SECURE_BOOT_VERIFICATION_KEY) $(SDKCONFIG_MAKEFILE)
+	$(summary) GEN $@
+	$(PYTHON) $(IDF_PATH)/components/micro-ecc/gen_verify_table.py --window $(CONFIG_SECURE_BOOT_VERIFY_WINDOW) $< $@
+
+COMPONENT_EXTRA_CLEAN += $(SECURE_BOOT_VERIFICATION_TABLE)
+
+COMPONENT_EMBED_FILES += $(SECURE_BOOT_VERIFICATION_TABLE)
+endif
+
 endif
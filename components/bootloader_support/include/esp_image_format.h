@@ -142,6 +142,46 @@ esp_err_t esp_image_load(esp_image_load_mode_t mode, const esp_partition_pos_t *
  */
 esp_err_t esp_image_verify_bootloader(uint32_t *length);
 
+/**
+ * @brief Record that an app image has been fully verified.
+ *
+ * Writes a marker to the erased flash immediately after the image. If
+ * CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE is enabled, the bootloader skips the
+ * checksum and SHA-256 verification of images carrying a matching marker,
+ * and only loads the segments which go to RAM.
+ *
+ * The bootloader marks an app the first time it verifies it in full, and
+ * esp_ota_end() marks a newly written OTA app once it has been verified.
+ *
+ * Only available if CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE is enabled.
+ *
+ * @param part Partition holding the image.
+ * @param data Image metadata, as returned by a successful esp_image_load().
+ *
+ * @return
+ * - ESP_OK if the image is marked as verified (including if it was already marked)
+ * - ESP_ERR_NOT_SUPPORTED if the image has no appended SHA-256 digest, or secure boot is enabled
+ * - ESP_ERR_INVALID_SIZE if there's no space in the partition after the image
+ * - ESP_ERR_INVALID_STATE if the flash after the image is not erased
+ * - Flash read or write errors
+ */
+esp_err_t esp_image_mark_verified(const esp_partition_pos_t *part, const esp_image_metadata_t *data);
+
+/**
+ * @brief Check whether the image in a partition carries a verified marker matching it.
+ *
+ * This is the check the bootloader makes before skipping verification. It
+ * only reads the image and segment headers, the appended digest and the
+ * marker, it doesn't verify the image contents.
+ *
+ * Only available if CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE is enabled.
+ *
+ * @param part Partition holding the image.
+ *
+ * @return true if the marker after the image matches its length and appended digest.
+ */
+bool esp_image_is_marked_verified(const esp_partition_pos_t *part);
+
 typedef struct {
     uint32_t drom_addr;
     uint32_t drom_load_addr;
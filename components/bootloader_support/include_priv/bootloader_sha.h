@@ -29,4 +29,11 @@ bootloader_sha256_handle_t bootloader_sha256_start();
 
 void bootloader_sha256_data(bootloader_sha256_handle_t handle, const void *data, size_t data_len);
 
+/* As bootloader_sha256_data(), and also XOR each 32-bit word of data into *checksum.
+
+   This saves a second pass over the data when verifying images. Hardware version calculates the
+   checksum while the SHA engine is busy with the previous block.
+*/
+void bootloader_sha256_data_checksum(bootloader_sha256_handle_t handle, const void *data, size_t data_len, uint32_t *checksum);
+
 void bootloader_sha256_finish(bootloader_sha256_handle_t handle, uint8_t *digest);
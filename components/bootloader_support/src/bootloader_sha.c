@@ -39,6 +39,25 @@ void bootloader_sha256_data(bootloader_sha256_handle_t handle, const void *data,
     mbedtls_sha256_update(ctx, data, data_len);
 }
 
+void bootloader_sha256_data_checksum(bootloader_sha256_handle_t handle, const void *data, size_t data_len, uint32_t *checksum)
+{
+    assert(data_len % 4 == 0);
+    const uint32_t *w = (const uint32_t *)data;
+    size_t word_len = data_len / 4;
+    uint32_t c0 = *checksum, c1 = 0;
+    size_t i;
+
+    bootloader_sha256_data(handle, data, data_len);
+    for (i = 0; i + 2 <= word_len; i += 2) {
+        c0 ^= w[i];
+        c1 ^= w[i + 1];
+    }
+    if (i < word_len) {
+        c0 ^= w[i];
+    }
+    *checksum = c0 ^ c1;
+}
+
 void bootloader_sha256_finish(bootloader_sha256_handle_t handle, uint8_t *digest)
 {
     assert(handle != NULL);
@@ -118,6 +137,63 @@ void bootloader_sha256_data(bootloader_sha256_handle_t handle, const void *data,
     }
 }
 
+void bootloader_sha256_data_checksum(bootloader_sha256_handle_t handle, const void *data, size_t data_len, uint32_t *checksum)
+{
+    assert(handle != NULL);
+    assert(data_len % 4 == 0);
+
+    const uint32_t *w = (const uint32_t *)data;
+    size_t word_len = data_len / 4;
+    uint32_t *sha_text_reg = (uint32_t *)(SHA_TEXT_BASE);
+    uint32_t xor = 0;
+
+    /* Top up any partial block left by a previous call */
+    size_t head = (BLOCK_WORDS - words_hashed % BLOCK_WORDS) % BLOCK_WORDS;
+    head = MIN(head, word_len);
+    for (int i = 0; i < head; i++) {
+        xor ^= w[i];
+    }
+    bootloader_sha256_data(handle, w, head * 4);
+    w += head;
+    word_len -= head;
+
+    /* Whole blocks: the engine hashes block N while the words of block N+1 are checksummed, so wait for it
+       only once the next block is ready to load */
+    uint32_t block[BLOCK_WORDS];
+    while (word_len >= BLOCK_WORDS) {
+        for (int i = 0; i < BLOCK_WORDS; i += 2) {
+            uint32_t w0 = w[i];
+            uint32_t w1 = w[i + 1];
+            xor ^= w0 ^ w1;
+            block[i] = __builtin_bswap32(w0);
+            block[i + 1] = __builtin_bswap32(w1);
+        }
+
+        while(REG_READ(SHA_256_BUSY_REG) != 0) { }
+        for (int i = 0; i < BLOCK_WORDS; i++) {
+            sha_text_reg[i] = block[i];
+        }
+        asm volatile ("memw");
+
+        words_hashed += BLOCK_WORDS;
+        if (words_hashed == BLOCK_WORDS) {
+            REG_WRITE(SHA_256_START_REG, 1);
+        } else {
+            REG_WRITE(SHA_256_CONTINUE_REG, 1);
+        }
+        w += BLOCK_WORDS;
+        word_len -= BLOCK_WORDS;
+    }
+
+    /* Any tail is left in the engine's text buffer for the next call */
+    for (int i = 0; i < word_len; i++) {
+        xor ^= w[i];
+    }
+    bootloader_sha256_data(handle, w, word_len * 4);
+
+    *checksum ^= xor;
+}
+
 void bootloader_sha256_finish(bootloader_sha256_handle_t handle, uint8_t *digest)
 {
     assert(handle != NULL);
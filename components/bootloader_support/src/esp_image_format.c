@@ -34,6 +34,13 @@ static const char *TAG = "esp_image";
 /* Headroom to ensure between stack SP (at time of checking) and data loaded from flash */
 #define STACK_LOAD_HEADROOM 32768
 
+/* SHA_CHUNK determined experimentally as the optimum size
+   to call bootloader_sha256_data() with. This is a bit
+   counter-intuitive, but it's ~3ms better than using the
+   SHA256 block size.
+*/
+#define SHA_CHUNK 1024
+
 #ifdef BOOTLOADER_BUILD
 /* 64 bits of random data to obfuscate loaded RAM with, until verification is complete
    (Means loaded code isn't executable until after the secure boot check.)
@@ -46,12 +53,16 @@ static bool should_load(uint32_t load_addr);
 /* Return true if load_addr is an address the bootloader should map via flash cache */
 static bool should_map(uint32_t load_addr);
 
-/* Load or verify a segment */
+/* Load or verify a segment. If checksum is NULL the image is already known to be valid,
+   so segment data is only read if it needs to be loaded. */
 static esp_err_t process_segment(int index, uint32_t flash_addr, esp_image_segment_header_t *header, bool silent, bool do_load, bootloader_sha256_handle_t sha_handle, uint32_t *checksum);
 
 /* Verify the main image header */
 static esp_err_t verify_image_header(uint32_t src_addr, const esp_image_header_t *image, bool silent);
 
+/* XOR a number of words into a checksum */
+static uint32_t checksum_words(const uint32_t *src, size_t count, uint32_t checksum);
+
 /* Verify a segment header */
 static esp_err_t verify_segment_header(int index, const esp_image_segment_header_t *segment, uint32_t segment_data_offs, bool silent);
 
@@ -69,6 +80,24 @@ static esp_err_t verify_checksum(bootloader_sha256_handle_t sha_handle, uint32_t
 static esp_err_t __attribute__((unused)) verify_secure_boot_signature(bootloader_sha256_handle_t sha_handle, esp_image_metadata_t *data);
 static esp_err_t __attribute__((unused)) verify_simple_hash(bootloader_sha256_handle_t sha_handle, esp_image_metadata_t *data);
 
+#ifdef CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE
+/* Marker written after an image with an appended SHA-256 digest, once the image has been fully verified */
+typedef struct {
+    uint32_t magic;
+    uint32_t image_len;
+    uint8_t digest[HASH_LEN - 8];   /* First bytes of the appended digest, ties the marker to this image */
+} verified_marker_t;
+
+_Static_assert(sizeof(verified_marker_t) == 32, "verified marker should be 32 bytes");
+
+#define VERIFIED_MARKER_MAGIC 0x56524649 /* "IFRV" */
+
+static bool image_marked_verified(const esp_partition_pos_t *part, esp_image_metadata_t *data);
+#endif
+
+/* Length of the image on flash, given the end address of the last segment */
+static uint32_t image_length(const esp_image_metadata_t *data, uint32_t end_addr);
+
 esp_err_t esp_image_load(esp_image_load_mode_t mode, const esp_partition_pos_t *part, esp_image_metadata_t *data)
 {
 #ifdef BOOTLOADER_BUILD
@@ -130,6 +159,26 @@ goto err;
                   data->start_addr, data->image.segment_count, ESP_IMAGE_MAX_SEGMENTS);
     }
 
+#ifdef CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE
+    /* Image was verified in full before, only load the segments which go to RAM */
+    if (do_load && image_marked_verified(part, data)) {
+        ESP_LOGI(TAG, "image at 0x%x was verified before, skipping hash", data->start_addr);
+        if (sha_handle != NULL) {
+            bootloader_sha256_finish(sha_handle, NULL);
+            sha_handle = NULL;
+        }
+        uint32_t next_addr = data->start_addr + sizeof(esp_image_header_t);
+        for (int i = 0; i < data->image.segment_count; i++) {
+            err = process_segment(i, next_addr, &data->segments[i], silent, do_load, NULL, NULL);
+            if (err != ESP_OK) {
+                goto err;
+            }
+            next_addr += sizeof(esp_image_segment_header_t) + data->segments[i].data_len;
+        }
+        return ESP_OK;
+    }
+#endif
+
     uint32_t next_addr = data->start_addr + sizeof(esp_image_header_t);
     for(int i = 0; i < data->image.segment_count; i++) {
         esp_image_segment_header_t *header = &data->segments[i];
@@ -189,6 +238,12 @@ goto err;
         goto err;
     }
 
+#ifdef CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE
+    if (do_load && !is_bootloader) {
+        esp_image_mark_verified(part, data);
+    }
+#endif
+
 #ifdef BOOTLOADER_BUILD
     if (do_load) { // Need to deobfuscate RAM
         for (int i = 0; i < data->image.segment_count; i++) {
@@ -295,6 +350,10 @@ static esp_err_t process_segment(int index, uint32_t flash_addr, esp_image_segme
         }
     }
 
+    if (checksum == NULL && !do_load) {
+        return ESP_OK; /* already verified, and nothing to load */
+    }
+
     const uint32_t *data = (const uint32_t *)bootloader_mmap(data_addr, data_len);
     if(!data) {
         ESP_LOGE(TAG, "bootloader_mmap(0x%x, 0x%x) failed",
@@ -302,35 +361,55 @@ static esp_err_t process_segment(int index, uint32_t flash_addr, esp_image_segme
         return ESP_FAIL;
     }
 
+    if (!do_load) {
+        if (sha_handle != NULL) {
+            /* Hash and checksum in one pass over the mapped data */
+            bootloader_sha256_data_checksum(sha_handle, data, data_len, checksum);
+        } else {
+            *checksum = checksum_words(data, data_len / 4, *checksum);
+        }
+        bootloader_munmap(data);
+        return ESP_OK;
+    }
+
 #ifdef BOOTLOADER_BUILD
     // Set up the obfuscation value to use for loading
     while (ram_obfs_value[0] == 0 || ram_obfs_value[1] == 0) {
         bootloader_fill_random(ram_obfs_value, sizeof(ram_obfs_value));
     }
     uint32_t *dest = (uint32_t *)load_addr;
-#endif
-
     const uint32_t *src = data;
-
-    for (int i = 0; i < data_len; i += 4) {
-        int w_i = i/4; // Word index
-        uint32_t w = src[w_i];
-        *checksum ^= w;
-#ifdef BOOTLOADER_BUILD
-        if (do_load) {
-            dest[w_i] = w ^ ((w_i & 1) ? ram_obfs_value[0] : ram_obfs_value[1]);
+    /* Loaded code can't run before it is verified, so obfuscate it with random data. Already verified images
+       are loaded as-is. */
+    const uint32_t obfs_odd = (checksum != NULL) ? ram_obfs_value[0] : 0;
+    const uint32_t obfs_even = (checksum != NULL) ? ram_obfs_value[1] : 0;
+    uint32_t xor = 0;
+    int w_i = 0;
+    const int words = data_len / 4;
+
+    for (int chunk = 0; chunk < words; chunk += SHA_CHUNK / 4) {
+        const int chunk_end = MIN(chunk + SHA_CHUNK / 4, words);
+        if (sha_handle != NULL) {
+            bootloader_sha256_data(sha_handle, &src[chunk], (chunk_end - chunk) * 4);
         }
-#endif
-        // SHA_CHUNK determined experimentally as the optimum size
-        // to call bootloader_sha256_data() with. This is a bit
-        // counter-intuitive, but it's ~3ms better than using the
-        // SHA256 block size.
-        const size_t SHA_CHUNK = 1024;
-        if (sha_handle != NULL && i % SHA_CHUNK == 0) {
-            bootloader_sha256_data(sha_handle, &src[w_i],
-                                   MIN(SHA_CHUNK, data_len - i));
+        // Segment lengths are word aligned and chunks start on even words, so copy in pairs
+        for (w_i = chunk; w_i + 1 < chunk_end; w_i += 2) {
+            uint32_t w0 = src[w_i];
+            uint32_t w1 = src[w_i + 1];
+            xor ^= w0 ^ w1;
+            dest[w_i] = w0 ^ obfs_even;
+            dest[w_i + 1] = w1 ^ obfs_odd;
+        }
+        if (w_i < chunk_end) {
+            uint32_t w = src[w_i];
+            xor ^= w;
+            dest[w_i] = w ^ obfs_even;
         }
     }
+    if (checksum != NULL) {
+        *checksum ^= xor;
+    }
+#endif
 
     bootloader_munmap(data);
 
@@ -343,6 +422,23 @@ static esp_err_t process_segment(int index, uint32_t flash_addr, esp_image_segme
     return err;
 }
 
+/* XOR 'count' words into 'checksum', four at a time */
+static uint32_t checksum_words(const uint32_t *src, size_t count, uint32_t checksum)
+{
+    uint32_t c0 = checksum, c1 = 0, c2 = 0, c3 = 0;
+    size_t i;
+    for (i = 0; i + 4 <= count; i += 4) {
+        c0 ^= src[i];
+        c1 ^= src[i + 1];
+        c2 ^= src[i + 2];
+        c3 ^= src[i + 3];
+    }
+    for (; i < count; i++) {
+        c0 ^= src[i];
+    }
+    return c0 ^ c1 ^ c2 ^ c3;
+}
+
 static esp_err_t verify_segment_header(int index, const esp_image_segment_header_t *segment, uint32_t segment_data_offs, bool silent)
 {
     if ((segment->data_len & 3) != 0
@@ -427,6 +523,17 @@ esp_err_t esp_image_verify_bootloader(uint32_t *length)
     return err;
 }
 
+static uint32_t image_length(const esp_image_metadata_t *data, uint32_t end_addr)
+{
+    uint32_t length = end_addr - data->start_addr + 1; // Add a byte for the checksum
+    length = (length + 15) & ~15; // Pad to next full 16 byte block
+    if (data->image.hash_appended) {
+        // Account for the hash in the total image length
+        length += HASH_LEN;
+    }
+    return length;
+}
+
 static esp_err_t verify_checksum(bootloader_sha256_handle_t sha_handle, uint32_t checksum_word, esp_image_metadata_t *data)
 {
     uint32_t unpadded_length = data->image_len;
@@ -449,15 +556,121 @@ static esp_err_t verify_checksum(bootloader_sha256_handle_t sha_handle, uint32_t
         bootloader_sha256_data(sha_handle, buf, length - unpadded_length);
     }
 
-    if (data->image.hash_appended) {
-        // Account for the hash in the total image length
-        length += HASH_LEN;
-    }
-    data->image_len = length;
+    data->image_len = image_length(data, data->start_addr + unpadded_length);
 
     return ESP_OK;
 }
 
+#ifdef CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE
+/* Marker lives in the 32 byte aligned block following the image */
+static uint32_t verified_marker_addr(const esp_image_metadata_t *data)
+{
+    return (data->start_addr + data->image_len + 31) & ~31;
+}
+
+/* Read the segment headers only, and check for a verified marker matching the image.
+   Fills in segment headers and image_len in 'data' */
+static bool image_marked_verified(const esp_partition_pos_t *part, esp_image_metadata_t *data)
+{
+    if (!data->image.hash_appended || esp_secure_boot_enabled()) {
+        return false;
+    }
+
+    uint32_t next_addr = data->start_addr + sizeof(esp_image_header_t);
+    for (int i = 0; i < data->image.segment_count; i++) {
+        esp_image_segment_header_t *header = &data->segments[i];
+        if (bootloader_flash_read(next_addr, header, sizeof(esp_image_segment_header_t), true) != ESP_OK) {
+            return false;
+        }
+        next_addr += sizeof(esp_image_segment_header_t);
+        if (verify_segment_header(i, header, next_addr, true) != ESP_OK) {
+            return false;
+        }
+        data->segment_data[i] = next_addr;
+        next_addr += header->data_len;
+        if (next_addr < data->start_addr || next_addr > part->offset + part->size) {
+            return false;
+        }
+    }
+    data->image_len = image_length(data, next_addr);
+
+    uint32_t marker_addr = verified_marker_addr(data);
+    if (marker_addr + sizeof(verified_marker_t) > part->offset + part->size) {
+        return false;
+    }
+
+    verified_marker_t marker;
+    uint8_t digest[HASH_LEN];
+    if (bootloader_flash_read(marker_addr, &marker, sizeof(marker), true) != ESP_OK
+        || bootloader_flash_read(data->start_addr + data->image_len - HASH_LEN, digest, HASH_LEN, true) != ESP_OK) {
+        return false;
+    }
+
+    return marker.magic == VERIFIED_MARKER_MAGIC
+        && marker.image_len == data->image_len
+        && memcmp(marker.digest, digest, sizeof(marker.digest)) == 0;
+}
+
+bool esp_image_is_marked_verified(const esp_partition_pos_t *part)
+{
+    if (part == NULL) {
+        return false;
+    }
+    esp_image_metadata_t data = { .start_addr = part->offset };
+    if (bootloader_flash_read(data.start_addr, &data.image, sizeof(esp_image_header_t), true) != ESP_OK
+        || data.image.magic != ESP_IMAGE_HEADER_MAGIC
+        || data.image.segment_count > ESP_IMAGE_MAX_SEGMENTS) {
+        return false;
+    }
+    return image_marked_verified(part, &data);
+}
+
+esp_err_t esp_image_mark_verified(const esp_partition_pos_t *part, const esp_image_metadata_t *data)
+{
+    if (part == NULL || data == NULL || data->image_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!data->image.hash_appended || esp_secure_boot_enabled()) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    uint32_t marker_addr = verified_marker_addr(data);
+    if (marker_addr + sizeof(verified_marker_t) > part->offset + part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    verified_marker_t marker;
+    esp_err_t err = bootloader_flash_read(marker_addr, &marker, sizeof(marker), true);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    verified_marker_t expected = {
+        .magic = VERIFIED_MARKER_MAGIC,
+        .image_len = data->image_len,
+    };
+    err = bootloader_flash_read(data->start_addr + data->image_len - HASH_LEN, expected.digest, sizeof(expected.digest), true);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (memcmp(&marker, &expected, sizeof(marker)) == 0) {
+        return ESP_OK; /* already marked */
+    }
+
+    /* Only write over erased flash, the space after the image may be in use for something else */
+    const uint8_t *marker_bytes = (const uint8_t *)&marker;
+    for (int i = 0; i < sizeof(marker); i++) {
+        if (marker_bytes[i] != 0xFF) {
+            ESP_LOGD(TAG, "no space for verified marker at 0x%x", marker_addr);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    ESP_LOGD(TAG, "marking image at 0x%x as verified", data->start_addr);
+    return bootloader_flash_write(marker_addr, &expected, sizeof(expected), false);
+}
+#endif // CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE
+
 static void debug_log_hash(const uint8_t *image_hash, const char *caption);
 
 static esp_err_t verify_secure_boot_signature(bootloader_sha256_handle_t sha_handle, esp_image_metadata_t *data)
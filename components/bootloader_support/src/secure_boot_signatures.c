@@ -20,6 +20,7 @@
 #include "esp_secure_boot.h"
 
 #include "uECC.h"
+#include "esp_uecc_verify.h"
 
 #ifdef BOOTLOADER_BUILD
 #include "rom/sha.h"
@@ -33,6 +34,11 @@ static const char* TAG = "secure_boot";
 extern const uint8_t signature_verification_key_start[] asm("_binary_signature_verification_key_bin_start");
 extern const uint8_t signature_verification_key_end[] asm("_binary_signature_verification_key_bin_end");
 
+#ifdef CONFIG_SECURE_BOOT_VERIFY_FAST
+extern const uint8_t signature_verification_table_start[] asm("_binary_signature_verification_key_table_bin_start");
+extern const uint8_t signature_verification_table_end[] asm("_binary_signature_verification_key_table_bin_end");
+#endif
+
 #define SIGNATURE_VERIFICATION_KEYLEN 64
 
 #define DIGEST_LEN 32
@@ -84,10 +90,24 @@ esp_err_t esp_secure_boot_verify_signature_block(const esp_secure_boot_sig_block
         return ESP_FAIL;
     }
 
+#ifdef CONFIG_SECURE_BOOT_VERIFY_FAST
+    ptrdiff_t tablelen = signature_verification_table_end - signature_verification_table_start;
+    if(tablelen != ESP_UECC_VERIFY_TABLE_LEN) {
+        ESP_LOGE(TAG, "Embedded verification key table has wrong length %d", tablelen);
+        return ESP_FAIL;
+    }
+
+    is_valid = esp_uecc_verify(signature_verification_key_start,
+                                signature_verification_table_start,
+                                image_digest,
+                                DIGEST_LEN,
+                                sig_block->signature);
+#else
     is_valid = uECC_verify(signature_verification_key_start,
                                 image_digest,
                                 DIGEST_LEN,
                                 sig_block->signature,
                                 uECC_secp256r1());
+#endif
     return is_valid ? ESP_OK : ESP_ERR_IMAGE_INVALID;
 }
@@ -4,6 +4,7 @@
 
 #include <esp_types.h>
 #include <stdio.h>
+#include <string.h>
 #include "rom/ets_sys.h"
 
 #include "freertos/FreeRTOS.h"
@@ -16,6 +17,9 @@
 #include "esp_partition.h"
 #include "esp_ota_ops.h"
 #include "esp_image_format.h"
+#include "esp_timer.h"
+#include "idf_performance.h"
+#include "mbedtls/sha256.h"
 
 TEST_CASE("Verify bootloader image in flash", "[bootloader_support]")
 {
@@ -47,3 +51,125 @@ TEST_CASE("Verify unit test app image", "[bootloader_support]")
     TEST_ASSERT_TRUE(data.image_len <= running->size);
 }
 
+
+TEST_CASE("Verify unit test app image performance", "[bootloader_support]")
+{
+    esp_image_metadata_t data = { 0 };
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    TEST_ASSERT_NOT_EQUAL(NULL, running);
+    const esp_partition_pos_t running_pos  = {
+        .offset = running->address,
+        .size = running->size,
+    };
+
+    int64_t start = esp_timer_get_time();
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_image_load(ESP_IMAGE_VERIFY, &running_pos, &data));
+    int64_t elapsed = esp_timer_get_time() - start;
+    IDF_LOG_PERFORMANCE("verify_app_image_us_per_kb", "%d", (int)(elapsed * 1024 / data.image_len));
+}
+
+#ifdef CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE
+
+#define TEST_IMAGE_DATA_LEN 64
+/* header, one segment, checksum padded to 16 bytes, SHA-256 */
+#define TEST_IMAGE_LEN (112 + 32)
+
+/* Write a minimal valid image with an appended digest to the start of 'part'.
+   Images with different 'seed' have the same length but different contents. */
+static void write_test_image(const esp_partition_t *part, uint8_t seed)
+{
+    uint8_t image[TEST_IMAGE_LEN] = { 0 };
+    esp_image_header_t *header = (esp_image_header_t *)image;
+    esp_image_segment_header_t *segment = (esp_image_segment_header_t *)(image + sizeof(esp_image_header_t));
+    uint8_t *segment_data = (uint8_t *)(segment + 1);
+
+    header->magic = ESP_IMAGE_HEADER_MAGIC;
+    header->segment_count = 1;
+    header->spi_size = ESP_IMAGE_FLASH_SIZE_2MB;
+    header->entry_addr = 0x40080000;
+    header->wp_pin = 0xEE;
+    header->hash_appended = 1;
+    segment->load_addr = 0x3FFB0000; /* DRAM, so no flash mapping alignment to satisfy */
+    segment->data_len = TEST_IMAGE_DATA_LEN;
+
+    uint32_t checksum_word = 0xEF;
+    for (int i = 0; i < TEST_IMAGE_DATA_LEN; i++) {
+        segment_data[i] = seed + i * 7;
+    }
+    for (int i = 0; i < TEST_IMAGE_DATA_LEN; i += 4) {
+        uint32_t w;
+        memcpy(&w, segment_data + i, 4);
+        checksum_word ^= w;
+    }
+    image[TEST_IMAGE_LEN - 32 - 1] = (checksum_word >> 24) ^ (checksum_word >> 16) ^ (checksum_word >> 8) ^ checksum_word;
+    mbedtls_sha256(image, TEST_IMAGE_LEN - 32, image + TEST_IMAGE_LEN - 32, 0);
+
+    TEST_ESP_OK(esp_partition_erase_range(part, 0, SPI_FLASH_SEC_SIZE));
+    TEST_ESP_OK(esp_partition_write(part, 0, image, sizeof(image)));
+}
+
+static const esp_partition_t *get_test_partition(esp_partition_pos_t *pos)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, NULL);
+    if (part == NULL || part == esp_ota_get_running_partition()) {
+        TEST_IGNORE_MESSAGE("no OTA 0 partition to write to, skipping verified marker test");
+    }
+    pos->offset = part->address;
+    pos->size = part->size;
+    return part;
+}
+
+TEST_CASE("Verified marker round trips", "[bootloader_support]")
+{
+    esp_partition_pos_t pos;
+    const esp_partition_t *part = get_test_partition(&pos);
+    esp_image_metadata_t data = { 0 };
+
+    write_test_image(part, 1);
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_image_load(ESP_IMAGE_VERIFY, &pos, &data));
+    TEST_ASSERT_EQUAL(TEST_IMAGE_LEN, data.image_len);
+    TEST_ASSERT_FALSE(esp_image_is_marked_verified(&pos));
+
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_image_mark_verified(&pos, &data));
+    TEST_ASSERT_TRUE(esp_image_is_marked_verified(&pos));
+    /* marking again is a no-op */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_image_mark_verified(&pos, &data));
+    TEST_ASSERT_TRUE(esp_image_is_marked_verified(&pos));
+
+    /* erasing the image (as an OTA update does) takes the marker with it */
+    TEST_ESP_OK(esp_partition_erase_range(part, 0, SPI_FLASH_SEC_SIZE));
+    TEST_ASSERT_FALSE(esp_image_is_marked_verified(&pos));
+}
+
+TEST_CASE("Verified marker of a different image is not trusted", "[bootloader_support]")
+{
+    esp_partition_pos_t pos;
+    const esp_partition_t *part = get_test_partition(&pos);
+    esp_image_metadata_t data = { 0 };
+    const size_t marker_offs = (TEST_IMAGE_LEN + 31) & ~31;
+    uint8_t marker[32];
+
+    write_test_image(part, 1);
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_image_load(ESP_IMAGE_VERIFY, &pos, &data));
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_image_mark_verified(&pos, &data));
+    TEST_ESP_OK(esp_partition_read(part, marker_offs, marker, sizeof(marker)));
+
+    /* a different image of the same length at the same address, with the old marker left after it */
+    write_test_image(part, 2);
+    TEST_ESP_OK(esp_partition_write(part, marker_offs, marker, sizeof(marker)));
+    TEST_ASSERT_FALSE(esp_image_is_marked_verified(&pos));
+    /* the stale marker isn't overwritten, so the image is verified in full every time */
+    TEST_ASSERT_EQUAL_HEX(ESP_OK, esp_image_load(ESP_IMAGE_VERIFY, &pos, &data));
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_INVALID_STATE, esp_image_mark_verified(&pos, &data));
+    TEST_ASSERT_FALSE(esp_image_is_marked_verified(&pos));
+
+    /* a marker with the right digest but the wrong length (image_len follows the magic word) */
+    write_test_image(part, 1);
+    marker[4] += 32;
+    TEST_ESP_OK(esp_partition_write(part, marker_offs, marker, sizeof(marker)));
+    TEST_ASSERT_FALSE(esp_image_is_marked_verified(&pos));
+
+    TEST_ESP_OK(esp_partition_erase_range(part, 0, SPI_FLASH_SEC_SIZE));
+}
+
+#endif // CONFIG_BOOTLOADER_VERIFY_IMAGE_ONCE
@@ -384,3 +384,60 @@ int esp_aes_crypt_ctr( esp_aes_context *ctx,
 
     return 0;
 }
+
+/*
+ * AES-GCM counter mode (GCTR) encryption/decryption
+ */
+int esp_aes_crypt_gctr( esp_aes_context *ctx,
+                        size_t length,
+                        unsigned char counter[16],
+                        unsigned char ectr0[16],
+                        const unsigned char *input,
+                        unsigned char *output )
+{
+    uint32_t ctr_words[4];
+    uint32_t stream_words[4];
+    unsigned char *ctr = (unsigned char *)ctr_words;
+    const unsigned char *stream = (const unsigned char *)stream_words;
+    uint32_t inc;
+    size_t i, use_len;
+
+    /* word aligned copies, as the hardware text registers are written and read by word */
+    memcpy(ctr_words, counter, 16);
+    inc = ((uint32_t)ctr[12] << 24) | ((uint32_t)ctr[13] << 16) | ((uint32_t)ctr[14] << 8) | ctr[15];
+
+    esp_aes_acquire_hardware();
+
+    esp_aes_setkey_hardware(ctx, ESP_AES_ENCRYPT);
+
+    if ( ectr0 != NULL ) {
+        esp_aes_block(ctr_words, stream_words);
+        memcpy(ectr0, stream_words, 16);
+    }
+
+    while ( length > 0 ) {
+        inc++;
+        ctr[12] = (unsigned char)(inc >> 24);
+        ctr[13] = (unsigned char)(inc >> 16);
+        ctr[14] = (unsigned char)(inc >> 8);
+        ctr[15] = (unsigned char)inc;
+
+        esp_aes_block(ctr_words, stream_words);
+
+        use_len = ( length < 16 ) ? length : 16;
+        for ( i = 0; i < use_len; i++ ) {
+            output[i] = input[i] ^ stream[i];
+        }
+
+        input += use_len;
+        output += use_len;
+        length -= use_len;
+    }
+
+    esp_aes_release_hardware();
+
+    memcpy(counter, ctr_words, 16);
+    bzero(stream_words, sizeof(stream_words));
+
+    return 0;
+}
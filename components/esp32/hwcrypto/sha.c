@@ -33,6 +33,7 @@
 
 #include "hwcrypto/sha.h"
 #include "rom/ets_sys.h"
+#include "freertos/FreeRTOS.h"
 #include "soc/dport_reg.h"
 #include "soc/hwcrypto_reg.h"
 
@@ -59,6 +60,8 @@ static _lock_t memory_block_lock;
 typedef struct {
     _lock_t lock;
     bool in_use;
+    esp_sha_digest_t *digest; /* digest whose state is loaded in the engine, if any */
+    esp_sha_stats_t stats;
 } sha_engine_state;
 
 /* Pointer to state of each concurrent SHA engine.
@@ -70,6 +73,14 @@ typedef struct {
 */
 static sha_engine_state engine_states[3];
 
+/* Protects the stats counters, software blocks are counted without holding any engine */
+static portMUX_TYPE stats_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+/* A digest only takes over an engine from another digest if it has at
+   least this many blocks of input pending. Below that the state read out
+   costs more than hashing the input in software. */
+#define SHA_HANDOVER_MIN_BLOCKS 4
+
 /* Index into the sha_engine_state array */
 inline static size_t sha_engine_index(esp_sha_type type) {
     switch(type) {
@@ -134,6 +145,8 @@ inline static bool sha_engines_all_idle() {
 }
 
 static void esp_sha_lock_engine_inner(sha_engine_state *engine);
+static void esp_sha_unlock_engine_inner(sha_engine_state *engine);
+static void esp_sha_evict_digest(sha_engine_state *engine);
 
 bool esp_sha_try_lock_engine(esp_sha_type sha_type)
 {
@@ -154,8 +167,15 @@ void esp_sha_lock_engine(esp_sha_type sha_type)
     esp_sha_lock_engine_inner(engine);
 }
 
+/* Call with engine->lock held. Exclusive users of the engine move any loaded digest off it. */
 static void esp_sha_lock_engine_inner(sha_engine_state *engine)
 {
+    if (engine->digest != NULL) {
+        /* engine is already enabled and in_use */
+        esp_sha_evict_digest(engine);
+        return;
+    }
+
     _lock_acquire(&state_change_lock);
 
     if (sha_engines_all_idle()) {
@@ -183,6 +203,14 @@ void esp_sha_unlock_engine(esp_sha_type sha_type)
 {
     sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
 
+    esp_sha_unlock_engine_inner(engine);
+
+    _lock_release(&engine->lock);
+}
+
+/* Call with engine->lock held */
+static void esp_sha_unlock_engine_inner(sha_engine_state *engine)
+{
     _lock_acquire(&state_change_lock);
 
     assert( engine->in_use && "in_use flag should be set" );
@@ -200,10 +228,127 @@ void esp_sha_unlock_engine(esp_sha_type sha_type)
     }
 
     _lock_release(&state_change_lock);
+}
+
+/* Call with engine->lock held and engine->digest set. Saves the digest
+   state to the digest's context, the digest continues in software. */
+static void esp_sha_evict_digest(sha_engine_state *engine)
+{
+    esp_sha_digest_t *digest = engine->digest;
+
+    /* SHA-384 interim state is the full SHA-512 state */
+    esp_sha_type read_type = (digest->type == SHA2_384) ? SHA2_512 : digest->type;
+    esp_sha_read_digest_state(read_type, digest->state);
+    digest->loaded = false;
+    engine->digest = NULL;
+
+    portENTER_CRITICAL(&stats_spinlock);
+    engine->stats.handovers++;
+    portEXIT_CRITICAL(&stats_spinlock);
+}
+
+bool esp_sha_digest_claim(esp_sha_digest_t *digest, esp_sha_type sha_type, void *state, size_t pending)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
+
+    _lock_acquire(&engine->lock);
+    if (engine->digest != NULL) {
+        if (pending <= engine->digest->weight
+            || pending < SHA_HANDOVER_MIN_BLOCKS * block_length(sha_type)) {
+            _lock_release(&engine->lock);
+            return false;
+        }
+        esp_sha_evict_digest(engine);
+    } else {
+        esp_sha_lock_engine_inner(engine);
+    }
+
+    digest->type = sha_type;
+    digest->state = state;
+    digest->weight = pending;
+    digest->loaded = true;
+    engine->digest = digest;
+    return true;
+}
+
+bool esp_sha_digest_begin(esp_sha_digest_t *digest, size_t pending)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(digest->type)];
+
+    /* Always take the lock before checking loaded, the eviction which clears
+       it also writes the saved state which the caller is about to use. */
+    _lock_acquire(&engine->lock);
+    if (!digest->loaded || engine->digest != digest) {
+        _lock_release(&engine->lock);
+        return false;
+    }
+    digest->weight = pending;
+    return true;
+}
 
+void esp_sha_digest_end(esp_sha_digest_t *digest)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(digest->type)];
+    _lock_release(&engine->lock);
+}
+
+void esp_sha_digest_release(esp_sha_digest_t *digest)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(digest->type)];
+
+    _lock_acquire(&engine->lock);
+    if (digest->loaded && engine->digest == digest) {
+        engine->digest = NULL;
+        esp_sha_unlock_engine_inner(engine);
+    }
+    digest->loaded = false;
+    _lock_release(&engine->lock);
+}
+
+void esp_sha_digest_forget(esp_sha_digest_t *digest, esp_sha_type sha_type)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
+
+    /* Only this digest's owner can make the engine point at it, so if it
+       doesn't already, it won't while we look */
+    if (engine->digest != digest) {
+        return;
+    }
+    _lock_acquire(&engine->lock);
+    if (engine->digest == digest) {
+        engine->digest = NULL;
+        esp_sha_unlock_engine_inner(engine);
+    }
     _lock_release(&engine->lock);
 }
 
+void esp_sha_count_software_blocks(esp_sha_type sha_type, size_t blocks)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
+
+    portENTER_CRITICAL(&stats_spinlock);
+    engine->stats.software_blocks += blocks;
+    portEXIT_CRITICAL(&stats_spinlock);
+}
+
+void esp_sha_get_stats(esp_sha_type sha_type, esp_sha_stats_t *stats)
+{
+    sha_engine_state *engine = &engine_states[sha_engine_index(sha_type)];
+
+    portENTER_CRITICAL(&stats_spinlock);
+    *stats = engine->stats;
+    portEXIT_CRITICAL(&stats_spinlock);
+}
+
+void esp_sha_reset_stats(void)
+{
+    portENTER_CRITICAL(&stats_spinlock);
+    for (int i = 0; i < sizeof(engine_states) / sizeof(engine_states[0]); i++) {
+        memset(&engine_states[i].stats, 0, sizeof(esp_sha_stats_t));
+    }
+    portEXIT_CRITICAL(&stats_spinlock);
+}
+
 void esp_sha_wait_idle(void)
 {
     DPORT_STALL_OTHER_CPU_START();
@@ -274,6 +419,10 @@ void esp_sha_block(esp_sha_type sha_type, const void *data_block, bool is_first_
 
     esp_sha_unlock_memory_block();
 
+    portENTER_CRITICAL(&stats_spinlock);
+    engine->stats.hardware_blocks++;
+    portEXIT_CRITICAL(&stats_spinlock);
+
     /* Note: deliberately not waiting for this operation to complete,
        as a performance tweak - delay waiting until the next time we need the SHA
        unit, instead.
@@ -299,6 +448,9 @@ void esp_sha(esp_sha_type sha_type, const unsigned char *input, size_t ilen, uns
         }
         DPORT_STALL_OTHER_CPU_END();
         esp_sha_unlock_memory_block();
+        portENTER_CRITICAL(&stats_spinlock);
+        engine_states[sha_engine_index(sha_type)].stats.hardware_blocks++;
+        portEXIT_CRITICAL(&stats_spinlock);
         input += chunk_len;
         ilen -= chunk_len;
     }
@@ -233,6 +233,35 @@ int esp_aes_crypt_ctr( esp_aes_context *ctx,
                        const unsigned char *input,
                        unsigned char *output );
 
+/**
+ * \brief               AES-GCM counter mode (GCTR) encryption/decryption
+ *
+ * Used by the GCM implementation. Differs from esp_aes_crypt_ctr() in that
+ * only the last 32 bits of the counter are incremented (wrapping, as GCM
+ * requires) and the counter is incremented before each block is encrypted.
+ * Any partial final block of keystream is discarded.
+ *
+ * The AES hardware is held for the whole buffer, so this runs with
+ * interrupts disabled on the calling CPU for roughly 1us per block.
+ *
+ * \param ctx           AES context
+ * \param length        The length of the data
+ * \param counter       The counter block. Updated to the last counter used.
+ * \param ectr0         If not NULL, the counter block is encrypted into
+ *                      this buffer before it is first incremented (GCM uses
+ *                      this to mask the tag).
+ * \param input         The input data stream
+ * \param output        The output data stream. May be the same as input.
+ *
+ * \return         0 if successful
+ */
+int esp_aes_crypt_gctr( esp_aes_context *ctx,
+                        size_t length,
+                        unsigned char counter[16],
+                        unsigned char ectr0[16],
+                        const unsigned char *input,
+                        unsigned char *output );
+
 
 /**
  * \brief           Internal AES block encryption function
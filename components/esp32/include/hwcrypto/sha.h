@@ -37,6 +37,12 @@
  *   engines, so all engines must be idle before this memory block is
  *   modified.
  *
+ * - Several digests can share one engine using the esp_sha_digest_xxx()
+ *   functions. The engine holds one digest at a time. When another digest
+ *   with a larger input is waiting, the state of the loaded digest is read
+ *   out and that digest continues in software, as the state can't be
+ *   restored into the engine.
+ *
  */
 
 #ifdef __cplusplus
@@ -46,6 +52,32 @@ extern "C" {
 /* Defined in rom/sha.h */
 typedef enum SHA_TYPE esp_sha_type;
 
+/**
+ * @brief A digest which shares a SHA engine with other digests
+ *
+ * Embed one in each digest context and zero initialise it, after calling
+ * esp_sha_digest_forget(). The fields are managed by the esp_sha_digest_xxx()
+ * functions. The engine keeps a pointer to a loaded digest, so call
+ * esp_sha_digest_release() before the digest's memory is released.
+ */
+typedef struct {
+    esp_sha_type type;      /*!< SHA algorithm of the digest */
+    void *state;            /*!< Where to save the digest state when the digest is moved off the engine */
+    size_t weight;          /*!< Input length of the digest's latest update, a larger pending input takes the engine over */
+    volatile bool loaded;   /*!< The digest state is held by the engine */
+} esp_sha_digest_t;
+
+/**
+ * @brief Counters for one SHA engine
+ *
+ * SHA2_384 and SHA2_512 share an engine, and share counters.
+ */
+typedef struct {
+    uint32_t hardware_blocks;   /*!< Blocks calculated by the engine */
+    uint32_t software_blocks;   /*!< Blocks calculated in software, reported with esp_sha_count_software_blocks() */
+    uint32_t handovers;         /*!< Digests moved off the engine for another user */
+} esp_sha_stats_t;
+
 /** @brief Calculate SHA1 or SHA2 sum of some data, using hardware SHA engine
  *
  * @note For more versatile SHA calculations, where data doesn't need
@@ -56,9 +88,8 @@ typedef enum SHA_TYPE esp_sha_type;
  * @note It is not necessary to lock any SHA hardware before calling
  * this function, thread safety is managed internally.
  *
- * @note If a TLS connection is open then this function may block
- * indefinitely waiting for a SHA engine to become available. Use the
- * mbedTLS SHA API to avoid this problem.
+ * @note If an mbedTLS digest is loaded in the SHA engine, it is moved
+ * to software to make way for this function.
  *
  * @param sha_type SHA algorithm to use.
  *
@@ -130,9 +161,9 @@ void esp_sha_read_digest_state(esp_sha_type sha_type, void *digest_state);
  *
  * @param sha_type Type of SHA engine to use.
  *
- * Blocks until engine is available. Note: Can block indefinitely
- * while a TLS connection is open, suggest using
- * esp_sha_try_lock_engine() and failing over to software SHA.
+ * Blocks until engine is available. A digest loaded with
+ * esp_sha_digest_claim() is moved off the engine, and continues in
+ * software.
  */
 void esp_sha_lock_engine(esp_sha_type sha_type);
 
@@ -155,6 +186,100 @@ bool esp_sha_try_lock_engine(esp_sha_type sha_type);
  */
 void esp_sha_unlock_engine(esp_sha_type sha_type);
 
+/**
+ * @brief Load a new digest into a SHA engine
+ *
+ * The digest gets the engine if it is free, or if the digest already loaded
+ * in the engine had a smaller latest update than the pending input of this
+ * one. In the second case the state of the other digest is saved to its
+ * state buffer and the other digest continues in software.
+ *
+ * Call esp_sha_block() with is_first_block set for the first block.
+ *
+ * @param digest Digest to load, must not be loaded already.
+ *
+ * @param sha_type SHA algorithm of the digest.
+ *
+ * @param state Where to save the digest state if it's moved off the engine
+ * (20 bytes for SHA1, 32 bytes for SHA2_256, 64 bytes for SHA2_384 and SHA2_512,
+ * in the format of esp_sha_read_digest_state()).
+ *
+ * @param pending Length of the input which is about to be digested.
+ *
+ * @return true if the digest is loaded. The engine is locked for the caller,
+ * call esp_sha_digest_end() after the blocks of this input. false if the
+ * engine is busy with a more deserving digest, use software for this digest.
+ */
+bool esp_sha_digest_claim(esp_sha_digest_t *digest, esp_sha_type sha_type, void *state, size_t pending);
+
+/**
+ * @brief Lock the engine for a digest loaded with esp_sha_digest_claim()
+ *
+ * @param digest Digest to continue.
+ *
+ * @param pending Length of the input which is about to be digested.
+ *
+ * @return true if the digest is still loaded in the engine, which is locked
+ * for the caller until esp_sha_digest_end(). false if the digest was moved off
+ * the engine, its state buffer holds the digest state so far.
+ */
+bool esp_sha_digest_begin(esp_sha_digest_t *digest, size_t pending);
+
+/**
+ * @brief Unlock the engine after esp_sha_digest_claim() or esp_sha_digest_begin() returned true
+ *
+ * The digest stays loaded.
+ *
+ * @param digest Digest which was locked.
+ */
+void esp_sha_digest_end(esp_sha_digest_t *digest);
+
+/**
+ * @brief Unload a digest from its engine, if it's still loaded
+ *
+ * Call when the digest is finished or abandoned. Safe to call for a digest
+ * which was moved off the engine.
+ *
+ * @param digest Digest to unload.
+ */
+void esp_sha_digest_release(esp_sha_digest_t *digest);
+
+/**
+ * @brief Drop any reference the engine holds to a digest, without saving its state
+ *
+ * Call before (re)initialising the memory of a digest. Unlike
+ * esp_sha_digest_release() this doesn't read the digest, so it's safe for
+ * uninitialised memory.
+ *
+ * @param digest Digest about to be overwritten.
+ *
+ * @param sha_type SHA algorithm the digest's context is for.
+ */
+void esp_sha_digest_forget(esp_sha_digest_t *digest, esp_sha_type sha_type);
+
+/**
+ * @brief Count blocks calculated in software, for esp_sha_get_stats()
+ *
+ * @param sha_type SHA algorithm of the blocks.
+ *
+ * @param blocks Number of blocks.
+ */
+void esp_sha_count_software_blocks(esp_sha_type sha_type, size_t blocks);
+
+/**
+ * @brief Read the counters of the engine for a SHA algorithm
+ *
+ * @param sha_type SHA algorithm.
+ *
+ * @param stats Filled with the counters.
+ */
+void esp_sha_get_stats(esp_sha_type sha_type, esp_sha_stats_t *stats);
+
+/**
+ * @brief Reset the counters of all SHA engines
+ */
+void esp_sha_reset_stats(void);
+
 /**
  * @brief Acquire exclusive access to the SHA shared memory block at SHA_TEXT_BASE
  *
@@ -110,6 +110,9 @@ struct emac_close_cmd {
 #define DMA_RX_BUF_SIZE 1600
 #define DMA_TX_BUF_SIZE 1600
 
+//tx segments shorter than this are copied rather than given a descriptor of their own
+#define DMA_TX_ZERO_COPY_MIN 128
+
 //rest buf num
 #define FLOW_CONTROL_HIGH_WATERMARK 3
 //used buf num
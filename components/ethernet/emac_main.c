@@ -26,6 +26,7 @@
 #include "soc/emac_ex_reg.h"
 #include "soc/emac_reg_v2.h"
 #include "soc/soc.h"
+#include "soc/soc_memory_layout.h"
 
 #include "tcpip_adapter.h"
 #include "sdkconfig.h"
@@ -63,6 +64,12 @@ static uint8_t emac_dma_tx_chain_buf[sizeof(struct dma_extended_desc) * DMA_TX_B
 static uint8_t emac_dma_rx_buf[DMA_RX_BUF_SIZE * DMA_RX_BUF_NUM];
 static uint8_t emac_dma_tx_buf[DMA_TX_BUF_SIZE * DMA_TX_BUF_NUM];
 
+//frames still referenced by the tx chain, indexed by the last descriptor of each frame
+static struct {
+    eth_tx_free_func free_cb;
+    void *ctx;
+} emac_tx_pending[DMA_TX_BUF_NUM];
+
 static SemaphoreHandle_t emac_g_sem;
 static portMUX_TYPE g_emac_mux = portMUX_INITIALIZER_UNLOCKED;
 static xTaskHandle emac_task_hdl;
@@ -73,6 +80,7 @@ static SemaphoreHandle_t emac_rx_xMutex = NULL;
 static SemaphoreHandle_t emac_tx_xMutex = NULL;
 static const char *TAG = "emac";
 static bool pause_send = false;
+static eth_rx_stats_t emac_rx_stats;
 #ifdef CONFIG_PM_ENABLE
 static esp_pm_lock_handle_t s_pm_lock;
 #endif
@@ -100,11 +108,10 @@ esp_err_t esp_eth_set_mac(const uint8_t mac[6])
     }
 }
 
-static void emac_setup_tx_desc(struct dma_extended_desc *tx_desc , uint32_t size)
+static void emac_setup_tx_desc(struct dma_extended_desc *tx_desc , uint32_t size, uint32_t flags)
 {
     tx_desc->basic.desc1 = size & 0xfff;
-    tx_desc->basic.desc0 = EMAC_DESC_INT_COMPL | EMAC_DESC_LAST_SEGMENT | EMAC_DESC_FIRST_SEGMENT | EMAC_DESC_SECOND_ADDR_CHAIN;
-    tx_desc->basic.desc0 = EMAC_DESC_TX_OWN | EMAC_DESC_INT_COMPL | EMAC_DESC_LAST_SEGMENT | EMAC_DESC_FIRST_SEGMENT | EMAC_DESC_SECOND_ADDR_CHAIN;
+    tx_desc->basic.desc0 = flags | EMAC_DESC_SECOND_ADDR_CHAIN;
 }
 
 static void emac_clean_tx_desc(struct dma_extended_desc *tx_desc)
@@ -113,6 +120,26 @@ static void emac_clean_tx_desc(struct dma_extended_desc *tx_desc)
     tx_desc->basic.desc0 = 0;
 }
 
+static uint8_t *emac_tx_copy_buf(uint32_t index)
+{
+    return &emac_dma_tx_buf[index * DMA_TX_BUF_SIZE];
+}
+
+/* Hand a transmitted descriptor back to the driver, pointing at its own buffer again,
+   and release the frame if this descriptor ended one */
+static void emac_release_tx_desc(uint32_t index)
+{
+    eth_tx_free_func free_cb = emac_tx_pending[index].free_cb;
+
+    emac_clean_tx_desc(&(emac_config.dma_etx[index]));
+    emac_config.dma_etx[index].basic.desc2 = (uint32_t)emac_tx_copy_buf(index);
+
+    if (free_cb != NULL) {
+        emac_tx_pending[index].free_cb = NULL;
+        free_cb(emac_tx_pending[index].ctx);
+    }
+}
+
 static void emac_clean_rx_desc(struct dma_extended_desc *rx_desc , uint32_t buf_ptr)
 {
     if (buf_ptr != 0) {
@@ -153,6 +180,14 @@ static void emac_set_rx_base_reg(void)
 */
 static void emac_reset_dma_chain(void)
 {
+    xSemaphoreTakeRecursive( emac_tx_xMutex, ( TickType_t ) portMAX_DELAY );
+    while (emac_config.cnt_tx > 0) {
+        emac_release_tx_desc(emac_config.dirty_tx);
+        emac_config.dirty_tx = (emac_config.dirty_tx + 1) % DMA_TX_BUF_NUM;
+        emac_config.cnt_tx --;
+    }
+    xSemaphoreGiveRecursive( emac_tx_xMutex );
+
     emac_config.cnt_tx = 0;
     emac_config.cur_tx = 0;
     emac_config.dirty_tx = 0;
@@ -371,7 +406,11 @@ static void emac_process_tx(void)
     xSemaphoreTakeRecursive( emac_tx_xMutex, ( TickType_t ) portMAX_DELAY );
 
     while (((uint32_t) & (emac_config.dma_etx[emac_config.dirty_tx].basic.desc0) != cur_tx_desc)) {
-        emac_clean_tx_desc(&(emac_config.dma_etx[emac_config.dirty_tx]));
+        //the dma may be part way through a multi descriptor frame
+        if (emac_config.dma_etx[emac_config.dirty_tx].basic.desc0 & EMAC_DESC_TX_OWN) {
+            break;
+        }
+        emac_release_tx_desc(emac_config.dirty_tx);
         emac_config.dirty_tx = (emac_config.dirty_tx + 1) % DMA_TX_BUF_NUM;
         emac_config.cnt_tx --;
 
@@ -421,6 +460,70 @@ static uint32_t IRAM_ATTR emac_get_rxbuf_count_in_intr(void)
     return cnt;
 }
 
+/*
+ * RX is polled once the first frame is in: the interrupt handler masks RX interrupts and
+ * each pass of emac_process_rx() hands up to CONFIG_EMAC_RX_POLL_BUDGET frames to the stack.
+ * A pass that uses its whole budget queues another one behind any other pending events,
+ * with interrupts still masked. The interrupt is re-armed once a pass finds nothing more;
+ * a frame arriving after that sets the (masked) RX status and interrupts straight away.
+ */
+static void emac_rx_poll_done(uint32_t handled)
+{
+    bool repoll = false;
+
+    portENTER_CRITICAL(&g_emac_mux);
+    if (handled > 0) {
+        uint32_t bucket = 31 - __builtin_clz(handled);
+        emac_rx_stats.frames += handled;
+        emac_rx_stats.polls++;
+        emac_rx_stats.batch[bucket < ETH_RX_BATCH_BUCKETS ? bucket : ETH_RX_BATCH_BUCKETS - 1]++;
+    }
+    if (handled >= CONFIG_EMAC_RX_POLL_BUDGET) {
+        emac_rx_stats.budget_exhausted++;
+        //the interrupt is masked, so nothing else posts this signal
+        if (emac_sig_cnt[SIG_EMAC_RX_DONE] == 0) {
+            emac_sig_cnt[SIG_EMAC_RX_DONE]++;
+            repoll = true;
+        }
+    }
+    portEXIT_CRITICAL(&g_emac_mux);
+
+    if (repoll) {
+        emac_event_t evt = {
+            .sig = SIG_EMAC_RX_DONE,
+            .par = 0,
+        };
+        if (xQueueSend(emac_xqueue, &evt, 0) == pdTRUE) {
+            return;
+        }
+        portENTER_CRITICAL(&g_emac_mux);
+        emac_sig_cnt[SIG_EMAC_RX_DONE]--;
+        portEXIT_CRITICAL(&g_emac_mux);
+    }
+    emac_enable_rx_intr();
+}
+
+esp_err_t esp_eth_get_rx_stats(eth_rx_stats_t *stats, bool reset)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&g_emac_mux);
+    if (emac_config.emac_status == EMAC_RUNTIME_START) {
+        //clears on read
+        uint32_t missed = REG_READ(EMAC_DMAMISSEDFR_REG);
+        emac_rx_stats.missed += missed & EMAC_MISSED_FRAME_COUNTER;
+        emac_rx_stats.overflow += (missed >> EMAC_OVERFLOW_FRAME_COUNTER_S) & EMAC_OVERFLOW_FRAME_COUNTER;
+    }
+    *stats = emac_rx_stats;
+    if (reset) {
+        memset(&emac_rx_stats, 0, sizeof(emac_rx_stats));
+    }
+    portEXIT_CRITICAL(&g_emac_mux);
+    return ESP_OK;
+}
+
 #if CONFIG_EMAC_L2_TO_L3_RX_BUF_MODE
 static void emac_process_rx(void)
 {
@@ -428,8 +531,10 @@ static void emac_process_rx(void)
         return;
     }
     uint32_t cur_rx_desc = emac_read_rx_cur_reg();
+    uint32_t handled = 0;
 
-    while (((uint32_t) & (emac_config.dma_erx[emac_config.dirty_rx].basic.desc0) != cur_rx_desc)) {
+    while (((uint32_t) & (emac_config.dma_erx[emac_config.dirty_rx].basic.desc0) != cur_rx_desc) && handled < CONFIG_EMAC_RX_POLL_BUDGET) {
+        handled++;
         //copy data to lwip
         emac_config.emac_tcpip_input((void *)(emac_config.dma_erx[emac_config.dirty_rx].basic.desc2),
                                      (((emac_config.dma_erx[emac_config.dirty_rx].basic.desc0) >> EMAC_DESC_FRAME_LENGTH_S) & EMAC_DESC_FRAME_LENGTH) , NULL);
@@ -441,7 +546,7 @@ static void emac_process_rx(void)
         cur_rx_desc = emac_read_rx_cur_reg();
     }
 
-    emac_enable_rx_intr();
+    emac_rx_poll_done(handled);
 }
 
 static void emac_process_rx_unavail(void)
@@ -450,6 +555,10 @@ static void emac_process_rx_unavail(void)
         return;
     }
 
+    portENTER_CRITICAL(&g_emac_mux);
+    emac_rx_stats.buf_unavail++;
+    portEXIT_CRITICAL(&g_emac_mux);
+
     uint32_t dirty_cnt = 0;
     while (dirty_cnt < DMA_RX_BUF_NUM) {
 
@@ -477,6 +586,10 @@ static void emac_process_rx_unavail(void)
         return;
     }
 
+    portENTER_CRITICAL(&g_emac_mux);
+    emac_rx_stats.buf_unavail++;
+    portEXIT_CRITICAL(&g_emac_mux);
+
     xSemaphoreTakeRecursive( emac_rx_xMutex, ( TickType_t ) portMAX_DELAY );
 
     while (emac_config.cnt_rx < DMA_RX_BUF_NUM) {
@@ -509,12 +622,15 @@ static void emac_process_rx(void)
     }
 
     uint32_t cur_rx_desc = emac_read_rx_cur_reg();
+    uint32_t handled = 0;
 
     xSemaphoreTakeRecursive( emac_rx_xMutex, ( TickType_t ) portMAX_DELAY );
 
     if (((uint32_t) & (emac_config.dma_erx[emac_config.dirty_rx].basic.desc0) != cur_rx_desc)) {
 
-        while (((uint32_t) & (emac_config.dma_erx[emac_config.dirty_rx].basic.desc0) != cur_rx_desc) && emac_config.cnt_rx < DMA_RX_BUF_NUM ) {
+        while (((uint32_t) & (emac_config.dma_erx[emac_config.dirty_rx].basic.desc0) != cur_rx_desc) && emac_config.cnt_rx < DMA_RX_BUF_NUM
+                && handled < CONFIG_EMAC_RX_POLL_BUDGET) {
+            handled++;
             emac_config.cnt_rx++;
             if (emac_config.cnt_rx > DMA_RX_BUF_NUM ) {
                 ESP_LOGE(TAG, "emac rx buf err!!\n");
@@ -532,12 +648,13 @@ static void emac_process_rx(void)
     } else {
         if (emac_config.cnt_rx < DMA_RX_BUF_NUM) {
             if ((emac_config.dma_erx[emac_config.dirty_rx].basic.desc0 & EMAC_DESC_RX_OWN) == 0) {
-                while (emac_config.cnt_rx < DMA_RX_BUF_NUM) {
+                while (emac_config.cnt_rx < DMA_RX_BUF_NUM && handled < CONFIG_EMAC_RX_POLL_BUDGET) {
 
                     if (emac_config.dma_erx[emac_config.dirty_rx].basic.desc0 == EMAC_DESC_RX_OWN) {
                         break;
                     }
 
+                    handled++;
                     emac_config.cnt_rx++;
                     if (emac_config.cnt_rx > DMA_RX_BUF_NUM) {
                         ESP_LOGE(TAG, "emac rx buf err!!!\n");
@@ -553,7 +670,7 @@ static void emac_process_rx(void)
             }
         }
     }
-    emac_enable_rx_intr();
+    emac_rx_poll_done(handled);
     xSemaphoreGiveRecursive( emac_rx_xMutex );
 }
 #endif
@@ -663,38 +780,137 @@ static void emac_hw_init(void)
     //ipc TODO
 }
 
-esp_err_t esp_eth_tx(uint8_t *buf, uint16_t size)
+static bool emac_tx_seg_zero_copy(const eth_tx_seg_t *seg)
+{
+    return !seg->copy && seg->len >= DMA_TX_ZERO_COPY_MIN && esp_ptr_dma_capable(seg->buf)
+           && esp_ptr_dma_capable((const uint8_t *)seg->buf + seg->len - 1);
+}
+
+/* Each zero copy segment takes a descriptor, each run of copied segments shares one */
+static int emac_tx_desc_count(const eth_tx_seg_t *segs, int seg_num, bool zero_copy)
+{
+    int count = 0;
+    bool copying = false;
+
+    for (int i = 0; i < seg_num; i++) {
+        if (segs[i].len == 0) {
+            continue;
+        }
+        if (zero_copy && emac_tx_seg_zero_copy(&segs[i])) {
+            count++;
+            copying = false;
+        } else if (!copying) {
+            count++;
+            copying = true;
+        }
+    }
+    return count;
+}
+
+esp_err_t esp_eth_tx_chain(const eth_tx_seg_t *segs, int seg_num, eth_tx_free_func free_cb, void *ctx)
 {
     esp_err_t ret = ESP_OK;
+    bool zero_copy = (free_cb != NULL);
+    bool copying = false;
+    bool referenced = false;
+    struct dma_extended_desc *first = NULL;
+    struct dma_extended_desc *desc = NULL;
+    uint32_t index = 0;
+    uint32_t desc_len = 0;
+    uint32_t total = 0;
+    int needed;
 
     if (emac_config.emac_status != EMAC_RUNTIME_START || emac_config.emac_status == EMAC_RUNTIME_NOT_INIT) {
         ESP_LOGI(TAG, "tx netif close");
-        ret = ERR_IF;
-        return ret;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (int i = 0; i < seg_num; i++) {
+        total += segs[i].len;
+    }
+    if (total > DMA_TX_BUF_SIZE) {
+        ESP_LOGD(TAG, "tx frame too long %u", total);
+        return ESP_ERR_INVALID_SIZE;
     }
 
     xSemaphoreTakeRecursive( emac_tx_xMutex, ( TickType_t ) portMAX_DELAY );
-    if (emac_config.cnt_tx == DMA_TX_BUF_NUM - 1) {
+
+    needed = emac_tx_desc_count(segs, seg_num, zero_copy);
+    if (needed > DMA_TX_BUF_NUM - 1) {
+        //too fragmented to ever fit in the chain, send it as one copied descriptor
+        zero_copy = false;
+        needed = 1;
+    }
+    if (emac_config.cnt_tx + needed > DMA_TX_BUF_NUM - 1) {
         ESP_LOGD(TAG, "tx buf full");
-        ret = ERR_MEM;
+        ret = ESP_ERR_NO_MEM;
         goto _exit;
     }
 
-    memcpy((uint8_t *)(emac_config.dma_etx[emac_config.cur_tx].basic.desc2), (uint8_t *)buf, size);
+    for (int i = 0; i < seg_num; i++) {
+        bool seg_zero_copy = zero_copy && emac_tx_seg_zero_copy(&segs[i]);
 
-    emac_setup_tx_desc(&(emac_config.dma_etx[emac_config.cur_tx]), size);
+        if (segs[i].len == 0) {
+            continue;
+        }
+        if (seg_zero_copy || !copying) {
+            //every descriptor but the first is handed to the dma as soon as it is complete
+            if (desc != NULL) {
+                emac_setup_tx_desc(desc, desc_len, desc == first ? EMAC_DESC_FIRST_SEGMENT : EMAC_DESC_TX_OWN);
+            }
+            index = emac_config.cur_tx;
+            desc = &(emac_config.dma_etx[index]);
+            if (first == NULL) {
+                first = desc;
+            }
+            desc->basic.desc2 = seg_zero_copy ? (uint32_t)segs[i].buf : (uint32_t)emac_tx_copy_buf(index);
+            desc_len = 0;
+            copying = !seg_zero_copy;
 
-    emac_config.cnt_tx ++;
-    emac_config.cur_tx = (emac_config.cur_tx + 1) % DMA_TX_BUF_NUM ;
+            emac_config.cnt_tx ++;
+            emac_config.cur_tx = (emac_config.cur_tx + 1) % DMA_TX_BUF_NUM ;
+        }
+        if (seg_zero_copy) {
+            referenced = true;
+        } else {
+            memcpy(emac_tx_copy_buf(index) + desc_len, segs[i].buf, segs[i].len);
+        }
+        desc_len += segs[i].len;
+    }
+
+    if (desc == NULL) {
+        goto _exit;
+    }
+
+    emac_tx_pending[index].free_cb = referenced ? free_cb : NULL;
+    emac_tx_pending[index].ctx = ctx;
+    emac_setup_tx_desc(desc, desc_len, EMAC_DESC_INT_COMPL | EMAC_DESC_LAST_SEGMENT |
+                       (desc == first ? EMAC_DESC_FIRST_SEGMENT : EMAC_DESC_TX_OWN));
+    //the dma may start as soon as the first descriptor is owned, so that goes last
+    first->basic.desc0 |= EMAC_DESC_TX_OWN;
 
     emac_poll_tx_cmd();
 
 _exit:
 
     xSemaphoreGiveRecursive( emac_tx_xMutex );
+
+    if (ret == ESP_OK && !referenced && free_cb != NULL) {
+        free_cb(ctx);
+    }
     return ret;
 }
 
+esp_err_t esp_eth_tx(uint8_t *buf, uint16_t size)
+{
+    eth_tx_seg_t seg = {
+        .buf = buf,
+        .len = size,
+    };
+
+    return esp_eth_tx_chain(&seg, 1, NULL, NULL);
+}
+
 static void emac_init_default_data(void)
 {
     memset((uint8_t *)&emac_config, 0, sizeof(struct emac_config_data));
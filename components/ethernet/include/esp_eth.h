@@ -89,6 +89,32 @@ typedef esp_err_t (*eth_tcpip_input_func)(void *buffer, uint16_t len, void *eb);
 typedef void (*eth_gpio_config_func)(void);
 typedef bool (*eth_phy_get_partner_pause_enable_func)(void);
 typedef void (*eth_phy_power_enable_func)(bool enable);
+typedef void (*eth_tx_free_func)(void *ctx);
+
+/** Number of buckets in eth_rx_stats_t::batch */
+#define ETH_RX_BATCH_BUCKETS 6
+
+/**
+ * @brief Receive path counters, see esp_eth_get_rx_stats()
+ */
+typedef struct {
+    uint32_t frames;            /*!< frames handed to the TCP/IP stack */
+    uint32_t polls;             /*!< RX poll passes which found at least one frame */
+    uint32_t budget_exhausted;  /*!< poll passes which used all of CONFIG_EMAC_RX_POLL_BUDGET */
+    uint32_t batch[ETH_RX_BATCH_BUCKETS]; /*!< frames per poll pass: bucket i counts passes with 2^i to 2^(i+1)-1 frames, the last bucket all larger ones */
+    uint32_t buf_unavail;       /*!< times the DMA found no free RX descriptor */
+    uint32_t missed;            /*!< frames dropped by the DMA for lack of RX descriptors */
+    uint32_t overflow;          /*!< frames dropped by the MAC due to RX FIFO overflow */
+} eth_rx_stats_t;
+
+/**
+ * @brief One contiguous piece of an outgoing frame, see esp_eth_tx_chain()
+ */
+typedef struct {
+    const void *buf;    /*!< start address of the segment */
+    uint16_t len;       /*!< length of the segment in bytes */
+    bool copy;          /*!< buffer may change once esp_eth_tx_chain() returns, always copy it */
+} eth_tx_seg_t;
 
 /**
  * @brief ethernet configuration
@@ -152,11 +178,51 @@ esp_err_t esp_eth_init_internal(eth_config_t *config);
  *
  * @param[in] size:  size (byte) of packet data.
  *
+ * @return As esp_eth_tx_chain()
+ */
+esp_err_t esp_eth_tx(uint8_t *buf, uint16_t size);
+
+/**
+ * @brief  Send a frame made up of several segments without copying it
+ *
+ * Segments in DMA capable memory are handed to the EMAC DMA as they are, so they must
+ * stay valid and unmodified until free_cb is called. Short segments, segments marked
+ * 'copy', and segments outside DMA capable memory (PSRAM, flash), are copied into the
+ * driver's own buffers.
+ *
+ * @note   free_cb is called from the emac task once the frame has been transmitted, or
+ *         before returning if no segment needed to be kept. It is not called on error.
+ *
+ * @param[in] segs:  segments of the frame, in order. Total length must be less than 1580.
+ *
+ * @param[in] seg_num:  number of segments
+ *
+ * @param[in] free_cb:  called once the segments are no longer needed. If NULL, all segments are copied.
+ *
+ * @param[in] ctx:  argument for free_cb
+ *
  * @return
  *      - ESP_OK
- *      - ESP_FAIL
+ *      - ESP_ERR_INVALID_STATE if the EMAC is not started
+ *      - ESP_ERR_INVALID_SIZE if the frame is too long
+ *      - ESP_ERR_NO_MEM if there are not enough free TX descriptors
  */
-esp_err_t esp_eth_tx(uint8_t *buf, uint16_t size);
+esp_err_t esp_eth_tx_chain(const eth_tx_seg_t *segs, int seg_num, eth_tx_free_func free_cb, void *ctx);
+
+/**
+ * @brief  Get receive path counters
+ *
+ * @note   Frames dropped by the TCP/IP stack are counted in its own link statistics.
+ *
+ * @param[out] stats:  counters since the interface was initialized or last reset
+ *
+ * @param[in] reset:  reset the counters after reading them
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG if stats is NULL
+ */
+esp_err_t esp_eth_get_rx_stats(eth_rx_stats_t *stats, bool reset);
 
 /**
  * @brief  Enable ethernet interface
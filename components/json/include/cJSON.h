@@ -80,6 +80,17 @@ typedef struct cJSON_Hooks
 
 typedef int cJSON_bool;
 
+/* Memory for cJSON_ParseWithArena and cJSON_ParseInPlace. All items and strings of a parse come
+ * from one caller supplied buffer and/or a chain of blocks allocated with the hooks as it fills up. */
+typedef struct cJSON_Arena
+{
+    unsigned char *buffer; /* block items are currently allocated from */
+    size_t size;
+    size_t offset;
+    size_t block_size; /* size of the blocks allocated when the buffer is full, 0 to never allocate */
+    void *blocks; /* allocated blocks, released by cJSON_FreeArena */
+} cJSON_Arena;
+
 #if !defined(__WINDOWS__) && (defined(WIN32) || defined(WIN64) || defined(_MSC_VER) || defined(_WIN32))
 #define __WINDOWS__
 #endif
@@ -142,18 +153,61 @@ CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value);
 /* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error so will match cJSON_GetErrorPtr(). */
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 
+/* Set up an arena. buffer (may be NULL) is used first; when it is full, blocks of block_size bytes are allocated with the hooks. */
+CJSON_PUBLIC(void) cJSON_InitArena(cJSON_Arena *arena, void *buffer, size_t size, size_t block_size);
+/* Release all items parsed into the arena in one go. Call cJSON_InitArena again before reusing it. */
+CJSON_PUBLIC(void) cJSON_FreeArena(cJSON_Arena *arena);
+/* Parse with every item and string allocated from the arena. The result must not be passed to cJSON_Delete,
+ * and items from the heap must not be added to it (they would not be released by cJSON_FreeArena). */
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithArena(const char *value, cJSON_Arena *arena);
+/* As cJSON_ParseWithArena, but strings are unescaped in place in value and the items point into it, so value
+ * must outlive the result. The contents of value are undefined after this call, whether it succeeds or not. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInPlace(char *value, cJSON_Arena *arena);
+
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
 CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item);
 /* Render a cJSON entity to text using a buffered strategy. prebuffer is a guess at the final size. guessing well reduces reallocation. fmt=0 gives unformatted, =1 gives formatted */
 CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt);
+/* Receives printed JSON text from cJSON_PrintStreamed. Return 0 to abort printing. */
+typedef cJSON_bool (*cJSON_StreamWriter)(void *context, const char *data, size_t length);
+/* Render a cJSON entity to text, passing it to writer in pieces of at most length bytes as buffer fills up. Nothing is allocated.
+ * The buffer must be large enough for the longest (escaped) string or raw item plus the indentation when formatting.
+ * Returns 1 on success and 0 if an item didn't fit in the buffer or writer returned 0. */
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintStreamed(const cJSON *item, char *buffer, size_t length, cJSON_bool format, cJSON_StreamWriter writer, void *context);
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *c);
 
+/* Events reported by the streaming parser */
+typedef enum
+{
+    cJSON_StreamObjectStart,
+    cJSON_StreamObjectEnd,
+    cJSON_StreamArrayStart,
+    cJSON_StreamArrayEnd,
+    cJSON_StreamValue /* a null, false, true, number or string, see value->type */
+} cJSON_StreamEvent;
+
+/* Called by the streaming parser for every value and for the start and end of every object and array.
+ * key is the name of the value or container in the enclosing object, NULL in arrays, at the top level and for the end events.
+ * value is only set for cJSON_StreamValue. key and value are only valid during the call. Return 0 to abort parsing. */
+typedef cJSON_bool (*cJSON_StreamCallback)(void *context, cJSON_StreamEvent event, const char *key, const cJSON *value, size_t depth);
+
+typedef struct cJSON_StreamParser cJSON_StreamParser;
+
+/* Create a streaming parser. The input is fed in chunks of any size, without building a tree or keeping the document.
+ * Memory use is fixed at creation: no string or number (including quotes and escapes) may be longer than max_token bytes. */
+CJSON_PUBLIC(cJSON_StreamParser *) cJSON_CreateStreamParser(cJSON_StreamCallback callback, void *context, size_t max_token);
+/* Parse the next chunk of input. Returns 0 if the input is invalid or the callback aborted, then all further input is rejected. */
+CJSON_PUBLIC(cJSON_bool) cJSON_StreamParserFeed(cJSON_StreamParser *parser, const char *data, size_t length);
+/* Signal the end of the input. Returns 1 if it was exactly one complete JSON value. */
+CJSON_PUBLIC(cJSON_bool) cJSON_StreamParserFinish(cJSON_StreamParser *parser);
+CJSON_PUBLIC(void) cJSON_DeleteStreamParser(cJSON_StreamParser *parser);
+
 /* Returns the number of items in an array (or object). */
 CJSON_PUBLIC(int) cJSON_GetArraySize(const cJSON *array);
 /* Retrieve item number "item" from array "array". Returns NULL if unsuccessful. */
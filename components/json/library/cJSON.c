@@ -245,8 +245,123 @@ typedef struct
     size_t offset;
     size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
+    cJSON_Arena *arena; /* allocate from here instead of the hooks */
+    cJSON_bool in_place; /* unescape strings into the (mutable) content */
 } parse_buffer;
 
+/* arena allocations are aligned for the double in cJSON */
+#define arena_align(size) (((size) + sizeof(double) - 1) & ~(sizeof(double) - 1))
+
+CJSON_PUBLIC(void) cJSON_InitArena(cJSON_Arena *arena, void *buffer, size_t size, size_t block_size)
+{
+    size_t skip = 0;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    memset(arena, '\0', sizeof(cJSON_Arena));
+    if ((buffer != NULL) && (size > 0))
+    {
+        skip = arena_align((size_t)buffer) - (size_t)buffer;
+        if (skip < size)
+        {
+            arena->buffer = (unsigned char*)buffer + skip;
+            arena->size = size - skip;
+        }
+    }
+    arena->block_size = block_size;
+}
+
+CJSON_PUBLIC(void) cJSON_FreeArena(cJSON_Arena *arena)
+{
+    void *block = NULL;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    while (arena->blocks != NULL)
+    {
+        block = arena->blocks;
+        arena->blocks = *(void**)block;
+        global_hooks.deallocate(block);
+    }
+    arena->buffer = NULL;
+    arena->size = 0;
+    arena->offset = 0;
+}
+
+static void *arena_allocate(cJSON_Arena * const arena, size_t size)
+{
+    const size_t header = arena_align(sizeof(void*));
+    unsigned char *block = NULL;
+    size_t block_length = 0;
+    void *pointer = NULL;
+
+    size = arena_align(size);
+    if ((arena->buffer == NULL) || ((arena->size - arena->offset) < size))
+    {
+        /* chain a new block, the rest of the current one is left unused */
+        if ((arena->block_size == 0) || (size > (INT_MAX - header)))
+        {
+            return NULL;
+        }
+        block_length = header + ((size > arena->block_size) ? size : arena->block_size);
+        block = (unsigned char*)global_hooks.allocate(block_length);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        *(void**)block = arena->blocks;
+        arena->blocks = block;
+        arena->buffer = block + header;
+        arena->size = block_length - header;
+        arena->offset = 0;
+    }
+
+    pointer = arena->buffer + arena->offset;
+    arena->offset += size;
+    return pointer;
+}
+
+static void *parse_allocate(parse_buffer * const buffer, size_t size)
+{
+    if (buffer->arena != NULL)
+    {
+        return arena_allocate(buffer->arena, size);
+    }
+    return buffer->hooks.allocate(size);
+}
+
+static cJSON *parse_new_item(parse_buffer * const buffer)
+{
+    cJSON *node = NULL;
+
+    if (buffer->arena == NULL)
+    {
+        return cJSON_New_Item(&buffer->hooks);
+    }
+
+    node = (cJSON*)arena_allocate(buffer->arena, sizeof(cJSON));
+    if (node)
+    {
+        memset(node, '\0', sizeof(cJSON));
+    }
+    return node;
+}
+
+/* items from an arena are only released all together */
+static void parse_delete(parse_buffer * const buffer, cJSON *item)
+{
+    if (buffer->arena == NULL)
+    {
+        cJSON_Delete(item);
+    }
+}
+
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
 #define can_read(buffer, size) ((buffer != NULL) && (((buffer)->offset + size) <= (buffer)->length))
 /* check if the buffer can be accessed at the given index (starting with 0) */
@@ -360,6 +475,8 @@ typedef struct
     cJSON_bool noalloc;
     cJSON_bool format; /* is this print a formatted print */
     internal_hooks hooks;
+    cJSON_StreamWriter writer; /* if set, a full (noalloc) buffer is emptied to here */
+    void *writer_context;
 } printbuffer;
 
 /* realloc printbuffer if necessary to have at least "needed" bytes more */
@@ -391,6 +508,21 @@ static unsigned char* ensure(printbuffer * const p, size_t needed)
         return p->buffer + p->offset;
     }
 
+    if ((p->writer != NULL) && (p->offset > 0))
+    {
+        /* everything up to offset is final, pass it on and reuse the buffer */
+        if (!p->writer(p->writer_context, (const char*)p->buffer, p->offset))
+        {
+            return NULL;
+        }
+        needed -= p->offset;
+        p->offset = 0;
+        if (needed <= p->length)
+        {
+            return p->buffer;
+        }
+    }
+
     if (p->noalloc) {
         return NULL;
     }
@@ -725,9 +857,17 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
             goto fail; /* string ended unexpectedly */
         }
 
-        /* This is at most how much we need for the output */
-        allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        if (input_buffer->in_place)
+        {
+            /* unescaping never makes a string longer, so it can be written over its own text */
+            output = (unsigned char*)input_pointer;
+        }
+        else
+        {
+            /* This is at most how much we need for the output */
+            allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
+            output = (unsigned char*)parse_allocate(input_buffer, allocation_length + sizeof(""));
+        }
         if (output == NULL)
         {
             goto fail; /* allocation failure */
@@ -803,7 +943,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     return true;
 
 fail:
-    if (output != NULL)
+    if ((output != NULL) && (input_buffer->arena == NULL) && !input_buffer->in_place)
     {
         input_buffer->hooks.deallocate(output);
     }
@@ -990,9 +1130,9 @@ static parse_buffer *skip_utf8_bom(parse_buffer * const buffer)
 }
 
 /* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+static cJSON *parse(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated, cJSON_Arena * const arena, const cJSON_bool in_place)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, false };
     cJSON *item = NULL;
 
     /* reset error position */
@@ -1008,8 +1148,10 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
     buffer.length = strlen((const char*)value) + sizeof("");
     buffer.offset = 0;
     buffer.hooks = global_hooks;
+    buffer.arena = arena;
+    buffer.in_place = in_place;
 
-    item = cJSON_New_Item(&global_hooks);
+    item = parse_new_item(&buffer);
     if (item == NULL) /* memory fail */
     {
         goto fail;
@@ -1040,7 +1182,7 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
 fail:
     if (item != NULL)
     {
-        cJSON_Delete(item);
+        parse_delete(&buffer, item);
     }
 
     if (value != NULL)
@@ -1069,12 +1211,389 @@ fail:
     return NULL;
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    return parse(value, return_parse_end, require_null_terminated, NULL, false);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithArena(const char *value, cJSON_Arena *arena)
+{
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+    return parse(value, 0, 0, arena, false);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInPlace(char *value, cJSON_Arena *arena)
+{
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+    return parse(value, 0, 0, arena, true);
+}
+
 /* Default options for cJSON_Parse */
 CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
 {
     return cJSON_ParseWithOpts(value, 0, 0);
 }
 
+typedef enum
+{
+    stream_value, /* expecting a value */
+    stream_value_or_end, /* expecting a value or ']' */
+    stream_key, /* expecting a key */
+    stream_key_or_end, /* expecting a key or '}' */
+    stream_colon,
+    stream_after_value, /* expecting ',' or the end of the enclosing container */
+    stream_string,
+    stream_number,
+    stream_literal,
+    stream_done, /* the top level value is complete */
+    stream_error
+} stream_state;
+
+struct cJSON_StreamParser
+{
+    cJSON_StreamCallback callback;
+    void *context;
+    stream_state state;
+    cJSON_bool escape; /* the previous character in a string was a backslash */
+    cJSON_bool token_is_key;
+    size_t depth;
+    unsigned char objects[(CJSON_NESTING_LIMIT + 7) / 8]; /* bit set for each nesting level that is an object */
+    unsigned char *token; /* the string, number or literal being read */
+    size_t token_length;
+    unsigned char *key; /* the most recent key */
+    size_t max_token;
+};
+
+#define stream_in_object(parser) (((parser)->depth > 0) && ((parser)->objects[((parser)->depth - 1) / 8] & (1 << (((parser)->depth - 1) % 8))))
+#define stream_key_for_value(parser) (stream_in_object(parser) ? (const char*)(parser)->key : NULL)
+
+CJSON_PUBLIC(cJSON_StreamParser *) cJSON_CreateStreamParser(cJSON_StreamCallback callback, void *context, size_t max_token)
+{
+    cJSON_StreamParser *parser = NULL;
+
+    if ((callback == NULL) || (max_token == 0) || (max_token > (INT_MAX / 2)))
+    {
+        return NULL;
+    }
+
+    /* the token and the key live behind the parser */
+    parser = (cJSON_StreamParser*)global_hooks.allocate(sizeof(cJSON_StreamParser) + 2 * (max_token + 1));
+    if (parser == NULL)
+    {
+        return NULL;
+    }
+    memset(parser, '\0', sizeof(cJSON_StreamParser));
+    parser->callback = callback;
+    parser->context = context;
+    parser->state = stream_value;
+    parser->token = (unsigned char*)(parser + 1);
+    parser->key = parser->token + max_token + 1;
+    parser->key[0] = '\0';
+    parser->max_token = max_token;
+
+    return parser;
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteStreamParser(cJSON_StreamParser *parser)
+{
+    if (parser != NULL)
+    {
+        global_hooks.deallocate(parser);
+    }
+}
+
+static cJSON_bool stream_open(cJSON_StreamParser * const parser, const cJSON_bool object)
+{
+    const char *key = stream_key_for_value(parser);
+
+    if (parser->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false; /* to deeply nested */
+    }
+    if (object)
+    {
+        parser->objects[parser->depth / 8] |= (unsigned char)(1 << (parser->depth % 8));
+    }
+    else
+    {
+        parser->objects[parser->depth / 8] &= (unsigned char)~(1 << (parser->depth % 8));
+    }
+    parser->depth++;
+    parser->state = object ? stream_key_or_end : stream_value_or_end;
+
+    return parser->callback(parser->context, object ? cJSON_StreamObjectStart : cJSON_StreamArrayStart, key, NULL, parser->depth);
+}
+
+static cJSON_bool stream_close(cJSON_StreamParser * const parser, const cJSON_bool object)
+{
+    size_t depth = parser->depth;
+
+    if ((depth == 0) || (stream_in_object(parser) != object))
+    {
+        return false; /* mismatched bracket */
+    }
+    parser->depth--;
+    parser->state = (parser->depth == 0) ? stream_done : stream_after_value;
+
+    return parser->callback(parser->context, object ? cJSON_StreamObjectEnd : cJSON_StreamArrayEnd, NULL, NULL, depth);
+}
+
+/* A string, number or literal is complete: parse it with the regular parser and report it */
+static cJSON_bool stream_token_end(cJSON_StreamParser * const parser)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, NULL, false };
+    cJSON item;
+
+    memset(&item, '\0', sizeof(cJSON));
+    buffer.content = parser->token;
+    buffer.length = parser->token_length;
+    buffer.hooks = global_hooks;
+    /* the token buffer is ours, so strings are unescaped in place */
+    buffer.in_place = true;
+
+    if (parser->state == stream_string)
+    {
+        if (!parse_string(&item, &buffer))
+        {
+            return false;
+        }
+        if (parser->token_is_key)
+        {
+            memcpy(parser->key, item.valuestring, strlen(item.valuestring) + sizeof(""));
+            parser->state = stream_colon;
+            return true;
+        }
+    }
+    else if (parser->state == stream_number)
+    {
+        if (!parse_number(&item, &buffer) || (buffer.offset != buffer.length))
+        {
+            return false;
+        }
+    }
+    else if ((parser->token_length == 4) && (strncmp((const char*)parser->token, "null", 4) == 0))
+    {
+        item.type = cJSON_NULL;
+    }
+    else if ((parser->token_length == 5) && (strncmp((const char*)parser->token, "false", 5) == 0))
+    {
+        item.type = cJSON_False;
+    }
+    else if ((parser->token_length == 4) && (strncmp((const char*)parser->token, "true", 4) == 0))
+    {
+        item.type = cJSON_True;
+        item.valueint = 1;
+    }
+    else
+    {
+        return false;
+    }
+
+    parser->state = (parser->depth == 0) ? stream_done : stream_after_value;
+    return parser->callback(parser->context, cJSON_StreamValue, stream_key_for_value(parser), &item, parser->depth);
+}
+
+static cJSON_bool stream_token_add(cJSON_StreamParser * const parser, const unsigned char c)
+{
+    if (parser->token_length >= parser->max_token)
+    {
+        return false; /* token too long */
+    }
+    parser->token[parser->token_length++] = c;
+    return true;
+}
+
+static cJSON_bool stream_token_start(cJSON_StreamParser * const parser, const stream_state state, const unsigned char c)
+{
+    parser->state = state;
+    parser->escape = false;
+    parser->token_length = 0;
+    return stream_token_add(parser, c);
+}
+
+static cJSON_bool stream_parse_char(cJSON_StreamParser * const parser, const unsigned char c)
+{
+    switch (parser->state)
+    {
+        case stream_string:
+            if (!stream_token_add(parser, c))
+            {
+                return false;
+            }
+            if (parser->escape)
+            {
+                parser->escape = false;
+            }
+            else if (c == '\\')
+            {
+                parser->escape = true;
+            }
+            else if (c == '\"')
+            {
+                return stream_token_end(parser);
+            }
+            return true;
+
+        case stream_number:
+            if (((c >= '0') && (c <= '9')) || (c == '+') || (c == '-') || (c == 'e') || (c == 'E') || (c == '.'))
+            {
+                return stream_token_add(parser, c);
+            }
+            /* the character after the number still has to be parsed */
+            return stream_token_end(parser) && stream_parse_char(parser, c);
+
+        case stream_literal:
+            if ((c >= 'a') && (c <= 'z'))
+            {
+                return stream_token_add(parser, c);
+            }
+            return stream_token_end(parser) && stream_parse_char(parser, c);
+
+        default:
+            break;
+    }
+
+    /* whitespace between tokens */
+    if (c <= 32)
+    {
+        return true;
+    }
+
+    switch (parser->state)
+    {
+        case stream_value_or_end:
+            if (c == ']')
+            {
+                return stream_close(parser, false);
+            }
+            /* fall through */
+        case stream_value:
+            parser->token_is_key = false;
+            if (c == '{')
+            {
+                return stream_open(parser, true);
+            }
+            if (c == '[')
+            {
+                return stream_open(parser, false);
+            }
+            if (c == '\"')
+            {
+                return stream_token_start(parser, stream_string, c);
+            }
+            if ((c == '-') || ((c >= '0') && (c <= '9')))
+            {
+                return stream_token_start(parser, stream_number, c);
+            }
+            if ((c >= 'a') && (c <= 'z'))
+            {
+                return stream_token_start(parser, stream_literal, c);
+            }
+            return false;
+
+        case stream_key_or_end:
+            if (c == '}')
+            {
+                return stream_close(parser, true);
+            }
+            /* fall through */
+        case stream_key:
+            parser->token_is_key = true;
+            return (c == '\"') && stream_token_start(parser, stream_string, c);
+
+        case stream_colon:
+            if (c != ':')
+            {
+                return false;
+            }
+            parser->state = stream_value;
+            return true;
+
+        case stream_after_value:
+            if (c == ',')
+            {
+                parser->state = stream_in_object(parser) ? stream_key : stream_value;
+                return true;
+            }
+            if ((c == '}') || (c == ']'))
+            {
+                return stream_close(parser, c == '}');
+            }
+            return false;
+
+        default:
+            /* done, or a previous error */
+            return false;
+    }
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_StreamParserFeed(cJSON_StreamParser *parser, const char *data, size_t length)
+{
+    size_t i = 0;
+
+    if ((parser == NULL) || ((data == NULL) && (length > 0)))
+    {
+        return false;
+    }
+
+    for (i = 0; i < length; i++)
+    {
+        if ((parser->state == stream_string) && !parser->escape)
+        {
+            /* copy plain string content in one go, the parser only needs to see quotes and backslashes */
+            size_t run = 0;
+            while (((i + run) < length) && (data[i + run] != '\"') && (data[i + run] != '\\'))
+            {
+                run++;
+            }
+            if (run > 0)
+            {
+                if (run > (parser->max_token - parser->token_length))
+                {
+                    parser->state = stream_error;
+                    return false;
+                }
+                memcpy(parser->token + parser->token_length, data + i, run);
+                parser->token_length += run;
+                i += run;
+                if (i == length)
+                {
+                    break;
+                }
+            }
+        }
+        if (!stream_parse_char(parser, (unsigned char)data[i]))
+        {
+            parser->state = stream_error;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_StreamParserFinish(cJSON_StreamParser *parser)
+{
+    if (parser == NULL)
+    {
+        return false;
+    }
+
+    /* a number or literal at the top level is only ended by the end of the input */
+    if (((parser->state == stream_number) || (parser->state == stream_literal)) && !stream_token_end(parser))
+    {
+        parser->state = stream_error;
+    }
+
+    return parser->state == stream_done;
+}
+
 #define cjson_min(a, b) ((a < b) ? a : b)
 
 static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
@@ -1152,7 +1671,7 @@ CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
 
 CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL };
 
     if (prebuffer < 0)
     {
@@ -1182,7 +1701,7 @@ CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON
 
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buf, const int len, const cJSON_bool fmt)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL };
 
     if ((len < 0) || (buf == NULL))
     {
@@ -1199,6 +1718,33 @@ CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buf, const i
     return print_value(item, &p);
 }
 
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintStreamed(const cJSON *item, char *buffer, size_t length, cJSON_bool format, cJSON_StreamWriter writer, void *context)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, NULL, NULL };
+
+    if ((buffer == NULL) || (length == 0) || (writer == NULL))
+    {
+        return false;
+    }
+
+    p.buffer = (unsigned char*)buffer;
+    p.length = length;
+    p.offset = 0;
+    p.noalloc = true;
+    p.format = format;
+    p.hooks = global_hooks;
+    p.writer = writer;
+    p.writer_context = context;
+
+    if (!print_value(item, &p))
+    {
+        return false;
+    }
+    update_offset(&p);
+
+    return (p.offset == 0) || writer(context, (const char*)p.buffer, p.offset);
+}
+
 /* Parser core - when encountering text, process appropriately. */
 static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
 {
@@ -1371,7 +1917,7 @@ static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buf
     do
     {
         /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        cJSON *new_item = parse_new_item(input_buffer);
         if (new_item == NULL)
         {
             goto fail; /* allocation failure */
@@ -1420,7 +1966,7 @@ success:
 fail:
     if (head != NULL)
     {
-        cJSON_Delete(head);
+        parse_delete(input_buffer, head);
     }
 
     return false;
@@ -1525,7 +2071,7 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
     do
     {
         /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        cJSON *new_item = parse_new_item(input_buffer);
         if (new_item == NULL)
         {
             goto fail; /* allocation failure */
@@ -1591,7 +2137,7 @@ success:
 fail:
     if (head != NULL)
     {
-        cJSON_Delete(head);
+        parse_delete(input_buffer, head);
     }
 
     return false;
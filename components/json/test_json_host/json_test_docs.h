@@ -0,0 +1,83 @@
+/* Documents and helpers shared by the cJSON host tests */
+#pragma once
+
+#include "catch.hpp"
+#include "cJSON.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static size_t malloc_calls;
+static size_t free_calls;
+
+static inline void *counting_malloc(size_t size)
+{
+    malloc_calls++;
+    return malloc(size);
+}
+
+static inline void counting_free(void *ptr)
+{
+    if (ptr != NULL) {
+        free_calls++;
+    }
+    free(ptr);
+}
+
+/* Count heap calls made by cJSON for as long as this is in scope */
+struct HeapCounter {
+    HeapCounter()
+    {
+        cJSON_Hooks hooks = { counting_malloc, counting_free };
+        cJSON_InitHooks(&hooks);
+        malloc_calls = 0;
+        free_calls = 0;
+    }
+    ~HeapCounter()
+    {
+        cJSON_InitHooks(NULL);
+    }
+};
+
+/* An AWS IoT thing shadow document (as returned by a shadow get) for a device with 'sensors' sensors */
+static inline std::string make_shadow(int sensors)
+{
+    std::string state, metadata;
+    char buf[512];
+    for (int i = 0; i < sensors; i++) {
+        snprintf(buf, sizeof(buf),
+                 "%s\"sensor_%d\":{\"temperature\":%d.%d,\"humidity\":%d,\"enabled\":%s,"
+                 "\"label\":\"Room %d \\\"north\\\" \\u00b0C\",\"thresholds\":[-10,%d,35.5],\"calibration\":null}",
+                 i ? "," : "", i, 18 + i % 7, i % 10, 30 + i % 50, (i % 3) ? "true" : "false", i, 20 + i % 5);
+        state += buf;
+        snprintf(buf, sizeof(buf),
+                 "%s\"sensor_%d\":{\"temperature\":{\"timestamp\":%d},\"humidity\":{\"timestamp\":%d},"
+                 "\"enabled\":{\"timestamp\":%d},\"label\":{\"timestamp\":%d},"
+                 "\"thresholds\":[{\"timestamp\":%d},{\"timestamp\":%d},{\"timestamp\":%d}],\"calibration\":{\"timestamp\":%d}}",
+                 i ? "," : "", i, 1514764800 + i, 1514764800 + i, 1514764800 + i, 1514764800 + i,
+                 1514764800 + i, 1514764800 + i, 1514764800 + i, 1514764800 + i);
+        metadata += buf;
+    }
+    return "{\"state\":{\"desired\":{\"fw_version\":\"v3.0-dev\",\"interval\":60},\"reported\":{" + state + "}},"
+           "\"metadata\":{\"desired\":{\"fw_version\":{\"timestamp\":1514764800},\"interval\":{\"timestamp\":1514764800}},"
+           "\"reported\":{" + metadata + "}},\"version\":4711,\"timestamp\":1514768400,"
+           "\"clientToken\":\"esp32-240ac4000001-0001\"}";
+}
+
+/* A shadow update/delta message, as pushed to the device */
+static const char *shadow_delta =
+    "{\"version\":4712,\"timestamp\":1514768460,\"state\":{\"interval\":30,\"fw_version\":\"v3.0-dev\","
+    "\"ota\":{\"url\":\"https:\\/\\/example.com\\/fw\\/v3.0.bin\",\"size\":912384}},"
+    "\"metadata\":{\"interval\":{\"timestamp\":1514768460},\"fw_version\":{\"timestamp\":1514768460},"
+    "\"ota\":{\"url\":{\"timestamp\":1514768460},\"size\":{\"timestamp\":1514768460}}},"
+    "\"clientToken\":\"cloud-\\u00e9\\ud83d\\ude00\"}";
+
+static inline std::string print(const cJSON *json)
+{
+    char *text = cJSON_PrintUnformatted(json);
+    REQUIRE(text != NULL);
+    std::string res(text);
+    cJSON_free(text);
+    return res;
+}
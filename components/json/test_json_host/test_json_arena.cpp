@@ -0,0 +1,149 @@
+#include "catch.hpp"
+#include "cJSON.h"
+#include "json_test_docs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+TEST_CASE("arena parse gives the same tree as heap parse", "[json]")
+{
+    std::string doc = make_shadow(46);
+    cJSON *expected = cJSON_Parse(doc.c_str());
+    REQUIRE(expected != NULL);
+
+    cJSON_Arena arena;
+    cJSON *json;
+    {
+        HeapCounter counter;
+        cJSON_InitArena(&arena, NULL, 0, 4096);
+        json = cJSON_ParseWithArena(doc.c_str(), &arena);
+        REQUIRE(json != NULL);
+        CHECK(malloc_calls < 50);
+        CHECK(cJSON_Compare(expected, json, true));
+        CHECK(print(expected) == print(json));
+        cJSON_FreeArena(&arena);
+        CHECK(free_calls == malloc_calls);
+    }
+
+    cJSON_Delete(expected);
+}
+
+TEST_CASE("arena parse from a caller buffer makes no heap calls", "[json]")
+{
+    cJSON *expected = cJSON_Parse(shadow_delta);
+    REQUIRE(expected != NULL);
+    std::vector<uint8_t> buf(8192);
+    cJSON_Arena arena;
+
+    {
+        HeapCounter counter;
+        cJSON_InitArena(&arena, buf.data() + 1, buf.size() - 1, 0);
+        cJSON *json = cJSON_ParseWithArena(shadow_delta, &arena);
+        REQUIRE(json != NULL);
+        CHECK(((uintptr_t)json % sizeof(double)) == 0);
+        CHECK(cJSON_Compare(expected, json, true));
+        cJSON_FreeArena(&arena);
+        CHECK(malloc_calls == 0);
+    }
+
+    /* buffer too small and no blocks allowed */
+    cJSON_InitArena(&arena, buf.data(), 256, 0);
+    CHECK(cJSON_ParseWithArena(shadow_delta, &arena) == NULL);
+    cJSON_FreeArena(&arena);
+
+    /* buffer too small, continued in blocks */
+    cJSON_InitArena(&arena, buf.data(), 256, 512);
+    cJSON *json = cJSON_ParseWithArena(shadow_delta, &arena);
+    REQUIRE(json != NULL);
+    CHECK(cJSON_Compare(expected, json, true));
+    cJSON_FreeArena(&arena);
+
+    CHECK(cJSON_ParseWithArena(shadow_delta, NULL) == NULL);
+    cJSON_Delete(expected);
+}
+
+TEST_CASE("in place parse references strings in the input", "[json]")
+{
+    cJSON *expected = cJSON_Parse(shadow_delta);
+    REQUIRE(expected != NULL);
+    std::vector<char> input(shadow_delta, shadow_delta + strlen(shadow_delta) + 1);
+    cJSON_Arena arena;
+
+    cJSON_InitArena(&arena, NULL, 0, 1024);
+    cJSON *json = cJSON_ParseInPlace(input.data(), &arena);
+    REQUIRE(json != NULL);
+    CHECK(cJSON_Compare(expected, json, true));
+    CHECK(print(expected) == print(json));
+
+    cJSON *token = cJSON_GetObjectItem(json, "clientToken");
+    REQUIRE(cJSON_IsString(token));
+    CHECK(token->valuestring >= input.data());
+    CHECK(token->valuestring < input.data() + input.size());
+    CHECK(token->string >= input.data());
+    CHECK(std::string(token->valuestring) == "cloud-\xc3\xa9\xf0\x9f\x98\x80");
+    cJSON *url = cJSON_GetObjectItem(cJSON_GetObjectItem(cJSON_GetObjectItem(json, "state"), "ota"), "url");
+    REQUIRE(cJSON_IsString(url));
+    CHECK(std::string(url->valuestring) == "https://example.com/fw/v3.0.bin");
+    cJSON_FreeArena(&arena);
+
+    cJSON_Delete(expected);
+}
+
+TEST_CASE("invalid json is rejected by arena parse", "[json]")
+{
+    const char *bad[] = { "{\"a\":", "{\"a\" 1}", "[1,2", "\"abc", "{\"a\":\"\\u12\"}", "{\"a\":\"\\ud800\"}", "" };
+    cJSON_Arena arena;
+    for (const char *json : bad) {
+        cJSON_InitArena(&arena, NULL, 0, 256);
+        CHECK(cJSON_ParseWithArena(json, &arena) == NULL);
+        std::vector<char> input(json, json + strlen(json) + 1);
+        CHECK(cJSON_ParseInPlace(input.data(), &arena) == NULL);
+        cJSON_FreeArena(&arena);
+    }
+}
+
+TEST_CASE("shadow document parse benchmark", "[json][perf]")
+{
+    const int rounds = 200;
+    std::string doc = make_shadow(46);
+    std::vector<char> input(doc.size() + 1);
+    std::vector<uint8_t> buf(128 * 1024);
+    cJSON_Arena arena;
+    HeapCounter counter;
+
+    clock_t start = clock();
+    for (int i = 0; i < rounds; i++) {
+        cJSON *json = cJSON_Parse(doc.c_str());
+        REQUIRE(json != NULL);
+        cJSON_Delete(json);
+    }
+    double heap_us = (double)(clock() - start) * 1000000 / CLOCKS_PER_SEC / rounds;
+    size_t heap_calls = (malloc_calls + free_calls) / rounds;
+
+    malloc_calls = free_calls = 0;
+    start = clock();
+    for (int i = 0; i < rounds; i++) {
+        cJSON_InitArena(&arena, NULL, 0, 4096);
+        REQUIRE(cJSON_ParseWithArena(doc.c_str(), &arena) != NULL);
+        cJSON_FreeArena(&arena);
+    }
+    double chain_us = (double)(clock() - start) * 1000000 / CLOCKS_PER_SEC / rounds;
+    size_t chain_calls = (malloc_calls + free_calls) / rounds;
+
+    start = clock();
+    for (int i = 0; i < rounds; i++) {
+        memcpy(input.data(), doc.c_str(), input.size());
+        cJSON_InitArena(&arena, buf.data(), buf.size(), 0);
+        REQUIRE(cJSON_ParseInPlace(input.data(), &arena) != NULL);
+        cJSON_FreeArena(&arena);
+    }
+    double in_place_us = (double)(clock() - start) * 1000000 / CLOCKS_PER_SEC / rounds;
+
+    printf("%zu byte shadow document: heap %.1f us (%zu heap calls), arena blocks %.1f us (%zu heap calls), "
+           "in place %.1f us (0 heap calls)\n", doc.size(), heap_us, heap_calls, chain_us, chain_calls, in_place_us);
+    CHECK(chain_calls < heap_calls / 20);
+}
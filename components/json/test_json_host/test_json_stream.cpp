@@ -0,0 +1,220 @@
+#include "catch.hpp"
+#include "cJSON.h"
+#include "json_test_docs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+/* Rebuilds a cJSON tree from stream parser events, to compare against cJSON_Parse */
+struct TreeBuilder {
+    cJSON *root = NULL;
+    std::vector<cJSON *> stack;
+    size_t events = 0;
+    size_t abort_after = 0;
+
+    ~TreeBuilder()
+    {
+        cJSON_Delete(root);
+    }
+
+    void add(const char *key, cJSON *item)
+    {
+        if (stack.empty()) {
+            REQUIRE(root == NULL);
+            root = item;
+        } else if (cJSON_IsObject(stack.back())) {
+            REQUIRE(key != NULL);
+            cJSON_AddItemToObject(stack.back(), key, item);
+        } else {
+            REQUIRE(key == NULL);
+            cJSON_AddItemToArray(stack.back(), item);
+        }
+    }
+};
+
+static cJSON_bool build_tree(void *context, cJSON_StreamEvent event, const char *key, const cJSON *value, size_t depth)
+{
+    TreeBuilder *b = static_cast<TreeBuilder *>(context);
+    cJSON *item;
+
+    b->events++;
+    if (b->abort_after != 0 && b->events >= b->abort_after) {
+        return false;
+    }
+    switch (event) {
+    case cJSON_StreamObjectStart:
+    case cJSON_StreamArrayStart:
+        item = (event == cJSON_StreamObjectStart) ? cJSON_CreateObject() : cJSON_CreateArray();
+        b->add(key, item);
+        b->stack.push_back(item);
+        CHECK(depth == b->stack.size());
+        break;
+    case cJSON_StreamObjectEnd:
+    case cJSON_StreamArrayEnd:
+        CHECK(key == NULL);
+        CHECK(depth == b->stack.size());
+        CHECK(cJSON_IsObject(b->stack.back()) == (event == cJSON_StreamObjectEnd));
+        b->stack.pop_back();
+        break;
+    case cJSON_StreamValue:
+        CHECK(depth == b->stack.size());
+        b->add(key, cJSON_Duplicate(value, false));
+        break;
+    }
+    return true;
+}
+
+/* Stream parse 'json' in pieces of 'chunk' bytes */
+static bool stream_parse(const std::string &json, size_t chunk, TreeBuilder &builder, size_t max_token = 256)
+{
+    cJSON_StreamParser *parser = cJSON_CreateStreamParser(build_tree, &builder, max_token);
+    REQUIRE(parser != NULL);
+    bool ok = true;
+    for (size_t pos = 0; pos < json.size() && ok; pos += chunk) {
+        ok = cJSON_StreamParserFeed(parser, json.data() + pos, std::min(chunk, json.size() - pos));
+    }
+    ok = ok && cJSON_StreamParserFinish(parser);
+    cJSON_DeleteStreamParser(parser);
+    return ok;
+}
+
+struct PieceCollector {
+    std::string text;
+    size_t max_piece = 0;
+    size_t pieces = 0;
+    size_t abort_after = 0;
+};
+
+static cJSON_bool collect(void *context, const char *data, size_t length)
+{
+    PieceCollector *c = static_cast<PieceCollector *>(context);
+    c->pieces++;
+    if (c->abort_after != 0 && c->pieces >= c->abort_after) {
+        return false;
+    }
+    c->text.append(data, length);
+    c->max_piece = std::max(c->max_piece, length);
+    return true;
+}
+
+TEST_CASE("stream parser events rebuild the parsed tree", "[json]")
+{
+    std::string docs[] = { make_shadow(46), shadow_delta, "[]", "{}", "[[],{},[[1]],{\"a\":{}}]", " 42 ", "-1.5e3",
+                           "\"top\"", "true", "null", "[true,false,null,0,-0.5,1E+2]" };
+    for (const std::string &doc : docs) {
+        cJSON *expected = cJSON_Parse(doc.c_str());
+        REQUIRE(expected != NULL);
+        for (size_t chunk : { (size_t)1, (size_t)7, (size_t)64, doc.size() }) {
+            TreeBuilder builder;
+            CHECK(stream_parse(doc, chunk, builder));
+            CHECK(builder.stack.empty());
+            CHECK(cJSON_Compare(expected, builder.root, true));
+        }
+        cJSON_Delete(expected);
+    }
+}
+
+TEST_CASE("stream parser rejects invalid json", "[json]")
+{
+    const char *bad[] = { "{\"a\":", "{\"a\" 1}", "[1,2", "\"abc", "{\"a\":\"\\u12\"}", "{\"a\":\"\\ud800\"}", "",
+                          "[1,]", "{\"a\":1,}", "[1 2]", "{1:2}", "[}", "{]", "]", "tru", "nul", "[truex]", "1.2.3",
+                          "{\"a\":1}x", "[1]]", "--1", "{\"a\"::1}" };
+    for (const char *json : bad) {
+        TreeBuilder builder;
+        CHECK_FALSE(stream_parse(json, 3, builder));
+    }
+
+    /* nesting limit */
+    std::string deep(CJSON_NESTING_LIMIT + 1, '[');
+    TreeBuilder builder;
+    CHECK_FALSE(stream_parse(deep, 16, builder));
+
+    /* a string longer than the token buffer */
+    TreeBuilder token_builder;
+    CHECK(stream_parse("[\"0123456789\"]", 4, token_builder, 12));
+    TreeBuilder long_builder;
+    CHECK_FALSE(stream_parse("[\"0123456789a\"]", 4, long_builder, 12));
+
+    /* the callback stops the parse */
+    TreeBuilder abort_builder;
+    abort_builder.abort_after = 5;
+    CHECK_FALSE(stream_parse(shadow_delta, 10, abort_builder));
+    CHECK(abort_builder.events == 5);
+
+    CHECK(cJSON_CreateStreamParser(NULL, NULL, 16) == NULL);
+    CHECK(cJSON_CreateStreamParser(build_tree, NULL, 0) == NULL);
+}
+
+TEST_CASE("streamed print matches the regular printer", "[json]")
+{
+    cJSON *json = cJSON_Parse(make_shadow(46).c_str());
+    REQUIRE(json != NULL);
+    char buf[64];
+
+    for (bool format : { false, true }) {
+        char *expected = format ? cJSON_Print(json) : cJSON_PrintUnformatted(json);
+        REQUIRE(expected != NULL);
+        PieceCollector collector;
+        {
+            HeapCounter counter;
+            CHECK(cJSON_PrintStreamed(json, buf, sizeof(buf), format, collect, &collector));
+            CHECK(malloc_calls == 0);
+        }
+        CHECK(collector.text == expected);
+        CHECK(collector.max_piece < sizeof(buf));
+        CHECK(collector.pieces > strlen(expected) / sizeof(buf));
+        cJSON_free(expected);
+    }
+
+    /* the writer stops the print */
+    PieceCollector aborting;
+    aborting.abort_after = 3;
+    CHECK_FALSE(cJSON_PrintStreamed(json, buf, sizeof(buf), false, collect, &aborting));
+    CHECK(aborting.pieces == 3);
+
+    /* a single value that doesn't fit the buffer */
+    cJSON *str = cJSON_CreateString(std::string(100, 'x').c_str());
+    PieceCollector collector;
+    CHECK_FALSE(cJSON_PrintStreamed(str, buf, sizeof(buf), false, collect, &collector));
+    cJSON_Delete(str);
+
+    CHECK_FALSE(cJSON_PrintStreamed(json, buf, sizeof(buf), false, NULL, NULL));
+    cJSON_Delete(json);
+}
+
+static cJSON_bool count_values(void *context, cJSON_StreamEvent event, const char *key, const cJSON *value, size_t depth)
+{
+    if (event == cJSON_StreamValue) {
+        (*static_cast<size_t *>(context))++;
+    }
+    return true;
+}
+
+TEST_CASE("shadow document stream parse benchmark", "[json][perf]")
+{
+    const int rounds = 200;
+    std::string doc = make_shadow(46);
+    size_t values = 0;
+    HeapCounter counter;
+
+    clock_t start = clock();
+    for (int i = 0; i < rounds; i++) {
+        cJSON_StreamParser *parser = cJSON_CreateStreamParser(count_values, &values, 64);
+        REQUIRE(parser != NULL);
+        for (size_t pos = 0; pos < doc.size(); pos += 1460) {
+            REQUIRE(cJSON_StreamParserFeed(parser, doc.data() + pos, std::min((size_t)1460, doc.size() - pos)));
+        }
+        REQUIRE(cJSON_StreamParserFinish(parser));
+        cJSON_DeleteStreamParser(parser);
+    }
+    double stream_us = (double)(clock() - start) * 1000000 / CLOCKS_PER_SEC / rounds;
+    size_t stream_calls = (malloc_calls + free_calls) / rounds;
+
+    printf("%zu byte shadow document: stream parse %.1f us (%zu heap calls, %zu values)\n",
+           doc.size(), stream_us, stream_calls, values / rounds);
+    CHECK(stream_calls == 2);
+}
@@ -74,6 +74,22 @@ $(LSRC)/crypto_pwhash/argon2/argon2-core.o: CFLAGS += -Wno-type-limits
 $(LSRC)/crypto_pwhash/scryptsalsa208sha256/pwhash_scryptsalsa208sha256.o: CFLAGS += -Wno-type-limits
 $(LSRC)/sodium/utils.o: CFLAGS += -Wno-unused-variable
 
+# The implementations of port/ replace libsodium's reference implementations
+# in the dispatchers, which are otherwise left unchanged. The reference
+# implementations are still built, for the equivalence tests in test/.
+# The glue files include libsodium's private implementation headers.
+ifdef CONFIG_LIBSODIUM_CHACHA20_ESP32
+COMPONENT_SRCDIRS += port/crypto_stream_chacha20_esp32
+$(LSRC)/crypto_stream/chacha20/stream_chacha20.o: CFLAGS += -Dcrypto_stream_chacha20_ref_implementation=crypto_stream_chacha20_esp32_implementation
+port/crypto_stream_chacha20_esp32/stream_chacha20_esp32.o: CFLAGS += -I$(COMPONENT_PATH)/$(LSRC)
+endif
+
+ifdef CONFIG_LIBSODIUM_X25519_ESP32
+COMPONENT_SRCDIRS += port/crypto_scalarmult_curve25519_esp32
+$(LSRC)/crypto_scalarmult/curve25519/scalarmult_curve25519.o: CFLAGS += -Dcrypto_scalarmult_curve25519_ref10_implementation=crypto_scalarmult_curve25519_esp32_implementation
+port/crypto_scalarmult_curve25519_esp32/scalarmult_curve25519_esp32.o: CFLAGS += -I$(COMPONENT_PATH)/$(LSRC)
+endif
+
 COMPONENT_ADD_INCLUDEDIRS := $(LSRC)/include port_include
 COMPONENT_PRIV_INCLUDEDIRS := $(LSRC)/include/sodium port_include/sodium port
 
@@ -0,0 +1,41 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/* libsodium's X25519 implementation (crypto_scalarmult_curve25519) on the
+   kernel of x25519_esp32.c. Selected with CONFIG_LIBSODIUM_X25519_ESP32,
+   see component.mk. */
+
+#include "crypto_scalarmult_curve25519.h"
+#include "crypto_scalarmult/curve25519/scalarmult_curve25519.h"
+#include "crypto_scalarmult/curve25519/ref10/x25519_ref10.h"
+#include "x25519_esp32.h"
+
+static int crypto_scalarmult_curve25519_esp32(unsigned char *q, const unsigned char *n,
+                                              const unsigned char *p)
+{
+    esp_x25519(q, n, p);
+    return 0;
+}
+
+/* ref10 multiplies the base point on the Edwards curve with its precomputed
+   tables, which is faster than a ladder */
+static int crypto_scalarmult_curve25519_esp32_base(unsigned char *q, const unsigned char *n)
+{
+    return crypto_scalarmult_curve25519_ref10_implementation.mult_base(q, n);
+}
+
+struct crypto_scalarmult_curve25519_implementation crypto_scalarmult_curve25519_esp32_implementation = {
+    .mult = crypto_scalarmult_curve25519_esp32,
+    .mult_base = crypto_scalarmult_curve25519_esp32_base,
+};
@@ -0,0 +1,349 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/* X25519 for 32-bit cores with a 32x32->64 multiplier (MULL and MULUH on
+ * Xtensa).
+ *
+ * Field elements are 10 unsigned limbs of alternately 26 and 25 bits
+ * (radix 2^25.5), as in the ref10 code, but unsigned: carries are a shift
+ * and a mask instead of ref10's rounded signed carries, and a subtraction
+ * adds 2p to stay positive. The bounds of the ladder are:
+ *
+ * - fe_mul()/fe_sq() results: limbs below 2^26 (even) and 2^25 + 2^17 (odd)
+ * - fe_add() of two such elements: below 2^27 / 2^26 + 2^18
+ * - fe_sub(): below 3 * 2^26 / 3 * 2^25
+ *
+ * so with inputs of fe_mul() within these bounds, the largest column
+ * (h0 = f0 g0 + 38 f1 g9 + 19 f2 g8 + ...) stays below 2^63.
+ */
+
+#include <string.h>
+#include "x25519_esp32.h"
+
+typedef uint32_t fe[10];
+
+#define MASK26 0x3ffffff
+#define MASK25 0x1ffffff
+
+static uint32_t load32_le(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Limb i starts at bit ceil(25.5 i): 0, 26, 51, 77, 102, 128, 153, 179, 204, 230 */
+static void fe_frombytes(fe h, const uint8_t s[32])
+{
+    h[0] = load32_le(s) & MASK26;
+    h[1] = (load32_le(s + 3) >> 2) & MASK25;
+    h[2] = (load32_le(s + 6) >> 3) & MASK26;
+    h[3] = (load32_le(s + 9) >> 5) & MASK25;
+    h[4] = (load32_le(s + 12) >> 6) & MASK26;
+    h[5] = load32_le(s + 16) & MASK25;
+    h[6] = (load32_le(s + 19) >> 1) & MASK26;
+    h[7] = (load32_le(s + 22) >> 3) & MASK25;
+    h[8] = (load32_le(s + 25) >> 4) & MASK26;
+    h[9] = (load32_le(s + 28) >> 6) & MASK25; /* the top bit is ignored */
+}
+
+/* One carry pass from limb 0 to limb 9 and back into limb 0 (2^255 = 19) */
+static void fe_carry(fe h)
+{
+    uint32_t c;
+
+    c = h[0] >> 26; h[0] &= MASK26; h[1] += c;
+    c = h[1] >> 25; h[1] &= MASK25; h[2] += c;
+    c = h[2] >> 26; h[2] &= MASK26; h[3] += c;
+    c = h[3] >> 25; h[3] &= MASK25; h[4] += c;
+    c = h[4] >> 26; h[4] &= MASK26; h[5] += c;
+    c = h[5] >> 25; h[5] &= MASK25; h[6] += c;
+    c = h[6] >> 26; h[6] &= MASK26; h[7] += c;
+    c = h[7] >> 25; h[7] &= MASK25; h[8] += c;
+    c = h[8] >> 26; h[8] &= MASK26; h[9] += c;
+    c = h[9] >> 25; h[9] &= MASK25; h[0] += 19 * c;
+}
+
+/* The canonical encoding, h mod p */
+static void fe_tobytes(uint8_t s[32], const fe f)
+{
+    fe h;
+    uint32_t q;
+
+    memcpy(h, f, sizeof(fe));
+    fe_carry(h);
+    fe_carry(h);
+
+    /* h < 2p, q = 1 if h >= p: the carry out of h + 19 */
+    q = (h[0] + 19) >> 26;
+    q = (h[1] + q) >> 25;
+    q = (h[2] + q) >> 26;
+    q = (h[3] + q) >> 25;
+    q = (h[4] + q) >> 26;
+    q = (h[5] + q) >> 25;
+    q = (h[6] + q) >> 26;
+    q = (h[7] + q) >> 25;
+    q = (h[8] + q) >> 26;
+    q = (h[9] + q) >> 25;
+
+    /* h - q p = h + 19 q - q 2^255, the carry out of limb 9 is dropped */
+    h[0] += 19 * q;
+    h[1] += h[0] >> 26; h[0] &= MASK26;
+    h[2] += h[1] >> 25; h[1] &= MASK25;
+    h[3] += h[2] >> 26; h[2] &= MASK26;
+    h[4] += h[3] >> 25; h[3] &= MASK25;
+    h[5] += h[4] >> 26; h[4] &= MASK26;
+    h[6] += h[5] >> 25; h[5] &= MASK25;
+    h[7] += h[6] >> 26; h[6] &= MASK26;
+    h[8] += h[7] >> 25; h[7] &= MASK25;
+    h[9] += h[8] >> 26; h[8] &= MASK26;
+    h[9] &= MASK25;
+
+    /* pack the 255 bits */
+    uint64_t acc = 0;
+    int bits = 0, pos = 0;
+    for (int i = 0; i < 10; i++) {
+        acc |= (uint64_t)h[i] << bits;
+        bits += (i & 1) ? 25 : 26;
+        while (bits >= 8) {
+            s[pos++] = (uint8_t)acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    s[pos] = (uint8_t)acc;
+}
+
+static void fe_add(fe h, const fe f, const fe g)
+{
+    for (int i = 0; i < 10; i++) {
+        h[i] = f[i] + g[i];
+    }
+}
+
+/* f - g + 2p */
+static void fe_sub(fe h, const fe f, const fe g)
+{
+    h[0] = f[0] + 0x7ffffda - g[0];
+    for (int i = 1; i < 10; i++) {
+        h[i] = f[i] + ((i & 1) ? 0x3fffffe : 0x7fffffe) - g[i];
+    }
+}
+
+static void fe_copy(fe h, const fe f)
+{
+    memcpy(h, f, sizeof(fe));
+}
+
+/* Swap f and g if b is 1, in constant time */
+static void fe_cswap(fe f, fe g, uint32_t b)
+{
+    uint32_t mask = 0 - b;
+
+    for (int i = 0; i < 10; i++) {
+        uint32_t x = (f[i] ^ g[i]) & mask;
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+/* Carry the 64-bit columns of a product into h */
+static void fe_carry_wide(fe h, uint64_t h0, uint64_t h1, uint64_t h2, uint64_t h3, uint64_t h4,
+                          uint64_t h5, uint64_t h6, uint64_t h7, uint64_t h8, uint64_t h9)
+{
+    h1 += h0 >> 26; h0 &= MASK26;
+    h2 += h1 >> 25; h1 &= MASK25;
+    h3 += h2 >> 26; h2 &= MASK26;
+    h4 += h3 >> 25; h3 &= MASK25;
+    h5 += h4 >> 26; h4 &= MASK26;
+    h6 += h5 >> 25; h5 &= MASK25;
+    h7 += h6 >> 26; h6 &= MASK26;
+    h8 += h7 >> 25; h7 &= MASK25;
+    h9 += h8 >> 26; h8 &= MASK26;
+    /* h9 >> 25 is below 2^38, times 19 below 2^43 */
+    h0 += 19 * (h9 >> 25); h9 &= MASK25;
+    /* h1 to h9 now fit in 26 bits, the carry out of h0 in 18 */
+    h[0] = (uint32_t)h0 & MASK26;
+    h[1] = (uint32_t)h1 + (uint32_t)(h0 >> 26);
+    h[2] = (uint32_t)h2;
+    h[3] = (uint32_t)h3;
+    h[4] = (uint32_t)h4;
+    h[5] = (uint32_t)h5;
+    h[6] = (uint32_t)h6;
+    h[7] = (uint32_t)h7;
+    h[8] = (uint32_t)h8;
+    h[9] = (uint32_t)h9;
+}
+
+#define MUL(a, b) ((uint64_t)(a) * (b))
+
+static void fe_mul(fe h, const fe f, const fe g)
+{
+    uint32_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    uint32_t f5 = f[5], f6 = f[6], f7 = f[7], f8 = f[8], f9 = f[9];
+    uint32_t g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+    uint32_t g5 = g[5], g6 = g[6], g7 = g[7], g8 = g[8], g9 = g[9];
+    /* odd limb times odd limb lands half a bit too high: doubled */
+    uint32_t f1_2 = 2 * f1, f3_2 = 2 * f3, f5_2 = 2 * f5, f7_2 = 2 * f7, f9_2 = 2 * f9;
+    /* wraps around 2^255 = 19 */
+    uint32_t g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4, g5_19 = 19 * g5;
+    uint32_t g6_19 = 19 * g6, g7_19 = 19 * g7, g8_19 = 19 * g8, g9_19 = 19 * g9;
+
+    uint64_t h0 = MUL(f0, g0) + MUL(f1_2, g9_19) + MUL(f2, g8_19) + MUL(f3_2, g7_19) + MUL(f4, g6_19) +
+                  MUL(f5_2, g5_19) + MUL(f6, g4_19) + MUL(f7_2, g3_19) + MUL(f8, g2_19) + MUL(f9_2, g1_19);
+    uint64_t h1 = MUL(f0, g1) + MUL(f1, g0) + MUL(f2, g9_19) + MUL(f3, g8_19) + MUL(f4, g7_19) +
+                  MUL(f5, g6_19) + MUL(f6, g5_19) + MUL(f7, g4_19) + MUL(f8, g3_19) + MUL(f9, g2_19);
+    uint64_t h2 = MUL(f0, g2) + MUL(f1_2, g1) + MUL(f2, g0) + MUL(f3_2, g9_19) + MUL(f4, g8_19) +
+                  MUL(f5_2, g7_19) + MUL(f6, g6_19) + MUL(f7_2, g5_19) + MUL(f8, g4_19) + MUL(f9_2, g3_19);
+    uint64_t h3 = MUL(f0, g3) + MUL(f1, g2) + MUL(f2, g1) + MUL(f3, g0) + MUL(f4, g9_19) +
+                  MUL(f5, g8_19) + MUL(f6, g7_19) + MUL(f7, g6_19) + MUL(f8, g5_19) + MUL(f9, g4_19);
+    uint64_t h4 = MUL(f0, g4) + MUL(f1_2, g3) + MUL(f2, g2) + MUL(f3_2, g1) + MUL(f4, g0) +
+                  MUL(f5_2, g9_19) + MUL(f6, g8_19) + MUL(f7_2, g7_19) + MUL(f8, g6_19) + MUL(f9_2, g5_19);
+    uint64_t h5 = MUL(f0, g5) + MUL(f1, g4) + MUL(f2, g3) + MUL(f3, g2) + MUL(f4, g1) +
+                  MUL(f5, g0) + MUL(f6, g9_19) + MUL(f7, g8_19) + MUL(f8, g7_19) + MUL(f9, g6_19);
+    uint64_t h6 = MUL(f0, g6) + MUL(f1_2, g5) + MUL(f2, g4) + MUL(f3_2, g3) + MUL(f4, g2) +
+                  MUL(f5_2, g1) + MUL(f6, g0) + MUL(f7_2, g9_19) + MUL(f8, g8_19) + MUL(f9_2, g7_19);
+    uint64_t h7 = MUL(f0, g7) + MUL(f1, g6) + MUL(f2, g5) + MUL(f3, g4) + MUL(f4, g3) +
+                  MUL(f5, g2) + MUL(f6, g1) + MUL(f7, g0) + MUL(f8, g9_19) + MUL(f9, g8_19);
+    uint64_t h8 = MUL(f0, g8) + MUL(f1_2, g7) + MUL(f2, g6) + MUL(f3_2, g5) + MUL(f4, g4) +
+                  MUL(f5_2, g3) + MUL(f6, g2) + MUL(f7_2, g1) + MUL(f8, g0) + MUL(f9_2, g9_19);
+    uint64_t h9 = MUL(f0, g9) + MUL(f1, g8) + MUL(f2, g7) + MUL(f3, g6) + MUL(f4, g5) +
+                  MUL(f5, g4) + MUL(f6, g3) + MUL(f7, g2) + MUL(f8, g1) + MUL(f9, g0);
+
+    fe_carry_wide(h, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9);
+}
+
+/* fe_mul(h, f, f) with the symmetric products computed once: 55 products instead of 100 */
+static void fe_sq(fe h, const fe f)
+{
+    uint32_t f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    uint32_t f5 = f[5], f6 = f[6], f7 = f[7], f8 = f[8], f9 = f[9];
+    uint32_t f0_2 = 2 * f0, f1_2 = 2 * f1, f2_2 = 2 * f2, f3_2 = 2 * f3, f4_2 = 2 * f4;
+    uint32_t f5_2 = 2 * f5, f6_2 = 2 * f6, f7_2 = 2 * f7;
+    uint32_t f5_38 = 38 * f5, f6_19 = 19 * f6, f7_38 = 38 * f7, f8_19 = 19 * f8, f9_38 = 38 * f9;
+
+    uint64_t h0 = MUL(f0, f0) + MUL(f1_2, f9_38) + MUL(f2_2, f8_19) + MUL(f3_2, f7_38) + MUL(f4_2, f6_19) + MUL(f5, f5_38);
+    uint64_t h1 = MUL(f0_2, f1) + MUL(f2, f9_38) + MUL(f3_2, f8_19) + MUL(f4, f7_38) + MUL(f5_2, f6_19);
+    uint64_t h2 = MUL(f0_2, f2) + MUL(f1_2, f1) + MUL(f3_2, f9_38) + MUL(f4_2, f8_19) + MUL(f5_2, f7_38) + MUL(f6, f6_19);
+    uint64_t h3 = MUL(f0_2, f3) + MUL(f1_2, f2) + MUL(f4, f9_38) + MUL(f5_2, f8_19) + MUL(f6, f7_38);
+    uint64_t h4 = MUL(f0_2, f4) + MUL(f1_2, f3_2) + MUL(f2, f2) + MUL(f5_2, f9_38) + MUL(f6_2, f8_19) + MUL(f7, f7_38);
+    uint64_t h5 = MUL(f0_2, f5) + MUL(f1_2, f4) + MUL(f2_2, f3) + MUL(f6, f9_38) + MUL(f7_2, f8_19);
+    uint64_t h6 = MUL(f0_2, f6) + MUL(f1_2, f5_2) + MUL(f2_2, f4) + MUL(f3_2, f3) + MUL(f7_2, f9_38) + MUL(f8, f8_19);
+    uint64_t h7 = MUL(f0_2, f7) + MUL(f1_2, f6) + MUL(f2_2, f5) + MUL(f3_2, f4) + MUL(f8, f9_38);
+    uint64_t h8 = MUL(f0_2, f8) + MUL(f1_2, f7_2) + MUL(f2_2, f6) + MUL(f3_2, f5_2) + MUL(f4, f4) + MUL(f9, f9_38);
+    uint64_t h9 = MUL(f0_2, f9) + MUL(f1_2, f8) + MUL(f2_2, f7) + MUL(f3_2, f6) + MUL(f4_2, f5);
+
+    fe_carry_wide(h, h0, h1, h2, h3, h4, h5, h6, h7, h8, h9);
+}
+
+/* h = f * 121665, (A - 2) / 4 for the curve constant A = 486662 */
+static void fe_mul121665(fe h, const fe f)
+{
+    fe_carry_wide(h, MUL(f[0], 121665), MUL(f[1], 121665), MUL(f[2], 121665), MUL(f[3], 121665),
+                  MUL(f[4], 121665), MUL(f[5], 121665), MUL(f[6], 121665), MUL(f[7], 121665),
+                  MUL(f[8], 121665), MUL(f[9], 121665));
+}
+
+/* h = f^(2^n) */
+static void fe_sq_n(fe h, const fe f, int n)
+{
+    fe_sq(h, f);
+    while (--n > 0) {
+        fe_sq(h, h);
+    }
+}
+
+/* h = z^(p - 2) = 1 / z */
+static void fe_invert(fe h, const fe z)
+{
+    fe t0, t1, t2, t3;
+
+    fe_sq(t0, z);               /* 2 */
+    fe_sq_n(t1, t0, 2);         /* 8 */
+    fe_mul(t1, z, t1);          /* 9 */
+    fe_mul(t0, t0, t1);         /* 11 */
+    fe_sq(t2, t0);              /* 22 */
+    fe_mul(t1, t1, t2);         /* 2^5 - 1 */
+    fe_sq_n(t2, t1, 5);
+    fe_mul(t1, t2, t1);         /* 2^10 - 1 */
+    fe_sq_n(t2, t1, 10);
+    fe_mul(t2, t2, t1);         /* 2^20 - 1 */
+    fe_sq_n(t3, t2, 20);
+    fe_mul(t2, t3, t2);         /* 2^40 - 1 */
+    fe_sq_n(t2, t2, 10);
+    fe_mul(t1, t2, t1);         /* 2^50 - 1 */
+    fe_sq_n(t2, t1, 50);
+    fe_mul(t2, t2, t1);         /* 2^100 - 1 */
+    fe_sq_n(t3, t2, 100);
+    fe_mul(t2, t3, t2);         /* 2^200 - 1 */
+    fe_sq_n(t2, t2, 50);
+    fe_mul(t1, t2, t1);         /* 2^250 - 1 */
+    fe_sq_n(t1, t1, 5);         /* 2^255 - 2^5 */
+    fe_mul(h, t1, t0);          /* 2^255 - 21 */
+}
+
+void esp_x25519(uint8_t q[32], const uint8_t n[32], const uint8_t p[32])
+{
+    uint8_t e[32];
+    fe x1, x2, z2, x3, z3, a, b, aa, bb, da, cb;
+    uint32_t swap = 0;
+
+    memcpy(e, n, 32);
+    e[0] &= 248;
+    e[31] &= 127;
+    e[31] |= 64;
+
+    /* Montgomery ladder, RFC 7748 section 5 */
+    fe_frombytes(x1, p);
+    memset(x2, 0, sizeof(fe));
+    x2[0] = 1;
+    memset(z2, 0, sizeof(fe));
+    fe_copy(x3, x1);
+    memset(z3, 0, sizeof(fe));
+    z3[0] = 1;
+
+    for (int pos = 254; pos >= 0; pos--) {
+        uint32_t bit = (e[pos >> 3] >> (pos & 7)) & 1;
+
+        swap ^= bit;
+        fe_cswap(x2, x3, swap);
+        fe_cswap(z2, z3, swap);
+        swap = bit;
+
+        fe_add(a, x2, z2);          /* A = x2 + z2 */
+        fe_sub(b, x2, z2);          /* B = x2 - z2 */
+        fe_add(x2, x3, z3);         /* C = x3 + z3 */
+        fe_sub(z2, x3, z3);         /* D = x3 - z3 */
+        fe_mul(da, z2, a);          /* DA */
+        fe_mul(cb, x2, b);          /* CB */
+        fe_sq(aa, a);               /* AA */
+        fe_sq(bb, b);               /* BB */
+        fe_add(x3, da, cb);
+        fe_sq(x3, x3);              /* x3 = (DA + CB)^2 */
+        fe_sub(z3, da, cb);
+        fe_sq(z3, z3);
+        fe_mul(z3, x1, z3);         /* z3 = x1 (DA - CB)^2 */
+        fe_mul(x2, aa, bb);         /* x2 = AA BB */
+        fe_sub(b, aa, bb);          /* E = AA - BB */
+        fe_mul121665(a, b);
+        fe_add(a, aa, a);
+        fe_mul(z2, b, a);           /* z2 = E (AA + a24 E) */
+    }
+    fe_cswap(x2, x3, swap);
+    fe_cswap(z2, z3, swap);
+
+    fe_invert(z2, z2);
+    fe_mul(x2, x2, z2);
+    fe_tobytes(q, x2);
+
+    memset(e, 0, sizeof(e));
+}
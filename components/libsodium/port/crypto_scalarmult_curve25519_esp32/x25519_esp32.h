@@ -0,0 +1,39 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* X25519 kernel, shared by the libsodium implementation in
+   scalarmult_curve25519_esp32.c and the host tests (test_kernels_host) */
+
+/**
+ * X25519 (RFC 7748): the u coordinate of n times the point p.
+ *
+ * The scalar is clamped and the top bit of p is ignored, as in the RFC.
+ * Constant time with respect to n and p.
+ *
+ * @param q result, 32 bytes
+ * @param n scalar, 32 bytes
+ * @param p u coordinate of the point, 32 bytes
+ */
+void esp_x25519(uint8_t q[32], const uint8_t n[32], const uint8_t p[32]);
+
+#ifdef __cplusplus
+}
+#endif
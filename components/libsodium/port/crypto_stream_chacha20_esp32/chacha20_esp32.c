@@ -0,0 +1,114 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include "chacha20_esp32.h"
+
+#ifndef __XTENSA__
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d)                         \
+    a += b; d ^= a; d = ROTL32(d, 16);                   \
+    c += d; b ^= c; b = ROTL32(b, 12);                   \
+    a += b; d ^= a; d = ROTL32(d, 8);                    \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+void esp_chacha20_block(uint32_t out[16], const uint32_t in[16])
+{
+    uint32_t x0 = in[0], x1 = in[1], x2 = in[2], x3 = in[3];
+    uint32_t x4 = in[4], x5 = in[5], x6 = in[6], x7 = in[7];
+    uint32_t x8 = in[8], x9 = in[9], x10 = in[10], x11 = in[11];
+    uint32_t x12 = in[12], x13 = in[13], x14 = in[14], x15 = in[15];
+
+    for (int i = 0; i < 10; i++) {
+        QUARTERROUND(x0, x4, x8, x12);
+        QUARTERROUND(x1, x5, x9, x13);
+        QUARTERROUND(x2, x6, x10, x14);
+        QUARTERROUND(x3, x7, x11, x15);
+        QUARTERROUND(x0, x5, x10, x15);
+        QUARTERROUND(x1, x6, x11, x12);
+        QUARTERROUND(x2, x7, x8, x13);
+        QUARTERROUND(x3, x4, x9, x14);
+    }
+
+    out[0] = x0 + in[0];
+    out[1] = x1 + in[1];
+    out[2] = x2 + in[2];
+    out[3] = x3 + in[3];
+    out[4] = x4 + in[4];
+    out[5] = x5 + in[5];
+    out[6] = x6 + in[6];
+    out[7] = x7 + in[7];
+    out[8] = x8 + in[8];
+    out[9] = x9 + in[9];
+    out[10] = x10 + in[10];
+    out[11] = x11 + in[11];
+    out[12] = x12 + in[12];
+    out[13] = x13 + in[13];
+    out[14] = x14 + in[14];
+    out[15] = x15 + in[15];
+}
+
+#endif /* __XTENSA__ */
+
+/* The key stream words are bytes in little endian order */
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "esp_chacha20_xor() assumes a little endian CPU"
+#endif
+
+void esp_chacha20_xor(uint8_t *c, const uint8_t *m, size_t len, uint32_t state[16])
+{
+    uint32_t ks[16];
+
+    while (len > 0) {
+        size_t n = len < sizeof(ks) ? len : sizeof(ks);
+
+        esp_chacha20_block(ks, state);
+        if (++state[12] == 0) {
+            state[13]++;
+        }
+
+        if (m == NULL) {
+            memcpy(c, ks, n);
+        } else if (n == sizeof(ks) && (((uintptr_t)c | (uintptr_t)m) & 3) == 0) {
+            /* a word at a time, instead of the byte loads and stores of the reference code */
+            const uint32_t *mw = (const uint32_t *)m;
+            uint32_t *cw = (uint32_t *)c;
+            for (int i = 0; i < 16; i += 4) {
+                cw[i] = mw[i] ^ ks[i];
+                cw[i + 1] = mw[i + 1] ^ ks[i + 1];
+                cw[i + 2] = mw[i + 2] ^ ks[i + 2];
+                cw[i + 3] = mw[i + 3] ^ ks[i + 3];
+            }
+        } else {
+            const uint8_t *kb = (const uint8_t *)ks;
+            for (size_t i = 0; i < n; i++) {
+                c[i] = m[i] ^ kb[i];
+            }
+        }
+
+        c += n;
+        if (m != NULL) {
+            m += n;
+        }
+        len -= n;
+    }
+
+    /* the key stream is as secret as the key */
+    volatile uint32_t *vks = ks;
+    for (int i = 0; i < 16; i++) {
+        vks[i] = 0;
+    }
+}
@@ -0,0 +1,52 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ChaCha20 kernels, shared by the libsodium implementation in
+   stream_chacha20_esp32.c and the host tests (test_kernels_host) */
+
+/**
+ * One ChaCha20 block: the 20 rounds of the input state, added to it.
+ *
+ * In assembly on Xtensa (chacha20_esp32_xtensa.S), in C elsewhere.
+ *
+ * @param out key stream block, as native (little endian) words
+ * @param in state: constants, key, block counter and nonce
+ */
+void esp_chacha20_block(uint32_t out[16], const uint32_t in[16]);
+
+/**
+ * XOR the key stream of a state with a message.
+ *
+ * The block counter in state[12] is incremented for each block, with a
+ * carry into state[13] as in libsodium's reference implementation (the
+ * 64-bit counter of the original ChaCha20).
+ *
+ * @param c output, may be the same buffer as m
+ * @param m message, or NULL to write the key stream itself
+ * @param len length in bytes
+ * @param state state of the first block, updated for the next block
+ */
+void esp_chacha20_xor(uint8_t *c, const uint8_t *m, size_t len, uint32_t state[16]);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,130 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/* libsodium's ChaCha20 implementation (crypto_stream_chacha20_*) on the
+   kernels of chacha20_esp32.c. Selected with CONFIG_LIBSODIUM_CHACHA20_ESP32,
+   see component.mk. */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "crypto_stream_chacha20.h"
+#include "utils.h"
+#include "crypto_stream/chacha20/stream_chacha20.h"
+#include "chacha20_esp32.h"
+
+static uint32_t load32_le(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void chacha20_init(uint32_t state[16], const unsigned char *k)
+{
+    state[0] = 0x61707865; /* "expand 32-byte k" */
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) {
+        state[4 + i] = load32_le(k + 4 * i);
+    }
+}
+
+/* 64-bit block counter and 64-bit nonce */
+static void chacha20_init_djb(uint32_t state[16], const unsigned char *n, uint64_t ic,
+                              const unsigned char *k)
+{
+    chacha20_init(state, k);
+    state[12] = (uint32_t)ic;
+    state[13] = (uint32_t)(ic >> 32);
+    state[14] = load32_le(n);
+    state[15] = load32_le(n + 4);
+}
+
+/* IETF (RFC 7539): 32-bit block counter and 96-bit nonce */
+static void chacha20_init_ietf(uint32_t state[16], const unsigned char *n, uint32_t ic,
+                               const unsigned char *k)
+{
+    chacha20_init(state, k);
+    state[12] = ic;
+    state[13] = load32_le(n);
+    state[14] = load32_le(n + 4);
+    state[15] = load32_le(n + 8);
+}
+
+static int stream_esp32(unsigned char *c, unsigned long long clen,
+                        const unsigned char *n, const unsigned char *k)
+{
+    uint32_t state[16];
+
+    if (clen > SIZE_MAX) {
+        return -1;
+    }
+    chacha20_init_djb(state, n, 0, k);
+    esp_chacha20_xor(c, NULL, (size_t)clen, state);
+    sodium_memzero(state, sizeof(state));
+    return 0;
+}
+
+static int stream_ietf_esp32(unsigned char *c, unsigned long long clen,
+                             const unsigned char *n, const unsigned char *k)
+{
+    uint32_t state[16];
+
+    if (clen > SIZE_MAX) {
+        return -1;
+    }
+    chacha20_init_ietf(state, n, 0, k);
+    esp_chacha20_xor(c, NULL, (size_t)clen, state);
+    sodium_memzero(state, sizeof(state));
+    return 0;
+}
+
+static int stream_esp32_xor_ic(unsigned char *c, const unsigned char *m,
+                               unsigned long long mlen,
+                               const unsigned char *n, uint64_t ic,
+                               const unsigned char *k)
+{
+    uint32_t state[16];
+
+    if (mlen > SIZE_MAX) {
+        return -1;
+    }
+    chacha20_init_djb(state, n, ic, k);
+    esp_chacha20_xor(c, m, (size_t)mlen, state);
+    sodium_memzero(state, sizeof(state));
+    return 0;
+}
+
+static int stream_ietf_esp32_xor_ic(unsigned char *c, const unsigned char *m,
+                                    unsigned long long mlen,
+                                    const unsigned char *n, uint32_t ic,
+                                    const unsigned char *k)
+{
+    uint32_t state[16];
+
+    if (mlen > SIZE_MAX) {
+        return -1;
+    }
+    chacha20_init_ietf(state, n, ic, k);
+    esp_chacha20_xor(c, m, (size_t)mlen, state);
+    sodium_memzero(state, sizeof(state));
+    return 0;
+}
+
+struct crypto_stream_chacha20_implementation crypto_stream_chacha20_esp32_implementation = {
+    .stream = stream_esp32,
+    .stream_ietf = stream_ietf_esp32,
+    .stream_xor_ic = stream_esp32_xor_ic,
+    .stream_ietf_xor_ic = stream_ietf_esp32_xor_ic,
+};
@@ -12,9 +12,10 @@ endif # TESTS_ALL
 
 COMPONENT_SRCDIRS := . $(LS_TESTDIR)
 
-COMPONENT_PRIV_INCLUDEDIRS := $(LS_TESTDIR)/../quirks
+# libsodium's private implementation headers, for test_sodium_esp32.c
+COMPONENT_PRIV_INCLUDEDIRS := $(LS_TESTDIR)/../quirks ../libsodium/src/libsodium ../libsodium/src/libsodium/include/sodium
 
-COMPONENT_OBJS := test_sodium.o
+COMPONENT_OBJS := test_sodium.o test_sodium_esp32.o
 
 # The libsodium test suite is designed to be run each test case as an executable on a desktop computer and uses
 # filesytem to write & then compare contents of each file.
@@ -0,0 +1,150 @@
+/*
+ * ChaCha20 and X25519 implementations of port/ against libsodium's reference
+ * implementations, which stay linked for this test.
+ *
+ * The host test in test_kernels_host covers the C kernels; this checks the
+ * Xtensa assembly and the glue to libsodium on the chip.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "unity.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "sodium.h"
+#include "idf_performance.h"
+#include "crypto_stream/chacha20/stream_chacha20.h"
+#include "crypto_stream/chacha20/ref/chacha20_ref.h"
+#include "crypto_scalarmult/curve25519/scalarmult_curve25519.h"
+#include "crypto_scalarmult/curve25519/ref10/x25519_ref10.h"
+
+#define BUF_SIZE 1100
+
+#if CONFIG_LIBSODIUM_CHACHA20_ESP32 || CONFIG_LIBSODIUM_X25519_ESP32
+static void fill_random(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i += 4) {
+        uint32_t r = esp_random();
+        memcpy(buf + i, &r, (len - i < 4) ? len - i : 4);
+    }
+}
+#endif
+
+#if CONFIG_LIBSODIUM_CHACHA20_ESP32
+
+TEST_CASE("ChaCha20 matches the reference implementation", "[libsodium]")
+{
+    uint8_t *m = malloc(BUF_SIZE);
+    uint8_t *c = malloc(BUF_SIZE);
+    uint8_t *expected = malloc(BUF_SIZE);
+    uint8_t key[crypto_stream_chacha20_KEYBYTES];
+    uint8_t nonce[crypto_stream_chacha20_ietf_NONCEBYTES];
+    TEST_ASSERT_NOT_NULL(m);
+    TEST_ASSERT_NOT_NULL(c);
+    TEST_ASSERT_NOT_NULL(expected);
+
+    for (int iter = 0; iter < 1000; iter++) {
+        fill_random(m, BUF_SIZE);
+        fill_random(key, sizeof(key));
+        fill_random(nonce, sizeof(nonce));
+        size_t len = (iter < 200) ? iter : esp_random() % 1024;
+        int m_off = esp_random() % 4, c_off = (iter & 1) ? m_off : esp_random() % 4;
+        uint32_t ic = (iter % 3 == 0) ? 0xfffffffe : esp_random();
+
+        crypto_stream_chacha20_ref_implementation.stream_xor_ic(expected, m + m_off, len, nonce, ic, key);
+        TEST_ASSERT_EQUAL(0, crypto_stream_chacha20_xor_ic(c + c_off, m + m_off, len, nonce, ic, key));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, c + c_off, len);
+
+        crypto_stream_chacha20_ref_implementation.stream_ietf_xor_ic(expected, m + m_off, len, nonce, ic, key);
+        TEST_ASSERT_EQUAL(0, crypto_stream_chacha20_ietf_xor_ic(c + c_off, m + m_off, len, nonce, ic, key));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, c + c_off, len);
+
+        crypto_stream_chacha20_ref_implementation.stream(expected, len, nonce, key);
+        TEST_ASSERT_EQUAL(0, crypto_stream_chacha20(c, len, nonce, key));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, c, len);
+    }
+
+    free(m);
+    free(c);
+    free(expected);
+}
+
+TEST_CASE("ChaCha20 performance", "[libsodium]")
+{
+    const int rounds = 200;
+    const size_t len = 1024;
+    uint8_t *buf = malloc(len);
+    uint8_t key[crypto_stream_chacha20_KEYBYTES] = { 1 };
+    uint8_t nonce[crypto_stream_chacha20_NONCEBYTES] = { 2 };
+    TEST_ASSERT_NOT_NULL(buf);
+    memset(buf, 0x5a, len);
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        crypto_stream_chacha20_ref_implementation.stream_xor_ic(buf, buf, len, nonce, i, key);
+    }
+    int64_t ref_elapsed = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        crypto_stream_chacha20_xor_ic(buf, buf, len, nonce, i, key);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    free(buf);
+
+    /* cycles per byte */
+    IDF_LOG_PERFORMANCE("chacha20_ref_cycles_per_byte", "%d", (int)(ref_elapsed * CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ / rounds / len));
+    IDF_LOG_PERFORMANCE("chacha20_cycles_per_byte", "%d", (int)(elapsed * CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ / rounds / len));
+}
+
+#endif /* CONFIG_LIBSODIUM_CHACHA20_ESP32 */
+
+#if CONFIG_LIBSODIUM_X25519_ESP32
+
+TEST_CASE("X25519 matches the reference implementation", "[libsodium]")
+{
+    uint8_t n[crypto_scalarmult_curve25519_SCALARBYTES];
+    uint8_t p[crypto_scalarmult_curve25519_BYTES];
+    uint8_t q[crypto_scalarmult_curve25519_BYTES], expected[crypto_scalarmult_curve25519_BYTES];
+
+    for (int iter = 0; iter < 100; iter++) {
+        fill_random(n, sizeof(n));
+        fill_random(p, sizeof(p));
+        if (iter % 4 == 0) {
+            /* not reduced */
+            memset(p, 0xff, sizeof(p));
+        }
+        crypto_scalarmult_curve25519_ref10_implementation.mult(expected, n, p);
+        crypto_scalarmult_curve25519(q, n, p);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, q, sizeof(q));
+    }
+
+    /* the all zero result is still rejected */
+    memset(p, 0, sizeof(p));
+    TEST_ASSERT_EQUAL(-1, crypto_scalarmult_curve25519(q, n, p));
+}
+
+TEST_CASE("X25519 performance", "[libsodium]")
+{
+    const int rounds = 20;
+    uint8_t n[crypto_scalarmult_curve25519_SCALARBYTES] = { 1, 2, 3 };
+    uint8_t p[crypto_scalarmult_curve25519_BYTES] = { 9 };
+    uint8_t q[crypto_scalarmult_curve25519_BYTES];
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        crypto_scalarmult_curve25519_ref10_implementation.mult(q, n, p);
+    }
+    int64_t ref_elapsed = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        crypto_scalarmult_curve25519(q, n, p);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    IDF_LOG_PERFORMANCE("x25519_ref10_ops_per_second", "%d", (int)(1000000LL * rounds / ref_elapsed));
+    IDF_LOG_PERFORMANCE("x25519_ops_per_second", "%d", (int)(1000000LL * rounds / elapsed));
+}
+
+#endif /* CONFIG_LIBSODIUM_X25519_ESP32 */
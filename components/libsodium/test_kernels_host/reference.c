@@ -0,0 +1,205 @@
+#include <string.h>
+#include "reference.h"
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d)                         \
+    a += b; d ^= a; d = ROTL32(d, 16);                   \
+    c += d; b ^= c; b = ROTL32(b, 12);                   \
+    a += b; d ^= a; d = ROTL32(d, 8);                    \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+static uint32_t load32_le(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void ref_chacha20_xor(uint8_t *c, const uint8_t *m, size_t len, const uint8_t nonce[8],
+                      uint64_t ic, const uint8_t key[32])
+{
+    uint32_t in[16], x[16];
+    uint8_t ks[64];
+
+    in[0] = 0x61707865;
+    in[1] = 0x3320646e;
+    in[2] = 0x79622d32;
+    in[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) {
+        in[4 + i] = load32_le(key + 4 * i);
+    }
+    in[12] = (uint32_t)ic;
+    in[13] = (uint32_t)(ic >> 32);
+    in[14] = load32_le(nonce);
+    in[15] = load32_le(nonce + 4);
+
+    for (size_t pos = 0; pos < len; pos++) {
+        if (pos % 64 == 0) {
+            memcpy(x, in, sizeof(x));
+            for (int i = 0; i < 10; i++) {
+                QUARTERROUND(x[0], x[4], x[8], x[12]);
+                QUARTERROUND(x[1], x[5], x[9], x[13]);
+                QUARTERROUND(x[2], x[6], x[10], x[14]);
+                QUARTERROUND(x[3], x[7], x[11], x[15]);
+                QUARTERROUND(x[0], x[5], x[10], x[15]);
+                QUARTERROUND(x[1], x[6], x[11], x[12]);
+                QUARTERROUND(x[2], x[7], x[8], x[13]);
+                QUARTERROUND(x[3], x[4], x[9], x[14]);
+            }
+            for (int i = 0; i < 16; i++) {
+                uint32_t w = x[i] + in[i];
+                ks[4 * i] = (uint8_t)w;
+                ks[4 * i + 1] = (uint8_t)(w >> 8);
+                ks[4 * i + 2] = (uint8_t)(w >> 16);
+                ks[4 * i + 3] = (uint8_t)(w >> 24);
+            }
+            if (++in[12] == 0) {
+                in[13]++;
+            }
+        }
+        c[pos] = (m ? m[pos] : 0) ^ ks[pos % 64];
+    }
+}
+
+typedef int64_t gf[16];
+
+static void car25519(gf o)
+{
+    for (int i = 0; i < 16; i++) {
+        o[i] += (1LL << 16);
+        int64_t c = o[i] >> 16;
+        o[(i + 1) * (i < 15)] += c - 1 + 37 * (c - 1) * (i == 15);
+        o[i] -= c * 65536;
+    }
+}
+
+static void sel25519(gf p, gf q, int b)
+{
+    int64_t c = ~(b - 1);
+    for (int i = 0; i < 16; i++) {
+        int64_t t = c & (p[i] ^ q[i]);
+        p[i] ^= t;
+        q[i] ^= t;
+    }
+}
+
+static void pack25519(uint8_t *o, const gf n)
+{
+    gf m, t;
+    memcpy(t, n, sizeof(gf));
+    car25519(t);
+    car25519(t);
+    car25519(t);
+    for (int j = 0; j < 2; j++) {
+        m[0] = t[0] - 0xffed;
+        for (int i = 1; i < 15; i++) {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= 0xffff;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        int b = (m[15] >> 16) & 1;
+        m[14] &= 0xffff;
+        sel25519(t, m, 1 - b);
+    }
+    for (int i = 0; i < 16; i++) {
+        o[2 * i] = t[i] & 0xff;
+        o[2 * i + 1] = t[i] >> 8;
+    }
+}
+
+static void unpack25519(gf o, const uint8_t *n)
+{
+    for (int i = 0; i < 16; i++) {
+        o[i] = n[2 * i] + ((int64_t)n[2 * i + 1] << 8);
+    }
+    o[15] &= 0x7fff;
+}
+
+static void A(gf o, const gf a, const gf b)
+{
+    for (int i = 0; i < 16; i++) {
+        o[i] = a[i] + b[i];
+    }
+}
+
+static void Z(gf o, const gf a, const gf b)
+{
+    for (int i = 0; i < 16; i++) {
+        o[i] = a[i] - b[i];
+    }
+}
+
+static void M(gf o, const gf a, const gf b)
+{
+    int64_t t[31] = { 0 };
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 16; j++) {
+            t[i + j] += a[i] * b[j];
+        }
+    }
+    for (int i = 0; i < 15; i++) {
+        t[i] += 38 * t[i + 16];
+    }
+    for (int i = 0; i < 16; i++) {
+        o[i] = t[i];
+    }
+    car25519(o);
+    car25519(o);
+}
+
+static void inv25519(gf o, const gf i)
+{
+    gf c;
+    memcpy(c, i, sizeof(gf));
+    for (int a = 253; a >= 0; a--) {
+        M(c, c, c);
+        if (a != 2 && a != 4) {
+            M(c, c, i);
+        }
+    }
+    memcpy(o, c, sizeof(gf));
+}
+
+void ref_x25519(uint8_t q[32], const uint8_t n[32], const uint8_t p[32])
+{
+    static const gf _121665 = { 0xDB41, 1 };
+    uint8_t z[32];
+    gf x, a, b, c, d, e, f;
+
+    memcpy(z, n, 32);
+    z[31] = (n[31] & 127) | 64;
+    z[0] &= 248;
+    unpack25519(x, p);
+    for (int i = 0; i < 16; i++) {
+        b[i] = x[i];
+        d[i] = a[i] = c[i] = 0;
+    }
+    a[0] = d[0] = 1;
+    for (int i = 254; i >= 0; --i) {
+        int r = (z[i >> 3] >> (i & 7)) & 1;
+        sel25519(a, b, r);
+        sel25519(c, d, r);
+        A(e, a, c);
+        Z(a, a, c);
+        A(c, b, d);
+        Z(b, b, d);
+        M(d, e, e);
+        M(f, a, a);
+        M(a, c, a);
+        M(c, b, e);
+        A(e, a, c);
+        Z(a, a, c);
+        M(b, a, a);
+        Z(c, d, f);
+        M(a, c, _121665);
+        A(a, a, d);
+        M(c, c, a);
+        M(a, d, f);
+        M(d, b, x);
+        M(b, e, e);
+        sel25519(a, b, r);
+        sel25519(c, d, r);
+    }
+    inv25519(c, c);
+    M(a, a, c);
+    pack25519(q, a);
+}
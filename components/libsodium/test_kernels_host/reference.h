@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Straightforward implementations from the specifications, byte at a time
+   as libsodium's reference code: the expected results, and the baseline of
+   the benchmarks */
+
+/* ChaCha20 with a 64-bit counter in words 12 and 13 and a 64-bit nonce in
+   words 14 and 15, m may be NULL for the key stream itself */
+void ref_chacha20_xor(uint8_t *c, const uint8_t *m, size_t len, const uint8_t nonce[8],
+                      uint64_t ic, const uint8_t key[32]);
+
+/* X25519 as TweetNaCl: 16 limbs of 16 bits in 64-bit integers */
+void ref_x25519(uint8_t q[32], const uint8_t n[32], const uint8_t p[32]);
+
+#ifdef __cplusplus
+}
+#endif
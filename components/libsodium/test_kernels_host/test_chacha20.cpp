@@ -0,0 +1,140 @@
+#include "catch.hpp"
+#include "chacha20_esp32.h"
+#include "reference.h"
+
+#include <string.h>
+#include <random>
+#include <vector>
+#include <chrono>
+
+static void hex_to_bin(const char *hex, uint8_t *bin)
+{
+    for (size_t i = 0; hex[2 * i]; i++) {
+        sscanf(hex + 2 * i, "%2hhx", &bin[i]);
+    }
+}
+
+static uint32_t load32_le(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* The state as libsodium's crypto_stream_chacha20_xor_ic() sets it */
+static void chacha20_state(uint32_t state[16], const uint8_t key[32], const uint8_t nonce[8], uint64_t ic)
+{
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) {
+        state[4 + i] = load32_le(key + 4 * i);
+    }
+    state[12] = (uint32_t)ic;
+    state[13] = (uint32_t)(ic >> 32);
+    state[14] = load32_le(nonce);
+    state[15] = load32_le(nonce + 4);
+}
+
+TEST_CASE("ChaCha20 test vectors", "[chacha20]")
+{
+    SECTION("RFC 8439 2.4.2 (IETF nonce)") {
+        static const char plaintext[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one "
+                                        "tip for the future, sunscreen would be it.";
+        const size_t len = sizeof(plaintext) - 1;
+        uint8_t key[32], expected[len], c[len];
+        uint32_t state[16];
+
+        for (int i = 0; i < 32; i++) {
+            key[i] = i;
+        }
+        hex_to_bin("6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0bf91b65c5524733ab8f593dabcd62b35716"
+                   "39d624e65152ab8f530c359f0861d807ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91ab77937365af9"
+                   "0bbf74a35be6b40b8eedf2785e42874d", expected);
+        /* counter 1, nonce 00000000 0000004a 00000000 */
+        chacha20_state(state, key, (const uint8_t *)"\0\0\0\0\0\0\0\x4a", 0);
+        state[12] = 1;
+        state[13] = 0;
+        state[14] = 0x4a000000;
+        state[15] = 0;
+        esp_chacha20_xor(c, (const uint8_t *)plaintext, len, state);
+        CHECK(memcmp(c, expected, len) == 0);
+        CHECK(state[12] == 3);
+    }
+
+    SECTION("all zero key and nonce (original 64-bit nonce)") {
+        uint8_t key[32] = { 0 }, nonce[8] = { 0 }, expected[64], c[64];
+        uint32_t state[16];
+
+        hex_to_bin("76b8e0ada0f13d90405d6ae55386bd28bdd219b8a08ded1aa836efcc8b770dc7da41597c5157488d7724e03fb8d84a37"
+                   "6a43b8f41518a11cc387b669b2ee6586", expected);
+        chacha20_state(state, key, nonce, 0);
+        esp_chacha20_xor(c, NULL, sizeof(c), state);
+        CHECK(memcmp(c, expected, sizeof(c)) == 0);
+    }
+}
+
+TEST_CASE("ChaCha20 matches the reference", "[chacha20]")
+{
+    std::mt19937 gen(1);
+    std::vector<uint8_t> m(1100), c(1100), expected(1100);
+    uint8_t key[32], nonce[8];
+
+    for (int n = 0; n < 2000; n++) {
+        for (auto &b : m) {
+            b = gen();
+        }
+        for (auto &b : key) {
+            b = gen();
+        }
+        for (auto &b : nonce) {
+            b = gen();
+        }
+        size_t len = n < 200 ? n : gen() % 1024;
+        size_t m_off = gen() % 4, c_off = (n & 1) ? m_off : gen() % 4;
+        /* a counter which carries into the high word in the message */
+        uint64_t ic = (n % 3 == 0) ? 0xfffffffdULL : ((uint64_t)gen() << 32) | gen();
+        bool keystream = n % 7 == 0;
+        uint32_t state[16];
+        INFO("length " << len << ", offsets " << m_off << " " << c_off << ", counter " << ic);
+
+        ref_chacha20_xor(expected.data(), keystream ? NULL : &m[m_off], len, nonce, ic, key);
+        chacha20_state(state, key, nonce, ic);
+        esp_chacha20_xor(&c[c_off], keystream ? NULL : &m[m_off], len, state);
+        REQUIRE(memcmp(&c[c_off], expected.data(), len) == 0);
+        uint64_t next = ic + (len + 63) / 64;
+        CHECK(state[12] == (uint32_t)next);
+        CHECK(state[13] == (uint32_t)(next >> 32));
+
+        /* in place */
+        chacha20_state(state, key, nonce, ic);
+        esp_chacha20_xor(&m[m_off], &m[m_off], len, state);
+        if (!keystream) {
+            REQUIRE(memcmp(&m[m_off], expected.data(), len) == 0);
+        }
+    }
+}
+
+TEST_CASE("ChaCha20 throughput", "[chacha20][perf]")
+{
+    const size_t len = 1024;
+    const int rounds = 5000;
+    std::vector<uint8_t> m(len, 0x5a), c(len);
+    uint8_t key[32] = { 1 }, nonce[8] = { 2 };
+    uint32_t state[16];
+
+    chacha20_state(state, key, nonce, 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        ref_chacha20_xor(c.data(), m.data(), len, nonce, i, key);
+    }
+    double ref_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds / len;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        esp_chacha20_xor(c.data(), m.data(), len, state);
+    }
+    double esp_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds / len;
+
+    printf("ChaCha20, 1 KB messages: reference %.2f ns/byte, esp_chacha20_xor() %.2f ns/byte (%.1fx)\n",
+           ref_ns, esp_ns, ref_ns / esp_ns);
+}
@@ -0,0 +1,127 @@
+#include "catch.hpp"
+#include "x25519_esp32.h"
+#include "reference.h"
+
+#include <string.h>
+#include <random>
+#include <chrono>
+
+static void hex_to_bin(const char *hex, uint8_t *bin)
+{
+    for (size_t i = 0; hex[2 * i]; i++) {
+        sscanf(hex + 2 * i, "%2hhx", &bin[i]);
+    }
+}
+
+static void check_x25519(const char *scalar, const char *u, const char *expected)
+{
+    uint8_t n[32], p[32], q[32], e[32];
+
+    hex_to_bin(scalar, n);
+    hex_to_bin(u, p);
+    hex_to_bin(expected, e);
+    esp_x25519(q, n, p);
+    CHECK(memcmp(q, e, 32) == 0);
+}
+
+TEST_CASE("X25519 test vectors (RFC 7748)", "[x25519]")
+{
+    SECTION("5.2") {
+        check_x25519("a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4",
+                     "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c",
+                     "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552");
+        /* the top bit of u is set, and ignored */
+        check_x25519("4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d",
+                     "e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493",
+                     "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957");
+    }
+
+    SECTION("5.2, iterated") {
+        uint8_t k[32] = { 9 }, u[32] = { 9 }, r[32], e1[32], e1000[32];
+
+        hex_to_bin("422c8e7a6227d7bca1350b3e2bb7279f7897b87bb6854b783c60e80311ae3079", e1);
+        hex_to_bin("684cf59ba83309552800ef566f2f4d3c1c3887c49360e3875f2eb94d99532c51", e1000);
+        for (int i = 1; i <= 1000; i++) {
+            esp_x25519(r, k, u);
+            memcpy(u, k, 32);
+            memcpy(k, r, 32);
+            if (i == 1) {
+                CHECK(memcmp(k, e1, 32) == 0);
+            }
+        }
+        CHECK(memcmp(k, e1000, 32) == 0);
+    }
+
+    SECTION("6.1 Diffie-Hellman") {
+        const char *alice = "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a";
+        const char *bob = "5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb";
+        const char *base = "0900000000000000000000000000000000000000000000000000000000000000";
+        const char *alice_pub = "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a";
+        const char *bob_pub = "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f";
+        const char *shared = "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742";
+
+        check_x25519(alice, base, alice_pub);
+        check_x25519(bob, base, bob_pub);
+        check_x25519(alice, bob_pub, shared);
+        check_x25519(bob, alice_pub, shared);
+    }
+}
+
+TEST_CASE("X25519 matches the reference", "[x25519]")
+{
+    std::mt19937 gen(1);
+    uint8_t n[32], p[32], q[32], expected[32];
+
+    for (int i = 0; i < 500; i++) {
+        for (auto &b : n) {
+            b = gen();
+        }
+        for (auto &b : p) {
+            b = gen();
+        }
+        switch (i % 5) {
+        case 0: /* u >= p, not reduced */
+            memset(p, 0xff, 32);
+            p[0] -= gen() % 19;
+            break;
+        case 1: /* u = 0, and small orders */
+            memset(p, 0, 32);
+            p[0] = (i / 5) % 2;
+            break;
+        case 2: /* p - 1 */
+            memset(p, 0xff, 32);
+            p[0] = 0xec;
+            p[31] = 0x7f;
+            break;
+        default:
+            break;
+        }
+        ref_x25519(expected, n, p);
+        esp_x25519(q, n, p);
+        INFO("case " << i);
+        REQUIRE(memcmp(q, expected, 32) == 0);
+    }
+}
+
+TEST_CASE("X25519 operations per second", "[x25519][perf]")
+{
+    const int rounds = 200;
+    uint8_t n[32] = { 1, 2, 3 }, p[32] = { 9 }, q[32];
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        ref_x25519(q, n, p);
+        n[0] ^= q[0];
+    }
+    double ref_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        esp_x25519(q, n, p);
+        n[0] ^= q[0];
+    }
+    double esp_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    printf("X25519: reference (16-bit limbs) %.0f ops/s, esp_x25519() %.0f ops/s (%.1fx)\n",
+           1e6 / ref_us, 1e6 / esp_us, ref_us / esp_us);
+}
@@ -696,6 +696,40 @@ netconn_send(struct netconn *conn, struct netbuf *buf)
   return err;
 }
 
+/**
+ * Send several datagrams over a UDP or RAW netconn with a single
+ * message to tcpip_thread. Sending stops at the first datagram that fails.
+ *
+ * @param conn the UDP or RAW netconn over which to send data
+ * @param bufs array of num netbufs, each containing one datagram and its destination
+ * @param num number of netbufs in bufs
+ * @param sent if not NULL, receives the number of datagrams sent
+ * @return ERR_OK if all datagrams were sent, else the error for the first one not sent
+ */
+err_t
+netconn_send_batch(struct netconn *conn, struct netbuf *bufs, u16_t num, u16_t *sent)
+{
+  API_MSG_VAR_DECLARE(msg);
+  err_t err;
+
+  LWIP_ERROR("netconn_send_batch: invalid conn", (conn != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_send_batch: invalid bufs", (bufs != NULL) || (num == 0), return ERR_ARG;);
+
+  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_send_batch: sending %"U16_F" datagrams\n", num));
+  API_MSG_VAR_ALLOC(msg);
+  API_MSG_VAR_REF(msg).msg.conn = conn;
+  API_MSG_VAR_REF(msg).msg.msg.bb.bufs = bufs;
+  API_MSG_VAR_REF(msg).msg.msg.bb.num = num;
+  API_MSG_VAR_REF(msg).msg.msg.bb.sent = 0;
+  TCPIP_APIMSG(&API_MSG_VAR_REF(msg), lwip_netconn_do_send_batch, err);
+  if (sent != NULL) {
+    *sent = API_MSG_VAR_REF(msg).msg.msg.bb.sent;
+  }
+  API_MSG_VAR_FREE(msg);
+
+  return err;
+}
+
 /**
  * Send data over a TCP netconn.
  *
@@ -1435,53 +1435,54 @@ lwip_netconn_do_listen(void *m)
 #endif /* LWIP_TCP */
 
 /**
- * Send some data on a RAW or UDP pcb contained in a netconn
- * Called from netconn_send
+ * Send one netbuf on a RAW or UDP pcb contained in a netconn
  *
- * @param msg the api_msg_msg pointing to the connection
+ * @param conn the netconn to send on
+ * @param b the netbuf to send
+ * @return ERR_OK if the data was sent, any other err_t on error
  */
-void
-lwip_netconn_do_send(void *m)
+static err_t
+lwip_netconn_send_netbuf(struct netconn *conn, struct netbuf *b)
 {
-  struct api_msg_msg *msg = (struct api_msg_msg*)m;
+  err_t err;
 
-  if (ERR_IS_FATAL(msg->conn->last_err)) {
-    msg->err = msg->conn->last_err;
+  if (ERR_IS_FATAL(conn->last_err)) {
+    err = conn->last_err;
 #if LWIP_IPV4 && LWIP_IPV6
-  } else if ((msg->conn->flags & NETCONN_FLAG_IPV6_V6ONLY) &&
-             IP_IS_V4MAPPEDV6(&msg->msg.b->addr)) {
+  } else if ((conn->flags & NETCONN_FLAG_IPV6_V6ONLY) &&
+             IP_IS_V4MAPPEDV6(&b->addr)) {
     LWIP_DEBUGF(API_MSG_DEBUG, ("lwip_netconn_do_send: Dropping IPv4 packet on IPv6-only socket"));
-    msg->err = ERR_VAL;
+    err = ERR_VAL;
 #endif /* LWIP_IPV4 && LWIP_IPV6 */
   } else {
-    msg->err = ERR_CONN;
-    if (msg->conn->pcb.tcp != NULL) {
-      switch (NETCONNTYPE_GROUP(msg->conn->type)) {
+    err = ERR_CONN;
+    if (conn->pcb.tcp != NULL) {
+      switch (NETCONNTYPE_GROUP(conn->type)) {
 #if LWIP_RAW
       case NETCONN_RAW:
-        if (ip_addr_isany(&msg->msg.b->addr)) {
-          msg->err = raw_send(msg->conn->pcb.raw, msg->msg.b->p);
+        if (ip_addr_isany(&b->addr)) {
+          err = raw_send(conn->pcb.raw, b->p);
         } else {
-          msg->err = raw_sendto(msg->conn->pcb.raw, msg->msg.b->p, &msg->msg.b->addr);
+          err = raw_sendto(conn->pcb.raw, b->p, &b->addr);
         }
         break;
 #endif
 #if LWIP_UDP
       case NETCONN_UDP:
 #if LWIP_CHECKSUM_ON_COPY
-        if (ip_addr_isany(&msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-          msg->err = udp_send_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-            msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
+        if (ip_addr_isany(&b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+          err = udp_send_chksum(conn->pcb.udp, b->p,
+            b->flags & NETBUF_FLAG_CHKSUM, b->toport_chksum);
         } else {
-          msg->err = udp_sendto_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-            &msg->msg.b->addr, msg->msg.b->port,
-            msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
+          err = udp_sendto_chksum(conn->pcb.udp, b->p,
+            &b->addr, b->port,
+            b->flags & NETBUF_FLAG_CHKSUM, b->toport_chksum);
         }
 #else /* LWIP_CHECKSUM_ON_COPY */
-        if (ip_addr_isany_val(msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-          msg->err = udp_send(msg->conn->pcb.udp, msg->msg.b->p);
+        if (ip_addr_isany_val(b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+          err = udp_send(conn->pcb.udp, b->p);
         } else {
-          msg->err = udp_sendto(msg->conn->pcb.udp, msg->msg.b->p, &msg->msg.b->addr, msg->msg.b->port);
+          err = udp_sendto(conn->pcb.udp, b->p, &b->addr, b->port);
         }
 #endif /* LWIP_CHECKSUM_ON_COPY */
         break;
@@ -1491,6 +1492,45 @@ lwip_netconn_do_send(void *m)
       }
     }
   }
+  return err;
+}
+
+/**
+ * Send some data on a RAW or UDP pcb contained in a netconn
+ * Called from netconn_send
+ *
+ * @param msg the api_msg_msg pointing to the connection
+ */
+void
+lwip_netconn_do_send(void *m)
+{
+  struct api_msg_msg *msg = (struct api_msg_msg*)m;
+
+  msg->err = lwip_netconn_send_netbuf(msg->conn, msg->msg.b);
+  TCPIP_APIMSG_ACK(msg);
+}
+
+/**
+ * Send an array of netbufs on a RAW or UDP pcb contained in a netconn,
+ * stopping at the first one that fails
+ * Called from netconn_send_batch
+ *
+ * @param msg the api_msg_msg pointing to the connection
+ */
+void
+lwip_netconn_do_send_batch(void *m)
+{
+  struct api_msg_msg *msg = (struct api_msg_msg*)m;
+  u16_t i;
+
+  msg->err = ERR_OK;
+  for (i = 0; i < msg->msg.bb.num; i++) {
+    msg->err = lwip_netconn_send_netbuf(msg->conn, &msg->msg.bb.bufs[i]);
+    if (msg->err != ERR_OK) {
+      break;
+    }
+  }
+  msg->msg.bb.sent = i;
   TCPIP_APIMSG_ACK(msg);
 }
 
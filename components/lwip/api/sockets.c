@@ -1452,6 +1452,292 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
   return (err == ERR_OK ? short_size : -1);
 }
 
+#if LWIP_UDP || LWIP_RAW
+/** Most datagrams lwip_sendmmsg() passes to tcpip_thread in one message */
+#define LWIP_SENDMMSG_BATCH 16
+
+/**
+ * Fill a zeroed netbuf with the destination and data of one sendmmsg() datagram.
+ * On error, anything allocated is left in the netbuf for netbuf_free().
+ */
+static err_t
+lwip_sendmmsg_fill(struct lwip_sock *sock, struct netbuf *buf, const struct msghdr *msg, u16_t *size)
+{
+  const struct sockaddr *to = (const struct sockaddr *)msg->msg_name;
+  u16_t remote_port;
+  size_t len = 0;
+  int i;
+
+  if ((msg->msg_iov == NULL && msg->msg_iovlen != 0) || (msg->msg_iovlen < 0) ||
+      ((to == NULL) ? (msg->msg_namelen != 0) :
+       (!IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen) || !IS_SOCK_ADDR_TYPE_VALID(to) || !IS_SOCK_ADDR_ALIGNED(to)))) {
+    return ERR_ARG;
+  }
+  if (to != NULL) {
+    if (!SOCK_ADDR_TYPE_MATCH(to, sock)) {
+      /* sockaddr does not match socket type (IPv4/IPv6) */
+      return ERR_VAL;
+    }
+    SOCKADDR_TO_IPADDR_PORT(to, &buf->addr, remote_port);
+    netbuf_fromport(buf) = remote_port;
+  }
+
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    len += msg->msg_iov[i].iov_len;
+  }
+  if (len > 0xFFFF) {
+    return ERR_VAL;
+  }
+  *size = (u16_t)len;
+
+#if LWIP_NETIF_TX_SINGLE_PBUF
+  if (netbuf_alloc(buf, (u16_t)len) == NULL) {
+    return ERR_MEM;
+  }
+#if LWIP_CHECKSUM_ON_COPY
+  if ((msg->msg_iovlen == 1) && (NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_RAW)) {
+    u16_t chksum = LWIP_CHKSUM_COPY(buf->p->payload, msg->msg_iov[0].iov_base, (u16_t)len);
+    netbuf_set_chksum(buf, chksum);
+    return ERR_OK;
+  }
+#endif /* LWIP_CHECKSUM_ON_COPY */
+  len = 0;
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    MEMCPY((u8_t*)buf->p->payload + len, msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+    len += msg->msg_iov[i].iov_len;
+  }
+#else /* LWIP_NETIF_TX_SINGLE_PBUF */
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
+    if (p == NULL) {
+      return ERR_MEM;
+    }
+    p->payload = msg->msg_iov[i].iov_base;
+    p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
+    if (buf->p == NULL) {
+      buf->p = buf->ptr = p;
+    } else {
+      pbuf_cat(buf->p, p);
+    }
+  }
+#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
+  if (buf->p == NULL) {
+    /* zero length datagram */
+    return netbuf_ref(buf, NULL, 0);
+  }
+  return ERR_OK;
+}
+#endif /* LWIP_UDP || LWIP_RAW */
+
+/**
+ * Send several messages with one call. For UDP and RAW sockets, the datagrams are
+ * passed to tcpip_thread up to LWIP_SENDMMSG_BATCH at a time, in one message.
+ *
+ * Returns the number of messages sent, with msg_len set for each, or -1 and errno
+ * if the first one could not be sent.
+ */
+int
+lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  struct lwip_sock *sock;
+  unsigned int done = 0;
+  err_t err = ERR_OK;
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  LWIP_ERROR("lwip_sendmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    /* no datagrams to batch: send one message after another */
+    for (done = 0; done < vlen; done++) {
+      int ret = lwip_sendmsg(s, &msgvec[done].msg_hdr, flags);
+      if (ret < 0) {
+        /* errno was set by lwip_sendmsg */
+        return (done > 0) ? (int)done : -1;
+      }
+      msgvec[done].msg_len = (unsigned int)ret;
+    }
+    sock_set_errno(sock, 0);
+    return (int)done;
+  }
+
+#if LWIP_UDP || LWIP_RAW
+  LWIP_UNUSED_ARG(flags);
+  if (vlen > 0) {
+    u16_t sizes[LWIP_SENDMMSG_BATCH];
+    struct netbuf *bufs;
+
+    /* one allocation holds the netbufs of a whole batch */
+    bufs = (struct netbuf *)mem_malloc(LWIP_MIN(vlen, LWIP_SENDMMSG_BATCH) * sizeof(struct netbuf));
+    if (bufs == NULL) {
+      sock_set_errno(sock, err_to_errno(ERR_MEM));
+      return -1;
+    }
+
+    while ((done < vlen) && (err == ERR_OK)) {
+      u16_t num, sent = 0, i;
+
+      for (num = 0; (num < LWIP_SENDMMSG_BATCH) && (done + num < vlen); num++) {
+        memset(&bufs[num], 0, sizeof(struct netbuf));
+        err = lwip_sendmmsg_fill(sock, &bufs[num], &msgvec[done + num].msg_hdr, &sizes[num]);
+        if (err != ERR_OK) {
+          netbuf_free(&bufs[num]);
+          break;
+        }
+      }
+      if (num > 0) {
+        err_t send_err = netconn_send_batch(sock->conn, bufs, num, &sent);
+        if (sent < num) {
+          err = send_err;
+        }
+      }
+      for (i = 0; i < num; i++) {
+        if (i < sent) {
+          msgvec[done + i].msg_len = sizes[i];
+        }
+        netbuf_free(&bufs[i]);
+      }
+      done += sent;
+    }
+    mem_free(bufs);
+  }
+
+  if (done == 0 && err != ERR_OK) {
+    sock_set_errno(sock, err_to_errno(err));
+    return -1;
+  }
+  sock_set_errno(sock, 0);
+  return (int)done;
+#else /* LWIP_UDP || LWIP_RAW */
+  sock_set_errno(sock, err_to_errno(ERR_ARG));
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+
+#if LWIP_UDP || LWIP_RAW
+/**
+ * Receive one datagram into a msghdr for lwip_recvmmsg().
+ * Datagrams longer than the iovecs are truncated and flagged with MSG_TRUNC.
+ */
+static err_t
+lwip_recvmmsg_one(struct lwip_sock *sock, struct msghdr *msg, int flags, unsigned int *len)
+{
+  struct netbuf *buf;
+  struct pbuf *p;
+  u16_t off = 0;
+  int i;
+  err_t err;
+
+  if ((msg->msg_iov == NULL && msg->msg_iovlen != 0) || (msg->msg_iovlen < 0)) {
+    return ERR_ARG;
+  }
+
+  if (sock->lastdata) {
+    /* left by a previous MSG_PEEK */
+    buf = (struct netbuf *)sock->lastdata;
+  } else {
+    if (((flags & MSG_DONTWAIT) || netconn_is_nonblocking(sock->conn)) &&
+        (sock->rcvevent <= 0)) {
+      return ERR_WOULDBLOCK;
+    }
+    err = netconn_recv(sock->conn, &buf);
+    if (err != ERR_OK) {
+      return err;
+    }
+    sock->lastdata = buf;
+  }
+
+  p = buf->p;
+  for (i = 0; (i < msg->msg_iovlen) && (off < p->tot_len); i++) {
+    u16_t copylen = (u16_t)LWIP_MIN(msg->msg_iov[i].iov_len, (size_t)(p->tot_len - off));
+    pbuf_copy_partial(p, msg->msg_iov[i].iov_base, copylen, off);
+    off += copylen;
+  }
+  msg->msg_flags = (off < p->tot_len) ? MSG_TRUNC : 0;
+  msg->msg_controllen = 0;
+
+  if (msg->msg_name != NULL) {
+    union sockaddr_aligned saddr;
+    IPADDR_PORT_TO_SOCKADDR(&saddr, netbuf_fromaddr(buf), netbuf_fromport(buf));
+    if (msg->msg_namelen > saddr.sa.sa_len) {
+      msg->msg_namelen = saddr.sa.sa_len;
+    }
+    MEMCPY(msg->msg_name, &saddr, msg->msg_namelen);
+  }
+
+  if ((flags & MSG_PEEK) == 0) {
+    sock->lastdata = NULL;
+    sock->lastoffset = 0;
+    netbuf_delete(buf);
+  }
+  *len = off;
+  return ERR_OK;
+}
+#endif /* LWIP_UDP || LWIP_RAW */
+
+/**
+ * Receive several datagrams with one call. Blocks (subject to MSG_DONTWAIT,
+ * O_NONBLOCK and SO_RCVTIMEO) until the first datagram arrives, then returns it
+ * together with any others already queued, up to vlen.
+ *
+ * The timeout argument is not supported and must be NULL.
+ */
+int
+lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+              struct timeval *timeout)
+{
+  struct lwip_sock *sock;
+  unsigned int done = 0;
+  err_t err = ERR_OK;
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  LWIP_ERROR("lwip_recvmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+  LWIP_ERROR("lwip_recvmmsg: timeout not supported", (timeout == NULL),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    sock_set_errno(sock, EOPNOTSUPP);
+    return -1;
+  }
+
+#if LWIP_UDP || LWIP_RAW
+  for (done = 0; done < vlen; done++) {
+    unsigned int len;
+    err = lwip_recvmmsg_one(sock, &msgvec[done].msg_hdr, flags, &len);
+    if (err != ERR_OK) {
+      break;
+    }
+    msgvec[done].msg_len = len;
+    if (flags & MSG_PEEK) {
+      /* the peeked datagram stays first in line */
+      done++;
+      break;
+    }
+    /* only the first datagram is waited for */
+    flags |= MSG_DONTWAIT;
+  }
+
+  if (done == 0 && err != ERR_OK) {
+    sock_set_errno(sock, err_to_errno(err));
+    return (err == ERR_CLSD) ? 0 : -1;
+  }
+  sock_set_errno(sock, 0);
+  return (int)done;
+#else /* LWIP_UDP || LWIP_RAW */
+  sock_set_errno(sock, err_to_errno(ERR_ARG));
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+
 int
 lwip_socket(int domain, int type, int protocol)
 {
@@ -3205,6 +3491,23 @@ lwip_sendmsg_r(int s, const struct msghdr *msg, int flags)
   LWIP_API_UNLOCK();
 }
 
+int
+lwip_sendmmsg_r(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  LWIP_API_LOCK();
+  __ret = lwip_sendmmsg(s, msgvec, vlen, flags);
+  LWIP_API_UNLOCK();
+}
+
+int
+lwip_recvmmsg_r(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+              struct timeval *timeout)
+{
+  LWIP_API_LOCK();
+  __ret = lwip_recvmmsg(s, msgvec, vlen, flags, timeout);
+  LWIP_API_UNLOCK();
+}
+
 int
 lwip_write_r(int s, const void *data, size_t size)
 {
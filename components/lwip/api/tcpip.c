@@ -96,11 +96,11 @@ tcpip_thread(void *arg)
 
 
     /* MAIN Loop */
-    UNLOCK_TCPIP_CORE();
     LWIP_TCPIP_THREAD_ALIVE();
-    /* wait for a message, timeouts are processed while waiting */
+    /* wait for a message, timeouts are processed while waiting. With
+       LWIP_TCPIP_CORE_LOCKING, the core lock is only released while waiting,
+       so the timeout list is never walked without it */
     sys_timeouts_mbox_fetch(&mbox, (void **)&msg);
-    LOCK_TCPIP_CORE();
     
 
     
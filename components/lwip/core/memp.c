@@ -430,3 +430,232 @@ memp_free(memp_t type, void *mem)
 }
 
 #endif /* MEMP_MEM_MALLOC */
+
+#if MEMP_MEM_MALLOC && ESP_MEMP_POOLS
+/*
+ * The memp types allocated for (nearly) every packet come from fixed pools,
+ * all other types from mem_malloc().
+ *
+ * A pool's free list is a stack of element numbers. Elements are allocated by
+ * lwIP, driver and application tasks on both CPUs, so the list head is updated
+ * with compare-and-set rather than under SYS_ARCH_PROTECT. The upper half of the
+ * head is a generation count, bumped on every update, so that a pop which raced
+ * with other tasks popping and pushing back the same element fails (ABA).
+ *
+ * When a pool is empty the element comes from mem_malloc(). memp_free() tells
+ * the two apart by address.
+ */
+
+struct memp_esp_pool {
+  /** generation << 16 | (number of the first free element + 1), 0 if empty */
+  volatile u32_t head;
+  /** element number + 1 of the next free element, for each element */
+  u16_t *next;
+  u8_t *base;
+  u16_t num;
+  u16_t size;
+};
+
+#define MEMP_ESP_POOL_DECLARE(name, num, type) \
+  static u32_t memp_esp_memory_ ## name[(num) * LWIP_MEM_ALIGN_SIZE(sizeof(type)) / sizeof(u32_t)]; \
+  static u16_t memp_esp_next_ ## name[(num)];
+
+#define MEMP_ESP_POOL_INIT(name, type) \
+  memp_esp_pool_init(MEMP_ ## name, (u8_t *)memp_esp_memory_ ## name, memp_esp_next_ ## name, \
+                     LWIP_ARRAYSIZE(memp_esp_next_ ## name), LWIP_MEM_ALIGN_SIZE(sizeof(type)))
+
+#define MEMP_ESP_HEAD_NEXT_GEN(head)  (((head) + 0x10000) & 0xffff0000)
+
+#if ESP_MEMP_NUM_PBUF
+MEMP_ESP_POOL_DECLARE(PBUF, ESP_MEMP_NUM_PBUF, struct pbuf)
+#endif
+#if LWIP_TCP && ESP_MEMP_NUM_TCP_SEG
+MEMP_ESP_POOL_DECLARE(TCP_SEG, ESP_MEMP_NUM_TCP_SEG, struct tcp_seg)
+#endif
+#if (LWIP_NETCONN || LWIP_SOCKET) && ESP_MEMP_NUM_NETBUF
+MEMP_ESP_POOL_DECLARE(NETBUF, ESP_MEMP_NUM_NETBUF, struct netbuf)
+#endif
+#if !NO_SYS && ESP_MEMP_NUM_TCPIP_MSG
+MEMP_ESP_POOL_DECLARE(TCPIP_MSG_API, ESP_MEMP_NUM_TCPIP_MSG, struct tcpip_msg)
+#if !LWIP_TCPIP_CORE_LOCKING_INPUT
+MEMP_ESP_POOL_DECLARE(TCPIP_MSG_INPKT, ESP_MEMP_NUM_TCPIP_MSG, struct tcpip_msg)
+#endif
+#endif
+
+/* types without a pool have num == 0 */
+static struct memp_esp_pool memp_esp_pools[MEMP_MAX];
+
+/* uxPortCompareSet() has no "memory" clobber, so without the barriers the
+   compiler could sink a push's next[] store below the S32C1I (another CPU
+   could pop the element and follow a stale link), or hoist a pop's next[]
+   load above it. S32C1I itself orders the accesses in hardware. */
+static inline int
+memp_esp_cas(volatile u32_t *addr, u32_t compare, u32_t set)
+{
+  __asm__ __volatile__("" ::: "memory");
+  uxPortCompareSet(addr, compare, &set);
+  __asm__ __volatile__("" ::: "memory");
+  return set == compare;
+}
+
+#if MEMP_STATS
+static void
+memp_esp_stats_used(memp_t type, int delta)
+{
+  /* mem_size_t is 32 bit with MEM_LIBC_MALLOC */
+  volatile u32_t *used = (volatile u32_t *)&lwip_stats.memp[type].used;
+  u32_t old;
+
+  do {
+    old = *used;
+  } while (!memp_esp_cas(used, old, old + delta));
+
+  /* the high-water mark may miss a concurrent update, which is good enough */
+  if (old + delta > lwip_stats.memp[type].max) {
+    lwip_stats.memp[type].max = old + delta;
+  }
+}
+#define MEMP_ESP_STATS_USED(type, delta) memp_esp_stats_used((type), (delta))
+#else /* MEMP_STATS */
+#define MEMP_ESP_STATS_USED(type, delta)
+#endif /* MEMP_STATS */
+
+static inline void
+memp_esp_pool_init(memp_t type, u8_t *base, u16_t *next, u16_t num, u16_t size)
+{
+  struct memp_esp_pool *pool = &memp_esp_pools[type];
+  u16_t i;
+
+  LWIP_ASSERT("memp_esp_pool_init: element size", size == memp_pools[type]->size);
+
+  /* element i links to element i + 1, the last one ends the list */
+  for (i = 0; i < num; i++) {
+    next[i] = (i + 1 < num) ? i + 2 : 0;
+  }
+  pool->next = next;
+  pool->base = base;
+  pool->num = num;
+  pool->size = size;
+  pool->head = 1;
+  MEMP_STATS_AVAIL(avail, type, num);
+}
+
+static void *
+memp_esp_pool_pop(struct memp_esp_pool *pool)
+{
+  u32_t head;
+  u32_t first;
+
+  do {
+    head = pool->head;
+    first = head & 0xffff;
+    if (first == 0) {
+      return NULL;
+    }
+  } while (!memp_esp_cas(&pool->head, head, MEMP_ESP_HEAD_NEXT_GEN(head) | pool->next[first - 1]));
+
+  return pool->base + (first - 1) * pool->size;
+}
+
+static void
+memp_esp_pool_push(struct memp_esp_pool *pool, u32_t element)
+{
+  u32_t head;
+
+  do {
+    head = pool->head;
+    pool->next[element] = (u16_t)(head & 0xffff);
+  } while (!memp_esp_cas(&pool->head, head, MEMP_ESP_HEAD_NEXT_GEN(head) | (element + 1)));
+}
+
+/**
+ * Initializes the memp pools.
+ */
+void
+memp_init(void)
+{
+#if ESP_MEMP_NUM_PBUF
+  MEMP_ESP_POOL_INIT(PBUF, struct pbuf);
+#endif
+#if LWIP_TCP && ESP_MEMP_NUM_TCP_SEG
+  MEMP_ESP_POOL_INIT(TCP_SEG, struct tcp_seg);
+#endif
+#if (LWIP_NETCONN || LWIP_SOCKET) && ESP_MEMP_NUM_NETBUF
+  MEMP_ESP_POOL_INIT(NETBUF, struct netbuf);
+#endif
+#if !NO_SYS && ESP_MEMP_NUM_TCPIP_MSG
+  MEMP_ESP_POOL_INIT(TCPIP_MSG_API, struct tcpip_msg);
+#if !LWIP_TCPIP_CORE_LOCKING_INPUT
+  MEMP_ESP_POOL_INIT(TCPIP_MSG_INPKT, struct tcpip_msg);
+#endif
+#endif
+}
+
+/**
+ * Get an element from a specific pool, or from the heap if that type
+ * has no pool or its pool is empty.
+ *
+ * @param type the pool to get an element from
+ *
+ * @return a pointer to the allocated memory or a NULL pointer on error
+ */
+void *
+memp_malloc(memp_t type)
+{
+  struct memp_esp_pool *pool;
+  void *mem = NULL;
+
+  LWIP_ERROR("memp_malloc: type < MEMP_MAX", (type < MEMP_MAX), return NULL;);
+
+  ESP_CNT_MEM_MALLOC_INC(type);
+  pool = &memp_esp_pools[type];
+  if (pool->num != 0) {
+    mem = memp_esp_pool_pop(pool);
+    if (mem == NULL) {
+      /* pool exhausted, counted so the pool size can be tuned */
+      MEMP_STATS_INC(err, type);
+    }
+  }
+  if (mem == NULL) {
+    mem = mem_malloc(memp_pools[type]->size);
+    if (mem == NULL && pool->num == 0) {
+      MEMP_STATS_INC(err, type);
+    }
+  }
+  if (mem != NULL) {
+    MEMP_ESP_STATS_USED(type, 1);
+  }
+  return mem;
+}
+
+/**
+ * Put an element back into its pool, or free it to the heap if it
+ * didn't come from the pool.
+ *
+ * @param type the pool where to put mem
+ * @param mem the memp element to free
+ */
+void
+memp_free(memp_t type, void *mem)
+{
+  struct memp_esp_pool *pool;
+  u8_t *p = (u8_t *)mem;
+
+  LWIP_ERROR("memp_free: type < MEMP_MAX", (type < MEMP_MAX), return;);
+
+  if (mem == NULL) {
+    return;
+  }
+
+  ESP_CNT_MEM_FREE_INC(type);
+  MEMP_ESP_STATS_USED(type, -1);
+  pool = &memp_esp_pools[type];
+  if (pool->num != 0 && p >= pool->base && p < pool->base + pool->num * pool->size) {
+    LWIP_ASSERT("memp_free: misaligned pool element", ((p - pool->base) % pool->size) == 0);
+    memp_esp_pool_push(pool, (u32_t)(p - pool->base) / pool->size);
+  } else {
+    mem_free(mem);
+  }
+}
+
+#endif /* MEMP_MEM_MALLOC && ESP_MEMP_POOLS */
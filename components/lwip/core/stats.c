@@ -195,6 +195,10 @@ void stats_display_esp(struct stats_esp *esp)
   LWIP_PLATFORM_DIAG(("esp.tcpip_cb_post_fail:  %"U32_F"\n\t", (u32_t)esp->tcpip_cb_post_fail));
   LWIP_PLATFORM_DIAG(("esp.wlanif_input_pbuf_fail:  %"U32_F"\n\t", (u32_t)esp->wlanif_input_pbuf_fail));
   LWIP_PLATFORM_DIAG(("esp.wlanif_outut_pbuf_fail:  %"U32_F"\n\t", (u32_t)esp->wlanif_outut_pbuf_fail));
+  LWIP_PLATFORM_DIAG(("esp.wlanif_rx_ref:  %"U32_F"\n\t", (u32_t)esp->wlanif_rx_ref));
+  LWIP_PLATFORM_DIAG(("esp.wlanif_rx_copy:  %"U32_F"\n\t", (u32_t)esp->wlanif_rx_copy));
+  LWIP_PLATFORM_DIAG(("esp.wlanif_rx_pool_empty:  %"U32_F"\n\t", (u32_t)esp->wlanif_rx_pool_empty));
+  LWIP_PLATFORM_DIAG(("esp.wlanif_rx_held_max:  %"U32_F"\n\t", (u32_t)esp->wlanif_rx_held_max));
 }
 #endif
 
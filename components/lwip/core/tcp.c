@@ -908,8 +908,11 @@ tcp_slowtmr_start:
           ++pcb->rtime;
         }
 
-        if (pcb->unacked != NULL && pcb->rtime >= pcb->rto) {
-          /* Time for a retransmission. */
+        if (pcb->unacked != NULL && pcb->rtime >= pcb->rto &&
+            tcp_rexmit_rto_prepare(pcb) == ERR_OK) {
+          /* Time for a retransmission. A segment the netif still holds
+             can't be resent yet: the timer stays expired and this is
+             retried on the next tick, without backing off. */
           LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_slowtmr: rtime %"S16_F
                                       " pcb->rto %"S16_F"\n",
                                       pcb->rtime, pcb->rto));
@@ -938,7 +941,7 @@ tcp_slowtmr_start:
 
           /* The following needs to be called AFTER cwnd is set to one
              mss - STJ */
-          tcp_rexmit_rto(pcb);
+          tcp_rexmit_rto_commit(pcb);
         }
       }
     }
@@ -95,6 +95,17 @@
 /* Forward declarations.*/
 static err_t tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb);
 
+/* Check if a segment's pbufs are used by someone else than TCP.
+ * This can happen on retransmission if the pbuf of this segment is still
+ * referenced by the netif driver due to deferred (zero copy) transmission.
+ * Such a segment must not have its header rewritten until the driver is done.
+ */
+static int
+tcp_output_segment_busy(struct tcp_seg *seg)
+{
+  return seg->p->ref != 1;
+}
+
 /** Allocate a pbuf and create a tcphdr at p->payload, used for output
  * functions other than the default tcp_output -> tcp_output_segment
  * (e.g. tcp_send_empty_ack, etc.)
@@ -1142,6 +1153,13 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
   u32_t *opts;
   struct netif *netif;
 
+  if (tcp_output_segment_busy(seg)) {
+    /* This should not happen: rexmit functions should have checked this.
+       However, since this function modifies p->len, we must not continue in this case. */
+    LWIP_DEBUGF(TCP_RTO_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_output_segment: segment busy\n"));
+    return ERR_OK;
+  }
+
   /** @bug Exclude retransmitted segments from this count. */
   MIB2_STATS_INC(mib2.tcpoutsegs);
 
@@ -1355,21 +1373,34 @@ tcp_rst(u32_t seqno, u32_t ackno,
 /**
  * Requeue all unacked segments for retransmission
  *
- * Called by tcp_slowtmr() for slow retransmission.
+ * Called by tcp_slowtmr() for slow retransmission, which backs off the
+ * retransmission timer between this and tcp_rexmit_rto_commit(), and only
+ * if this succeeded.
  *
  * @param pcb the tcp_pcb for which to re-enqueue all unacked segments
+ * @return ERR_OK if the segments were requeued, ERR_VAL if there is nothing
+ *         to retransmit or a segment is still being transmitted
  */
-void
-tcp_rexmit_rto(struct tcp_pcb *pcb)
+err_t
+tcp_rexmit_rto_prepare(struct tcp_pcb *pcb)
 {
   struct tcp_seg *seg;
 
   if (pcb->unacked == NULL) {
-    return;
+    return ERR_VAL;
   }
 
   /* Move all unacked segments to the head of the unsent queue */
-  for (seg = pcb->unacked; seg->next != NULL; seg = seg->next);
+  for (seg = pcb->unacked; seg->next != NULL; seg = seg->next) {
+    if (tcp_output_segment_busy(seg)) {
+      LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_rexmit_rto: segment busy\n"));
+      return ERR_VAL;
+    }
+  }
+  if (tcp_output_segment_busy(seg)) {
+    LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_rexmit_rto: segment busy\n"));
+    return ERR_VAL;
+  }
   /* concatenate unsent queue after unacked queue */
   seg->next = pcb->unsent;
 #if TCP_OVERSIZE_DBGCHECK
@@ -1383,6 +1414,17 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
   /* unacked queue is now empty */
   pcb->unacked = NULL;
 
+  return ERR_OK;
+}
+
+/**
+ * Send the segments requeued by tcp_rexmit_rto_prepare()
+ *
+ * @param pcb the tcp_pcb for which to retransmit the requeued segments
+ */
+void
+tcp_rexmit_rto_commit(struct tcp_pcb *pcb)
+{
   /* increment number of retransmissions */
   ++pcb->nrtx;
 
@@ -1393,26 +1435,53 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
   tcp_output(pcb);
 }
 
+/**
+ * Requeue all unacked segments and retransmit them
+ *
+ * @param pcb the tcp_pcb for which to retransmit all unacked segments
+ * @return ERR_OK if the segments were retransmitted, ERR_VAL if there is
+ *         nothing to retransmit or a segment is still being transmitted
+ */
+err_t
+tcp_rexmit_rto(struct tcp_pcb *pcb)
+{
+  err_t err = tcp_rexmit_rto_prepare(pcb);
+  if (err == ERR_OK) {
+    tcp_rexmit_rto_commit(pcb);
+  }
+  return err;
+}
+
 /**
  * Requeue the first unacked segment for retransmission
  *
  * Called by tcp_receive() for fast retramsmit.
  *
  * @param pcb the tcp_pcb for which to retransmit the first unacked segment
+ * @return ERR_OK if the segment was requeued, ERR_VAL if there is nothing to
+ *         retransmit or the segment is still being transmitted
  */
-void
+err_t
 tcp_rexmit(struct tcp_pcb *pcb)
 {
   struct tcp_seg *seg;
   struct tcp_seg **cur_seg;
 
   if (pcb->unacked == NULL) {
-    return;
+    return ERR_VAL;
+  }
+
+  seg = pcb->unacked;
+
+  /* Give up if the segment is still referenced by the netif driver
+     due to deferred transmission. */
+  if (tcp_output_segment_busy(seg)) {
+    LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_rexmit busy\n"));
+    return ERR_VAL;
   }
 
   /* Move the first unacked segment to the unsent queue */
   /* Keep the unsent queue sorted. */
-  seg = pcb->unacked;
   pcb->unacked = seg->next;
 
   cur_seg = &(pcb->unsent);
@@ -1439,6 +1508,7 @@ tcp_rexmit(struct tcp_pcb *pcb)
   MIB2_STATS_INC(mib2.tcpretranssegs);
   /* No need to call tcp_output: we are always called from tcp_input()
      and thus tcp_output directly returns. */
+  return ERR_OK;
 }
 
 
@@ -1457,7 +1527,9 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
                  "), fast retransmit %"U32_F"\n",
                  (u16_t)pcb->dupacks, pcb->lastack,
                  ntohl(pcb->unacked->tcphdr->seqno)));
-    tcp_rexmit(pcb);
+    if (tcp_rexmit(pcb) != ERR_OK) {
+      return;
+    }
 
     /* Set ssthresh to half of the minimum of the current
      * cwnd and the advertised window */
@@ -66,6 +66,13 @@
 static struct sys_timeo *next_timeout;
 #if NO_SYS
 static u32_t timeouts_last_time;
+#elif LWIP_TCPIP_CORE_LOCKING
+/* With core locking, other threads add and remove timeouts while tcpip_thread
+ * waits for a message, so the time of the first timeout is kept relative to
+ * timeouts_last_time instead of to the start of the current wait. */
+static u32_t timeouts_last_time;
+/** The mbox tcpip_thread is waiting on, NULL while it is running */
+static sys_mbox_t *timeouts_mbox;
 #endif /* NO_SYS */
 
 #if LWIP_TCP
@@ -330,6 +337,22 @@ void sys_timeouts_init(void)
  * @param handler callback function to call when msecs have elapsed
  * @param arg argument to pass to the callback function
  */
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+/** Charge the time elapsed since timeouts_last_time to the first timeout.
+ * Called with the core lock held. */
+static void
+sys_timeouts_rebase(void)
+{
+  u32_t now = sys_now();
+  u32_t diff = now - timeouts_last_time;
+
+  timeouts_last_time = now;
+  if (next_timeout != NULL) {
+    next_timeout->time = (diff < next_timeout->time) ? next_timeout->time - diff : 0;
+  }
+}
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
+
 #if LWIP_DEBUG_TIMERNAMES
 void
 sys_timeout_debug(u32_t msecs, sys_timeout_handler handler, void *arg, const char* handler_name)
@@ -384,12 +407,13 @@ sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
     (void *)timeout, msecs, handler_name, (void *)arg));
 #endif /* LWIP_DEBUG_TIMERNAMES */
 
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+  sys_timeouts_rebase();
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
+
   if (next_timeout == NULL) {
     next_timeout = timeout;
-    return;
-  }
-
-  if (next_timeout->time > msecs) {
+  } else if (next_timeout->time > msecs) {
     next_timeout->time -= msecs;
     timeout->next = next_timeout;
     next_timeout = timeout;
@@ -406,6 +430,14 @@ sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
       }
     }
   }
+
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+  if (timeouts_mbox != NULL && next_timeout == timeout) {
+    /* tcpip_thread is sleeping until a later timeout: wake it with an empty
+       message. If the mbox is full, it is about to wake up anyway. */
+    sys_mbox_trypost(timeouts_mbox, NULL);
+  }
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
 }
 
 /**
@@ -526,6 +558,71 @@ sys_timeouts_sleeptime(void)
   }
 }
 
+#elif LWIP_TCPIP_CORE_LOCKING
+
+/**
+ * Wait (forever) for a message to arrive in an mbox.
+ * While waiting, timeouts are processed.
+ *
+ * Called with the core lock held. The lock is released while waiting, and
+ * timeout handlers are called with it held.
+ *
+ * @param mbox the mbox to fetch the message from
+ * @param msg the place to store the message
+ */
+void
+sys_timeouts_mbox_fetch(sys_mbox_t *mbox, void **msg)
+{
+  struct sys_timeo *tmptimeout;
+  sys_timeout_handler handler;
+  void *arg;
+  u32_t sleeptime;
+  u32_t res;
+
+  LWIP_ASSERT("sys_timeouts_mbox_fetch: core not locked", sys_tcpip_core_locked());
+
+ again:
+  sys_timeouts_rebase();
+  tmptimeout = next_timeout;
+  if (tmptimeout != NULL && tmptimeout->time == 0) {
+    next_timeout = tmptimeout->next;
+    handler = tmptimeout->h;
+    arg = tmptimeout->arg;
+#if LWIP_DEBUG_TIMERNAMES
+    if (handler != NULL) {
+      LWIP_DEBUGF(TIMERS_DEBUG, ("stmf calling h=%s arg=%p\n",
+        tmptimeout->handler_name, arg));
+    }
+#endif /* LWIP_DEBUG_TIMERNAMES */
+    memp_free(MEMP_SYS_TIMEOUT, tmptimeout);
+    if (handler != NULL) {
+      handler(arg);
+    }
+    LWIP_TCPIP_THREAD_ALIVE();
+    goto again;
+  }
+
+  sleeptime = (tmptimeout != NULL) ? tmptimeout->time : 0;
+  timeouts_mbox = mbox;
+  UNLOCK_TCPIP_CORE();
+  res = sys_arch_mbox_fetch(mbox, msg, sleeptime);
+  LOCK_TCPIP_CORE();
+  timeouts_mbox = NULL;
+
+  if (res == SYS_ARCH_TIMEOUT) {
+    sys_timeouts_rebase();
+    if (next_timeout != NULL && next_timeout == tmptimeout) {
+      /* sys_arch_mbox_fetch() rounds down to whole ticks: don't spin until sys_now() catches up */
+      next_timeout->time = 0;
+    }
+    goto again;
+  }
+  if (*msg == NULL) {
+    /* woken up by sys_timeout() */
+    goto again;
+  }
+}
+
 #else /* NO_SYS */
 
 /**
@@ -70,6 +70,11 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
 
 #include "lwip/mem.h"
 
+#if ESP_MEMP_POOLS
+void  memp_init(void);
+void *memp_malloc(memp_t type);
+void  memp_free(memp_t type, void *mem);
+#else /* ESP_MEMP_POOLS */
 #define memp_init()
 #if ESP_STATS_MEM
 static inline void* memp_malloc(int type)
@@ -90,6 +95,7 @@ static inline void memp_free(int type, void *mem)
 #define memp_malloc(type)     mem_malloc(memp_pools[type]->size)
 #define memp_free(type, mem)  mem_free(mem)
 #endif
+#endif /* ESP_MEMP_POOLS */
 
 #define LWIP_MEMPOOL_DECLARE(name,num,size,desc) \
   const struct memp_desc memp_ ## name = { \
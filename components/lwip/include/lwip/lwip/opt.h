@@ -3031,6 +3031,51 @@
 #define ESP_L2_TO_L3_COPY                   0
 #endif
 
+/**
+ * ESP_WLAN_RX_POOL_NUM: number of preallocated buffers WiFi frames are copied
+ * into when too many WiFi driver RX buffers are held by the stack (0 = no pool)
+ */
+#ifndef ESP_WLAN_RX_POOL_NUM
+#define ESP_WLAN_RX_POOL_NUM                0
+#endif
+
+/**
+ * ESP_WLAN_RX_FREE_WATERMARK: WiFi driver RX buffers to keep free before
+ * frames are copied into the pool
+ */
+#ifndef ESP_WLAN_RX_FREE_WATERMARK
+#define ESP_WLAN_RX_FREE_WATERMARK          0
+#endif
+
+/**
+ * ESP_MEMP_POOLS==1: allocate the memp types below from fixed pools when
+ * MEMP_MEM_MALLOC is set. Other types, and allocations made while a pool is
+ * empty, use mem_malloc. A count of 0 leaves that type on mem_malloc.
+ */
+#ifndef ESP_MEMP_POOLS
+#define ESP_MEMP_POOLS                      0
+#endif
+
+#ifndef ESP_MEMP_NUM_PBUF
+#define ESP_MEMP_NUM_PBUF                   0
+#endif
+
+#ifndef ESP_MEMP_NUM_TCP_SEG
+#define ESP_MEMP_NUM_TCP_SEG                0
+#endif
+
+#ifndef ESP_MEMP_NUM_NETBUF
+#define ESP_MEMP_NUM_NETBUF                 0
+#endif
+
+/**
+ * ESP_MEMP_NUM_TCPIP_MSG: size of each of the TCPIP_MSG_INPKT and
+ * TCPIP_MSG_API pools
+ */
+#ifndef ESP_MEMP_NUM_TCPIP_MSG
+#define ESP_MEMP_NUM_TCPIP_MSG              0
+#endif
+
 #ifndef ESP_THREAD_SAFE_DEBUG
 #define ESP_THREAD_SAFE_DEBUG               0
 #endif
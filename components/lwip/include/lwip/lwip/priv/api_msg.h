@@ -85,6 +85,12 @@ struct api_msg_msg {
   union {
     /** used for lwip_netconn_do_send */
     struct netbuf *b;
+    /** used for lwip_netconn_do_send_batch */
+    struct {
+      struct netbuf *bufs;
+      u16_t num;
+      u16_t sent;
+    } bb;
     /** used for lwip_netconn_do_newconn */
     struct {
       u8_t proto;
@@ -231,6 +237,7 @@ void lwip_netconn_do_connect         (void *m);
 void lwip_netconn_do_disconnect      (void *m);
 void lwip_netconn_do_listen          (void *m);
 void lwip_netconn_do_send            (void *m);
+void lwip_netconn_do_send_batch      (void *m);
 void lwip_netconn_do_recv            (void *m);
 void lwip_netconn_do_write           (void *m);
 void lwip_netconn_do_getaddr         (void *m);
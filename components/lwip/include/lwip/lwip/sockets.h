@@ -155,6 +155,12 @@ struct msghdr {
   int           msg_flags;
 };
 
+/* One datagram for sendmmsg()/recvmmsg() */
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int  msg_len;   /* bytes sent or received */
+};
+
 /* Socket protocol types (TCP/UDP/RAW) */
 #define SOCK_STREAM     1
 #define SOCK_DGRAM      2
@@ -233,6 +239,9 @@ struct linger {
 #define MSG_DONTWAIT   0x08    /* Nonblocking i/o for this operation only */
 #define MSG_MORE       0x10    /* Sender will send more */
 
+/* Flags returned in msghdr.msg_flags */
+#define MSG_TRUNC      0x04    /* Datagram was longer than the buffers supplied */
+
 
 /*
  * Options for level IPPROTO_IP
@@ -484,6 +493,8 @@ void lwip_socket_thread_cleanup(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: destro
 #define lwip_recvfrom     recvfrom
 #define lwip_send         send
 #define lwip_sendmsg      sendmsg
+#define lwip_sendmmsg     sendmmsg
+#define lwip_recvmmsg     recvmmsg
 #define lwip_sendto       sendto
 #define lwip_socket       socket
 #define lwip_select       select
@@ -517,6 +528,9 @@ int lwip_recvfrom(int s, void *mem, size_t len, int flags,
       struct sockaddr *from, socklen_t *fromlen);
 int lwip_send(int s, const void *dataptr, size_t size, int flags);
 int lwip_sendmsg(int s, const struct msghdr *message, int flags);
+int lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+int lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+      struct timeval *timeout);
 int lwip_sendto(int s, const void *dataptr, size_t size, int flags,
     const struct sockaddr *to, socklen_t tolen);
 int lwip_socket(int domain, int type, int protocol);
@@ -548,6 +562,9 @@ int lwip_recvfrom_r(int s, void *mem, size_t len, int flags,
       struct sockaddr *from, socklen_t *fromlen);
 int lwip_send_r(int s, const void *dataptr, size_t size, int flags);
 int lwip_sendmsg_r(int s, const struct msghdr *message, int flags);
+int lwip_sendmmsg_r(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+int lwip_recvmmsg_r(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+      struct timeval *timeout);
 int lwip_sendto_r(int s, const void *dataptr, size_t size, int flags,
     const struct sockaddr *to, socklen_t tolen);
 int lwip_socket(int domain, int type, int protocol);
@@ -586,6 +603,10 @@ static inline int send(int s,const void *dataptr,size_t size,int flags)
 { return lwip_send_r(s,dataptr,size,flags); }
 static inline int sendmsg(int s,const struct msghdr *message,int flags)
 { return lwip_sendmsg_r(s,message,flags); }
+static inline int sendmmsg(int s,struct mmsghdr *msgvec,unsigned int vlen,int flags)
+{ return lwip_sendmmsg_r(s,msgvec,vlen,flags); }
+static inline int recvmmsg(int s,struct mmsghdr *msgvec,unsigned int vlen,int flags,struct timeval *timeout)
+{ return lwip_recvmmsg_r(s,msgvec,vlen,flags,timeout); }
 static inline int sendto(int s,const void *dataptr,size_t size,int flags,const struct sockaddr *to,socklen_t tolen)
 { return lwip_sendto_r(s,dataptr,size,flags,to,tolen); }
 static inline int socket(int domain,int type,int protocol)
@@ -640,6 +661,10 @@ static inline int send(int s,const void *dataptr,size_t size,int flags)
 { return lwip_send(s,dataptr,size,flags); }
 static inline int sendmsg(int s,const struct msghdr *message,int flags)
 { return lwip_sendmsg(s,message,flags); }
+static inline int sendmmsg(int s,struct mmsghdr *msgvec,unsigned int vlen,int flags)
+{ return lwip_sendmmsg(s,msgvec,vlen,flags); }
+static inline int recvmmsg(int s,struct mmsghdr *msgvec,unsigned int vlen,int flags,struct timeval *timeout)
+{ return lwip_recvmmsg(s,msgvec,vlen,flags,timeout); }
 static inline int sendto(int s,const void *dataptr,size_t size,int flags,const struct sockaddr *to,socklen_t tolen)
 { return lwip_sendto(s,dataptr,size,flags,to,tolen); }
 static inline int socket(int domain,int type,int protocol)
@@ -228,6 +228,12 @@ struct stats_esp {
     /* memory malloc/free/failed stats */
     u32_t  wlanif_input_pbuf_fail;
     u32_t  wlanif_outut_pbuf_fail;
+
+    /* wifi rx buffer stats */
+    u32_t  wlanif_rx_ref;           /* frames passed up in the driver's buffer */
+    u32_t  wlanif_rx_copy;          /* frames copied into the rx pool */
+    u32_t  wlanif_rx_pool_empty;    /* frames that should have been copied, but the pool was empty */
+    u32_t  wlanif_rx_held_max;      /* most driver buffers held by the stack at once */
 };
 
 struct stats_ {
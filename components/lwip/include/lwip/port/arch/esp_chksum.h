@@ -0,0 +1,48 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __ESP_CHKSUM_H__
+#define __ESP_CHKSUM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Internet checksum used as LWIP_CHKSUM.
+ *
+ * Same result as lwIP's lwip_standard_chksum(): the non-inverted ones'
+ * complement sum of the data, in host byte order. The bulk of the data is
+ * summed a 32-bit word at a time (in assembly on Xtensa).
+ *
+ * @param dataptr start of the data, may be at any alignment
+ * @param len number of bytes, at most 0xFFFF
+ */
+uint16_t esp_lwip_chksum(const void *dataptr, int len);
+
+/**
+ * Copy and checksum in one pass, used as LWIP_CHKSUM_COPY.
+ *
+ * Same as memcpy() followed by esp_lwip_chksum(dst, len).
+ */
+uint16_t esp_lwip_chksum_copy(void *dst, const void *src, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ESP_CHKSUM_H__ */
@@ -73,6 +73,10 @@ sys_sem_t* sys_thread_sem_init(void);
 void sys_thread_sem_deinit(void);
 sys_sem_t* sys_thread_sem_get(void);
 
+void sys_lock_tcpip_core(void);
+void sys_unlock_tcpip_core(void);
+int sys_tcpip_core_locked(void);
+
 #ifdef __cplusplus
 }
 #endif
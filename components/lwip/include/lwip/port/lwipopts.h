@@ -42,6 +42,7 @@
 #include "esp_task.h"
 #include "esp_system.h"
 #include "sdkconfig.h"
+#include "arch/esp_chksum.h"
 
 /* Enable all Espressif-only options */
 
@@ -90,6 +91,18 @@
 */
 #define MEMP_MEM_MALLOC                 1
 
+/**
+ * ESP_MEMP_POOLS==1: Serve the most frequently allocated memp types from
+ * fixed pools, falling back to mem_malloc when a pool is empty.
+ */
+#if CONFIG_LWIP_MEMP_POOLS
+#define ESP_MEMP_POOLS                  1
+#define ESP_MEMP_NUM_PBUF               CONFIG_LWIP_MEMP_NUM_PBUF
+#define ESP_MEMP_NUM_TCP_SEG            CONFIG_LWIP_MEMP_NUM_TCP_SEG
+#define ESP_MEMP_NUM_NETBUF             CONFIG_LWIP_MEMP_NUM_NETBUF
+#define ESP_MEMP_NUM_TCPIP_MSG          CONFIG_LWIP_MEMP_NUM_TCPIP_MSG
+#endif
+
 /**
  * MEM_ALIGNMENT: should be set to the alignment of the CPU
  *    4 byte alignment -> #define MEM_ALIGNMENT 4
@@ -474,10 +487,15 @@
    ----------------------------------------------
 */
 /**
- * LWIP_TCPIP_CORE_LOCKING: (EXPERIMENTAL!)
- * Don't use it if you're not an active lwIP project member
+ * LWIP_TCPIP_CORE_LOCKING: Run socket and netconn API functions in the calling
+ * thread, holding the core lock, instead of posting them to tcpip_thread.
  */
-#define LWIP_TCPIP_CORE_LOCKING         0
+#define LWIP_TCPIP_CORE_LOCKING         CONFIG_LWIP_TCPIP_CORE_LOCKING
+
+#if LWIP_TCPIP_CORE_LOCKING
+#define LOCK_TCPIP_CORE()               sys_lock_tcpip_core()
+#define UNLOCK_TCPIP_CORE()             sys_unlock_tcpip_core()
+#endif
 
 /*
    ------------------------------------
@@ -538,6 +556,13 @@
  * LWIP_STATS_DISPLAY==1: Compile in the statistics output functions.
  */
 #define LWIP_STATS_DISPLAY              CONFIG_LWIP_STATS
+
+/**
+ * MEMP_STATS==1: Enable memp.c pool stats.
+ */
+#if CONFIG_LWIP_MEMP_POOLS
+#define MEMP_STATS                      1
+#endif
 #endif
 
 
@@ -721,6 +746,10 @@
 #define ESP_IP4_ATON                    1
 #define ESP_LIGHT_SLEEP                 1
 #define ESP_L2_TO_L3_COPY               CONFIG_L2_TO_L3_COPY
+#if CONFIG_LWIP_WLAN_RX_POOL_NUM
+#define ESP_WLAN_RX_POOL_NUM            CONFIG_LWIP_WLAN_RX_POOL_NUM
+#define ESP_WLAN_RX_FREE_WATERMARK      CONFIG_LWIP_WLAN_RX_FREE_WATERMARK
+#endif
 #define ESP_STATS_MEM                   CONFIG_LWIP_STATS
 #define ESP_STATS_DROP                  CONFIG_LWIP_STATS
 #define ESP_STATS_TCP                   0
@@ -767,8 +796,23 @@ enum {
 #define LWIP_DEBUG                      LWIP_DBG_OFF
 #define TCP_DEBUG                       LWIP_DBG_OFF
 
-#define CHECKSUM_CHECK_UDP              0
-#define CHECKSUM_CHECK_IP               0
+/**
+ * CHECKSUM_CHECK_IP/UDP: check checksums of received IP headers and UDP packets
+ */
+#define CHECKSUM_CHECK_UDP              CONFIG_LWIP_CHECKSUM_CHECK_UDP
+#define CHECKSUM_CHECK_IP               CONFIG_LWIP_CHECKSUM_CHECK_IP
+
+/**
+ * LWIP_CHKSUM: word-at-a-time checksum, see port/esp_chksum.c
+ */
+#define LWIP_CHKSUM                     esp_lwip_chksum
+
+/**
+ * LWIP_CHECKSUM_ON_COPY==1: checksum TCP and UDP data while copying it into
+ * pbufs, so it doesn't have to be read again when the packet is sent.
+ */
+#define LWIP_CHECKSUM_ON_COPY           1
+#define LWIP_CHKSUM_COPY(dst, src, len) esp_lwip_chksum_copy(dst, src, len)
 
 #define LWIP_NETCONN_FULLDUPLEX         1
 #define LWIP_NETCONN_SEM_PER_THREAD     1
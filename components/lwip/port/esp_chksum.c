@@ -0,0 +1,169 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/* Internet checksum (RFC 1071) for lwIP.
+ *
+ * A sum of 32-bit words is congruent to the sum of their 16-bit halves modulo
+ * 0xFFFF, so the bulk of a buffer can be summed a word at a time with end-around
+ * carry and folded to 16 bits at the end. Only the unaligned head and tail are
+ * handled a byte or halfword at a time.
+ */
+
+#include <string.h>
+#include "arch/esp_chksum.h"
+
+/* Ones' complement sum of 'count' aligned words plus 'sum', folded to 32 bits.
+ * On Xtensa this is implemented in esp_chksum_xtensa.S */
+uint32_t esp_chksum_words(const uint32_t *words, size_t count, uint32_t sum);
+
+#ifndef __XTENSA__
+uint32_t esp_chksum_words(const uint32_t *words, size_t count, uint32_t sum)
+{
+    uint64_t acc = sum;
+
+    while (count >= 4) {
+        acc += words[0];
+        acc += words[1];
+        acc += words[2];
+        acc += words[3];
+        words += 4;
+        count -= 4;
+    }
+    while (count > 0) {
+        acc += *words++;
+        count--;
+    }
+    acc = (acc >> 32) + (acc & 0xFFFFFFFF);
+    acc = (acc >> 32) + (acc & 0xFFFFFFFF);
+    return (uint32_t)acc;
+}
+#endif /* __XTENSA__ */
+
+static inline uint16_t fold_u32(uint32_t sum)
+{
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    return (uint16_t)sum;
+}
+
+static inline uint16_t swap_u16(uint16_t w)
+{
+    return (uint16_t)((w << 8) | (w >> 8));
+}
+
+/* Sum a buffer starting at a 16-bit aligned address. Returns a 32-bit partial sum. */
+static uint32_t chksum_aligned16(const uint8_t *pb, size_t len)
+{
+    uint32_t sum = 0;
+    uint16_t t = 0;
+
+    if (((uintptr_t)pb & 2) && len > 1) {
+        sum = *(const uint16_t *)(const void *)pb;
+        pb += 2;
+        len -= 2;
+    }
+    sum = esp_chksum_words((const uint32_t *)(const void *)pb, len / 4, sum);
+    pb += len & ~3;
+    len &= 3;
+    if (len > 1) {
+        sum += *(const uint16_t *)(const void *)pb;
+        if (sum < *(const uint16_t *)(const void *)pb) {
+            sum++;
+        }
+        pb += 2;
+        len -= 2;
+    }
+    if (len > 0) {
+        ((uint8_t *)&t)[0] = *pb;
+        sum += t;
+        if (sum < t) {
+            sum++;
+        }
+    }
+    return sum;
+}
+
+uint16_t esp_lwip_chksum(const void *dataptr, int len)
+{
+    const uint8_t *pb = (const uint8_t *)dataptr;
+    int odd = ((uintptr_t)pb & 1);
+    uint32_t sum = 0;
+    uint16_t t = 0;
+
+    if (len <= 0) {
+        return 0;
+    }
+
+    /* Starting at an odd address, sum from the next byte and swap the result:
+       the first byte becomes the high half of the swapped sum */
+    if (odd) {
+        ((uint8_t *)&t)[1] = *pb++;
+        len--;
+    }
+    sum = chksum_aligned16(pb, len);
+    sum = fold_u32(sum) + t;
+    sum = fold_u32(sum);
+    if (odd) {
+        sum = swap_u16(sum);
+    }
+    return (uint16_t)sum;
+}
+
+uint16_t esp_lwip_chksum_copy(void *dst, const void *src, uint16_t len)
+{
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+
+    if ((((uintptr_t)d ^ (uintptr_t)s) & 3) != 0 || len < 16) {
+        /* Can't copy whole words: copy, then sum the copy while it's hot in cache */
+        memcpy(dst, src, len);
+        return esp_lwip_chksum(dst, len);
+    }
+
+    /* Copy and sum the unaligned head separately, then a word at a time */
+    size_t head = (4 - ((uintptr_t)s & 3)) & 3;
+    uint16_t head_sum = 0;
+    if (head > 0) {
+        memcpy(d, s, head);
+        head_sum = esp_lwip_chksum(s, head);
+    }
+    uint32_t *dw = (uint32_t *)(void *)(d + head);
+    const uint32_t *sw = (const uint32_t *)(const void *)(s + head);
+    size_t words = (len - head) / 4;
+    uint64_t acc = 0;
+    for (size_t i = 0; i < words; i++) {
+        uint32_t w = sw[i];
+        dw[i] = w;
+        acc += w;
+    }
+    acc = (acc >> 32) + (acc & 0xFFFFFFFF);
+    acc = (acc >> 32) + (acc & 0xFFFFFFFF);
+    uint16_t body_sum = fold_u32((uint32_t)acc);
+
+    size_t tail = (len - head) & 3;
+    uint16_t tail_sum = 0;
+    if (tail > 0) {
+        memcpy(d + len - tail, s + len - tail, tail);
+        tail_sum = esp_lwip_chksum(s + len - tail, tail);
+    }
+
+    /* Partial sums of pieces starting at odd offsets are byte swapped */
+    if (head & 1) {
+        body_sum = swap_u16(body_sum);
+    }
+    if ((len - tail) & 1) {
+        tail_sum = swap_u16(tail_sum);
+    }
+    return fold_u32((uint32_t)head_sum + body_sum + tail_sum);
+}
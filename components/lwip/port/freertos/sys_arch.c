@@ -39,6 +39,7 @@
 #include "lwip/mem.h"
 #include "arch/sys_arch.h"
 #include "lwip/stats.h"
+#include "lwip/priv/tcpip_priv.h"
 #include "esp_log.h"
 
 /* This is the number of threads that can be started with sys_thread_new() */
@@ -103,6 +104,42 @@ sys_mutex_free(sys_mutex_t *pxMutex)
 }
 #endif
 
+#if LWIP_TCPIP_CORE_LOCKING
+/* Task holding lock_tcpip_core, only written by the holder */
+static sys_thread_t s_tcpip_core_holder = NULL;
+
+/** Lock the lwIP core (LOCK_TCPIP_CORE())
+ *
+ * lock_tcpip_core is a FreeRTOS mutex, so it may be taken from tasks on either
+ * CPU and the holder inherits the priority of any task waiting for it.
+ * It is not recursive: taking it twice from the same task would deadlock.
+ */
+void
+sys_lock_tcpip_core(void)
+{
+  LWIP_ASSERT("core lock taken from ISR", !xPortInIsrContext());
+  LWIP_ASSERT("core lock is not recursive", s_tcpip_core_holder != xTaskGetCurrentTaskHandle());
+  sys_mutex_lock(&lock_tcpip_core);
+  s_tcpip_core_holder = xTaskGetCurrentTaskHandle();
+}
+
+/** Unlock the lwIP core (UNLOCK_TCPIP_CORE()) */
+void
+sys_unlock_tcpip_core(void)
+{
+  LWIP_ASSERT("core lock released by a task not holding it", s_tcpip_core_holder == xTaskGetCurrentTaskHandle());
+  s_tcpip_core_holder = NULL;
+  sys_mutex_unlock(&lock_tcpip_core);
+}
+
+/** Returns non-zero if the calling task holds the lwIP core lock */
+int
+sys_tcpip_core_locked(void)
+{
+  return s_tcpip_core_holder == xTaskGetCurrentTaskHandle();
+}
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+
 /*-----------------------------------------------------------------------------------*/
 //  Creates and returns a new semaphore. The "count" argument specifies
 //  the initial state of the semaphore. TBD finish and test
@@ -45,6 +45,7 @@
 #include "lwip/snmp.h"
 #include "lwip/ethip6.h"
 #include "netif/etharp.h"
+#include "lwip/tcpip.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -55,6 +56,27 @@
 #define IFNAME0 'e'
 #define IFNAME1 'n'
 
+/* Most pbuf chains handed to the EMAC driver in one go, longer ones are flattened first */
+#define ETH_TX_MAX_SEGS 8
+
+#if ESP_LWIP
+/* Most received frames waiting for tcpip_thread, further frames are dropped */
+#define ETH_RX_BATCH_MAX 32
+
+/* Frames received by ethernetif_input() and not yet seen by tcpip_thread.
+ * The EMAC task runs at a higher priority than tcpip_thread and hands over
+ * a whole RX poll pass at a time, so a pass usually costs a single mbox post.
+ */
+static struct {
+  struct pbuf *frames[ETH_RX_BATCH_MAX];
+  u16_t head;
+  u16_t count;
+  bool posted;
+  struct netif *netif;
+  struct tcpip_callback_msg *msg;
+} s_rx_batch;
+#endif
+
 /**
  * In this function, the hardware should be initialized.
  * Called from ethernetif_init().
@@ -88,6 +110,15 @@ ethernet_low_level_init(struct netif *netif)
 #endif
 }
 
+#if ESP_LWIP
+/* Called by the EMAC driver once a frame sent by ethernet_low_level_output() is transmitted */
+static void
+ethernet_tx_done(void *ctx)
+{
+  pbuf_free((struct pbuf *)ctx);
+}
+#endif
+
 /**
  * This function should do the actual transmission of the packet. The packet is
  * contained in the pbuf that is passed to the function. This pbuf
@@ -103,6 +134,22 @@ ethernet_low_level_init(struct netif *netif)
  *       to become availale since the stack doesn't retry to send a packet
  *       dropped because of memory failure (except for the TCP timers).
  */
+#if ESP_LWIP
+/* A full TX descriptor chain is worth retrying, anything else is an interface error */
+static err_t
+ethernet_tx_err(esp_err_t ret)
+{
+  switch (ret) {
+  case ESP_OK:
+    return ERR_OK;
+  case ESP_ERR_NO_MEM:
+    return ERR_MEM;
+  default:
+    return ERR_IF;
+  }
+}
+#endif
+
 static err_t
 ethernet_low_level_output(struct netif *netif, struct pbuf *p)
 {
@@ -116,21 +163,38 @@ ethernet_low_level_output(struct netif *netif, struct pbuf *p)
   }
 
 #if ESP_LWIP
-  q = p;
-  u16_t pbuf_x_len = 0;
-  pbuf_x_len = q->len;
-  if(q->next !=NULL) {
-    //char cnt = 0;
-    struct pbuf *tmp = q->next;
-    while(tmp != NULL) {
-      memcpy( (u8_t *)( (u8_t *)(q->payload) + pbuf_x_len), (u8_t *)tmp->payload , tmp->len );
-      pbuf_x_len += tmp->len;
-      //cnt++;
-      tmp = tmp->next;
+  eth_tx_seg_t segs[ETH_TX_MAX_SEGS];
+  int seg_num = 0;
+  esp_err_t ret;
+
+  for (q = p; q != NULL && seg_num < ETH_TX_MAX_SEGS; q = q->next) {
+    segs[seg_num].buf = q->payload;
+    segs[seg_num].len = q->len;
+    /* holding a reference only keeps PBUF_RAM and PBUF_POOL payloads intact,
+       PBUF_REF and PBUF_ROM point at memory the caller may reuse once we return */
+    segs[seg_num].copy = (q->type != PBUF_RAM && q->type != PBUF_POOL);
+    seg_num++;
+  }
+
+  if (q != NULL) {
+    /* longer chains are rare enough to just be flattened */
+    struct pbuf *flat = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+    if (flat == NULL) {
+      return ERR_MEM;
     }
+    pbuf_copy(flat, p);
+    ret = esp_eth_tx(flat->payload, flat->len);
+    pbuf_free(flat);
+    return ethernet_tx_err(ret);
   }
 
-  return esp_eth_tx(q->payload, pbuf_x_len);
+  /* the EMAC DMA reads straight from the pbufs, hold them until it is done */
+  pbuf_ref(p);
+  ret = esp_eth_tx_chain(segs, seg_num, ethernet_tx_done, p);
+  if (ret != ESP_OK) {
+    pbuf_free(p);
+  }
+  return ethernet_tx_err(ret);
 #else
   for(q = p; q != NULL; q = q->next) {
     return esp_emac_tx(q->payload, q->len);
@@ -139,6 +203,83 @@ ethernet_low_level_output(struct netif *netif, struct pbuf *p)
 #endif
 }
 
+#if ESP_LWIP
+/* Runs in tcpip_thread: feed everything queued so far to the stack */
+static void
+ethernetif_rx_batch(void *ctx)
+{
+  struct pbuf *p;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  for (;;) {
+    SYS_ARCH_PROTECT(lev);
+    if (s_rx_batch.count == 0) {
+      s_rx_batch.posted = false;
+      SYS_ARCH_UNPROTECT(lev);
+      break;
+    }
+    p = s_rx_batch.frames[s_rx_batch.head];
+    s_rx_batch.head = (s_rx_batch.head + 1) % ETH_RX_BATCH_MAX;
+    s_rx_batch.count--;
+    SYS_ARCH_UNPROTECT(lev);
+
+    ethernet_input(p, s_rx_batch.netif);
+  }
+}
+
+/* Hand a received frame to tcpip_thread, posting to its mbox only if no batch is pending already */
+static void
+ethernetif_rx_deliver(struct netif *netif, struct pbuf *p)
+{
+  bool post;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (s_rx_batch.msg == NULL || netif != s_rx_batch.netif || netif->input != tcpip_input) {
+    if (netif->input(p, netif) != ERR_OK) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: IP input error\n"));
+      LINK_STATS_INC(link.drop);
+      pbuf_free(p);
+    }
+    return;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (s_rx_batch.count == ETH_RX_BATCH_MAX) {
+    SYS_ARCH_UNPROTECT(lev);
+    LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: rx batch full\n"));
+    LINK_STATS_INC(link.drop);
+    pbuf_free(p);
+    return;
+  }
+  s_rx_batch.frames[(s_rx_batch.head + s_rx_batch.count) % ETH_RX_BATCH_MAX] = p;
+  s_rx_batch.count++;
+  post = !s_rx_batch.posted;
+  s_rx_batch.posted = true;
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (post && tcpip_trycallback(s_rx_batch.msg) != ERR_OK) {
+    /* tcpip_thread is swamped. Nothing will pick these frames up, and without
+       an RX buffer back the EMAC may never deliver another frame: drop them all */
+    LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: tcpip mbox full\n"));
+    for (;;) {
+      SYS_ARCH_PROTECT(lev);
+      if (s_rx_batch.count == 0) {
+        s_rx_batch.posted = false;
+        SYS_ARCH_UNPROTECT(lev);
+        break;
+      }
+      p = s_rx_batch.frames[s_rx_batch.head];
+      s_rx_batch.head = (s_rx_batch.head + 1) % ETH_RX_BATCH_MAX;
+      s_rx_batch.count--;
+      SYS_ARCH_UNPROTECT(lev);
+
+      LINK_STATS_INC(link.drop);
+      pbuf_free(p);
+    }
+  }
+}
+#endif
+
 /**
  * This function should be called when a packet is ready to be read
  * from the interface. It uses the function low_level_input() that
@@ -177,11 +318,8 @@ ethernetif_input(struct netif *netif, void *buffer, uint16_t len)
   p->l2_owner = NULL;
   memcpy(p->payload, buffer, len);
 
-/* full packet send to tcpip_thread to process */
-if (netif->input(p, netif) != ERR_OK) {
-  LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: IP input error\n"));
-  pbuf_free(p);
-}
+  /* full packet send to tcpip_thread to process */
+  ethernetif_rx_deliver(netif, p);
 
 #else
   p = pbuf_alloc(PBUF_RAW, len, PBUF_REF);
@@ -194,11 +332,7 @@ if (netif->input(p, netif) != ERR_OK) {
   p->l2_buf = buffer;
 
   /* full packet send to tcpip_thread to process */
-if (netif->input(p, netif) != ERR_OK) {
-  LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: IP input error\n"));
-  p->l2_owner = NULL;
-  pbuf_free(p);
-}
+  ethernetif_rx_deliver(netif, p);
 #endif
 }
 
@@ -249,6 +383,14 @@ ethernetif_init(struct netif *netif)
 #endif /* LWIP_IPV6 */
   netif->linkoutput = ethernet_low_level_output;
 
+#if ESP_LWIP
+  s_rx_batch.netif = netif;
+  if (s_rx_batch.msg == NULL) {
+    /* without it, frames are posted to tcpip_thread one by one */
+    s_rx_batch.msg = tcpip_callbackmsg_new(ethernetif_rx_batch, NULL);
+  }
+#endif
+
   /* initialize the hardware */
   ethernet_low_level_init(netif);
 
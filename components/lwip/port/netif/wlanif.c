@@ -42,6 +42,7 @@
 #include "lwip/mem.h"
 #include "lwip/pbuf.h"
 #include "lwip/stats.h"
+#include "lwip/sys.h"
 #include "lwip/snmp.h"
 #include "lwip/ethip6.h"
 #include "netif/etharp.h"
@@ -52,6 +53,94 @@
 
 #include "tcpip_adapter.h"
 
+#if !ESP_L2_TO_L3_COPY
+/* WiFi driver RX buffers currently held by the stack */
+static u16_t s_rx_held;
+
+#if ESP_WLAN_RX_POOL_NUM
+/* Large enough for any 802.3 frame the driver delivers, possibly VLAN tagged */
+#define WLANIF_RX_POOL_BUF_SIZE 1536
+
+/* Estimate of how many RX buffers the driver can have outstanding. With an unlimited
+   dynamic buffer count, the static count stands in as a conservative limit */
+#if CONFIG_ESP32_WIFI_DYNAMIC_RX_BUFFER_NUM > 0
+#define WLANIF_RX_DRIVER_BUF_NUM CONFIG_ESP32_WIFI_DYNAMIC_RX_BUFFER_NUM
+#else
+#define WLANIF_RX_DRIVER_BUF_NUM CONFIG_ESP32_WIFI_STATIC_RX_BUFFER_NUM
+#endif
+
+/* Past this many held driver buffers, frames are copied into the pool */
+#define WLANIF_RX_HELD_MAX (WLANIF_RX_DRIVER_BUF_NUM - ESP_WLAN_RX_FREE_WATERMARK)
+
+static u8_t s_rx_pool[ESP_WLAN_RX_POOL_NUM][WLANIF_RX_POOL_BUF_SIZE] __attribute__((aligned(4)));
+static u8_t *s_rx_pool_free[ESP_WLAN_RX_POOL_NUM];
+static u8_t s_rx_pool_free_num;
+static bool s_rx_pool_ready;
+
+static void
+wlanif_rx_pool_init(void)
+{
+  SYS_ARCH_DECL_PROTECT(lev);
+  int i;
+
+  SYS_ARCH_PROTECT(lev);
+  if (!s_rx_pool_ready) {
+    for (i = 0; i < ESP_WLAN_RX_POOL_NUM; i++) {
+      s_rx_pool_free[i] = s_rx_pool[i];
+    }
+    s_rx_pool_free_num = ESP_WLAN_RX_POOL_NUM;
+    s_rx_pool_ready = true;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+static u8_t *
+wlanif_rx_pool_get(void)
+{
+  SYS_ARCH_DECL_PROTECT(lev);
+  u8_t *buf = NULL;
+
+  SYS_ARCH_PROTECT(lev);
+  if (s_rx_pool_free_num > 0) {
+    buf = s_rx_pool_free[--s_rx_pool_free_num];
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return buf;
+}
+
+static bool
+wlanif_rx_pool_put(void *buf)
+{
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if ((u8_t *)buf < s_rx_pool[0] || (u8_t *)buf >= s_rx_pool[ESP_WLAN_RX_POOL_NUM]) {
+    return false;
+  }
+  SYS_ARCH_PROTECT(lev);
+  s_rx_pool_free[s_rx_pool_free_num++] = buf;
+  SYS_ARCH_UNPROTECT(lev);
+  return true;
+}
+#endif /* ESP_WLAN_RX_POOL_NUM */
+
+/* pbuf_free() hands back the l2_buf of every RX pbuf here: a pool buffer or a driver buffer */
+static void
+wlanif_free_rx_buf(void *buf)
+{
+  SYS_ARCH_DECL_PROTECT(lev);
+
+#if ESP_WLAN_RX_POOL_NUM
+  if (wlanif_rx_pool_put(buf)) {
+    return;
+  }
+#endif
+  SYS_ARCH_PROTECT(lev);
+  s_rx_held--;
+  SYS_ARCH_UNPROTECT(lev);
+  esp_wifi_internal_free_rx_buffer(buf);
+}
+#endif /* !ESP_L2_TO_L3_COPY */
+
 
 /**
  * In this function, the hardware should be initialized.
@@ -82,7 +171,10 @@ low_level_init(struct netif *netif)
 #endif
 
 #if !ESP_L2_TO_L3_COPY
-  netif->l2_buffer_free_notify = esp_wifi_internal_free_rx_buffer;
+  netif->l2_buffer_free_notify = wlanif_free_rx_buf;
+#if ESP_WLAN_RX_POOL_NUM
+  wlanif_rx_pool_init();
+#endif
 #endif
 }
 
@@ -162,15 +254,50 @@ wlanif_input(struct netif *netif, void *buffer, u16_t len, void* eb)
   memcpy(p->payload, buffer, len);
   esp_wifi_internal_free_rx_buffer(eb);
 #else
+  SYS_ARCH_DECL_PROTECT(lev);
+  u16_t held;
+
   p = pbuf_alloc(PBUF_RAW, len, PBUF_REF);
   if (p == NULL){
     ESP_STATS_DROP_INC(esp.wlanif_input_pbuf_fail);
     esp_wifi_internal_free_rx_buffer(eb);
     return;
   }
-  p->payload = buffer;
   p->l2_owner = netif;
+
+#if ESP_WLAN_RX_POOL_NUM
+  /* the driver is running short of buffers: copy, and give this one back now */
+  if ((int)s_rx_held >= WLANIF_RX_HELD_MAX && len <= WLANIF_RX_POOL_BUF_SIZE) {
+    u8_t *pool_buf = wlanif_rx_pool_get();
+    if (pool_buf != NULL) {
+      memcpy(pool_buf, buffer, len);
+      esp_wifi_internal_free_rx_buffer(eb);
+      p->payload = pool_buf;
+      p->l2_buf = pool_buf;
+      ESP_STATS_DROP_INC(esp.wlanif_rx_copy);
+      goto input;
+    }
+    ESP_STATS_DROP_INC(esp.wlanif_rx_pool_empty);
+  }
+#endif
+
+  SYS_ARCH_PROTECT(lev);
+  held = ++s_rx_held;
+  SYS_ARCH_UNPROTECT(lev);
+#if ESP_STATS_DROP
+  if (held > lwip_stats.esp.wlanif_rx_held_max) {
+    lwip_stats.esp.wlanif_rx_held_max = held;
+  }
+#else
+  (void)held;
+#endif
+  p->payload = buffer;
   p->l2_buf = eb;
+  ESP_STATS_DROP_INC(esp.wlanif_rx_ref);
+
+#if ESP_WLAN_RX_POOL_NUM
+input:
+#endif
 #endif
 
   /* full packet send to tcpip_thread to process */
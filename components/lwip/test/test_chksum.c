@@ -0,0 +1,90 @@
+/*
+ * Internet checksum (LWIP_CHKSUM) against a byte-at-a-time reference.
+ *
+ * The host test in test_chksum_host covers the C implementation; this checks the
+ * Xtensa assembly kernel used on the chip.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "unity.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "lwip/inet_chksum.h"
+#include "idf_performance.h"
+
+#define BUF_SIZE 1600
+
+/* RFC 1071: sum big endian 16-bit words, return the result in host order */
+static uint16_t ref_chksum(const uint8_t *p, int len)
+{
+    uint32_t acc = 0;
+    while (len > 1) {
+        acc += (p[0] << 8) | p[1];
+        p += 2;
+        len -= 2;
+    }
+    if (len > 0) {
+        acc += p[0] << 8;
+    }
+    acc = (acc >> 16) + (acc & 0xffff);
+    acc = (acc >> 16) + (acc & 0xffff);
+    return lwip_htons((uint16_t)acc);
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i += 4) {
+        uint32_t r = esp_random();
+        memcpy(buf + i, &r, (len - i < 4) ? len - i : 4);
+    }
+}
+
+TEST_CASE("LWIP_CHKSUM matches reference for random data", "[lwip]")
+{
+    uint8_t *src = malloc(BUF_SIZE + 8);
+    uint8_t *dst = malloc(BUF_SIZE + 8);
+    TEST_ASSERT_NOT_NULL(src);
+    TEST_ASSERT_NOT_NULL(dst);
+
+    for (int iter = 0; iter < 2000; iter++) {
+        fill_random(src, BUF_SIZE + 8);
+        if (iter % 4 == 0) {
+            memset(src, 0xff, BUF_SIZE + 8);
+        }
+        int offset = esp_random() % 8;
+        int len = (iter < 128) ? iter : esp_random() % BUF_SIZE;
+        uint16_t expected = ref_chksum(src + offset, len);
+        TEST_ASSERT_EQUAL_HEX16(expected, LWIP_CHKSUM(src + offset, len));
+
+        int dst_offset = (iter & 1) ? offset : esp_random() % 8;
+        TEST_ASSERT_EQUAL_HEX16(expected, LWIP_CHKSUM_COPY(dst + dst_offset, src + offset, len));
+        if (len > 0) {
+            /* unity fails an array compare of zero elements */
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(src + offset, dst + dst_offset, len);
+        }
+    }
+
+    free(src);
+    free(dst);
+}
+
+TEST_CASE("LWIP_CHKSUM performance", "[lwip]")
+{
+    const int rounds = 1000;
+    const int len = 1460;
+    uint8_t *buf = malloc(len);
+    TEST_ASSERT_NOT_NULL(buf);
+    fill_random(buf, len);
+
+    volatile uint16_t sink = 0;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        sink += LWIP_CHKSUM(buf, len);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    (void) sink;
+    free(buf);
+
+    IDF_LOG_PERFORMANCE("lwip_chksum_1460_bytes_ns", "%d", (int)(elapsed * 1000 / rounds));
+}
@@ -0,0 +1,172 @@
+/*
+ * Socket API round trips over the loopback interface.
+ *
+ * The per-call cost measured here is dominated by how a socket call reaches the
+ * lwIP core: a message to the TCP/IP task, or a direct call under the core lock
+ * (CONFIG_LWIP_TCPIP_CORE_LOCKING).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "unity.h"
+#include "esp_timer.h"
+#include "tcpip_adapter.h"
+#include "idf_performance.h"
+
+#define LOOPBACK_PORT       4321
+#define ROUND_TRIPS         2000
+#define SMALL_MSG_SIZE      64
+
+static void loopback_addr(struct sockaddr_in *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(LOOPBACK_PORT);
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+static void set_timeout(int sock)
+{
+    const struct timeval tv = { .tv_sec = 1 };
+    TEST_ASSERT_EQUAL(0, setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)));
+}
+
+TEST_CASE("UDP small datagram round trips over loopback", "[lwip]")
+{
+    tcpip_adapter_init();
+    struct sockaddr_in addr;
+    loopback_addr(&addr);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    TEST_ASSERT(sock >= 0);
+    TEST_ASSERT_EQUAL(0, bind(sock, (struct sockaddr *)&addr, sizeof(addr)));
+    set_timeout(sock);
+
+    uint8_t tx[SMALL_MSG_SIZE], rx[SMALL_MSG_SIZE];
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        memset(tx, i, sizeof(tx));
+        TEST_ASSERT_EQUAL(sizeof(tx), sendto(sock, tx, sizeof(tx), 0, (struct sockaddr *)&addr, sizeof(addr)));
+        TEST_ASSERT_EQUAL(sizeof(rx), recv(sock, rx, sizeof(rx), 0));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(tx, rx, sizeof(tx));
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+    close(sock);
+
+    IDF_LOG_PERFORMANCE("udp_loopback_round_trip_us", "%d", (int)(elapsed / ROUND_TRIPS));
+}
+
+TEST_CASE("TCP small write round trips over loopback", "[lwip]")
+{
+    tcpip_adapter_init();
+    struct sockaddr_in addr;
+    loopback_addr(&addr);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(listener >= 0);
+    TEST_ASSERT_EQUAL(0, bind(listener, (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL(0, listen(listener, 1));
+
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(client >= 0);
+    TEST_ASSERT_EQUAL(0, connect(client, (struct sockaddr *)&addr, sizeof(addr)));
+    int server = accept(listener, NULL, NULL);
+    TEST_ASSERT(server >= 0);
+    set_timeout(server);
+    const int one = 1;
+    TEST_ASSERT_EQUAL(0, setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)));
+
+    uint8_t tx[SMALL_MSG_SIZE], rx[SMALL_MSG_SIZE];
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        memset(tx, i, sizeof(tx));
+        TEST_ASSERT_EQUAL(sizeof(tx), send(client, tx, sizeof(tx), 0));
+        size_t got = 0;
+        while (got < sizeof(rx)) {
+            int r = recv(server, rx + got, sizeof(rx) - got, 0);
+            TEST_ASSERT(r > 0);
+            got += r;
+        }
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(tx, rx, sizeof(tx));
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    close(client);
+    close(server);
+    close(listener);
+
+    IDF_LOG_PERFORMANCE("tcp_loopback_round_trip_us", "%d", (int)(elapsed / ROUND_TRIPS));
+}
+
+/* Datagrams in flight are limited by the loopback queue and the socket's receive mailbox */
+#define MMSG_MAX_BATCH      MIN(CONFIG_LWIP_LOOPBACK_MAX_PBUFS, CONFIG_UDP_RECVMBOX_SIZE)
+#define MMSG_DATAGRAMS      2400
+
+TEST_CASE("UDP sendmmsg/recvmmsg cost per datagram over loopback", "[lwip]")
+{
+    tcpip_adapter_init();
+    struct sockaddr_in addr;
+    loopback_addr(&addr);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    TEST_ASSERT(sock >= 0);
+    TEST_ASSERT_EQUAL(0, bind(sock, (struct sockaddr *)&addr, sizeof(addr)));
+    set_timeout(sock);
+
+    uint8_t tx[MMSG_MAX_BATCH][SMALL_MSG_SIZE], rx[MMSG_MAX_BATCH][SMALL_MSG_SIZE];
+    struct iovec tx_iov[MMSG_MAX_BATCH], rx_iov[MMSG_MAX_BATCH];
+    struct mmsghdr tx_msg[MMSG_MAX_BATCH], rx_msg[MMSG_MAX_BATCH];
+    memset(tx_msg, 0, sizeof(tx_msg));
+    memset(rx_msg, 0, sizeof(rx_msg));
+    for (int i = 0; i < MMSG_MAX_BATCH; i++) {
+        memset(tx[i], i + 1, SMALL_MSG_SIZE);
+        tx_iov[i] = (struct iovec) { .iov_base = tx[i], .iov_len = SMALL_MSG_SIZE };
+        tx_msg[i].msg_hdr.msg_iov = &tx_iov[i];
+        tx_msg[i].msg_hdr.msg_iovlen = 1;
+        tx_msg[i].msg_hdr.msg_name = &addr;
+        tx_msg[i].msg_hdr.msg_namelen = sizeof(addr);
+        rx_iov[i] = (struct iovec) { .iov_base = rx[i], .iov_len = SMALL_MSG_SIZE };
+        rx_msg[i].msg_hdr.msg_iov = &rx_iov[i];
+        rx_msg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for (int batch = 1; batch <= MMSG_MAX_BATCH; batch *= 2) {
+        int64_t start = esp_timer_get_time();
+        for (int n = 0; n < MMSG_DATAGRAMS; n += batch) {
+            TEST_ASSERT_EQUAL(batch, sendmmsg(sock, tx_msg, batch, 0));
+            int got = 0;
+            while (got < batch) {
+                int r = recvmmsg(sock, rx_msg + got, batch - got, 0, NULL);
+                TEST_ASSERT(r > 0);
+                got += r;
+            }
+        }
+        int64_t elapsed = esp_timer_get_time() - start;
+        for (int i = 0; i < batch; i++) {
+            TEST_ASSERT_EQUAL(SMALL_MSG_SIZE, rx_msg[i].msg_len);
+            TEST_ASSERT_EQUAL(0, rx_msg[i].msg_hdr.msg_flags);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(tx[i], rx[i], SMALL_MSG_SIZE);
+        }
+
+        char name[48];
+        snprintf(name, sizeof(name), "udp_loopback_mmsg_batch_%d_ns_per_datagram", batch);
+        IDF_LOG_PERFORMANCE(name, "%d", (int)(elapsed * 1000 / MMSG_DATAGRAMS));
+    }
+
+    /* datagrams longer than the buffer are truncated and flagged */
+    rx_iov[0].iov_len = SMALL_MSG_SIZE / 2;
+    TEST_ASSERT_EQUAL(1, sendmmsg(sock, tx_msg, 1, 0));
+    TEST_ASSERT_EQUAL(1, recvmmsg(sock, rx_msg, 1, 0, NULL));
+    TEST_ASSERT_EQUAL(SMALL_MSG_SIZE / 2, rx_msg[0].msg_len);
+    TEST_ASSERT_EQUAL(MSG_TRUNC, rx_msg[0].msg_hdr.msg_flags);
+
+    /* nothing queued */
+    TEST_ASSERT_EQUAL(-1, recvmmsg(sock, rx_msg, 1, MSG_DONTWAIT, NULL));
+    TEST_ASSERT_EQUAL(EWOULDBLOCK, errno);
+
+    close(sock);
+}
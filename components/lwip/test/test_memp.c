@@ -0,0 +1,114 @@
+/*
+ * memp pools (CONFIG_LWIP_MEMP_POOLS) used from tasks on both CPUs at once.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "tcpip_adapter.h"
+#include "lwip/memp.h"
+#include "sdkconfig.h"
+
+#if CONFIG_LWIP_MEMP_POOLS && CONFIG_LWIP_MEMP_NUM_PBUF > 0
+
+#define MEMP_TEST_ITERATIONS    20000
+#define MEMP_TEST_HELD          4
+
+typedef struct {
+    uint8_t tag;
+    int errors;
+    SemaphoreHandle_t done;
+} memp_test_task_t;
+
+/* Each task stamps the elements it holds; if the free list ever hands one element to
+   both tasks, the other task's stamp shows up */
+static void memp_test_task(void *arg)
+{
+    memp_test_task_t *t = (memp_test_task_t *)arg;
+    void *held[MEMP_TEST_HELD];
+
+    for (int i = 0; i < MEMP_TEST_ITERATIONS; i++) {
+        for (int j = 0; j < MEMP_TEST_HELD; j++) {
+            held[j] = memp_malloc(MEMP_PBUF);
+            if (held[j] == NULL) {
+                t->errors++;
+                continue;
+            }
+            memset(held[j], t->tag, memp_pools[MEMP_PBUF]->size);
+        }
+        for (int j = 0; j < MEMP_TEST_HELD; j++) {
+            if (held[j] == NULL) {
+                continue;
+            }
+            const uint8_t *p = (const uint8_t *)held[j];
+            for (int k = 0; k < memp_pools[MEMP_PBUF]->size; k++) {
+                if (p[k] != t->tag) {
+                    t->errors++;
+                    break;
+                }
+            }
+            memp_free(MEMP_PBUF, held[j]);
+        }
+    }
+    xSemaphoreGive(t->done);
+    vTaskDelete(NULL);
+}
+
+static void memp_test_both_cpus(void)
+{
+    memp_test_task_t tasks[2] = {
+        { .tag = 0xA5, .done = xSemaphoreCreateBinary() },
+        { .tag = 0x5A, .done = xSemaphoreCreateBinary() },
+    };
+
+    for (int i = 0; i < 2; i++) {
+        xTaskCreatePinnedToCore(memp_test_task, "memp_test", 2048, &tasks[i], UNITY_FREERTOS_PRIORITY - 1, NULL, i);
+    }
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT(xSemaphoreTake(tasks[i].done, 10000 / portTICK_PERIOD_MS));
+        vSemaphoreDelete(tasks[i].done);
+        TEST_ASSERT_EQUAL(0, tasks[i].errors);
+    }
+}
+
+static int memp_test_compare_ptr(const void *a, const void *b)
+{
+    uintptr_t pa = (uintptr_t)*(void * const *)a, pb = (uintptr_t)*(void * const *)b;
+    return (pa > pb) - (pa < pb);
+}
+
+TEST_CASE("memp pool allocations from both CPUs don't overlap", "[lwip]")
+{
+    tcpip_adapter_init();
+    memp_test_both_cpus();
+}
+
+/* A next[] link written after the CAS which publishes the element (the push and pop
+   ordering memp_esp_cas() enforces) loses or duplicates free list entries: after the
+   run, the whole pool has to come back as its CONFIG_LWIP_MEMP_NUM_PBUF distinct,
+   adjacent elements, without falling back to the heap */
+TEST_CASE("memp pool free list is intact after use from both CPUs", "[lwip]")
+{
+    const size_t size = memp_pools[MEMP_PBUF]->size;
+    void *held[CONFIG_LWIP_MEMP_NUM_PBUF];
+
+    tcpip_adapter_init();
+    memp_test_both_cpus();
+
+    for (int i = 0; i < CONFIG_LWIP_MEMP_NUM_PBUF; i++) {
+        held[i] = memp_malloc(MEMP_PBUF);
+        TEST_ASSERT_NOT_NULL(held[i]);
+    }
+    qsort(held, CONFIG_LWIP_MEMP_NUM_PBUF, sizeof(held[0]), memp_test_compare_ptr);
+    for (int i = 1; i < CONFIG_LWIP_MEMP_NUM_PBUF; i++) {
+        TEST_ASSERT_EQUAL(size, (uint8_t *)held[i] - (uint8_t *)held[i - 1]);
+    }
+    for (int i = 0; i < CONFIG_LWIP_MEMP_NUM_PBUF; i++) {
+        memp_free(MEMP_PBUF, held[i]);
+    }
+}
+
+#endif /* CONFIG_LWIP_MEMP_POOLS */
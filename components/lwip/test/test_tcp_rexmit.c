@@ -0,0 +1,104 @@
+/*
+ * TCP retransmission timeouts while the netif still holds an unacked segment
+ * (zero-copy TX keeps a pbuf reference until the DMA is done with it).
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "tcpip_adapter.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcp_priv.h"
+
+typedef struct {
+    SemaphoreHandle_t done;
+    bool ok;
+    u8_t nrtx_busy, nrtx_sent;
+    s16_t rto_before, rto_busy, rto_sent;
+    bool requeued_busy;
+} tcp_rexmit_test_t;
+
+/* Runs in the TCP/IP task: an established pcb with one unacked segment whose pbuf
+   has a second reference, and an expired retransmission timer */
+static void tcp_rexmit_busy_test(void *arg)
+{
+    tcp_rexmit_test_t *t = (tcp_rexmit_test_t *)arg;
+    struct tcp_pcb *pcb = tcp_new();
+    struct tcp_seg *seg = (struct tcp_seg *)memp_malloc(MEMP_TCP_SEG);
+    struct pbuf *p = pbuf_alloc(PBUF_IP, TCP_HLEN, PBUF_RAM);
+
+    if (pcb == NULL || seg == NULL || p == NULL) {
+        goto out;
+    }
+    IP_ADDR4(&pcb->local_ip, 127, 0, 0, 1);
+    IP_ADDR4(&pcb->remote_ip, 127, 0, 0, 1);
+    pcb->local_port = 4322;
+    pcb->remote_port = 4323;
+    pcb->state = ESTABLISHED;
+
+    memset(seg, 0, sizeof(*seg));
+    seg->p = p;
+    seg->tcphdr = (struct tcp_hdr *)p->payload;
+    memset(seg->tcphdr, 0, TCP_HLEN);
+    seg->tcphdr->src = lwip_htons(pcb->local_port);
+    seg->tcphdr->dest = lwip_htons(pcb->remote_port);
+    seg->tcphdr->seqno = lwip_htonl(pcb->lastack);
+    TCPH_HDRLEN_FLAGS_SET(seg->tcphdr, 5, TCP_ACK);
+    pcb->unacked = seg;
+    TCP_REG_ACTIVE(pcb);
+
+    pcb->rto = 2;
+    pcb->rtime = pcb->rto;
+    t->rto_before = pcb->rto;
+
+    /* the driver still holds the segment: nothing is resent, nothing backs off */
+    pbuf_ref(p);
+    tcp_slowtmr();
+    t->nrtx_busy = pcb->nrtx;
+    t->rto_busy = pcb->rto;
+    t->requeued_busy = (pcb->unacked != seg);
+
+    /* TX done: the next tick retransmits */
+    pbuf_free(p);
+    tcp_slowtmr();
+    t->nrtx_sent = pcb->nrtx;
+    t->rto_sent = pcb->rto;
+    t->ok = true;
+
+    tcp_abort(pcb);
+    pcb = NULL;
+    seg = NULL;
+    p = NULL;
+out:
+    if (pcb != NULL) {
+        tcp_close(pcb);
+    }
+    if (seg != NULL) {
+        memp_free(MEMP_TCP_SEG, seg);
+    }
+    if (p != NULL) {
+        pbuf_free(p);
+    }
+    xSemaphoreGive(t->done);
+}
+
+TEST_CASE("TCP RTO doesn't back off while the unacked segment is busy", "[lwip]")
+{
+    tcpip_adapter_init();
+    tcp_rexmit_test_t t = { .done = xSemaphoreCreateBinary() };
+    TEST_ASSERT_NOT_NULL(t.done);
+
+    TEST_ASSERT_EQUAL(ERR_OK, tcpip_callback(tcp_rexmit_busy_test, &t));
+    TEST_ASSERT_TRUE(xSemaphoreTake(t.done, 1000 / portTICK_PERIOD_MS));
+    vSemaphoreDelete(t.done);
+    TEST_ASSERT_TRUE(t.ok);
+
+    TEST_ASSERT_FALSE(t.requeued_busy);
+    TEST_ASSERT_EQUAL(0, t.nrtx_busy);
+    TEST_ASSERT_EQUAL(t.rto_before, t.rto_busy);
+
+    TEST_ASSERT_EQUAL(1, t.nrtx_sent);
+    TEST_ASSERT_NOT_EQUAL(t.rto_before, t.rto_sent);
+}
@@ -0,0 +1,163 @@
+#include "catch.hpp"
+#include "arch/esp_chksum.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include <chrono>
+
+/* The include path shadows <arpa/inet.h> with lwIP's */
+static uint16_t htons(uint16_t w)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return (uint16_t)((w << 8) | (w >> 8));
+#else
+    return w;
+#endif
+}
+
+/* RFC 1071 reference, as lwIP's lwip_standard_chksum() version #1: sum the
+   data as big endian 16-bit words, return the result in host byte order */
+static uint16_t ref_chksum(const void *dataptr, int len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(dataptr);
+    uint32_t acc = 0;
+    while (len > 1) {
+        acc += (p[0] << 8) | p[1];
+        p += 2;
+        len -= 2;
+    }
+    if (len > 0) {
+        acc += p[0] << 8;
+    }
+    acc = (acc >> 16) + (acc & 0xffff);
+    acc = (acc >> 16) + (acc & 0xffff);
+    return htons((uint16_t)acc);
+}
+
+/* lwIP's default, lwip_standard_chksum() version #2, for the benchmark */
+static uint16_t lwip_alg2_chksum(const void *dataptr, int len)
+{
+    const uint8_t *pb = (const uint8_t *)dataptr;
+    const uint16_t *ps;
+    uint16_t t = 0;
+    uint32_t sum = 0;
+    int odd = ((uintptr_t)pb & 1);
+
+    if (odd && len > 0) {
+        ((uint8_t *)&t)[1] = *pb++;
+        len--;
+    }
+    ps = (const uint16_t *)(const void *)pb;
+    while (len > 1) {
+        sum += *ps++;
+        len -= 2;
+    }
+    if (len > 0) {
+        ((uint8_t *)&t)[0] = *(const uint8_t *)ps;
+    }
+    sum += t;
+    sum = (sum >> 16) + (sum & 0xffff);
+    sum = (sum >> 16) + (sum & 0xffff);
+    if (odd) {
+        sum = ((sum & 0xff) << 8) | ((sum & 0xff00) >> 8);
+    }
+    return (uint16_t)sum;
+}
+
+TEST_CASE("checksum of known vectors", "[chksum]")
+{
+    /* RFC 1071 section 3 example */
+    const uint8_t rfc[] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+    CHECK(esp_lwip_chksum(rfc, sizeof(rfc)) == htons(0xddf2));
+
+    /* IPv4 header, checksum field included: sums to 0xffff */
+    const uint8_t ip[] = { 0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11,
+                           0xb8, 0x61, 0xc0, 0xa8, 0x00, 0x01, 0xc0, 0xa8, 0x00, 0xc7 };
+    CHECK(esp_lwip_chksum(ip, sizeof(ip)) == 0xffff);
+
+    std::vector<uint8_t> zeros(100, 0);
+    CHECK(esp_lwip_chksum(zeros.data(), zeros.size()) == 0);
+    std::vector<uint8_t> ones(100, 0xff);
+    CHECK(esp_lwip_chksum(ones.data(), ones.size()) == 0xffff);
+    CHECK(esp_lwip_chksum(ones.data(), 0) == 0);
+}
+
+TEST_CASE("checksum matches reference for random data, lengths and alignments", "[chksum]")
+{
+    std::mt19937 gen(5678);
+    std::vector<uint8_t> buf(2048 + 8);
+
+    for (int iter = 0; iter < 20000; iter++) {
+        /* mostly random bytes, sometimes saturated to exercise end-around carries */
+        int fill = gen() % 4;
+        for (auto &b : buf) {
+            b = (fill == 0) ? 0xff : (uint8_t)gen();
+        }
+        size_t offset = gen() % 8;
+        int len = (iter < 256) ? iter : gen() % 2048;
+        uint16_t expected = ref_chksum(&buf[offset], len);
+        INFO("offset " << offset << " len " << len);
+        REQUIRE(esp_lwip_chksum(&buf[offset], len) == expected);
+        REQUIRE(lwip_alg2_chksum(&buf[offset], len) == expected);
+    }
+}
+
+TEST_CASE("copy and checksum matches memcpy and reference", "[chksum]")
+{
+    std::mt19937 gen(91011);
+    std::vector<uint8_t> src(2048 + 8), dst(2048 + 8);
+
+    for (int iter = 0; iter < 20000; iter++) {
+        for (auto &b : src) {
+            b = (uint8_t)gen();
+        }
+        std::fill(dst.begin(), dst.end(), 0xa5);
+        size_t src_offset = gen() % 8;
+        size_t dst_offset = (iter & 1) ? src_offset : gen() % 8;
+        uint16_t len = (iter < 256) ? iter : gen() % 2048;
+        INFO("src offset " << src_offset << " dst offset " << dst_offset << " len " << len);
+
+        REQUIRE(esp_lwip_chksum_copy(&dst[dst_offset], &src[src_offset], len) == ref_chksum(&src[src_offset], len));
+        REQUIRE(memcmp(&dst[dst_offset], &src[src_offset], len) == 0);
+        /* nothing written outside the destination */
+        for (size_t i = 0; i < dst_offset; i++) {
+            REQUIRE(dst[i] == 0xa5);
+        }
+        for (size_t i = dst_offset + len; i < dst.size(); i++) {
+            REQUIRE(dst[i] == 0xa5);
+        }
+    }
+}
+
+template<typename F>
+static double bench_mbps(F fn, const uint8_t *data, size_t len, int rounds)
+{
+    volatile uint16_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        sink += fn(data, len);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    (void)sink;
+    return (double)len * rounds / elapsed.count() / 1e6;
+}
+
+TEST_CASE("checksum benchmark", "[chksum][perf]")
+{
+    std::mt19937 gen(1);
+    std::vector<uint8_t> buf(1500 + 2);
+    for (auto &b : buf) {
+        b = (uint8_t)gen();
+    }
+    const int rounds = 200000;
+    for (size_t offset : { (size_t)0, (size_t)2, (size_t)1 }) {
+        for (size_t len : { (size_t)20, (size_t)64, (size_t)1460 }) {
+            double ref = bench_mbps(lwip_alg2_chksum, &buf[offset], len, rounds);
+            double esp = bench_mbps(esp_lwip_chksum, &buf[offset], len, rounds);
+            printf("offset %zu len %4zu: lwip_standard_chksum %7.0f MB/s, esp_lwip_chksum %7.0f MB/s\n",
+                   offset, len, ref, esp);
+        }
+    }
+}
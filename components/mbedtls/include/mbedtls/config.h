@@ -561,6 +561,23 @@
  */
 #define MBEDTLS_ECP_NIST_OPTIM
 
+/**
+ * \def MBEDTLS_ECP_FIXED_POINT_TABLES
+ *
+ * Use precomputed tables for multiplications of the generator of
+ * secp256r1 (ECDSA signatures, ECDH key generation), instead of computing
+ * them at the first use in each group.
+ *
+ * Saves 2 to 3 KB of heap per group and the time of the precomputation,
+ * at the cost of about 1.6 KB of ROM.
+ *
+ * Requires: MBEDTLS_ECP_DP_SECP256R1_ENABLED, MBEDTLS_ECP_FIXED_POINT_OPTIM = 1,
+ *           MBEDTLS_ECP_WINDOW_SIZE >= 5
+ *
+ * Uncomment this macro to use the tables.
+ */
+//#define MBEDTLS_ECP_FIXED_POINT_TABLES
+
 /**
  * \def MBEDTLS_ECDSA_DETERMINISTIC
  *
@@ -1052,6 +1069,21 @@
  */
 #define MBEDTLS_SSL_ALL_ALERT_MESSAGES
 
+/**
+ * \def MBEDTLS_SSL_ASYNC_PRIVATE
+ *
+ * Enable asynchronous private key operations in the SSL server: the
+ * ServerKeyExchange signature and the RSA decryption of the premaster secret
+ * can be handed over to callbacks, see mbedtls_ssl_conf_async_private_cb().
+ * The handshake then returns MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS until the
+ * operation is completed.
+ *
+ * Requires: MBEDTLS_SSL_SRV_C
+ *
+ * Uncomment this macro to enable asynchronous private key operations.
+ */
+//#define MBEDTLS_SSL_ASYNC_PRIVATE
+
 /**
  * \def MBEDTLS_SSL_DEBUG_ALL
  *
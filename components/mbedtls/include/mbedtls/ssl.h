@@ -109,6 +109,7 @@
 #define MBEDTLS_ERR_SSL_UNEXPECTED_RECORD                 -0x6700  /**< Record header looks valid but is not expected. */
 #define MBEDTLS_ERR_SSL_NON_FATAL                         -0x6680  /**< The alert message received indicates a non-fatal error. */
 #define MBEDTLS_ERR_SSL_INVALID_VERIFY_HASH               -0x6600  /**< Couldn't set the hash for verifying CertificateVerify */
+#define MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS                 -0x6500  /**< The asynchronous operation is not completed yet. */
 
 /*
  * Various constants
@@ -651,6 +652,21 @@ struct mbedtls_ssl_config
     void *p_export_keys;            /*!< context for key export callback    */
 #endif
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && defined(MBEDTLS_SSL_SRV_C)
+    /** Callback to start an asynchronous signature                         */
+    int (*f_async_sign_start)( mbedtls_ssl_context *, mbedtls_pk_context *,
+            mbedtls_md_type_t, const unsigned char *, size_t );
+    /** Callback to start an asynchronous decryption                        */
+    int (*f_async_decrypt_start)( mbedtls_ssl_context *, mbedtls_pk_context *,
+            const unsigned char *, size_t );
+    /** Callback to complete an asynchronous operation                      */
+    int (*f_async_resume)( mbedtls_ssl_context *, unsigned char *, size_t *,
+            size_t );
+    /** Callback to abandon an asynchronous operation                       */
+    void (*f_async_cancel)( mbedtls_ssl_context * );
+    void *p_async_config_data;      /*!< context for the async callbacks    */
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE && MBEDTLS_SSL_SRV_C */
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
     const mbedtls_x509_crt_profile *cert_profile; /*!< verification profile */
     mbedtls_ssl_key_cert *key_cert; /*!< own certificate/key pair(s)        */
@@ -820,6 +836,9 @@ struct mbedtls_ssl_context
      * Record layer (incoming data)
      */
     unsigned char *in_buf;      /*!< input buffer                     */
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    size_t in_buf_len;          /*!< current size of in_buf           */
+#endif
     unsigned char *in_ctr;      /*!< 64-bit incoming message counter
                                      TLS: maintained by us
                                      DTLS: read from peer             */
@@ -853,6 +872,9 @@ struct mbedtls_ssl_context
      * Record layer (outgoing data)
      */
     unsigned char *out_buf;     /*!< output buffer                    */
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    size_t out_buf_len;         /*!< current size of out_buf          */
+#endif
     unsigned char *out_ctr;     /*!< 64-bit outgoing message counter  */
     unsigned char *out_hdr;     /*!< start of record header           */
     unsigned char *out_len;     /*!< two-bytes message length field   */
@@ -1291,6 +1313,158 @@ void mbedtls_ssl_conf_export_keys_cb( mbedtls_ssl_config *conf,
         void *p_export_keys );
 #endif /* MBEDTLS_SSL_EXPORT_KEYS */
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && defined(MBEDTLS_SSL_SRV_C)
+/**
+ * \brief           Callback type: start an asynchronous signature with the
+ *                  server's private key (ServerKeyExchange).
+ *
+ * \note            The callback must not run the operation to completion in
+ *                  the calling task: it hands it over (eg to a worker task or
+ *                  a crypto accelerator) and returns. The result is collected
+ *                  with the \c mbedtls_ssl_async_resume_t callback.
+ *
+ * \note            The hash buffer is only valid during the call, it must be
+ *                  copied if needed later.
+ *
+ * \param ssl       SSL context of the connection. The callback can attach
+ *                  its state with \c mbedtls_ssl_set_async_operation_data().
+ * \param key       Private key of the certificate chosen for the connection
+ * \param md_alg    Hash algorithm, or MBEDTLS_MD_NONE for the TLS 1.0/1.1
+ *                  MD5+SHA1 concatenation
+ * \param hash      Hash to sign
+ * \param hash_len  Length of the hash
+ *
+ * \return          0 if the operation was started,
+ *                  MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH to sign in the
+ *                  calling task instead, as without the callbacks,
+ *                  or another error code to abort the handshake.
+ */
+typedef int mbedtls_ssl_async_sign_t( mbedtls_ssl_context *ssl,
+                                      mbedtls_pk_context *key,
+                                      mbedtls_md_type_t md_alg,
+                                      const unsigned char *hash,
+                                      size_t hash_len );
+
+/**
+ * \brief           Callback type: start an asynchronous RSA decryption
+ *                  with the server's private key (ClientKeyExchange of the
+ *                  RSA and RSA-PSK key exchanges).
+ *
+ * \note            Same rules as \c mbedtls_ssl_async_sign_t. Decryption
+ *                  errors are reported by the resume callback and are not
+ *                  revealed to the peer (they result in a random premaster
+ *                  secret, as in the synchronous case).
+ *
+ * \param ssl       SSL context of the connection
+ * \param key       Private key of the certificate chosen for the connection
+ * \param input     Encrypted premaster secret
+ * \param input_len Length of the input, the size of the RSA modulus
+ *
+ * \return          0 if the operation was started,
+ *                  MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH to decrypt in the
+ *                  calling task instead,
+ *                  or another error code to abort the handshake.
+ */
+typedef int mbedtls_ssl_async_decrypt_t( mbedtls_ssl_context *ssl,
+                                         mbedtls_pk_context *key,
+                                         const unsigned char *input,
+                                         size_t input_len );
+
+/**
+ * \brief           Callback type: collect the result of an asynchronous
+ *                  operation.
+ *
+ * \note            Called from mbedtls_ssl_handshake() (or
+ *                  mbedtls_ssl_handshake_step()) right after a successful
+ *                  start, and again each time the application calls it
+ *                  after it returned MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS.
+ *                  Once it returns anything else, the operation is over
+ *                  and the operation data is reset to NULL.
+ *
+ * \param ssl         SSL context of the connection
+ * \param output      Buffer for the signature or the decrypted data
+ * \param output_len  On success, the length written to output
+ * \param output_size Size of the output buffer
+ *
+ * \return          0 if the operation completed and output is filled in,
+ *                  MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS if it is still running,
+ *                  or the error code of the operation.
+ */
+typedef int mbedtls_ssl_async_resume_t( mbedtls_ssl_context *ssl,
+                                        unsigned char *output,
+                                        size_t *output_len,
+                                        size_t output_size );
+
+/**
+ * \brief           Callback type: abandon an asynchronous operation.
+ *
+ * \note            Called when the SSL context is reset or freed while an
+ *                  operation is in progress. The operation's result must
+ *                  not be written anywhere in the SSL context afterwards.
+ *
+ * \param ssl       SSL context of the connection
+ */
+typedef void mbedtls_ssl_async_cancel_t( mbedtls_ssl_context *ssl );
+
+/**
+ * \brief           Configure asynchronous private key operations (server
+ *                  only). (Default: none.)
+ *
+ * \note            When an operation is started, mbedtls_ssl_handshake()
+ *                  returns MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS until it has
+ *                  completed; call it again (like after
+ *                  MBEDTLS_ERR_SSL_WANT_READ) to continue the handshake.
+ *                  In the meantime the task can run other connections.
+ *
+ * \param conf              SSL configuration context
+ * \param f_async_sign      Callback to start a signature, or NULL to sign
+ *                          synchronously
+ * \param f_async_decrypt   Callback to start a decryption, or NULL to
+ *                          decrypt synchronously
+ * \param f_async_resume    Callback to collect the result. Required if
+ *                          either start callback is set.
+ * \param f_async_cancel    Callback to abandon an operation, or NULL
+ * \param config_data       Context for the callbacks, see
+ *                          \c mbedtls_ssl_conf_get_async_config_data()
+ */
+void mbedtls_ssl_conf_async_private_cb( mbedtls_ssl_config *conf,
+        mbedtls_ssl_async_sign_t *f_async_sign,
+        mbedtls_ssl_async_decrypt_t *f_async_decrypt,
+        mbedtls_ssl_async_resume_t *f_async_resume,
+        mbedtls_ssl_async_cancel_t *f_async_cancel,
+        void *config_data );
+
+/**
+ * \brief           Get the context of the asynchronous operation callbacks.
+ *
+ * \param conf      SSL configuration context
+ *
+ * \return          The config_data passed to
+ *                  mbedtls_ssl_conf_async_private_cb()
+ */
+void *mbedtls_ssl_conf_get_async_config_data( const mbedtls_ssl_config *conf );
+
+/**
+ * \brief           Get the state of the connection's asynchronous operation.
+ *
+ * \param ssl       SSL context
+ *
+ * \return          The value set with mbedtls_ssl_set_async_operation_data(),
+ *                  NULL if no operation is in progress.
+ */
+void *mbedtls_ssl_get_async_operation_data( const mbedtls_ssl_context *ssl );
+
+/**
+ * \brief           Attach state to the connection's asynchronous operation,
+ *                  from the start callback.
+ *
+ * \param ssl       SSL context
+ * \param ctx       State of the operation
+ */
+void mbedtls_ssl_set_async_operation_data( mbedtls_ssl_context *ssl,
+                                           void *ctx );
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE && MBEDTLS_SSL_SRV_C */
+
 /**
  * \brief          Callback type: generate a cookie
  *
@@ -2351,11 +2525,14 @@ int mbedtls_ssl_get_session( const mbedtls_ssl_context *ssl, mbedtls_ssl_session
  *
  * \return         0 if successful, or
  *                 MBEDTLS_ERR_SSL_WANT_READ or MBEDTLS_ERR_SSL_WANT_WRITE, or
+ *                 MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS (see
+ *                 \c mbedtls_ssl_conf_async_private_cb()), or
  *                 MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED (see below), or
  *                 a specific SSL error code.
  *
  * \note           If this function returns something other than 0 or
- *                 MBEDTLS_ERR_SSL_WANT_READ/WRITE, then the ssl context
+ *                 MBEDTLS_ERR_SSL_WANT_READ/WRITE or
+ *                 MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, then the ssl context
  *                 becomes unusable, and you should either free it or call
  *                 \c mbedtls_ssl_session_reset() on it before re-using it for
  *                 a new connection; the current connection must be closed.
@@ -339,7 +339,7 @@ void mbedtls_ecp_group_free( mbedtls_ecp_group *grp )
         mbedtls_mpi_free( &grp->N );
     }
 
-    if( grp->T != NULL )
+    if( grp->T != NULL && grp->T_size != 0 )
     {
         for( i = 0; i < grp->T_size; i++ )
             mbedtls_ecp_point_free( &grp->T[i] );
@@ -1404,6 +1404,8 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     /*
      * Prepare precomputed points: if P == G we want to
      * use grp->T if already initialized, or initialize it.
+     * (With MBEDTLS_ECP_FIXED_POINT_TABLES, some groups come with a
+     * constant grp->T, built for the same w.)
      */
     T = p_eq_g ? grp->T : NULL;
 
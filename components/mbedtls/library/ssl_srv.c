@@ -2829,6 +2829,79 @@ static int ssl_get_ecdh_params_from_cert( mbedtls_ssl_context *ssl )
 #endif /* MBEDTLS_KEY_EXCHANGE_ECDH_RSA_ENABLED) ||
           MBEDTLS_KEY_EXCHANGE_ECDH_ECDSA_ENABLED */
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+/*
+ * Collect the result of the asynchronous private key operation in progress.
+ */
+static int ssl_resume_async_private( mbedtls_ssl_context *ssl,
+                                     unsigned char *output,
+                                     size_t *output_len,
+                                     size_t output_size )
+{
+    int ret = ssl->conf->f_async_resume( ssl, output, output_len, output_size );
+
+    if( ret != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS )
+    {
+        ssl->handshake->async_in_progress = 0;
+        mbedtls_ssl_set_async_operation_data( ssl, NULL );
+    }
+
+    MBEDTLS_SSL_DEBUG_RET( 2, "ssl_resume_async_private", ret );
+    return( ret );
+}
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+/*
+ * Send the ServerKeyExchange message of len bytes prepared in out_msg.
+ */
+static int ssl_send_server_key_exchange( mbedtls_ssl_context *ssl, size_t len )
+{
+    int ret;
+
+    ssl->out_msglen  = len;
+    ssl->out_msgtype = MBEDTLS_SSL_MSG_HANDSHAKE;
+    ssl->out_msg[0]  = MBEDTLS_SSL_HS_SERVER_KEY_EXCHANGE;
+
+    ssl->state++;
+
+    if( ( ret = mbedtls_ssl_write_record( ssl ) ) != 0 )
+    {
+        MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ssl_write_record", ret );
+        return( ret );
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= write server key exchange" ) );
+
+    return( 0 );
+}
+
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && \
+    defined(MBEDTLS_KEY_EXCHANGE__WITH_SERVER_SIGNATURE__ENABLED)
+/*
+ * Complete the ServerKeyExchange message once the asynchronous signature is
+ * available. ssl->out_msglen holds the offset of the signature length field.
+ */
+static int ssl_resume_server_key_exchange( mbedtls_ssl_context *ssl )
+{
+    int ret;
+    unsigned char *p = ssl->out_msg + ssl->out_msglen;
+    size_t signature_len = 0;
+
+    ret = ssl_resume_async_private( ssl, p + 2, &signature_len,
+                                    MBEDTLS_SSL_MAX_CONTENT_LEN - ssl->out_msglen - 2 );
+    if( ret != 0 )
+        return( ret );
+
+    p[0] = (unsigned char)( signature_len >> 8 );
+    p[1] = (unsigned char)( signature_len      );
+
+    MBEDTLS_SSL_DEBUG_BUF( 3, "my signature", p + 2, signature_len );
+
+    return( ssl_send_server_key_exchange( ssl, ssl->out_msglen + 2 + signature_len ) );
+}
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE &&
+          MBEDTLS_KEY_EXCHANGE__WITH_SERVER_SIGNATURE__ENABLED */
+
 static int ssl_write_server_key_exchange( mbedtls_ssl_context *ssl )
 {
     int ret;
@@ -2847,6 +2920,13 @@ static int ssl_write_server_key_exchange( mbedtls_ssl_context *ssl )
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> write server key exchange" ) );
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && \
+    defined(MBEDTLS_KEY_EXCHANGE__WITH_SERVER_SIGNATURE__ENABLED)
+    /* The parameters are already written, only the signature is missing */
+    if( ssl->handshake->async_in_progress != 0 )
+        return( ssl_resume_server_key_exchange( ssl ) );
+#endif
+
     /*
      *
      * Part 1: Extract static ECDH parameters and abort
@@ -3211,6 +3291,28 @@ curve_matching_done:
         }
 #endif /* MBEDTLS_SSL_PROTO_TLS1_2 */
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+        if( ssl->conf->f_async_sign_start != NULL )
+        {
+            ret = ssl->conf->f_async_sign_start( ssl, mbedtls_ssl_own_key( ssl ),
+                        md_alg, hash, hashlen != 0 ? hashlen :
+                        mbedtls_md_get_size( mbedtls_md_info_from_type( md_alg ) ) );
+            if( ret == 0 )
+            {
+                /* Remember where the signature goes, see
+                 * ssl_resume_server_key_exchange() */
+                ssl->handshake->async_in_progress = 1;
+                ssl->out_msglen = p - ssl->out_msg;
+                return( ssl_resume_server_key_exchange( ssl ) );
+            }
+            if( ret != MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH )
+            {
+                MBEDTLS_SSL_DEBUG_RET( 1, "f_async_sign_start", ret );
+                return( ret );
+            }
+        }
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
         if( ( ret = mbedtls_pk_sign( mbedtls_ssl_own_key( ssl ), md_alg, hash, hashlen,
                         p + 2 , &signature_len, ssl->conf->f_rng, ssl->conf->p_rng ) ) != 0 )
         {
@@ -3230,21 +3332,7 @@ curve_matching_done:
 
     /* Done with actual work; add header and send. */
 
-    ssl->out_msglen  = 4 + n;
-    ssl->out_msgtype = MBEDTLS_SSL_MSG_HANDSHAKE;
-    ssl->out_msg[0]  = MBEDTLS_SSL_HS_SERVER_KEY_EXCHANGE;
-
-    ssl->state++;
-
-    if( ( ret = mbedtls_ssl_write_record( ssl ) ) != 0 )
-    {
-        MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ssl_write_record", ret );
-        return( ret );
-    }
-
-    MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= write server key exchange" ) );
-
-    return( 0 );
+    return( ssl_send_server_key_exchange( ssl, 4 + n ) );
 }
 
 static int ssl_write_server_hello_done( mbedtls_ssl_context *ssl )
@@ -3318,6 +3406,44 @@ static int ssl_parse_client_dh_public( mbedtls_ssl_context *ssl, unsigned char *
 
 #if defined(MBEDTLS_KEY_EXCHANGE_RSA_ENABLED) ||                           \
     defined(MBEDTLS_KEY_EXCHANGE_RSA_PSK_ENABLED)
+/*
+ * Decrypt the premaster secret with the own private RSA key, in the calling
+ * task or with the asynchronous callbacks.
+ */
+static int ssl_decrypt_encrypted_pms( mbedtls_ssl_context *ssl,
+                                      const unsigned char *p, size_t len,
+                                      unsigned char *peer_pms,
+                                      size_t *peer_pmslen,
+                                      size_t peer_pmssize )
+{
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    int ret;
+
+    if( ssl->handshake->async_in_progress != 0 )
+        return( ssl_resume_async_private( ssl, peer_pms, peer_pmslen, peer_pmssize ) );
+
+    if( ssl->conf->f_async_decrypt_start != NULL )
+    {
+        ret = ssl->conf->f_async_decrypt_start( ssl, mbedtls_ssl_own_key( ssl ),
+                                                p, len );
+        if( ret == 0 )
+        {
+            ssl->handshake->async_in_progress = 1;
+            return( ssl_resume_async_private( ssl, peer_pms, peer_pmslen, peer_pmssize ) );
+        }
+        if( ret != MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH )
+        {
+            MBEDTLS_SSL_DEBUG_RET( 1, "f_async_decrypt_start", ret );
+            return( ret );
+        }
+    }
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+    return( mbedtls_pk_decrypt( mbedtls_ssl_own_key( ssl ), p, len,
+                                peer_pms, peer_pmslen, peer_pmssize,
+                                ssl->conf->f_rng, ssl->conf->p_rng ) );
+}
+
 static int ssl_parse_encrypted_pms( mbedtls_ssl_context *ssl,
                                     const unsigned char *p,
                                     const unsigned char *end,
@@ -3329,7 +3455,7 @@ static int ssl_parse_encrypted_pms( mbedtls_ssl_context *ssl,
     unsigned char ver[2];
     unsigned char fake_pms[48], peer_pms[48];
     unsigned char mask;
-    size_t i, peer_pmslen;
+    size_t i, peer_pmslen = 0;
     unsigned int diff;
 
     if( ! mbedtls_pk_can_do( mbedtls_ssl_own_key( ssl ), MBEDTLS_PK_RSA ) )
@@ -3360,6 +3486,13 @@ static int ssl_parse_encrypted_pms( mbedtls_ssl_context *ssl,
         return( MBEDTLS_ERR_SSL_BAD_HS_CLIENT_KEY_EXCHANGE );
     }
 
+    ret = ssl_decrypt_encrypted_pms( ssl, p, len,
+                                     peer_pms, &peer_pmslen, sizeof( peer_pms ) );
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    if( ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS )
+        return( ret );
+#endif
+
     mbedtls_ssl_write_version( ssl->handshake->max_major_ver,
                        ssl->handshake->max_minor_ver,
                        ssl->conf->transport, ver );
@@ -3371,16 +3504,12 @@ static int ssl_parse_encrypted_pms( mbedtls_ssl_context *ssl,
      * Also, avoid data-dependant branches here to protect against
      * timing-based variants.
      */
+    diff  = (unsigned int) ret;
+
     ret = ssl->conf->f_rng( ssl->conf->p_rng, fake_pms, sizeof( fake_pms ) );
     if( ret != 0 )
         return( ret );
 
-    ret = mbedtls_pk_decrypt( mbedtls_ssl_own_key( ssl ), p, len,
-                      peer_pms, &peer_pmslen,
-                      sizeof( peer_pms ),
-                      ssl->conf->f_rng, ssl->conf->p_rng );
-
-    diff  = (unsigned int) ret;
     diff |= peer_pmslen ^ 48;
     diff |= peer_pms[0] ^ ver[0];
     diff |= peer_pms[1] ^ ver[1];
@@ -3491,6 +3620,17 @@ static int ssl_parse_client_key_exchange( mbedtls_ssl_context *ssl )
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> parse client key exchange" ) );
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && \
+    ( defined(MBEDTLS_KEY_EXCHANGE_RSA_ENABLED) || \
+      defined(MBEDTLS_KEY_EXCHANGE_RSA_PSK_ENABLED) )
+    if( ssl->handshake->async_in_progress != 0 )
+    {
+        /* The message is still in in_msg, its premaster secret is being
+         * decrypted asynchronously */
+        MBEDTLS_SSL_DEBUG_MSG( 3, ( "resume decryption of the previously read message" ) );
+    }
+    else
+#endif
     if( ( ret = mbedtls_ssl_read_record( ssl ) ) != 0 )
     {
         MBEDTLS_SSL_DEBUG_RET( 1, "mbedtls_ssl_read_record", ret );
@@ -3603,6 +3743,17 @@ static int ssl_parse_client_key_exchange( mbedtls_ssl_context *ssl )
 #if defined(MBEDTLS_KEY_EXCHANGE_RSA_PSK_ENABLED)
     if( ciphersuite_info->key_exchange == MBEDTLS_KEY_EXCHANGE_RSA_PSK )
     {
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+        if( ssl->handshake->async_in_progress != 0 )
+        {
+            /* The identity was parsed (and the PSK callback run) before the
+             * decryption started, only skip over it. Its length was checked
+             * against the message then. */
+            MBEDTLS_SSL_DEBUG_MSG( 3, ( "PSK identity already parsed" ) );
+            p += ( ( (size_t) p[0] << 8 ) | p[1] ) + 2;
+        }
+        else
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
         if( ( ret = ssl_parse_client_psk_identity( ssl, &p, end ) ) != 0 )
         {
             MBEDTLS_SSL_DEBUG_RET( 1, ( "ssl_parse_client_psk_identity" ), ret );
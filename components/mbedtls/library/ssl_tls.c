@@ -2185,6 +2185,142 @@ static int ssl_resend_hello_request( mbedtls_ssl_context *ssl )
 #endif
 #endif /* MBEDTLS_SSL_SRV_C && MBEDTLS_SSL_RENEGOTIATION */
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+/*
+ * Dynamically sized record buffers (TLS only).
+ *
+ * An idle buffer keeps the counter, header and IV, so the in_xxx / out_xxx
+ * pointers always stay inside it and the TLS record counters (at the start
+ * of the buffers) are preserved.
+ */
+#define SSL_DYNAMIC_BUF_IDLE_LEN    ( 13 + MBEDTLS_MAX_IV_LENGTH )
+/* Counter, header and IV, and room for the MAC and padding after the content */
+#define SSL_DYNAMIC_BUF_OVERHEAD    ( MBEDTLS_SSL_BUFFER_LEN - MBEDTLS_SSL_MAX_CONTENT_LEN )
+
+static int ssl_dynamic_buffers( const mbedtls_ssl_context *ssl )
+{
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+    if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
+        return( 0 );
+#endif
+    return( 1 );
+}
+
+/*
+ * Move a record buffer to a new allocation of len bytes, keeping as much of
+ * its content as fits. *ptrs are pointers into the buffer to be moved along.
+ */
+static int ssl_resize_buf( const mbedtls_ssl_context *ssl,
+                           unsigned char **buf, size_t *buf_len, size_t len,
+                           unsigned char **ptrs[], size_t ptr_count )
+{
+    unsigned char *old = *buf;
+    unsigned char *new_buf;
+    size_t i;
+
+    if( ( new_buf = mbedtls_calloc( 1, len ) ) == NULL )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 1, ( "alloc(%d bytes) failed", len ) );
+        return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
+    }
+
+    memcpy( new_buf, old, ( *buf_len < len ) ? *buf_len : len );
+
+    for( i = 0; i < ptr_count; i++ )
+    {
+        if( *ptrs[i] != NULL )
+            *ptrs[i] = new_buf + ( *ptrs[i] - old );
+    }
+
+    mbedtls_zeroize( old, *buf_len );
+    mbedtls_free( old );
+
+    *buf = new_buf;
+    *buf_len = len;
+
+    return( 0 );
+}
+
+static int ssl_resize_in_buf( mbedtls_ssl_context *ssl, size_t len )
+{
+    unsigned char **ptrs[] = { &ssl->in_ctr, &ssl->in_hdr, &ssl->in_len,
+                               &ssl->in_iv, &ssl->in_msg, &ssl->in_offt };
+
+    MBEDTLS_SSL_DEBUG_MSG( 3, ( "input buffer %d -> %d bytes",
+                                ssl->in_buf_len, len ) );
+    return( ssl_resize_buf( ssl, &ssl->in_buf, &ssl->in_buf_len, len,
+                            ptrs, sizeof( ptrs ) / sizeof( ptrs[0] ) ) );
+}
+
+static int ssl_resize_out_buf( mbedtls_ssl_context *ssl, size_t len )
+{
+    unsigned char **ptrs[] = { &ssl->out_ctr, &ssl->out_hdr, &ssl->out_len,
+                               &ssl->out_iv, &ssl->out_msg };
+
+    MBEDTLS_SSL_DEBUG_MSG( 3, ( "output buffer %d -> %d bytes",
+                                ssl->out_buf_len, len ) );
+    return( ssl_resize_buf( ssl, &ssl->out_buf, &ssl->out_buf_len, len,
+                            ptrs, sizeof( ptrs ) / sizeof( ptrs[0] ) ) );
+}
+
+/*
+ * Make sure the input buffer holds at least len bytes. The CBC padding check
+ * reads up to 256 bytes past the record, hence the slack.
+ */
+static int ssl_grow_in_buf( mbedtls_ssl_context *ssl, size_t len )
+{
+    if( len <= ssl->in_buf_len )
+        return( 0 );
+
+    len += MBEDTLS_SSL_PADDING_ADD;
+    if( len > MBEDTLS_SSL_BUFFER_LEN )
+        len = MBEDTLS_SSL_BUFFER_LEN;
+
+    return( ssl_resize_in_buf( ssl, len ) );
+}
+
+/*
+ * Make sure the output buffer can take a record with content_len bytes
+ * of content.
+ */
+static int ssl_grow_out_buf( mbedtls_ssl_context *ssl, size_t content_len )
+{
+    size_t len = content_len + SSL_DYNAMIC_BUF_OVERHEAD;
+
+    if( len > MBEDTLS_SSL_BUFFER_LEN )
+        len = MBEDTLS_SSL_BUFFER_LEN;
+    if( len <= ssl->out_buf_len )
+        return( 0 );
+
+    return( ssl_resize_out_buf( ssl, len ) );
+}
+
+/*
+ * Shrink the buffers of an established connection when no record is
+ * being read or written. Failing to shrink is harmless, the larger
+ * buffer is kept.
+ */
+static void ssl_shrink_buffers( mbedtls_ssl_context *ssl )
+{
+    if( ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER || ! ssl_dynamic_buffers( ssl ) )
+        return;
+
+    if( ssl->out_left == 0 && ssl->out_buf_len > SSL_DYNAMIC_BUF_IDLE_LEN )
+        (void) ssl_resize_out_buf( ssl, SSL_DYNAMIC_BUF_IDLE_LEN );
+
+    /* The current record must be fully consumed: all application data read,
+     * or a handshake message which was the last one in its record */
+    if( ssl->in_left == 0 && ssl->in_offt == NULL &&
+        ssl->keep_current_message == 0 &&
+        ( ssl->in_msglen == 0 ||
+          ( ssl->in_hslen != 0 && ssl->in_hslen >= ssl->in_msglen ) ) &&
+        ssl->in_buf_len > SSL_DYNAMIC_BUF_IDLE_LEN )
+    {
+        (void) ssl_resize_in_buf( ssl, SSL_DYNAMIC_BUF_IDLE_LEN );
+    }
+}
+#endif /* MBEDTLS_SSL_DYNAMIC_BUFFERS */
+
 /*
  * Fill the input message buffer by appending data to it.
  * The amount of data already fetched is in ssl->in_left.
@@ -2220,6 +2356,15 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
     }
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ssl_dynamic_buffers( ssl ) &&
+        ( ret = ssl_grow_in_buf( ssl, (size_t)( ssl->in_hdr - ssl->in_buf ) +
+                                      nb_want ) ) != 0 )
+    {
+        return( ret );
+    }
+#endif
+
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
     {
@@ -4124,6 +4269,14 @@ int mbedtls_ssl_send_alert_message( mbedtls_ssl_context *ssl,
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> send alert message" ) );
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "send alert level=%u message=%u", level, message ));
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ssl_dynamic_buffers( ssl ) &&
+        ( ret = ssl_grow_out_buf( ssl, 2 ) ) != 0 )
+    {
+        return( ret );
+    }
+#endif
+
     ssl->out_msgtype = MBEDTLS_SSL_MSG_ALERT;
     ssl->out_msglen = 2;
     ssl->out_msg[0] = level;
@@ -5146,7 +5299,7 @@ static void ssl_handshake_wrapup_free_hs_transform( mbedtls_ssl_context *ssl )
     /*
      * Free our handshake params
      */
-    mbedtls_ssl_handshake_free( ssl->handshake );
+    mbedtls_ssl_handshake_free( ssl );
     mbedtls_free( ssl->handshake );
     ssl->handshake = NULL;
 
@@ -5501,7 +5654,7 @@ static int ssl_handshake_init( mbedtls_ssl_context *ssl )
     if( ssl->session_negotiate )
         mbedtls_ssl_session_free( ssl->session_negotiate );
     if( ssl->handshake )
-        mbedtls_ssl_handshake_free( ssl->handshake );
+        mbedtls_ssl_handshake_free( ssl );
 
     /*
      * Either the pointers are now NULL or cleared properly and can be freed.
@@ -5606,10 +5759,16 @@ int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
                        const mbedtls_ssl_config *conf )
 {
     int ret;
-    const size_t len = MBEDTLS_SSL_BUFFER_LEN;
+    size_t len = MBEDTLS_SSL_BUFFER_LEN;
 
     ssl->conf = conf;
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    /* Grown as needed, see ssl_grow_in_buf() and ssl_grow_out_buf() */
+    if( ssl_dynamic_buffers( ssl ) )
+        len = SSL_DYNAMIC_BUF_IDLE_LEN;
+#endif
+
     /*
      * Prepare base structures
      */
@@ -5621,6 +5780,10 @@ int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
         ssl->in_buf = NULL;
         return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
     }
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    ssl->in_buf_len = len;
+    ssl->out_buf_len = len;
+#endif
 
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     if( conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
@@ -5717,9 +5880,23 @@ static int ssl_session_reset_int( mbedtls_ssl_context *ssl, int partial )
     ssl->transform_in = NULL;
     ssl->transform_out = NULL;
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    /* Don't keep the buffers of an aborted handshake */
+    if( ssl_dynamic_buffers( ssl ) )
+    {
+        if( ssl->out_buf_len > SSL_DYNAMIC_BUF_IDLE_LEN )
+            (void) ssl_resize_out_buf( ssl, SSL_DYNAMIC_BUF_IDLE_LEN );
+        if( partial == 0 && ssl->in_buf_len > SSL_DYNAMIC_BUF_IDLE_LEN )
+            (void) ssl_resize_in_buf( ssl, SSL_DYNAMIC_BUF_IDLE_LEN );
+    }
+    memset( ssl->out_buf, 0, ssl->out_buf_len );
+    if( partial == 0 )
+        memset( ssl->in_buf, 0, ssl->in_buf_len );
+#else
     memset( ssl->out_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
     if( partial == 0 )
         memset( ssl->in_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
+#endif
 
 #if defined(MBEDTLS_SSL_HW_RECORD_ACCEL)
     if( mbedtls_ssl_hw_record_reset != NULL )
@@ -6375,6 +6552,42 @@ void mbedtls_ssl_conf_export_keys_cb( mbedtls_ssl_config *conf,
 }
 #endif
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && defined(MBEDTLS_SSL_SRV_C)
+void mbedtls_ssl_conf_async_private_cb( mbedtls_ssl_config *conf,
+        mbedtls_ssl_async_sign_t *f_async_sign,
+        mbedtls_ssl_async_decrypt_t *f_async_decrypt,
+        mbedtls_ssl_async_resume_t *f_async_resume,
+        mbedtls_ssl_async_cancel_t *f_async_cancel,
+        void *config_data )
+{
+    conf->f_async_sign_start = f_async_sign;
+    conf->f_async_decrypt_start = f_async_decrypt;
+    conf->f_async_resume = f_async_resume;
+    conf->f_async_cancel = f_async_cancel;
+    conf->p_async_config_data = config_data;
+}
+
+void *mbedtls_ssl_conf_get_async_config_data( const mbedtls_ssl_config *conf )
+{
+    return( conf->p_async_config_data );
+}
+
+void *mbedtls_ssl_get_async_operation_data( const mbedtls_ssl_context *ssl )
+{
+    if( ssl->handshake == NULL )
+        return( NULL );
+    else
+        return( ssl->handshake->user_async_ctx );
+}
+
+void mbedtls_ssl_set_async_operation_data( mbedtls_ssl_context *ssl,
+                                           void *ctx )
+{
+    if( ssl->handshake != NULL )
+        ssl->handshake->user_async_ctx = ctx;
+}
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE && MBEDTLS_SSL_SRV_C */
+
 /*
  * SSL get accessors
  */
@@ -6532,6 +6745,15 @@ int mbedtls_ssl_handshake_step( mbedtls_ssl_context *ssl )
     if( ssl == NULL || ssl->conf == NULL )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    /* Handshake messages are written straight into a full size buffer */
+    if( ssl_dynamic_buffers( ssl ) &&
+        ( ret = ssl_grow_out_buf( ssl, MBEDTLS_SSL_MAX_CONTENT_LEN ) ) != 0 )
+    {
+        return( ret );
+    }
+#endif
+
 #if defined(MBEDTLS_SSL_CLI_C)
     if( ssl->conf->endpoint == MBEDTLS_SSL_IS_CLIENT )
         ret = mbedtls_ssl_handshake_client_step( ssl );
@@ -6564,6 +6786,11 @@ int mbedtls_ssl_handshake( mbedtls_ssl_context *ssl )
             break;
     }
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ret == 0 )
+        ssl_shrink_buffers( ssl );
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= handshake" ) );
 
     return( ret );
@@ -6580,6 +6807,14 @@ static int ssl_write_hello_request( mbedtls_ssl_context *ssl )
 
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "=> write hello request" ) );
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ssl_dynamic_buffers( ssl ) &&
+        ( ret = ssl_grow_out_buf( ssl, 4 ) ) != 0 )
+    {
+        return( ret );
+    }
+#endif
+
     ssl->out_msglen  = 4;
     ssl->out_msgtype = MBEDTLS_SSL_MSG_HANDSHAKE;
     ssl->out_msg[0]  = MBEDTLS_SSL_HS_HELLO_REQUEST;
@@ -7039,6 +7274,10 @@ int mbedtls_ssl_read( mbedtls_ssl_context *ssl, unsigned char *buf, size_t len )
         ssl->in_offt += n;
     }
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    ssl_shrink_buffers( ssl );
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= read" ) );
 
     return( (int) n );
@@ -7081,6 +7320,14 @@ static int ssl_write_real( mbedtls_ssl_context *ssl,
     }
     else
     {
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+        if( ssl_dynamic_buffers( ssl ) &&
+            ( ret = ssl_grow_out_buf( ssl, len ) ) != 0 )
+        {
+            return( ret );
+        }
+#endif
+
         ssl->out_msglen  = len;
         ssl->out_msgtype = MBEDTLS_SSL_MSG_APPLICATION_DATA;
         memcpy( ssl->out_msg, buf, len );
@@ -7168,6 +7415,11 @@ int mbedtls_ssl_write( mbedtls_ssl_context *ssl, const unsigned char *buf, size_
     ret = ssl_write_real( ssl, buf, len );
 #endif
 
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+    if( ret >= 0 )
+        ssl_shrink_buffers( ssl );
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG( 2, ( "<= write" ) );
 
     return( ret );
@@ -7237,11 +7489,23 @@ static void ssl_key_cert_free( mbedtls_ssl_key_cert *key_cert )
 }
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
-void mbedtls_ssl_handshake_free( mbedtls_ssl_handshake_params *handshake )
+void mbedtls_ssl_handshake_free( mbedtls_ssl_context *ssl )
 {
+    mbedtls_ssl_handshake_params *handshake = ssl->handshake;
+
     if( handshake == NULL )
         return;
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && defined(MBEDTLS_SSL_SRV_C)
+    if( ssl->conf != NULL && ssl->conf->f_async_cancel != NULL &&
+        handshake->async_in_progress != 0 )
+    {
+        ssl->conf->f_async_cancel( ssl );
+    }
+    handshake->async_in_progress = 0;
+    handshake->user_async_ctx = NULL;
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE && MBEDTLS_SSL_SRV_C */
+
 #if defined(MBEDTLS_SSL_PROTO_SSL3) || defined(MBEDTLS_SSL_PROTO_TLS1) || \
     defined(MBEDTLS_SSL_PROTO_TLS1_1)
     mbedtls_md5_free(    &handshake->fin_md5  );
@@ -7345,13 +7609,21 @@ void mbedtls_ssl_free( mbedtls_ssl_context *ssl )
 
     if( ssl->out_buf != NULL )
     {
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+        mbedtls_zeroize( ssl->out_buf, ssl->out_buf_len );
+#else
         mbedtls_zeroize( ssl->out_buf, MBEDTLS_SSL_BUFFER_LEN );
+#endif
         mbedtls_free( ssl->out_buf );
     }
 
     if( ssl->in_buf != NULL )
     {
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+        mbedtls_zeroize( ssl->in_buf, ssl->in_buf_len );
+#else
         mbedtls_zeroize( ssl->in_buf, MBEDTLS_SSL_BUFFER_LEN );
+#endif
         mbedtls_free( ssl->in_buf );
     }
 
@@ -7371,7 +7643,7 @@ void mbedtls_ssl_free( mbedtls_ssl_context *ssl )
 
     if( ssl->handshake )
     {
-        mbedtls_ssl_handshake_free( ssl->handshake );
+        mbedtls_ssl_handshake_free( ssl );
         mbedtls_ssl_transform_free( ssl->transform_negotiate );
         mbedtls_ssl_session_free( ssl->session_negotiate );
 
@@ -0,0 +1,571 @@
+/*
+ *  NIST SP800-38D compliant GCM implementation, with the counter mode
+ *  part done in bulk on the ESP32 AES hardware.
+ *
+ *  Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ *  Additions Copyright (C) 2018, Espressif Systems (Shanghai) PTE LTD
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+/*
+ * http://csrc.nist.gov/publications/nistpubs/800-38D/SP-800-38D.pdf
+ *
+ * See also:
+ * [MGV] http://csrc.nist.gov/groups/ST/toolkit/BCM/documents/proposedmodes/gcm/gcm-revised-spec.pdf
+ *
+ * Differences from the mbedTLS software implementation in library/gcm.c:
+ *
+ * - With AES, each mbedtls_gcm_update() runs counter mode over the whole
+ *   buffer in one pass, taking the AES hardware once instead of going through
+ *   the cipher layer (and taking the hardware) for every block. The tag mask
+ *   E(K, Y0) is computed in the same pass.
+ *
+ * - GHASH uses Shoup's method with 4-bit tables ([MGV] 4.1) as upstream does,
+ *   but holds field elements in 32-bit words rather than 64-bit ones, which
+ *   the ESP32 has to shift in software, and hashes whole buffers without
+ *   going back to bytes between blocks.
+ *
+ * Without MBEDTLS_AES_ALT (for example in the host tests) software AES is
+ * used in the same places.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_GCM_C) && defined(MBEDTLS_GCM_ALT)
+
+#include "mbedtls/gcm.h"
+
+#include <string.h>
+
+#if defined(MBEDTLS_AES_ALT)
+#include "hwcrypto/aes.h"
+#endif
+
+/*
+ * 32-bit integer manipulation macros (big endian)
+ */
+#ifndef GET_UINT32_BE
+#define GET_UINT32_BE(n,b,i)                            \
+{                                                       \
+    (n) = ( (uint32_t) (b)[(i)    ] << 24 )             \
+        | ( (uint32_t) (b)[(i) + 1] << 16 )             \
+        | ( (uint32_t) (b)[(i) + 2] <<  8 )             \
+        | ( (uint32_t) (b)[(i) + 3]       );            \
+}
+#endif
+
+#ifndef PUT_UINT32_BE
+#define PUT_UINT32_BE(n,b,i)                            \
+{                                                       \
+    (b)[(i)    ] = (unsigned char) ( (n) >> 24 );       \
+    (b)[(i) + 1] = (unsigned char) ( (n) >> 16 );       \
+    (b)[(i) + 2] = (unsigned char) ( (n) >>  8 );       \
+    (b)[(i) + 3] = (unsigned char) ( (n)       );       \
+}
+#endif
+
+/* Implementation that should never be optimized out by the compiler */
+static void mbedtls_zeroize( void *v, size_t n ) {
+    volatile unsigned char *p = v; while( n-- ) *p++ = 0;
+}
+
+/*
+ * Initialize a context
+ */
+void mbedtls_gcm_init( mbedtls_gcm_context *ctx )
+{
+    memset( ctx, 0, sizeof( mbedtls_gcm_context ) );
+}
+
+/*
+ * Encrypt a single block with the context's key
+ */
+static int gcm_encrypt_block( mbedtls_gcm_context *ctx, const unsigned char input[16],
+                              unsigned char output[16] )
+{
+    size_t olen = 0;
+
+    if( ctx->use_aes )
+        return( mbedtls_aes_crypt_ecb( &ctx->aes_ctx, MBEDTLS_AES_ENCRYPT, input, output ) );
+
+    return( mbedtls_cipher_update( &ctx->cipher_ctx, input, 16, output, &olen ) );
+}
+
+/*
+ * Precompute small multiples of H, that is set
+ *      HT[i] = H times i,
+ * where i is seen as a field element as in [MGV], ie high-order bits
+ * correspond to low powers of P. The result is stored as four big endian
+ * words, the high-order bit of HT[i][0] corresponding to P^0 and the
+ * low-order bit of HT[i][3] to P^127.
+ */
+static int gcm_gen_table( mbedtls_gcm_context *ctx )
+{
+    int ret, i, j;
+    uint64_t hi, lo;
+    uint64_t vl, vh;
+    uint64_t HL[16], HH[16];
+    unsigned char h[16];
+
+    memset( h, 0, 16 );
+    if( ( ret = gcm_encrypt_block( ctx, h, h ) ) != 0 )
+        return( ret );
+
+    /* pack h as two 64-bits ints, big-endian */
+    GET_UINT32_BE( hi, h,  0  );
+    GET_UINT32_BE( lo, h,  4  );
+    vh = (uint64_t) hi << 32 | lo;
+
+    GET_UINT32_BE( hi, h,  8  );
+    GET_UINT32_BE( lo, h,  12 );
+    vl = (uint64_t) hi << 32 | lo;
+
+    /* 8 = 1000 corresponds to 1 in GF(2^128) */
+    HL[8] = vl;
+    HH[8] = vh;
+
+    /* 0 corresponds to 0 in GF(2^128) */
+    HH[0] = 0;
+    HL[0] = 0;
+
+    for( i = 4; i > 0; i >>= 1 )
+    {
+        uint32_t T = ( vl & 1 ) * 0xe1000000U;
+        vl  = ( vh << 63 ) | ( vl >> 1 );
+        vh  = ( vh >> 1 ) ^ ( (uint64_t) T << 32);
+
+        HL[i] = vl;
+        HH[i] = vh;
+    }
+
+    for( i = 2; i <= 8; i *= 2 )
+    {
+        uint64_t *HiL = HL + i, *HiH = HH + i;
+        vh = *HiH;
+        vl = *HiL;
+        for( j = 1; j < i; j++ )
+        {
+            HiH[j] = vh ^ HH[j];
+            HiL[j] = vl ^ HL[j];
+        }
+    }
+
+    for( i = 0; i < 16; i++ )
+    {
+        ctx->HT[i][0] = (uint32_t) ( HH[i] >> 32 );
+        ctx->HT[i][1] = (uint32_t) HH[i];
+        ctx->HT[i][2] = (uint32_t) ( HL[i] >> 32 );
+        ctx->HT[i][3] = (uint32_t) HL[i];
+    }
+
+    mbedtls_zeroize( h, sizeof( h ) );
+    mbedtls_zeroize( HL, sizeof( HL ) );
+    mbedtls_zeroize( HH, sizeof( HH ) );
+
+    return( 0 );
+}
+
+int mbedtls_gcm_setkey( mbedtls_gcm_context *ctx,
+                        mbedtls_cipher_id_t cipher,
+                        const unsigned char *key,
+                        unsigned int keybits )
+{
+    int ret;
+    const mbedtls_cipher_info_t *cipher_info;
+
+    cipher_info = mbedtls_cipher_info_from_values( cipher, keybits, MBEDTLS_MODE_ECB );
+    if( cipher_info == NULL )
+        return( MBEDTLS_ERR_GCM_BAD_INPUT );
+
+    if( cipher_info->block_size != 16 )
+        return( MBEDTLS_ERR_GCM_BAD_INPUT );
+
+    mbedtls_cipher_free( &ctx->cipher_ctx );
+    mbedtls_aes_free( &ctx->aes_ctx );
+    ctx->use_aes = 0;
+
+    if( cipher == MBEDTLS_CIPHER_ID_AES )
+    {
+        mbedtls_aes_init( &ctx->aes_ctx );
+        if( ( ret = mbedtls_aes_setkey_enc( &ctx->aes_ctx, key, keybits ) ) != 0 )
+            return( ret );
+        ctx->use_aes = 1;
+    }
+    else
+    {
+        if( ( ret = mbedtls_cipher_setup( &ctx->cipher_ctx, cipher_info ) ) != 0 )
+            return( ret );
+
+        if( ( ret = mbedtls_cipher_setkey( &ctx->cipher_ctx, key, keybits,
+                                   MBEDTLS_ENCRYPT ) ) != 0 )
+        {
+            return( ret );
+        }
+    }
+
+    if( ( ret = gcm_gen_table( ctx ) ) != 0 )
+        return( ret );
+
+    return( 0 );
+}
+
+/*
+ * Shoup's method for multiplication use this table with
+ *      last4[x] = x times P^128
+ * where x and last4[x] are seen as elements of GF(2^128) as in [MGV]
+ */
+static const uint32_t last4[16] =
+{
+    0x0000, 0x1c20, 0x3840, 0x2460,
+    0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560,
+    0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+/*
+ * One step of Shoup's method: Z = Z times P^4, plus H times the nibble n
+ */
+#define GCM_MULT_STEP( n )                              \
+{                                                       \
+    rem = z3 & 0xf;                                     \
+    z3 = ( z3 >> 4 ) | ( z2 << 28 );                    \
+    z2 = ( z2 >> 4 ) | ( z1 << 28 );                    \
+    z1 = ( z1 >> 4 ) | ( z0 << 28 );                    \
+    z0 = ( z0 >> 4 ) ^ ( last4[rem] << 16 );            \
+    z0 ^= HT[(n)][0];                                   \
+    z1 ^= HT[(n)][1];                                   \
+    z2 ^= HT[(n)][2];                                   \
+    z3 ^= HT[(n)][3];                                   \
+}
+
+/*
+ * Sets x to x times H using the precomputed tables.
+ * x is seen as an element of GF(2^128) as in [MGV], held as four big endian
+ * words.
+ */
+static void gcm_mult( const mbedtls_gcm_context *ctx, uint32_t x[4] )
+{
+    const uint32_t (*HT)[4] = ctx->HT;
+    uint32_t z0 = 0, z1 = 0, z2 = 0, z3 = 0;
+    uint32_t v, rem;
+    int i, j;
+
+    /* bytes 15 to 0, low nibble first */
+    for( i = 3; i >= 0; i-- )
+    {
+        v = x[i];
+        for( j = 0; j < 4; j++ )
+        {
+            GCM_MULT_STEP( v & 0xf );
+            GCM_MULT_STEP( ( v >> 4 ) & 0xf );
+            v >>= 8;
+        }
+    }
+
+    x[0] = z0;
+    x[1] = z1;
+    x[2] = z2;
+    x[3] = z3;
+}
+
+/*
+ * state = GHASH( state, data ), with a partial final block of data zero
+ * padded
+ */
+static void gcm_ghash( const mbedtls_gcm_context *ctx, unsigned char state[16],
+                       const unsigned char *data, size_t len )
+{
+    uint32_t x[4], d;
+    unsigned char last[16];
+    int i;
+
+    if( len == 0 )
+        return;
+
+    for( i = 0; i < 4; i++ )
+        GET_UINT32_BE( x[i], state, 4 * i );
+
+    while( len > 0 )
+    {
+        if( len < 16 )
+        {
+            memset( last, 0, 16 );
+            memcpy( last, data, len );
+            data = last;
+            len = 16;
+        }
+
+        for( i = 0; i < 4; i++ )
+        {
+            GET_UINT32_BE( d, data, 4 * i );
+            x[i] ^= d;
+        }
+
+        gcm_mult( ctx, x );
+
+        data += 16;
+        len -= 16;
+    }
+
+    for( i = 0; i < 4; i++ )
+        PUT_UINT32_BE( x[i], state, 4 * i );
+}
+
+/*
+ * Counter mode over the whole buffer, first computing base_ectr from the
+ * initial counter block if that's still pending
+ */
+static int gcm_gctr( mbedtls_gcm_context *ctx, size_t length,
+                     const unsigned char *input, unsigned char *output )
+{
+    int ret;
+    unsigned char ectr[16];
+    size_t i, use_len;
+
+#if defined(MBEDTLS_AES_ALT)
+    if( ctx->use_aes )
+    {
+        ret = esp_aes_crypt_gctr( &ctx->aes_ctx, length, ctx->y,
+                                  ctx->ectr_pending ? ctx->base_ectr : NULL,
+                                  input, output );
+        ctx->ectr_pending = 0;
+        return( ret );
+    }
+#endif
+
+    if( ctx->ectr_pending )
+    {
+        if( ( ret = gcm_encrypt_block( ctx, ctx->y, ctx->base_ectr ) ) != 0 )
+            return( ret );
+        ctx->ectr_pending = 0;
+    }
+
+    while( length > 0 )
+    {
+        for( i = 16; i > 12; i-- )
+            if( ++ctx->y[i - 1] != 0 )
+                break;
+
+        if( ( ret = gcm_encrypt_block( ctx, ctx->y, ectr ) ) != 0 )
+            return( ret );
+
+        use_len = ( length < 16 ) ? length : 16;
+        for( i = 0; i < use_len; i++ )
+            output[i] = input[i] ^ ectr[i];
+
+        length -= use_len;
+        input += use_len;
+        output += use_len;
+    }
+
+    return( 0 );
+}
+
+int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
+                int mode,
+                const unsigned char *iv,
+                size_t iv_len,
+                const unsigned char *add,
+                size_t add_len )
+{
+    unsigned char work_buf[16];
+
+    /* IV and AD are limited to 2^64 bits, so 2^61 bytes */
+    /* IV is not allowed to be zero length */
+    if( iv_len == 0 ||
+      ( (uint64_t) iv_len  ) >> 61 != 0 ||
+      ( (uint64_t) add_len ) >> 61 != 0 )
+    {
+        return( MBEDTLS_ERR_GCM_BAD_INPUT );
+    }
+
+    memset( ctx->y, 0x00, sizeof(ctx->y) );
+    memset( ctx->buf, 0x00, sizeof(ctx->buf) );
+
+    ctx->mode = mode;
+    ctx->len = 0;
+    ctx->add_len = 0;
+
+    if( iv_len == 12 )
+    {
+        memcpy( ctx->y, iv, iv_len );
+        ctx->y[15] = 1;
+    }
+    else
+    {
+        memset( work_buf, 0x00, 16 );
+        PUT_UINT32_BE( iv_len * 8, work_buf, 12 );
+
+        gcm_ghash( ctx, ctx->y, iv, iv_len );
+        gcm_ghash( ctx, ctx->y, work_buf, 16 );
+    }
+
+    /* E(K, Y0) is computed along with the first counter mode pass */
+    ctx->ectr_pending = 1;
+
+    ctx->add_len = add_len;
+    gcm_ghash( ctx, ctx->buf, add, add_len );
+
+    return( 0 );
+}
+
+int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
+                size_t length,
+                const unsigned char *input,
+                unsigned char *output )
+{
+    int ret;
+
+    if( output > input && (size_t) ( output - input ) < length )
+        return( MBEDTLS_ERR_GCM_BAD_INPUT );
+
+    /* Total length is restricted to 2^39 - 256 bits, ie 2^36 - 2^5 bytes
+     * Also check for possible overflow */
+    if( ctx->len + length < ctx->len ||
+        (uint64_t) ctx->len + length > 0xFFFFFFFE0ull )
+    {
+        return( MBEDTLS_ERR_GCM_BAD_INPUT );
+    }
+
+    ctx->len += length;
+
+    /* GHASH is always over the ciphertext, hashed before it's overwritten
+       when decrypting in place */
+    if( ctx->mode == MBEDTLS_GCM_DECRYPT )
+        gcm_ghash( ctx, ctx->buf, input, length );
+
+    if( ( ret = gcm_gctr( ctx, length, input, output ) ) != 0 )
+        return( ret );
+
+    if( ctx->mode == MBEDTLS_GCM_ENCRYPT )
+        gcm_ghash( ctx, ctx->buf, output, length );
+
+    return( 0 );
+}
+
+int mbedtls_gcm_finish( mbedtls_gcm_context *ctx,
+                unsigned char *tag,
+                size_t tag_len )
+{
+    int ret;
+    unsigned char work_buf[16];
+    size_t i;
+    uint64_t orig_len = ctx->len * 8;
+    uint64_t orig_add_len = ctx->add_len * 8;
+
+    if( tag_len > 16 || tag_len < 4 )
+        return( MBEDTLS_ERR_GCM_BAD_INPUT );
+
+    if( ctx->ectr_pending )
+    {
+        if( ( ret = gcm_gctr( ctx, 0, NULL, NULL ) ) != 0 )
+            return( ret );
+    }
+
+    memcpy( tag, ctx->base_ectr, tag_len );
+
+    if( orig_len || orig_add_len )
+    {
+        memset( work_buf, 0x00, 16 );
+
+        PUT_UINT32_BE( ( orig_add_len >> 32 ), work_buf, 0  );
+        PUT_UINT32_BE( ( orig_add_len       ), work_buf, 4  );
+        PUT_UINT32_BE( ( orig_len     >> 32 ), work_buf, 8  );
+        PUT_UINT32_BE( ( orig_len           ), work_buf, 12 );
+
+        gcm_ghash( ctx, ctx->buf, work_buf, 16 );
+
+        for( i = 0; i < tag_len; i++ )
+            tag[i] ^= ctx->buf[i];
+    }
+
+    return( 0 );
+}
+
+int mbedtls_gcm_crypt_and_tag( mbedtls_gcm_context *ctx,
+                       int mode,
+                       size_t length,
+                       const unsigned char *iv,
+                       size_t iv_len,
+                       const unsigned char *add,
+                       size_t add_len,
+                       const unsigned char *input,
+                       unsigned char *output,
+                       size_t tag_len,
+                       unsigned char *tag )
+{
+    int ret;
+
+    if( ( ret = mbedtls_gcm_starts( ctx, mode, iv, iv_len, add, add_len ) ) != 0 )
+        return( ret );
+
+    if( ( ret = mbedtls_gcm_update( ctx, length, input, output ) ) != 0 )
+        return( ret );
+
+    if( ( ret = mbedtls_gcm_finish( ctx, tag, tag_len ) ) != 0 )
+        return( ret );
+
+    return( 0 );
+}
+
+int mbedtls_gcm_auth_decrypt( mbedtls_gcm_context *ctx,
+                      size_t length,
+                      const unsigned char *iv,
+                      size_t iv_len,
+                      const unsigned char *add,
+                      size_t add_len,
+                      const unsigned char *tag,
+                      size_t tag_len,
+                      const unsigned char *input,
+                      unsigned char *output )
+{
+    int ret;
+    unsigned char check_tag[16];
+    size_t i;
+    int diff;
+
+    if( ( ret = mbedtls_gcm_crypt_and_tag( ctx, MBEDTLS_GCM_DECRYPT, length,
+                                   iv, iv_len, add, add_len,
+                                   input, output, tag_len, check_tag ) ) != 0 )
+    {
+        return( ret );
+    }
+
+    /* Check tag in "constant-time" */
+    for( diff = 0, i = 0; i < tag_len; i++ )
+        diff |= tag[i] ^ check_tag[i];
+
+    if( diff != 0 )
+    {
+        mbedtls_zeroize( output, length );
+        return( MBEDTLS_ERR_GCM_AUTH_FAILED );
+    }
+
+    return( 0 );
+}
+
+void mbedtls_gcm_free( mbedtls_gcm_context *ctx )
+{
+    mbedtls_cipher_free( &ctx->cipher_ctx );
+    mbedtls_aes_free( &ctx->aes_ctx );
+    mbedtls_zeroize( ctx, sizeof( mbedtls_gcm_context ) );
+}
+
+#endif /* MBEDTLS_GCM_C && MBEDTLS_GCM_ALT */
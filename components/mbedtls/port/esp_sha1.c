@@ -79,6 +79,7 @@ static void mbedtls_zeroize( void *v, size_t n ) {
 
 void mbedtls_sha1_init( mbedtls_sha1_context *ctx )
 {
+    esp_sha_digest_forget(&ctx->engine, SHA1);
     memset( ctx, 0, sizeof( mbedtls_sha1_context ) );
 }
 
@@ -88,7 +89,7 @@ void mbedtls_sha1_free( mbedtls_sha1_context *ctx )
         return;
 
     if (ctx->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
-        esp_sha_unlock_engine(SHA1);
+        esp_sha_digest_release(&ctx->engine);
     }
     mbedtls_zeroize( ctx, sizeof( mbedtls_sha1_context ) );
 }
@@ -96,13 +97,23 @@ void mbedtls_sha1_free( mbedtls_sha1_context *ctx )
 void mbedtls_sha1_clone( mbedtls_sha1_context *dst,
                          const mbedtls_sha1_context *src )
 {
+    esp_sha_digest_t *src_engine = (esp_sha_digest_t *)&src->engine;
+
+    esp_sha_digest_forget(&dst->engine, SHA1);
     *dst = *src;
+    memset(&dst->engine, 0, sizeof(dst->engine));
 
     if (src->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
         /* Copy hardware digest state out to cloned state,
            which will be a software digest.
         */
-        esp_sha_read_digest_state(SHA1, dst->state);
+        if (esp_sha_digest_begin(src_engine, src_engine->weight)) {
+            esp_sha_read_digest_state(SHA1, dst->state);
+            esp_sha_digest_end(src_engine);
+        } else {
+            /* src was moved off the engine, maybe after the copy above */
+            memcpy(dst->state, src->state, sizeof(dst->state));
+        }
         dst->mode = ESP_MBEDTLS_SHA1_SOFTWARE;
     }
 }
@@ -123,30 +134,62 @@ void mbedtls_sha1_starts( mbedtls_sha1_context *ctx )
     ctx->state[4] = 0xC3D2E1F0;
 
     if (ctx->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
-        esp_sha_unlock_engine(SHA1);
+        esp_sha_digest_release(&ctx->engine);
     }
     ctx->mode = ESP_MBEDTLS_SHA1_UNUSED;
 }
 
 static void mbedtls_sha1_software_process( mbedtls_sha1_context *ctx, const unsigned char data[64] );
 
-void mbedtls_sha1_process( mbedtls_sha1_context *ctx, const unsigned char data[64] )
+/* Lock the hardware engine for the next 'pending' bytes of input, if this
+   digest has (or can get) it. Returns true if the engine is locked, call
+   esp_sha_digest_end() after the blocks. *first_block is set if the engine
+   state needs initialising with the first block.
+*/
+static bool sha1_engine_begin( mbedtls_sha1_context *ctx, size_t pending, bool *first_block )
 {
-    bool first_block = false;
+    *first_block = false;
+
     if (ctx->mode == ESP_MBEDTLS_SHA1_UNUSED) {
         /* try to use hardware for this digest */
-        if (esp_sha_try_lock_engine(SHA1)) {
+        if (esp_sha_digest_claim(&ctx->engine, SHA1, ctx->state, pending)) {
             ctx->mode = ESP_MBEDTLS_SHA1_HARDWARE;
-            first_block = true;
-        } else {
-            ctx->mode = ESP_MBEDTLS_SHA1_SOFTWARE;
+            *first_block = true;
+            return true;
         }
+        ctx->mode = ESP_MBEDTLS_SHA1_SOFTWARE;
+        return false;
     }
 
     if (ctx->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
-        esp_sha_block(SHA1, data, first_block);
+        if (esp_sha_digest_begin(&ctx->engine, pending)) {
+            return true;
+        }
+        /* digest was handed over to software, ctx->state holds the state so far */
+        ctx->mode = ESP_MBEDTLS_SHA1_SOFTWARE;
+    }
+    return false;
+}
+
+static void sha1_block( mbedtls_sha1_context *ctx, const unsigned char data[64], bool in_hardware, bool *first_block )
+{
+    if (in_hardware) {
+        esp_sha_block(SHA1, data, *first_block);
+        *first_block = false;
     } else {
         mbedtls_sha1_software_process(ctx, data);
+        esp_sha_count_software_blocks(SHA1, 1);
+    }
+}
+
+void mbedtls_sha1_process( mbedtls_sha1_context *ctx, const unsigned char data[64] )
+{
+    bool first_block;
+    bool in_hardware = sha1_engine_begin(ctx, 64, &first_block);
+
+    sha1_block(ctx, data, in_hardware, &first_block);
+    if (in_hardware) {
+        esp_sha_digest_end(&ctx->engine);
     }
 }
 
@@ -314,6 +357,8 @@ void mbedtls_sha1_update( mbedtls_sha1_context *ctx, const unsigned char *input,
 {
     size_t fill;
     uint32_t left;
+    bool in_hardware = false;
+    bool first_block = false;
 
     if( ilen == 0 )
         return;
@@ -327,10 +372,14 @@ void mbedtls_sha1_update( mbedtls_sha1_context *ctx, const unsigned char *input,
     if( ctx->total[0] < (uint32_t) ilen )
         ctx->total[1]++;
 
+    /* hold the engine for all the blocks of this update */
+    if( left + ilen >= 64 )
+        in_hardware = sha1_engine_begin( ctx, left + ilen, &first_block );
+
     if( left && ilen >= fill )
     {
         memcpy( (void *) (ctx->buffer + left), input, fill );
-        mbedtls_sha1_process( ctx, ctx->buffer );
+        sha1_block( ctx, ctx->buffer, in_hardware, &first_block );
         input += fill;
         ilen  -= fill;
         left = 0;
@@ -338,11 +387,14 @@ void mbedtls_sha1_update( mbedtls_sha1_context *ctx, const unsigned char *input,
 
     while( ilen >= 64 )
     {
-        mbedtls_sha1_process( ctx, input );
+        sha1_block( ctx, input, in_hardware, &first_block );
         input += 64;
         ilen  -= 64;
     }
 
+    if( in_hardware )
+        esp_sha_digest_end( &ctx->engine );
+
     if( ilen > 0 )
         memcpy( (void *) (ctx->buffer + left), input, ilen );
 }
@@ -379,8 +431,11 @@ void mbedtls_sha1_finish( mbedtls_sha1_context *ctx, unsigned char output[20] )
 
     /* if state is in hardware, read it out */
     if (ctx->mode == ESP_MBEDTLS_SHA1_HARDWARE) {
-        esp_sha_read_digest_state(SHA1, ctx->state);
-        esp_sha_unlock_engine(SHA1);
+        if (esp_sha_digest_begin(&ctx->engine, 0)) {
+            esp_sha_read_digest_state(SHA1, ctx->state);
+            esp_sha_digest_end(&ctx->engine);
+        }
+        esp_sha_digest_release(&ctx->engine);
         ctx->mode = ESP_MBEDTLS_SHA1_SOFTWARE;
     }
 
@@ -80,6 +80,7 @@ do {                                                    \
 
 void mbedtls_sha256_init( mbedtls_sha256_context *ctx )
 {
+    esp_sha_digest_forget(&ctx->engine, SHA2_256);
     memset( ctx, 0, sizeof( mbedtls_sha256_context ) );
 }
 
@@ -89,7 +90,7 @@ void mbedtls_sha256_free( mbedtls_sha256_context *ctx )
         return;
 
     if (ctx->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
-        esp_sha_unlock_engine(SHA2_256);
+        esp_sha_digest_release(&ctx->engine);
     }
     mbedtls_zeroize( ctx, sizeof( mbedtls_sha256_context ) );
 }
@@ -97,13 +98,23 @@ void mbedtls_sha256_free( mbedtls_sha256_context *ctx )
 void mbedtls_sha256_clone( mbedtls_sha256_context *dst,
                            const mbedtls_sha256_context *src )
 {
+    esp_sha_digest_t *src_engine = (esp_sha_digest_t *)&src->engine;
+
+    esp_sha_digest_forget(&dst->engine, SHA2_256);
     *dst = *src;
+    memset(&dst->engine, 0, sizeof(dst->engine));
 
     if (src->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
         /* Copy hardware digest state out to cloned state,
            which will become a software digest.
         */
-        esp_sha_read_digest_state(SHA2_256, dst->state);
+        if (esp_sha_digest_begin(src_engine, src_engine->weight)) {
+            esp_sha_read_digest_state(SHA2_256, dst->state);
+            esp_sha_digest_end(src_engine);
+        } else {
+            /* src was moved off the engine, maybe after the copy above */
+            memcpy(dst->state, src->state, sizeof(dst->state));
+        }
         dst->mode = ESP_MBEDTLS_SHA256_SOFTWARE;
     }
 }
@@ -143,7 +154,7 @@ void mbedtls_sha256_starts( mbedtls_sha256_context *ctx, int is224 )
 
     ctx->is224 = is224;
     if (ctx->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
-        esp_sha_unlock_engine(SHA2_256);
+        esp_sha_digest_release(&ctx->engine);
     }
     ctx->mode = ESP_MBEDTLS_SHA256_UNUSED;
 }
@@ -196,24 +207,55 @@ static const uint32_t K[] =
 
 static void mbedtls_sha256_software_process( mbedtls_sha256_context *ctx, const unsigned char data[64] );
 
-void mbedtls_sha256_process( mbedtls_sha256_context *ctx, const unsigned char data[64] )
+/* Lock the hardware engine for the next 'pending' bytes of input, if this
+   digest has (or can get) it. Returns true if the engine is locked, call
+   esp_sha_digest_end() after the blocks. *first_block is set if the engine
+   state needs initialising with the first block.
+*/
+static bool sha256_engine_begin( mbedtls_sha256_context *ctx, size_t pending, bool *first_block )
 {
-    bool first_block = false;
+    *first_block = false;
 
     if (ctx->mode == ESP_MBEDTLS_SHA256_UNUSED) {
         /* try to use hardware for this digest */
-        if (!ctx->is224 && esp_sha_try_lock_engine(SHA2_256)) {
+        if (!ctx->is224 && esp_sha_digest_claim(&ctx->engine, SHA2_256, ctx->state, pending)) {
             ctx->mode = ESP_MBEDTLS_SHA256_HARDWARE;
-            first_block = true;
-        } else {
-            ctx->mode = ESP_MBEDTLS_SHA256_SOFTWARE;
+            *first_block = true;
+            return true;
         }
+        ctx->mode = ESP_MBEDTLS_SHA256_SOFTWARE;
+        return false;
     }
 
     if (ctx->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
-        esp_sha_block(SHA2_256, data, first_block);
+        if (esp_sha_digest_begin(&ctx->engine, pending)) {
+            return true;
+        }
+        /* digest was handed over to software, ctx->state holds the state so far */
+        ctx->mode = ESP_MBEDTLS_SHA256_SOFTWARE;
+    }
+    return false;
+}
+
+static void sha256_block( mbedtls_sha256_context *ctx, const unsigned char data[64], bool in_hardware, bool *first_block )
+{
+    if (in_hardware) {
+        esp_sha_block(SHA2_256, data, *first_block);
+        *first_block = false;
     } else {
         mbedtls_sha256_software_process(ctx, data);
+        esp_sha_count_software_blocks(SHA2_256, 1);
+    }
+}
+
+void mbedtls_sha256_process( mbedtls_sha256_context *ctx, const unsigned char data[64] )
+{
+    bool first_block;
+    bool in_hardware = sha256_engine_begin(ctx, 64, &first_block);
+
+    sha256_block(ctx, data, in_hardware, &first_block);
+    if (in_hardware) {
+        esp_sha_digest_end(&ctx->engine);
     }
 }
 
@@ -282,6 +324,8 @@ void mbedtls_sha256_update( mbedtls_sha256_context *ctx, const unsigned char *in
 {
     size_t fill;
     uint32_t left;
+    bool in_hardware = false;
+    bool first_block = false;
 
     if( ilen == 0 )
         return;
@@ -295,10 +339,14 @@ void mbedtls_sha256_update( mbedtls_sha256_context *ctx, const unsigned char *in
     if( ctx->total[0] < (uint32_t) ilen )
         ctx->total[1]++;
 
+    /* hold the engine for all the blocks of this update */
+    if( left + ilen >= 64 )
+        in_hardware = sha256_engine_begin( ctx, left + ilen, &first_block );
+
     if( left && ilen >= fill )
     {
         memcpy( (void *) (ctx->buffer + left), input, fill );
-        mbedtls_sha256_process( ctx, ctx->buffer );
+        sha256_block( ctx, ctx->buffer, in_hardware, &first_block );
         input += fill;
         ilen  -= fill;
         left = 0;
@@ -306,11 +354,14 @@ void mbedtls_sha256_update( mbedtls_sha256_context *ctx, const unsigned char *in
 
     while( ilen >= 64 )
     {
-        mbedtls_sha256_process( ctx, input );
+        sha256_block( ctx, input, in_hardware, &first_block );
         input += 64;
         ilen  -= 64;
     }
 
+    if( in_hardware )
+        esp_sha_digest_end( &ctx->engine );
+
     if( ilen > 0 )
         memcpy( (void *) (ctx->buffer + left), input, ilen );
 }
@@ -347,8 +398,11 @@ void mbedtls_sha256_finish( mbedtls_sha256_context *ctx, unsigned char output[32
 
     /* if state is in hardware, read it out */
     if (ctx->mode == ESP_MBEDTLS_SHA256_HARDWARE) {
-        esp_sha_read_digest_state(SHA2_256, ctx->state);
-        esp_sha_unlock_engine(SHA2_256);
+        if (esp_sha_digest_begin(&ctx->engine, 0)) {
+            esp_sha_read_digest_state(SHA2_256, ctx->state);
+            esp_sha_digest_end(&ctx->engine);
+        }
+        esp_sha_digest_release(&ctx->engine);
         ctx->mode = ESP_MBEDTLS_SHA256_SOFTWARE;
     }
 
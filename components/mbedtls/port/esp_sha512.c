@@ -99,6 +99,7 @@ static void mbedtls_zeroize( void *v, size_t n ) {
 
 void mbedtls_sha512_init( mbedtls_sha512_context *ctx )
 {
+    esp_sha_digest_forget(&ctx->engine, SHA2_512);
     memset( ctx, 0, sizeof( mbedtls_sha512_context ) );
 }
 
@@ -108,7 +109,7 @@ void mbedtls_sha512_free( mbedtls_sha512_context *ctx )
         return;
 
     if (ctx->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
-        esp_sha_unlock_engine(sha_type(ctx));
+        esp_sha_digest_release(&ctx->engine);
     }
     mbedtls_zeroize( ctx, sizeof( mbedtls_sha512_context ) );
 }
@@ -116,7 +117,11 @@ void mbedtls_sha512_free( mbedtls_sha512_context *ctx )
 void mbedtls_sha512_clone( mbedtls_sha512_context *dst,
                            const mbedtls_sha512_context *src )
 {
+    esp_sha_digest_t *src_engine = (esp_sha_digest_t *)&src->engine;
+
+    esp_sha_digest_forget(&dst->engine, SHA2_512);
     *dst = *src;
+    memset(&dst->engine, 0, sizeof(dst->engine));
 
     if (src->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
         /* Copy hardware digest state out to cloned state,
@@ -126,7 +131,13 @@ void mbedtls_sha512_clone( mbedtls_sha512_context *dst,
            (SHA-384 state is identical to SHA-512, only
            digest is truncated.)
         */
-        esp_sha_read_digest_state(SHA2_512, dst->state);
+        if (esp_sha_digest_begin(src_engine, src_engine->weight)) {
+            esp_sha_read_digest_state(SHA2_512, dst->state);
+            esp_sha_digest_end(src_engine);
+        } else {
+            /* src was moved off the engine, maybe after the copy above */
+            memcpy(dst->state, src->state, sizeof(dst->state));
+        }
         dst->mode = ESP_MBEDTLS_SHA512_SOFTWARE;
     }
 }
@@ -167,7 +178,7 @@ void mbedtls_sha512_starts( mbedtls_sha512_context *ctx, int is384 )
 
     ctx->is384 = is384;
     if (ctx->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
-        esp_sha_unlock_engine(sha_type(ctx));
+        esp_sha_digest_release(&ctx->engine);
     }
     ctx->mode = ESP_MBEDTLS_SHA512_UNUSED;
 }
@@ -222,24 +233,55 @@ static const uint64_t K[80] =
 
 static void mbedtls_sha512_software_process( mbedtls_sha512_context *ctx, const unsigned char data[128] );
 
-void mbedtls_sha512_process( mbedtls_sha512_context *ctx, const unsigned char data[128] )
+/* Lock the hardware engine for the next 'pending' bytes of input, if this
+   digest has (or can get) it. Returns true if the engine is locked, call
+   esp_sha_digest_end() after the blocks. *first_block is set if the engine
+   state needs initialising with the first block.
+*/
+static bool sha512_engine_begin( mbedtls_sha512_context *ctx, size_t pending, bool *first_block )
 {
-    bool first_block = false;
+    *first_block = false;
 
     if (ctx->mode == ESP_MBEDTLS_SHA512_UNUSED) {
         /* try to use hardware for this digest */
-        if (esp_sha_try_lock_engine(sha_type(ctx))) {
+        if (esp_sha_digest_claim(&ctx->engine, sha_type(ctx), ctx->state, pending)) {
             ctx->mode = ESP_MBEDTLS_SHA512_HARDWARE;
-            first_block = true;
-        } else {
-            ctx->mode = ESP_MBEDTLS_SHA512_SOFTWARE;
+            *first_block = true;
+            return true;
         }
+        ctx->mode = ESP_MBEDTLS_SHA512_SOFTWARE;
+        return false;
     }
 
     if (ctx->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
-        esp_sha_block(sha_type(ctx), data, first_block);
+        if (esp_sha_digest_begin(&ctx->engine, pending)) {
+            return true;
+        }
+        /* digest was handed over to software, ctx->state holds the state so far */
+        ctx->mode = ESP_MBEDTLS_SHA512_SOFTWARE;
+    }
+    return false;
+}
+
+static void sha512_block( mbedtls_sha512_context *ctx, const unsigned char data[128], bool in_hardware, bool *first_block )
+{
+    if (in_hardware) {
+        esp_sha_block(sha_type(ctx), data, *first_block);
+        *first_block = false;
     } else {
         mbedtls_sha512_software_process(ctx, data);
+        esp_sha_count_software_blocks(sha_type(ctx), 1);
+    }
+}
+
+void mbedtls_sha512_process( mbedtls_sha512_context *ctx, const unsigned char data[128] )
+{
+    bool first_block;
+    bool in_hardware = sha512_engine_begin(ctx, 128, &first_block);
+
+    sha512_block(ctx, data, in_hardware, &first_block);
+    if (in_hardware) {
+        esp_sha_digest_end(&ctx->engine);
     }
 }
 
@@ -322,6 +364,8 @@ void mbedtls_sha512_update( mbedtls_sha512_context *ctx, const unsigned char *in
 {
     size_t fill;
     unsigned int left;
+    bool in_hardware = false;
+    bool first_block = false;
 
     if( ilen == 0 )
         return;
@@ -334,10 +378,14 @@ void mbedtls_sha512_update( mbedtls_sha512_context *ctx, const unsigned char *in
     if( ctx->total[0] < (uint64_t) ilen )
         ctx->total[1]++;
 
+    /* hold the engine for all the blocks of this update */
+    if( left + ilen >= 128 )
+        in_hardware = sha512_engine_begin( ctx, left + ilen, &first_block );
+
     if( left && ilen >= fill )
     {
         memcpy( (void *) (ctx->buffer + left), input, fill );
-        mbedtls_sha512_process( ctx, ctx->buffer );
+        sha512_block( ctx, ctx->buffer, in_hardware, &first_block );
         input += fill;
         ilen  -= fill;
         left = 0;
@@ -345,11 +393,14 @@ void mbedtls_sha512_update( mbedtls_sha512_context *ctx, const unsigned char *in
 
     while( ilen >= 128 )
     {
-        mbedtls_sha512_process( ctx, input );
+        sha512_block( ctx, input, in_hardware, &first_block );
         input += 128;
         ilen  -= 128;
     }
 
+    if( in_hardware )
+        esp_sha_digest_end( &ctx->engine );
+
     if( ilen > 0 )
         memcpy( (void *) (ctx->buffer + left), input, ilen );
 }
@@ -390,8 +441,11 @@ void mbedtls_sha512_finish( mbedtls_sha512_context *ctx, unsigned char output[64
 
     /* if state is in hardware, read it out */
     if (ctx->mode == ESP_MBEDTLS_SHA512_HARDWARE) {
-        esp_sha_read_digest_state(sha_type(ctx), ctx->state);
-        esp_sha_unlock_engine(sha_type(ctx));
+        if (esp_sha_digest_begin(&ctx->engine, 0)) {
+            esp_sha_read_digest_state(sha_type(ctx), ctx->state);
+            esp_sha_digest_end(&ctx->engine);
+        }
+        esp_sha_digest_release(&ctx->engine);
         ctx->mode = ESP_MBEDTLS_SHA512_SOFTWARE;
     }
 
@@ -0,0 +1,461 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_MBEDTLS_SSL_ASYNC_PRIVATE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/entropy_poll.h"
+#include "mbedtls/esp_ssl_async.h"
+
+/* Number of keys each worker keeps a copy of (eg one RSA and one EC certificate) */
+#define WORKER_KEYS 2
+
+typedef enum {
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,
+} job_state_t;
+
+/* A job is freed once both the SSL context (result collected, or cancelled)
+   and the worker (done callback returned) are done with it */
+typedef struct {
+    const mbedtls_pk_context *key;  /* key of the SSL configuration */
+    mbedtls_ssl_context *ssl;
+    TaskHandle_t task;              /* task which started the operation */
+    bool decrypt;
+    mbedtls_md_type_t md_alg;
+    job_state_t state;
+    bool owner_done;
+    bool worker_done;
+    int ret;
+    size_t input_len;
+    size_t output_len;
+    size_t output_size;
+    unsigned char *output;
+    unsigned char input[];          /* followed by the output */
+} async_job_t;
+
+/* Private copy of a configuration key. Private key operations update the
+   key context (RSA blinding values, lazily computed tables), so the workers
+   never share one. */
+typedef struct {
+    const mbedtls_pk_context *source;
+    mbedtls_pk_context copy;
+    uint32_t last_use;
+} worker_key_t;
+
+typedef struct {
+    worker_key_t keys[WORKER_KEYS];
+    uint32_t uses;
+} async_worker_t;
+
+static QueueHandle_t s_queue;
+static TaskHandle_t s_tasks[portNUM_PROCESSORS];
+static async_worker_t s_workers[portNUM_PROCESSORS];
+static mbedtls_esp_ssl_async_done_t s_done;
+static void *s_done_arg;
+static mbedtls_esp_ssl_async_stats_t s_stats;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void async_zeroize(void *v, size_t n)
+{
+    volatile unsigned char *p = v;
+    while (n--) {
+        *p++ = 0;
+    }
+}
+
+static int async_random(void *ctx, unsigned char *buf, size_t len)
+{
+    size_t olen;
+    return mbedtls_hardware_poll(ctx, buf, len, &olen);
+}
+
+static bool key_is_rsa(const mbedtls_pk_context *key)
+{
+    return mbedtls_pk_get_type(key) == MBEDTLS_PK_RSA;
+}
+
+static bool key_is_ec(const mbedtls_pk_context *key)
+{
+    mbedtls_pk_type_t type = mbedtls_pk_get_type(key);
+    return type == MBEDTLS_PK_ECKEY || type == MBEDTLS_PK_ECDSA;
+}
+
+/* Same public key, hence the same key pair */
+static bool key_equal(const mbedtls_pk_context *a, const mbedtls_pk_context *b)
+{
+    if (mbedtls_pk_get_type(a) != mbedtls_pk_get_type(b)) {
+        return false;
+    }
+    if (key_is_rsa(a)) {
+        const mbedtls_rsa_context *ra = mbedtls_pk_rsa(*a), *rb = mbedtls_pk_rsa(*b);
+        return mbedtls_mpi_cmp_mpi(&ra->N, &rb->N) == 0 && mbedtls_mpi_cmp_mpi(&ra->E, &rb->E) == 0;
+    }
+    const mbedtls_ecp_keypair *ea = mbedtls_pk_ec(*a), *eb = mbedtls_pk_ec(*b);
+    return ea->grp.id == eb->grp.id && mbedtls_ecp_point_cmp(&ea->Q, &eb->Q) == 0;
+}
+
+static int key_copy(mbedtls_pk_context *dst, const mbedtls_pk_context *src)
+{
+    int ret = mbedtls_pk_setup(dst, mbedtls_pk_info_from_type(mbedtls_pk_get_type(src)));
+    if (ret != 0) {
+        return ret;
+    }
+    if (key_is_rsa(src)) {
+        /* Only the key itself: the blinding values and the cached R^2 (Vi, Vf,
+           RN, RP, RQ) are written by private key operations on the source in
+           other tasks, so they must not even be read. The copy computes its own. */
+        mbedtls_rsa_context *rsa = mbedtls_pk_rsa(*dst);
+        const mbedtls_rsa_context *src_rsa = mbedtls_pk_rsa(*src);
+        rsa->ver = src_rsa->ver;
+        rsa->len = src_rsa->len;
+        if ((ret = mbedtls_mpi_copy(&rsa->N, &src_rsa->N)) == 0 &&
+            (ret = mbedtls_mpi_copy(&rsa->E, &src_rsa->E)) == 0 &&
+            (ret = mbedtls_mpi_copy(&rsa->D, &src_rsa->D)) == 0 &&
+            (ret = mbedtls_mpi_copy(&rsa->P, &src_rsa->P)) == 0 &&
+            (ret = mbedtls_mpi_copy(&rsa->Q, &src_rsa->Q)) == 0 &&
+            (ret = mbedtls_mpi_copy(&rsa->DP, &src_rsa->DP)) == 0 &&
+            (ret = mbedtls_mpi_copy(&rsa->DQ, &src_rsa->DQ)) == 0) {
+            ret = mbedtls_mpi_copy(&rsa->QP, &src_rsa->QP);
+        }
+        mbedtls_rsa_set_padding(rsa, src_rsa->padding, src_rsa->hash_id);
+        return ret;
+    }
+    mbedtls_ecp_keypair *ec = mbedtls_pk_ec(*dst);
+    const mbedtls_ecp_keypair *src_ec = mbedtls_pk_ec(*src);
+    if ((ret = mbedtls_ecp_group_copy(&ec->grp, &src_ec->grp)) == 0 &&
+        (ret = mbedtls_mpi_copy(&ec->d, &src_ec->d)) == 0) {
+        ret = mbedtls_ecp_copy(&ec->Q, &src_ec->Q);
+    }
+    return ret;
+}
+
+/* Find or make the worker's copy of a configuration key */
+static int worker_key(async_worker_t *worker, const mbedtls_pk_context *source, mbedtls_pk_context **key)
+{
+    worker_key_t *slot = NULL;
+
+    for (int i = 0; i < WORKER_KEYS; i++) {
+        worker_key_t *k = &worker->keys[i];
+        if (k->source == source && key_equal(&k->copy, source)) {
+            slot = k;
+            break;
+        }
+    }
+
+    if (slot == NULL) {
+        /* Least recently used, unused slots have last_use 0 */
+        slot = &worker->keys[0];
+        for (int i = 1; i < WORKER_KEYS; i++) {
+            if (worker->keys[i].last_use < slot->last_use) {
+                slot = &worker->keys[i];
+            }
+        }
+        slot->source = NULL;
+        mbedtls_pk_free(&slot->copy);
+        mbedtls_pk_init(&slot->copy);
+        int ret = key_copy(&slot->copy, source);
+        if (ret != 0) {
+            mbedtls_pk_free(&slot->copy);
+            mbedtls_pk_init(&slot->copy);
+            slot->last_use = 0;
+            return ret;
+        }
+        slot->source = source;
+    }
+
+    slot->last_use = ++worker->uses;
+    *key = &slot->copy;
+    return 0;
+}
+
+static int async_job_run(async_worker_t *worker, async_job_t *job)
+{
+    mbedtls_pk_context *key;
+    int ret = worker_key(worker, job->key, &key);
+    if (ret != 0) {
+        return ret;
+    }
+    if (job->decrypt) {
+        return mbedtls_pk_decrypt(key, job->input, job->input_len,
+                                  job->output, &job->output_len, job->output_size,
+                                  async_random, NULL);
+    }
+    return mbedtls_pk_sign(key, job->md_alg, job->input, job->input_len,
+                           job->output, &job->output_len, async_random, NULL);
+}
+
+static void async_job_free(async_job_t *job)
+{
+    async_zeroize(job->input, job->input_len + job->output_size);
+    mbedtls_free(job);
+}
+
+static void async_worker_task(void *arg)
+{
+    async_worker_t *worker = arg;
+    async_job_t *job;
+    bool release;
+
+    while (true) {
+        if (xQueueReceive(s_queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        portENTER_CRITICAL(&s_lock);
+        release = job->owner_done;
+        if (!release) {
+            job->state = JOB_RUNNING;
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (release) {
+            /* cancelled while queued */
+            async_job_free(job);
+            continue;
+        }
+
+        job->ret = async_job_run(worker, job);
+
+        portENTER_CRITICAL(&s_lock);
+        job->state = JOB_DONE;
+        s_stats.completed[xPortGetCoreID()]++;
+        portEXIT_CRITICAL(&s_lock);
+
+        /* A cancel waits for worker_done, so job->ssl is still valid here */
+        if (s_done != NULL) {
+            s_done(job->ssl, s_done_arg);
+        } else {
+            xTaskNotifyGive(job->task);
+        }
+
+        portENTER_CRITICAL(&s_lock);
+        job->worker_done = true;
+        release = job->owner_done;
+        portEXIT_CRITICAL(&s_lock);
+
+        if (release) {
+            async_job_free(job);
+        }
+    }
+}
+
+static bool async_key_supported(const mbedtls_pk_context *key)
+{
+    return key_is_rsa(key) || key_is_ec(key);
+}
+
+static int async_start(mbedtls_ssl_context *ssl, mbedtls_pk_context *key, bool decrypt,
+                       mbedtls_md_type_t md_alg, const unsigned char *input, size_t input_len)
+{
+    size_t output_size = key_is_rsa(key) ? mbedtls_pk_get_len(key) : MBEDTLS_ECDSA_MAX_LEN;
+    async_job_t *job = NULL;
+
+    if (async_key_supported(key)) {
+        job = mbedtls_calloc(1, sizeof(async_job_t) + input_len + output_size);
+    }
+    if (job == NULL) {
+        portENTER_CRITICAL(&s_lock);
+        s_stats.fallbacks++;
+        portEXIT_CRITICAL(&s_lock);
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+
+    job->key = key;
+    job->ssl = ssl;
+    job->task = xTaskGetCurrentTaskHandle();
+    job->decrypt = decrypt;
+    job->md_alg = md_alg;
+    job->state = JOB_QUEUED;
+    job->input_len = input_len;
+    job->output_size = output_size;
+    job->output = job->input + input_len;
+    memcpy(job->input, input, input_len);
+
+    if (xQueueSend(s_queue, &job, 0) != pdTRUE) {
+        async_job_free(job);
+        portENTER_CRITICAL(&s_lock);
+        s_stats.fallbacks++;
+        portEXIT_CRITICAL(&s_lock);
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+
+    mbedtls_ssl_set_async_operation_data(ssl, job);
+    return 0;
+}
+
+static int async_sign_start(mbedtls_ssl_context *ssl, mbedtls_pk_context *key, mbedtls_md_type_t md_alg,
+                            const unsigned char *hash, size_t hash_len)
+{
+    return async_start(ssl, key, false, md_alg, hash, hash_len);
+}
+
+static int async_decrypt_start(mbedtls_ssl_context *ssl, mbedtls_pk_context *key,
+                               const unsigned char *input, size_t input_len)
+{
+    if (!key_is_rsa(key)) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+    return async_start(ssl, key, true, MBEDTLS_MD_NONE, input, input_len);
+}
+
+static int async_resume(mbedtls_ssl_context *ssl, unsigned char *output, size_t *output_len, size_t output_size)
+{
+    async_job_t *job = mbedtls_ssl_get_async_operation_data(ssl);
+    job_state_t state;
+    bool release;
+    int ret;
+
+    if (job == NULL) {
+        return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    state = job->state;
+    portEXIT_CRITICAL(&s_lock);
+    if (state != JOB_DONE) {
+        return MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+    }
+
+    /* The worker no longer writes the result, but may still be in the done
+       callback: take the result before giving the job up */
+    ret = job->ret;
+    if (ret == 0) {
+        if (job->output_len > output_size) {
+            ret = MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+        } else {
+            memcpy(output, job->output, job->output_len);
+            *output_len = job->output_len;
+        }
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    job->owner_done = true;
+    release = job->worker_done;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (release) {
+        async_job_free(job);
+    }
+    return ret;
+}
+
+static void async_cancel(mbedtls_ssl_context *ssl)
+{
+    async_job_t *job = mbedtls_ssl_get_async_operation_data(ssl);
+    bool queued;
+
+    if (job == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    queued = job->state == JOB_QUEUED;
+    job->owner_done = queued;
+    s_stats.cancelled++;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (queued) {
+        /* freed by the worker when it takes it from the queue */
+        return;
+    }
+
+    /* The worker uses the configuration key and the SSL context pointer
+       until it is done, which may take one private key operation */
+    while (true) {
+        portENTER_CRITICAL(&s_lock);
+        bool worker_done = job->worker_done;
+        portEXIT_CRITICAL(&s_lock);
+        if (worker_done) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    async_job_free(job);
+}
+
+int mbedtls_esp_ssl_async_init(mbedtls_esp_ssl_async_done_t done, void *arg)
+{
+    char task_name[16];
+
+    if (s_queue != NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    s_done = done;
+    s_done_arg = arg;
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    s_queue = xQueueCreate(CONFIG_MBEDTLS_SSL_ASYNC_QUEUE_LEN, sizeof(async_job_t *));
+    if (s_queue == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        for (int k = 0; k < WORKER_KEYS; k++) {
+            mbedtls_pk_init(&s_workers[i].keys[k].copy);
+        }
+        sprintf(task_name, "mbedtls_pk%d", i);
+        if (xTaskCreatePinnedToCore(async_worker_task, task_name, CONFIG_MBEDTLS_SSL_ASYNC_TASK_STACK_SIZE,
+                                    &s_workers[i], CONFIG_MBEDTLS_SSL_ASYNC_TASK_PRIORITY, &s_tasks[i], i) != pdPASS) {
+            /* The workers started so far are waiting on the empty queue */
+            while (i-- > 0) {
+                vTaskDelete(s_tasks[i]);
+                s_tasks[i] = NULL;
+            }
+            vQueueDelete(s_queue);
+            s_queue = NULL;
+            return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+    }
+    return 0;
+}
+
+void mbedtls_esp_ssl_async_conf(mbedtls_ssl_config *conf)
+{
+    mbedtls_ssl_conf_async_private_cb(conf, async_sign_start, async_decrypt_start,
+                                      async_resume, async_cancel, NULL);
+}
+
+void mbedtls_esp_ssl_async_get_stats(mbedtls_esp_ssl_async_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void mbedtls_esp_ssl_async_reset_stats(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(&s_stats, 0, sizeof(s_stats));
+    portEXIT_CRITICAL(&s_lock);
+}
+
+#endif /* CONFIG_MBEDTLS_SSL_ASYNC_PRIVATE */
@@ -0,0 +1,547 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_MBEDTLS_CLIENT_SESSION_CACHE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/lock.h>
+
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/entropy_poll.h"
+#include "mbedtls/esp_ssl_client_cache.h"
+
+#if defined(CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_RTC)
+#include "esp_attr.h"
+#elif defined(CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_NVS)
+#include "nvs.h"
+#endif
+
+#define CACHE_ENTRIES CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_ENTRIES
+#define CACHE_TICKET_MAX CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_TICKET_MAX
+
+/* Serialised session: ciphersuite (2), compression (1), id_len (1), id (32),
+   master (48), verify_result (4), mfl_code, trunc_hmac, encrypt_then_mac (3),
+   ticket_lifetime (4), ticket_len (2), then the ticket */
+#define SESSION_FIXED_LEN 97
+#define SESSION_MAX_LEN (SESSION_FIXED_LEN + CACHE_TICKET_MAX)
+
+#define CACHE_IV_LEN 12
+#define CACHE_TAG_LEN 16
+
+#define CACHE_MAGIC 0x53534c43 /* "SSLC" */
+
+/* Authenticated along with the session, not encrypted so that expiry
+   can be checked without decrypting */
+typedef struct {
+    uint8_t id[16];                 /* truncated SHA-256 of "host:port" */
+    int64_t start;                  /* time of the full handshake */
+    int64_t expires;
+} cache_slot_header_t;
+
+typedef struct {
+    cache_slot_header_t header;
+    uint32_t last_used;             /* LRU sequence number, 0 if the slot is empty */
+    uint16_t len;                   /* length of the sealed session */
+    uint8_t iv[CACHE_IV_LEN];
+    uint8_t tag[CACHE_TAG_LEN];
+    uint8_t data[SESSION_MAX_LEN];
+} cache_slot_t;
+
+typedef struct {
+    uint32_t magic;                 /* CACHE_MAGIC once random_key is set */
+    uint8_t random_key[MBEDTLS_ESP_CLIENT_CACHE_KEY_LEN];
+    uint32_t sequence;
+    mbedtls_esp_client_cache_stats_t stats;
+    cache_slot_t slots[CACHE_ENTRIES];
+} cache_store_t;
+
+/* With RTC storage the whole store (including the counters) is kept
+   over deep sleep, and is zeroed on power-on reset */
+#if defined(CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_RTC)
+static RTC_DATA_ATTR cache_store_t s_store;
+#else
+static cache_store_t s_store;
+#endif
+
+#if defined(CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_NVS)
+static const char *NVS_NAMESPACE = "mbedtls_cache";
+static nvs_handle s_nvs;
+#endif
+
+static _lock_t s_lock;
+static mbedtls_gcm_context s_gcm;
+static bool s_ready;
+static uint32_t s_max_age;
+
+static int random_bytes(unsigned char *buf, size_t len)
+{
+    size_t olen;
+    return mbedtls_hardware_poll(NULL, buf, len, &olen);
+}
+
+static int64_t cache_now(void)
+{
+#if defined(MBEDTLS_HAVE_TIME)
+    return (int64_t)mbedtls_time(NULL);
+#else
+    return 0;
+#endif
+}
+
+static void slot_id(const char *host, uint16_t port, uint8_t id[16])
+{
+    unsigned char digest[32];
+    char port_str[8];
+
+    snprintf(port_str, sizeof(port_str), ":%u", port);
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    mbedtls_sha256_update(&sha, (const unsigned char *)host, strlen(host));
+    mbedtls_sha256_update(&sha, (const unsigned char *)port_str, strlen(port_str));
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    memcpy(id, digest, 16);
+}
+
+/* Write the slot through to the backing storage, if there is one */
+static void slot_persist(int index)
+{
+#if defined(CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_NVS)
+    char key[16];
+    snprintf(key, sizeof(key), "session%d", index);
+    if (s_store.slots[index].last_used == 0) {
+        nvs_erase_key(s_nvs, key);
+    } else {
+        nvs_set_blob(s_nvs, key, &s_store.slots[index], sizeof(cache_slot_t));
+    }
+    nvs_commit(s_nvs);
+#endif
+}
+
+/* Implementation that should never be optimized out by the compiler */
+static void cache_zeroize(void *v, size_t n)
+{
+    volatile unsigned char *p = v; while( n-- ) *p++ = 0;
+}
+
+static void slot_drop(int index)
+{
+    cache_zeroize(&s_store.slots[index], sizeof(cache_slot_t));
+    slot_persist(index);
+}
+
+static int slot_find(const uint8_t id[16])
+{
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        if (s_store.slots[i].last_used != 0
+            && memcmp(s_store.slots[i].header.id, id, 16) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool slot_expired(const cache_slot_t *slot, int64_t now)
+{
+#if defined(MBEDTLS_HAVE_TIME)
+    /* a clock which went backwards (not set since power-on) can't tell how old the session is */
+    return now < slot->header.start || now >= slot->header.expires;
+#else
+    return false;
+#endif
+}
+
+/* Slot for a new server: an empty one, else an expired one, else the least recently used */
+static int slot_for_new(int64_t now)
+{
+    int lru = 0;
+
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        if (s_store.slots[i].last_used == 0) {
+            return i;
+        }
+    }
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        if (slot_expired(&s_store.slots[i], now)) {
+            s_store.stats.expired++;
+            return i;
+        }
+        if (s_store.slots[i].last_used < s_store.slots[lru].last_used) {
+            lru = i;
+        }
+    }
+    s_store.stats.evictions++;
+    return lru;
+}
+
+/* Decrypt a slot to plain, which has room for SESSION_MAX_LEN bytes */
+static int slot_open(const cache_slot_t *slot, unsigned char *plain)
+{
+    if (slot->len > SESSION_MAX_LEN) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    return mbedtls_gcm_auth_decrypt(&s_gcm, slot->len, slot->iv, CACHE_IV_LEN,
+                                    (const unsigned char *)&slot->header, sizeof(slot->header),
+                                    slot->tag, CACHE_TAG_LEN, slot->data, plain);
+}
+
+#define PUT_U16(p, v) do { (p)[0] = (unsigned char)((v) >> 8); (p)[1] = (unsigned char)(v); (p) += 2; } while (0)
+#define PUT_U32(p, v) do { PUT_U16(p, (v) >> 16); PUT_U16(p, (v) & 0xffff); } while (0)
+#define GET_U16(p) ((uint16_t)((p)[0] << 8 | (p)[1]))
+#define GET_U32(p) ((uint32_t)GET_U16(p) << 16 | GET_U16((p) + 2))
+
+/* Offset of the master secret in the serialised session */
+#define SESSION_MASTER_OFFSET 36
+
+static size_t session_write(const mbedtls_ssl_session *s, unsigned char *buf)
+{
+    unsigned char *p = buf;
+    size_t ticket_len = 0;
+    uint32_t ticket_lifetime = 0;
+    unsigned char mfl_code = 0, trunc_hmac = 0, encrypt_then_mac = 0;
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    ticket_len = s->ticket_len;
+    ticket_lifetime = s->ticket_lifetime;
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    mfl_code = s->mfl_code;
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+    trunc_hmac = (unsigned char)s->trunc_hmac;
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+    encrypt_then_mac = (unsigned char)s->encrypt_then_mac;
+#endif
+
+    PUT_U16(p, s->ciphersuite);
+    *p++ = (unsigned char)s->compression;
+    *p++ = (unsigned char)s->id_len;
+    memcpy(p, s->id, 32);
+    p += 32;
+    memcpy(p, s->master, 48);
+    p += 48;
+    PUT_U32(p, s->verify_result);
+    *p++ = mfl_code;
+    *p++ = trunc_hmac;
+    *p++ = encrypt_then_mac;
+    PUT_U32(p, ticket_lifetime);
+    PUT_U16(p, ticket_len);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if (ticket_len > 0) {
+        memcpy(p, s->ticket, ticket_len);
+        p += ticket_len;
+    }
+#endif
+    return p - buf;
+}
+
+/* Fill session from a serialised session, the ticket points into buf */
+static int session_read(mbedtls_ssl_session *s, unsigned char *buf, size_t len)
+{
+    const unsigned char *p = buf;
+    size_t ticket_len;
+
+    if (len < SESSION_FIXED_LEN) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    ticket_len = GET_U16(buf + SESSION_FIXED_LEN - 2);
+    if (len != SESSION_FIXED_LEN + ticket_len || buf[3] > 32) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    memset(s, 0, sizeof(mbedtls_ssl_session));
+    s->ciphersuite = GET_U16(p);
+    p += 2;
+    s->compression = *p++;
+    s->id_len = *p++;
+    memcpy(s->id, p, 32);
+    p += 32;
+    memcpy(s->master, p, 48);
+    p += 48;
+    s->verify_result = GET_U32(p);
+    p += 4;
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    s->mfl_code = p[0];
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+    s->trunc_hmac = p[1];
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+    s->encrypt_then_mac = p[2];
+#endif
+    p += 3;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    s->ticket_lifetime = GET_U32(p);
+    s->ticket_len = ticket_len;
+    s->ticket = ticket_len > 0 ? buf + SESSION_FIXED_LEN : NULL;
+#else
+    if (ticket_len > 0) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+#endif
+    return 0;
+}
+
+#if defined(CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_NVS)
+static bool s_nvs_open;
+
+static int nvs_load(void)
+{
+    if (s_nvs_open) {
+        return 0;
+    }
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &s_nvs) != ESP_OK) {
+        return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    }
+    s_nvs_open = true;
+
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        char key[16];
+        size_t len = sizeof(cache_slot_t);
+        snprintf(key, sizeof(key), "session%d", i);
+        /* a blob of another size was written by a build with other settings */
+        if (nvs_get_blob(s_nvs, key, &s_store.slots[i], &len) != ESP_OK || len != sizeof(cache_slot_t)) {
+            memset(&s_store.slots[i], 0, sizeof(cache_slot_t));
+        }
+        if (s_store.slots[i].last_used > s_store.sequence) {
+            s_store.sequence = s_store.slots[i].last_used;
+        }
+    }
+    return 0;
+}
+#endif
+
+int mbedtls_esp_client_cache_init(const unsigned char *key, uint32_t max_age)
+{
+    int ret;
+
+    _lock_acquire(&s_lock);
+    s_ready = false;
+
+#if defined(CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_NVS)
+    /* the store is in flash, a key kept next to it protects nothing */
+    if (key == NULL) {
+        ret = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        goto out;
+    }
+    if ((ret = nvs_load()) != 0) {
+        goto out;
+    }
+#endif
+
+    if (key == NULL) {
+        if (s_store.magic != CACHE_MAGIC) {
+            if ((ret = random_bytes(s_store.random_key, MBEDTLS_ESP_CLIENT_CACHE_KEY_LEN)) != 0) {
+                goto out;
+            }
+            s_store.magic = CACHE_MAGIC;
+        }
+        key = s_store.random_key;
+    }
+
+    mbedtls_gcm_free(&s_gcm);
+    mbedtls_gcm_init(&s_gcm);
+    if ((ret = mbedtls_gcm_setkey(&s_gcm, MBEDTLS_CIPHER_ID_AES, key, MBEDTLS_ESP_CLIENT_CACHE_KEY_LEN * 8)) != 0) {
+        goto out;
+    }
+    s_max_age = max_age;
+    s_ready = true;
+
+out:
+    _lock_release(&s_lock);
+    return ret;
+}
+
+int mbedtls_esp_client_cache_resume(mbedtls_ssl_context *ssl, const char *host, uint16_t port)
+{
+    uint8_t id[16];
+    unsigned char *plain;
+    mbedtls_ssl_session session;
+    int ret = 1;
+
+    if (!s_ready || ssl == NULL || host == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    plain = mbedtls_calloc(1, SESSION_MAX_LEN);
+    if (plain == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    slot_id(host, port, id);
+
+    _lock_acquire(&s_lock);
+    s_store.stats.lookups++;
+
+    int index = slot_find(id);
+    if (index < 0) {
+        goto out;
+    }
+    cache_slot_t *slot = &s_store.slots[index];
+    if (slot_expired(slot, cache_now())) {
+        s_store.stats.expired++;
+        slot_drop(index);
+        goto out;
+    }
+    /* sealed with another key, or damaged */
+    if (slot_open(slot, plain) != 0 || session_read(&session, plain, slot->len) != 0) {
+        slot_drop(index);
+        goto out;
+    }
+#if defined(MBEDTLS_HAVE_TIME)
+    session.start = (mbedtls_time_t)slot->header.start;
+#endif
+
+    ret = mbedtls_ssl_set_session(ssl, &session);
+    if (ret == 0) {
+        s_store.stats.hits++;
+        /* not written through to NVS, it's saved with the next session */
+        slot->last_used = ++s_store.sequence;
+    }
+    cache_zeroize(&session, sizeof(session));
+
+out:
+    _lock_release(&s_lock);
+    cache_zeroize(plain, SESSION_MAX_LEN);
+    mbedtls_free(plain);
+    return ret;
+}
+
+int mbedtls_esp_client_cache_save(mbedtls_ssl_context *ssl, const char *host, uint16_t port)
+{
+    const mbedtls_ssl_session *s;
+    cache_slot_t *slot;
+    unsigned char *plain;
+    size_t ticket_len = 0;
+    uint32_t lifetime;
+    int64_t now;
+    uint8_t id[16];
+    int index;
+    int ret;
+
+    if (!s_ready || ssl == NULL || ssl->session == NULL || host == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    s = ssl->session;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    ticket_len = s->ticket_len;
+#endif
+    if ((s->id_len == 0 && ticket_len == 0) || ticket_len > CACHE_TICKET_MAX) {
+        return 1;
+    }
+
+    /* the new session, then the cached one */
+    plain = mbedtls_calloc(2, SESSION_MAX_LEN);
+    if (plain == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    size_t len = session_write(s, plain);
+    slot_id(host, port, id);
+    now = cache_now();
+
+    lifetime = s_max_age;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if (ticket_len > 0 && s->ticket_lifetime > 0 && s->ticket_lifetime < lifetime) {
+        lifetime = s->ticket_lifetime;
+    }
+#endif
+
+    _lock_acquire(&s_lock);
+
+    index = slot_find(id);
+    if (index >= 0) {
+        /* the same master secret means the cached session was resumed */
+        unsigned char *cached = plain + SESSION_MAX_LEN;
+        if (slot_open(&s_store.slots[index], cached) == 0
+            && memcmp(cached + SESSION_MASTER_OFFSET, s->master, 48) == 0) {
+            s_store.stats.resumed++;
+        }
+    } else {
+        index = slot_for_new(now);
+    }
+
+    slot = &s_store.slots[index];
+    memset(slot, 0, sizeof(cache_slot_t));
+    memcpy(slot->header.id, id, 16);
+#if defined(MBEDTLS_HAVE_TIME)
+    slot->header.start = (int64_t)s->start;
+#endif
+    slot->header.expires = slot->header.start + lifetime;
+
+    ret = random_bytes(slot->iv, CACHE_IV_LEN);
+    if (ret == 0) {
+        ret = mbedtls_gcm_crypt_and_tag(&s_gcm, MBEDTLS_GCM_ENCRYPT, len, slot->iv, CACHE_IV_LEN,
+                                        (const unsigned char *)&slot->header, sizeof(slot->header),
+                                        plain, slot->data, CACHE_TAG_LEN, slot->tag);
+    }
+    if (ret == 0) {
+        slot->len = len;
+        slot->last_used = ++s_store.sequence;
+        slot_persist(index);
+    } else {
+        slot_drop(index);
+    }
+
+    _lock_release(&s_lock);
+    cache_zeroize(plain, 2 * SESSION_MAX_LEN);
+    mbedtls_free(plain);
+    return ret;
+}
+
+void mbedtls_esp_client_cache_remove(const char *host, uint16_t port)
+{
+    uint8_t id[16];
+
+    slot_id(host, port, id);
+    _lock_acquire(&s_lock);
+    int index = slot_find(id);
+    if (index >= 0) {
+        slot_drop(index);
+    }
+    _lock_release(&s_lock);
+}
+
+void mbedtls_esp_client_cache_clear(void)
+{
+    _lock_acquire(&s_lock);
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        if (s_store.slots[i].last_used != 0) {
+            slot_drop(i);
+        }
+    }
+    _lock_release(&s_lock);
+}
+
+void mbedtls_esp_client_cache_get_stats(mbedtls_esp_client_cache_stats_t *stats)
+{
+    _lock_acquire(&s_lock);
+    *stats = s_store.stats;
+    _lock_release(&s_lock);
+}
+
+void mbedtls_esp_client_cache_reset_stats(void)
+{
+    _lock_acquire(&s_lock);
+    memset(&s_store.stats, 0, sizeof(s_store.stats));
+    _lock_release(&s_lock);
+}
+
+#endif /* CONFIG_MBEDTLS_CLIENT_SESSION_CACHE */
@@ -247,6 +247,13 @@
 #define MBEDTLS_AES_ALT
 #endif
 
+/* MBEDTLS_GCM_ALT uses the AES hardware in bulk for GCM, see esp_gcm.c.
+   Without MBEDTLS_AES_ALT it falls back to software AES.
+*/
+#ifdef CONFIG_MBEDTLS_HARDWARE_GCM
+#define MBEDTLS_GCM_ALT
+#endif
+
 /* MBEDTLS_SHAxx_ALT to enable hardware SHA support
    with software fallback.
 */
@@ -492,6 +499,21 @@
 #define MBEDTLS_ECP_NIST_OPTIM
 #endif
 
+/**
+ * \def MBEDTLS_ECP_FIXED_POINT_TABLES
+ *
+ * Use precomputed tables for multiplications of the generator of
+ * secp256r1 (ECDSA signatures, ECDH key generation), instead of computing
+ * them at the first use in each group.
+ *
+ * The tables are in flash. Saves 2 to 3 KB of heap per group and the time
+ * of the precomputation, which is paid again in each TLS handshake with
+ * ECDHE over secp256r1.
+ */
+#ifdef CONFIG_MBEDTLS_ECP_FIXED_POINT_TABLES
+#define MBEDTLS_ECP_FIXED_POINT_TABLES
+#endif
+
 /**
  * \def MBEDTLS_ECDSA_DETERMINISTIC
  *
@@ -987,6 +1009,23 @@
  */
 #define MBEDTLS_SSL_ALL_ALERT_MESSAGES
 
+/**
+ * \def MBEDTLS_SSL_ASYNC_PRIVATE
+ *
+ * Enable asynchronous private key operations in the SSL server: the
+ * ServerKeyExchange signature and the RSA decryption of the premaster secret
+ * can be handed over to callbacks, see mbedtls_ssl_conf_async_private_cb().
+ * The handshake then returns MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS until the
+ * operation is completed.
+ *
+ * Requires: MBEDTLS_SSL_SRV_C
+ *
+ * Enabled with the private key workers of esp_ssl_async.c.
+ */
+#ifdef CONFIG_MBEDTLS_SSL_ASYNC_PRIVATE
+#define MBEDTLS_SSL_ASYNC_PRIVATE
+#endif
+
 /**
  * \def MBEDTLS_SSL_DEBUG_ALL
  *
@@ -1130,6 +1169,25 @@
  */
 #define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
 
+/**
+ * \def MBEDTLS_SSL_DYNAMIC_BUFFERS
+ *
+ * Size the TLS record buffers to the record being sent or received, instead
+ * of allocating MBEDTLS_SSL_BUFFER_LEN bytes for each direction for the
+ * lifetime of the connection. The output buffer is full size during the
+ * handshake; once the handshake is over both buffers are shrunk to the record
+ * header whenever no record is in flight.
+ *
+ * This trades two heap allocations per record for much lower steady-state
+ * memory use of idle connections.
+ *
+ * Only applies to TLS; DTLS contexts keep full size buffers.
+ * Not supported with MBEDTLS_ZLIB_SUPPORT.
+ */
+#ifdef CONFIG_MBEDTLS_DYNAMIC_BUFFERS
+#define MBEDTLS_SSL_DYNAMIC_BUFFERS
+#endif
+
 /**
  * \def MBEDTLS_SSL_PROTO_SSL3
  *
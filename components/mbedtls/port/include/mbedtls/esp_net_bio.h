@@ -0,0 +1,122 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef _ESP_NET_BIO_H_
+#define _ESP_NET_BIO_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "mbedtls/net_sockets.h"
+
+#ifdef CONFIG_MBEDTLS_NET_BIO
+
+/** @brief Socket with send gathering and read-ahead buffers
+ *
+ * Connect, bind or accept into the net member with the mbedtls_net_*()
+ * functions, then give the context and the mbedtls_esp_net_bio_*() callbacks
+ * to mbedtls_ssl_set_bio():
+ *
+ *     mbedtls_ssl_set_bio(&ssl, &bio, mbedtls_esp_net_bio_send,
+ *                         mbedtls_esp_net_bio_recv, mbedtls_esp_net_bio_recv_timeout);
+ */
+typedef struct {
+    mbedtls_net_context net;    /*!< the socket */
+    unsigned char *out;         /*!< gathered output, allocated at the first corked send */
+    size_t out_len;             /*!< bytes in out */
+    int corked;                 /*!< sends are gathered in out */
+    unsigned char *in;          /*!< read-ahead buffer, allocated at the first small read */
+    size_t in_start;            /*!< first byte in the read-ahead buffer not yet returned */
+    size_t in_end;              /*!< end of the data in the read-ahead buffer */
+    uint32_t writes;            /*!< socket writes made, for tuning the buffer sizes */
+    uint32_t reads;             /*!< socket reads made */
+} mbedtls_esp_net_bio_context;
+
+/** @brief Initialize a context, as mbedtls_net_init() */
+void mbedtls_esp_net_bio_init(mbedtls_esp_net_bio_context *ctx);
+
+/** @brief Send the gathered output, free the buffers and close the socket, as mbedtls_net_free() */
+void mbedtls_esp_net_bio_free(mbedtls_esp_net_bio_context *ctx);
+
+/** @brief Gather the following sends.
+ *
+ * While corked, the TLS records written by mbedtls_ssl_write(),
+ * mbedtls_ssl_handshake() or mbedtls_ssl_close_notify() are copied into a
+ * buffer of CONFIG_MBEDTLS_NET_BIO_SEND_BUF bytes and sent together when it
+ * is full, so several small records (for example with a maximum fragment
+ * length, or a handshake flight) cost one socket write. A record which
+ * doesn't fit is sent together with the buffer, without a copy.
+ *
+ * The gathered output is also sent before the socket is read, so a
+ * handshake can run corked (on a non-blocking socket, a read then returns
+ * MBEDTLS_ERR_SSL_WANT_WRITE until the output is sent). After the last
+ * write before waiting for something other than the TLS connection, call
+ * mbedtls_esp_net_bio_flush() or mbedtls_esp_net_bio_uncork(). This
+ * includes the end of a handshake in which the last flight was our own (a
+ * server, or a client resuming a session), if the peer speaks first.
+ *
+ * @param ctx Context.
+ */
+void mbedtls_esp_net_bio_cork(mbedtls_esp_net_bio_context *ctx);
+
+/** @brief Send the gathered output and stop gathering.
+ *
+ * @param ctx Context.
+ *
+ * @return 0 on success, or as mbedtls_esp_net_bio_flush().
+ */
+int mbedtls_esp_net_bio_uncork(mbedtls_esp_net_bio_context *ctx);
+
+/** @brief Send the gathered output.
+ *
+ * @param ctx Context.
+ *
+ * @return 0 when all output was sent, MBEDTLS_ERR_SSL_WANT_WRITE if a
+ * non-blocking socket took part of it (call again when the socket is
+ * writable), or an error of mbedtls_net_send().
+ */
+int mbedtls_esp_net_bio_flush(mbedtls_esp_net_bio_context *ctx);
+
+/** @brief Bytes read from the socket and not yet returned.
+ *
+ * Reads of less than CONFIG_MBEDTLS_NET_BIO_RECV_BUF bytes read ahead as
+ * much as the socket has, so a record header and its body cost one socket
+ * read. An application which waits for input with select() on the socket
+ * must check this (and mbedtls_ssl_check_pending()) first, the data may
+ * already be in the buffer.
+ *
+ * @param ctx Context.
+ *
+ * @return Bytes in the read-ahead buffer.
+ */
+size_t mbedtls_esp_net_bio_recv_pending(const mbedtls_esp_net_bio_context *ctx);
+
+/** @brief Send callback, as mbedtls_net_send() */
+int mbedtls_esp_net_bio_send(void *ctx, const unsigned char *buf, size_t len);
+
+/** @brief Receive callback, as mbedtls_net_recv() */
+int mbedtls_esp_net_bio_recv(void *ctx, unsigned char *buf, size_t len);
+
+/** @brief Receive callback with a timeout, as mbedtls_net_recv_timeout() */
+int mbedtls_esp_net_bio_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+
+#endif /* CONFIG_MBEDTLS_NET_BIO */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_NET_BIO_H_ */
@@ -0,0 +1,98 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef _ESP_SSL_ASYNC_H_
+#define _ESP_SSL_ASYNC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "mbedtls/ssl.h"
+
+#ifdef CONFIG_MBEDTLS_SSL_ASYNC_PRIVATE
+
+/** @brief Called from a worker task when the private key operation of a connection completed.
+ *
+ * Must not block. Typically wakes up the task running the handshake, which
+ * then calls mbedtls_ssl_handshake() again for the connection.
+ *
+ * @param ssl SSL context of the connection.
+ * @param arg Argument given to mbedtls_esp_ssl_async_init().
+ */
+typedef void (*mbedtls_esp_ssl_async_done_t)(mbedtls_ssl_context *ssl, void *arg);
+
+/** @brief Private key worker counters */
+typedef struct {
+    uint32_t completed[portNUM_PROCESSORS]; /*!< operations run by the worker of each core */
+    uint32_t fallbacks;     /*!< operations run in the handshake task (queue full, or unsupported key type) */
+    uint32_t cancelled;     /*!< operations abandoned because the connection was reset or freed */
+} mbedtls_esp_ssl_async_stats_t;
+
+/** @brief Start the private key workers.
+ *
+ * One worker task is pinned to each core. The workers take the signatures
+ * (ServerKeyExchange) and RSA decryptions (ClientKeyExchange) of TLS server
+ * handshakes from a common queue, so a burst of handshakes is spread over
+ * both cores and the RSA accelerator instead of running one after the other
+ * in the task which calls mbedtls_ssl_handshake().
+ *
+ * Each worker keeps its own copy of the keys it has used, private key
+ * operations on the same key run in parallel.
+ *
+ * @param done Called when an operation completed, or NULL to send a task
+ * notification (xTaskNotifyGive()) to the task which started it instead.
+ * @param arg Argument for the done callback.
+ *
+ * @return 0 on success, MBEDTLS_ERR_SSL_ALLOC_FAILED if the tasks or the queue
+ * can't be created, MBEDTLS_ERR_SSL_BAD_INPUT_DATA if already started.
+ */
+int mbedtls_esp_ssl_async_init(mbedtls_esp_ssl_async_done_t done, void *arg);
+
+/** @brief Run the private key operations of the handshakes of a server configuration on the workers.
+ *
+ * With this, mbedtls_ssl_handshake() returns MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS
+ * while the operation of the connection is queued or running. Call it again
+ * after the done callback (or the task notification), as after
+ * MBEDTLS_ERR_SSL_WANT_READ. Meanwhile the task can serve other connections.
+ *
+ * If the queue is full, the operation runs in the calling task.
+ *
+ * @note The keys must not be modified or freed while connections using them
+ * are in a handshake. Freeing or resetting an SSL context in a handshake
+ * waits for the operation of the connection if it is already running.
+ *
+ * @param conf SSL configuration of the server.
+ */
+void mbedtls_esp_ssl_async_conf(mbedtls_ssl_config *conf);
+
+/** @brief Read the worker counters.
+ *
+ * @param stats Filled with the counters since mbedtls_esp_ssl_async_init() or
+ * mbedtls_esp_ssl_async_reset_stats().
+ */
+void mbedtls_esp_ssl_async_get_stats(mbedtls_esp_ssl_async_stats_t *stats);
+
+/** @brief Reset the worker counters. */
+void mbedtls_esp_ssl_async_reset_stats(void);
+
+#endif /* CONFIG_MBEDTLS_SSL_ASYNC_PRIVATE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_SSL_ASYNC_H_ */
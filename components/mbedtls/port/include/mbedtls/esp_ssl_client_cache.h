@@ -0,0 +1,125 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef _ESP_SSL_CLIENT_CACHE_H_
+#define _ESP_SSL_CLIENT_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "mbedtls/ssl.h"
+
+#ifdef CONFIG_MBEDTLS_CLIENT_SESSION_CACHE
+
+/** @brief Length of the key which encrypts the cached sessions (AES-256) */
+#define MBEDTLS_ESP_CLIENT_CACHE_KEY_LEN 32
+
+/** @brief Client session cache counters */
+typedef struct {
+    uint32_t lookups;   /*!< calls to mbedtls_esp_client_cache_resume() */
+    uint32_t hits;      /*!< lookups which found a usable session */
+    uint32_t expired;   /*!< sessions dropped because they reached their lifetime */
+    uint32_t evictions; /*!< sessions dropped to make room for another server (least recently used) */
+    uint32_t resumed;   /*!< saved sessions which were resumptions of the cached session */
+} mbedtls_esp_client_cache_stats_t;
+
+/** @brief Set up the TLS client session cache.
+ *
+ * The cache keeps one session per server (host name and port), up to
+ * CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_ENTRIES servers. Sessions are
+ * encrypted and authenticated with AES-256-GCM before they are stored, in
+ * RAM, in RTC slow memory (kept over deep sleep) or in NVS (kept over power
+ * loss), as selected in menuconfig.
+ *
+ * Sessions which can't be decrypted with the key, for example after the key
+ * changed, are dropped.
+ *
+ * With NVS storage, nvs_flash_init() must have been called.
+ *
+ * @param key MBEDTLS_ESP_CLIENT_CACHE_KEY_LEN bytes of key. May be NULL with
+ * RAM or RTC storage, a random key is then generated at the first call after
+ * a power-on reset (and is kept with the sessions). Required with NVS storage.
+ * @param max_age Lifetime of a session in seconds, counted from the full
+ * handshake. A shorter ticket lifetime hint from the server also applies.
+ * Without CONFIG_MBEDTLS_HAVE_TIME sessions don't expire.
+ *
+ * @return 0 on success, MBEDTLS_ERR_SSL_BAD_INPUT_DATA if a key is required,
+ * or an mbedTLS error code.
+ */
+int mbedtls_esp_client_cache_init(const unsigned char *key, uint32_t max_age);
+
+/** @brief Offer the cached session for a server in the next handshake.
+ *
+ * Call after mbedtls_ssl_setup() and before mbedtls_ssl_handshake(). If the
+ * server no longer accepts the session, the handshake falls back to a full
+ * handshake.
+ *
+ * @note The peer certificate isn't cached, mbedtls_ssl_get_peer_cert()
+ * returns NULL on a resumed connection. The verification result of the
+ * full handshake is kept.
+ *
+ * @param ssl SSL context of a client connection.
+ * @param host Host name of the server.
+ * @param port Port of the server.
+ *
+ * @return 0 if a session was set, 1 if there is no usable session for the
+ * server, or an mbedTLS error code.
+ */
+int mbedtls_esp_client_cache_resume(mbedtls_ssl_context *ssl, const char *host, uint16_t port);
+
+/** @brief Store the session of a connection to a server.
+ *
+ * Call after mbedtls_ssl_handshake() succeeded. Replaces the cached session
+ * of the server, or the least recently used session if the cache is full.
+ *
+ * @param ssl SSL context of a client connection.
+ * @param host Host name of the server.
+ * @param port Port of the server.
+ *
+ * @return 0 on success, 1 if the session can't be resumed (the server gave
+ * neither a session ID nor a ticket, or the ticket is larger than
+ * CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_TICKET_MAX), or an mbedTLS error code.
+ */
+int mbedtls_esp_client_cache_save(mbedtls_ssl_context *ssl, const char *host, uint16_t port);
+
+/** @brief Drop the cached session for a server.
+ *
+ * @param host Host name of the server.
+ * @param port Port of the server.
+ */
+void mbedtls_esp_client_cache_remove(const char *host, uint16_t port);
+
+/** @brief Drop all cached sessions. */
+void mbedtls_esp_client_cache_clear(void);
+
+/** @brief Read the cache counters. The hit rate is hits / lookups.
+ *
+ * @param stats Filled with the counters since power-on (RTC storage) or
+ * since boot (RAM and NVS storage), or since
+ * mbedtls_esp_client_cache_reset_stats().
+ */
+void mbedtls_esp_client_cache_get_stats(mbedtls_esp_client_cache_stats_t *stats);
+
+/** @brief Reset the cache counters. */
+void mbedtls_esp_client_cache_reset_stats(void);
+
+#endif /* CONFIG_MBEDTLS_CLIENT_SESSION_CACHE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_SSL_CLIENT_CACHE_H_ */
@@ -29,9 +29,11 @@ extern "C" {
 
 #if defined(MBEDTLS_SHA1_ALT)
 
+#include "hwcrypto/sha.h"
+
 typedef enum {
     ESP_MBEDTLS_SHA1_UNUSED, /* first block hasn't been processed yet */
-    ESP_MBEDTLS_SHA1_HARDWARE, /* using hardware SHA engine */
+    ESP_MBEDTLS_SHA1_HARDWARE, /* using hardware SHA engine, unless moved off it (see engine) */
     ESP_MBEDTLS_SHA1_SOFTWARE, /* using software SHA */
 } esp_mbedtls_sha1_mode;
 
@@ -44,6 +46,7 @@ typedef struct
     uint32_t state[5];          /*!< intermediate digest state  */
     unsigned char buffer[64];   /*!< data block being processed */
     esp_mbedtls_sha1_mode mode;
+    esp_sha_digest_t engine;    /*!< hardware SHA engine sharing */
 }
 mbedtls_sha1_context;
 
@@ -57,6 +60,11 @@ void mbedtls_sha1_init( mbedtls_sha1_context *ctx );
 /**
  * \brief          Clear SHA-1 context
  *
+ * \note           Mandatory with the hardware SHA engine: the engine may keep a
+ *                 pointer to a context loaded in it, and writes the digest state
+ *                 back to it when another digest takes the engine over. Free every
+ *                 initialised context before its memory is released or reused.
+ *
  * \param ctx      SHA-1 context to be cleared
  */
 void mbedtls_sha1_free( mbedtls_sha1_context *ctx );
@@ -29,9 +29,11 @@ extern "C" {
 
 #if defined(MBEDTLS_SHA256_ALT)
 
+#include "hwcrypto/sha.h"
+
 typedef enum {
     ESP_MBEDTLS_SHA256_UNUSED, /* first block hasn't been processed yet */
-    ESP_MBEDTLS_SHA256_HARDWARE, /* using hardware SHA engine */
+    ESP_MBEDTLS_SHA256_HARDWARE, /* using hardware SHA engine, unless moved off it (see engine) */
     ESP_MBEDTLS_SHA256_SOFTWARE, /* using software SHA */
 } esp_mbedtls_sha256_mode;
 
@@ -45,6 +47,7 @@ typedef struct
     unsigned char buffer[64];   /*!< data block being processed */
     int is224;                  /*!< 0 => SHA-256, else SHA-224 */
     esp_mbedtls_sha256_mode mode;
+    esp_sha_digest_t engine;    /*!< hardware SHA engine sharing */
 }
 mbedtls_sha256_context;
 
@@ -58,6 +61,11 @@ void mbedtls_sha256_init( mbedtls_sha256_context *ctx );
 /**
  * \brief          Clear SHA-256 context
  *
+ * \note           Mandatory with the hardware SHA engine: the engine may keep a
+ *                 pointer to a context loaded in it, and writes the digest state
+ *                 back to it when another digest takes the engine over. Free every
+ *                 initialised context before its memory is released or reused.
+ *
  * \param ctx      SHA-256 context to be cleared
  */
 void mbedtls_sha256_free( mbedtls_sha256_context *ctx );
@@ -29,9 +29,11 @@ extern "C" {
 
 #if defined(MBEDTLS_SHA512_ALT)
 
+#include "hwcrypto/sha.h"
+
 typedef enum {
     ESP_MBEDTLS_SHA512_UNUSED, /* first block hasn't been processed yet */
-    ESP_MBEDTLS_SHA512_HARDWARE, /* using hardware SHA engine */
+    ESP_MBEDTLS_SHA512_HARDWARE, /* using hardware SHA engine, unless moved off it (see engine) */
     ESP_MBEDTLS_SHA512_SOFTWARE, /* using software SHA */
 } esp_mbedtls_sha512_mode;
 
@@ -45,6 +47,7 @@ typedef struct
     unsigned char buffer[128];  /*!< data block being processed */
     int is384;                  /*!< 0 => SHA-512, else SHA-384 */
     esp_mbedtls_sha512_mode mode;
+    esp_sha_digest_t engine;    /*!< hardware SHA engine sharing */
 }
 mbedtls_sha512_context;
 
@@ -58,6 +61,11 @@ void mbedtls_sha512_init( mbedtls_sha512_context *ctx );
 /**
  * \brief          Clear SHA-512 context
  *
+ * \note           Mandatory with the hardware SHA engine: the engine may keep a
+ *                 pointer to a context loaded in it, and writes the digest state
+ *                 back to it when another digest takes the engine over. Free every
+ *                 initialised context before its memory is released or reused.
+ *
  * \param ctx      SHA-512 context to be cleared
  */
 void mbedtls_sha512_free( mbedtls_sha512_context *ctx );
@@ -40,6 +40,7 @@
 #endif
 
 #include "mbedtls/net_sockets.h"
+#include "mbedtls/esp_net_bio.h"
 
 #include <string.h>
 #include <sys/types.h>
@@ -62,7 +63,7 @@ static int net_prepare( void )
 static int mbedtls_net_errno(int fd)
 {
     int sock_errno = 0;
-    u32_t optlen = sizeof(sock_errno);
+    socklen_t optlen = sizeof(sock_errno);
 
     getsockopt(fd, SOL_SOCKET, SO_ERROR, &sock_errno, &optlen);
 
@@ -373,19 +374,13 @@ int mbedtls_net_recv( void *ctx, unsigned char *buf, size_t len )
 }
 
 /*
- * Read at most 'len' characters, blocking for at most 'timeout' ms
+ * Wait at most 'timeout' ms (0: forever) until the socket is readable
  */
-int mbedtls_net_recv_timeout( void *ctx, unsigned char *buf, size_t len,
-                              uint32_t timeout )
+static int net_poll_read( int fd, uint32_t timeout )
 {
     int ret;
     struct timeval tv;
     fd_set read_fds;
-    int fd = ((mbedtls_net_context *) ctx)->fd;
-
-    if ( fd < 0 ) {
-        return ( MBEDTLS_ERR_NET_INVALID_CONTEXT );
-    }
 
     FD_ZERO( &read_fds );
     FD_SET( fd, &read_fds );
@@ -408,25 +403,37 @@ int mbedtls_net_recv_timeout( void *ctx, unsigned char *buf, size_t len,
         return ( MBEDTLS_ERR_NET_RECV_FAILED );
     }
 
-    /* This call will not block */
-    return ( mbedtls_net_recv( ctx, buf, len ) );
+    return ( 0 );
 }
 
 /*
- * Write at most 'len' characters
+ * Read at most 'len' characters, blocking for at most 'timeout' ms
  */
-int mbedtls_net_send( void *ctx, const unsigned char *buf, size_t len )
+int mbedtls_net_recv_timeout( void *ctx, unsigned char *buf, size_t len,
+                              uint32_t timeout )
 {
     int ret;
     int fd = ((mbedtls_net_context *) ctx)->fd;
 
-    int error = 0;
-
     if ( fd < 0 ) {
         return ( MBEDTLS_ERR_NET_INVALID_CONTEXT );
     }
 
-    ret = (int) write( fd, buf, len );
+    ret = net_poll_read( fd, timeout );
+    if ( ret != 0 ) {
+        return ( ret );
+    }
+
+    /* This call will not block */
+    return ( mbedtls_net_recv( ctx, buf, len ) );
+}
+
+/*
+ * Error code of a write() or writev() result
+ */
+static int net_send_result( const mbedtls_net_context *ctx, int ret )
+{
+    int error = 0;
 
     if ( ret < 0 ) {
         if ( net_would_block( ctx, &error ) != 0 ) {
@@ -447,6 +454,20 @@ int mbedtls_net_send( void *ctx, const unsigned char *buf, size_t len )
     return ( ret );
 }
 
+/*
+ * Write at most 'len' characters
+ */
+int mbedtls_net_send( void *ctx, const unsigned char *buf, size_t len )
+{
+    int fd = ((mbedtls_net_context *) ctx)->fd;
+
+    if ( fd < 0 ) {
+        return ( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+    }
+
+    return ( net_send_result( ctx, (int) write( fd, buf, len ) ) );
+}
+
 /*
  * Gracefully close the connection
  */
@@ -462,4 +483,201 @@ void mbedtls_net_free( mbedtls_net_context *ctx )
     ctx->fd = -1;
 }
 
+#if defined(CONFIG_MBEDTLS_NET_BIO)
+
+/*
+ * Buffered socket BIO: sends are gathered while corked, reads shorter than
+ * the read-ahead buffer read as much as the socket has
+ */
+void mbedtls_esp_net_bio_init( mbedtls_esp_net_bio_context *ctx )
+{
+    memset( ctx, 0, sizeof( *ctx ) );
+    mbedtls_net_init( &ctx->net );
+}
+
+void mbedtls_esp_net_bio_free( mbedtls_esp_net_bio_context *ctx )
+{
+    /* Best effort, a close_notify alert may be waiting in the buffer */
+    mbedtls_esp_net_bio_flush( ctx );
+
+    mbedtls_free( ctx->out );
+    mbedtls_free( ctx->in );
+    mbedtls_net_free( &ctx->net );
+    mbedtls_esp_net_bio_init( ctx );
+}
+
+void mbedtls_esp_net_bio_cork( mbedtls_esp_net_bio_context *ctx )
+{
+    ctx->corked = 1;
+}
+
+int mbedtls_esp_net_bio_uncork( mbedtls_esp_net_bio_context *ctx )
+{
+    ctx->corked = 0;
+
+    return ( mbedtls_esp_net_bio_flush( ctx ) );
+}
+
+/*
+ * Drop the first 'sent' bytes of the gathered output
+ */
+static void net_bio_consume( mbedtls_esp_net_bio_context *ctx, size_t sent )
+{
+    ctx->out_len -= sent;
+    memmove( ctx->out, ctx->out + sent, ctx->out_len );
+}
+
+int mbedtls_esp_net_bio_flush( mbedtls_esp_net_bio_context *ctx )
+{
+    int ret;
+
+    while ( ctx->out_len > 0 ) {
+        ctx->writes++;
+        ret = mbedtls_net_send( &ctx->net, ctx->out, ctx->out_len );
+        if ( ret < 0 ) {
+            return ( ret );
+        }
+
+        net_bio_consume( ctx, ret );
+    }
+
+    return ( 0 );
+}
+
+size_t mbedtls_esp_net_bio_recv_pending( const mbedtls_esp_net_bio_context *ctx )
+{
+    return ( ctx->in_end - ctx->in_start );
+}
+
+int mbedtls_esp_net_bio_send( void *ctx, const unsigned char *buf, size_t len )
+{
+    mbedtls_esp_net_bio_context *bio = ctx;
+    struct iovec iov[2];
+    int ret;
+
+    if ( bio->net.fd < 0 ) {
+        return ( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+    }
+
+    /* Output which doesn't fit, or any output when not corked, goes out
+     * together with what was gathered, in one write and without a copy */
+    while ( bio->out_len > 0 &&
+            ( !bio->corked || len > CONFIG_MBEDTLS_NET_BIO_SEND_BUF - bio->out_len ) ) {
+        iov[0].iov_base = bio->out;
+        iov[0].iov_len = bio->out_len;
+        iov[1].iov_base = (void *) buf;
+        iov[1].iov_len = len;
+
+        bio->writes++;
+        ret = net_send_result( &bio->net, (int) writev( bio->net.fd, iov, 2 ) );
+        if ( ret < 0 ) {
+            return ( ret );
+        }
+
+        if ( (size_t) ret < bio->out_len ) {
+            net_bio_consume( bio, ret );
+            continue;
+        }
+
+        ret -= bio->out_len;
+        bio->out_len = 0;
+        if ( ret > 0 ) {
+            return ( ret );
+        }
+    }
+
+    if ( bio->corked && len <= CONFIG_MBEDTLS_NET_BIO_SEND_BUF - bio->out_len ) {
+        if ( bio->out == NULL ) {
+            bio->out = mbedtls_calloc( 1, CONFIG_MBEDTLS_NET_BIO_SEND_BUF );
+        }
+        /* Without the buffer, records are sent one by one */
+        if ( bio->out != NULL ) {
+            memcpy( bio->out + bio->out_len, buf, len );
+            bio->out_len += len;
+            return ( (int) len );
+        }
+    }
+
+    bio->writes++;
+    return ( mbedtls_net_send( &bio->net, buf, len ) );
+}
+
+/*
+ * Copy out of the read-ahead buffer
+ */
+static int net_bio_take( mbedtls_esp_net_bio_context *bio, unsigned char *buf, size_t len )
+{
+    size_t n = bio->in_end - bio->in_start;
+
+    if ( n > len ) {
+        n = len;
+    }
+    memcpy( buf, bio->in + bio->in_start, n );
+    bio->in_start += n;
+
+    return ( (int) n );
+}
+
+int mbedtls_esp_net_bio_recv( void *ctx, unsigned char *buf, size_t len )
+{
+    mbedtls_esp_net_bio_context *bio = ctx;
+    int ret;
+
+    if ( bio->in_end > bio->in_start ) {
+        return ( net_bio_take( bio, buf, len ) );
+    }
+
+    /* The peer may be waiting for what was gathered */
+    ret = mbedtls_esp_net_bio_flush( bio );
+    if ( ret != 0 ) {
+        return ( ret );
+    }
+
+    if ( len < CONFIG_MBEDTLS_NET_BIO_RECV_BUF && bio->in == NULL ) {
+        bio->in = mbedtls_calloc( 1, CONFIG_MBEDTLS_NET_BIO_RECV_BUF );
+    }
+
+    /* Large reads, or without the buffer, read directly */
+    bio->reads++;
+    if ( len >= CONFIG_MBEDTLS_NET_BIO_RECV_BUF || bio->in == NULL ) {
+        return ( mbedtls_net_recv( &bio->net, buf, len ) );
+    }
+
+    ret = mbedtls_net_recv( &bio->net, bio->in, CONFIG_MBEDTLS_NET_BIO_RECV_BUF );
+    if ( ret <= 0 ) {
+        return ( ret );
+    }
+    bio->in_start = 0;
+    bio->in_end = ret;
+
+    return ( net_bio_take( bio, buf, len ) );
+}
+
+int mbedtls_esp_net_bio_recv_timeout( void *ctx, unsigned char *buf, size_t len,
+                                      uint32_t timeout )
+{
+    mbedtls_esp_net_bio_context *bio = ctx;
+    int ret;
+
+    if ( bio->net.fd < 0 ) {
+        return ( MBEDTLS_ERR_NET_INVALID_CONTEXT );
+    }
+
+    if ( bio->in_end == bio->in_start ) {
+        ret = mbedtls_esp_net_bio_flush( bio );
+        if ( ret != 0 ) {
+            return ( ret );
+        }
+
+        ret = net_poll_read( bio->net.fd, timeout );
+        if ( ret != 0 ) {
+            return ( ret );
+        }
+    }
+
+    return ( mbedtls_esp_net_bio_recv( ctx, buf, len ) );
+}
+
+#endif /* CONFIG_MBEDTLS_NET_BIO */
+
 #endif /* MBEDTLS_NET_C */
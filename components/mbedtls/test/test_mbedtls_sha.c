@@ -3,11 +3,13 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <esp_system.h>
 #include "mbedtls/sha1.h"
 #include "mbedtls/sha256.h"
 #include "mbedtls/sha512.h"
+#include "hwcrypto/sha.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -255,3 +257,72 @@ TEST_CASE("mbedtls SHA256 clone", "[mbedtls]")
     mbedtls_sha256_finish(&clone, sha256);
     TEST_ASSERT_EQUAL_MEMORY_MESSAGE(sha256_thousand_as, sha256, 32, "SHA256 cloned calculation");
 }
+
+TEST_CASE("mbedtls SHA engine handed over to the larger input", "[mbedtls]")
+{
+    mbedtls_sha256_context small_ctx, large_ctx, late_ctx;
+    mbedtls_sha512_context sha384_small, sha384_large;
+    esp_sha_stats_t stats;
+    unsigned char sha256[32], sha384[48];
+    unsigned char *thousand_bs = malloc(1000);
+    TEST_ASSERT_NOT_NULL(thousand_bs);
+    memset(thousand_bs, 'b', 1000);
+
+    esp_sha_reset_stats();
+
+    /* small_ctx gets the idle engine, large_ctx takes it over, small_ctx continues in software */
+    mbedtls_sha256_init(&small_ctx);
+    mbedtls_sha256_init(&large_ctx);
+    mbedtls_sha256_init(&late_ctx);
+    mbedtls_sha256_starts(&small_ctx, false);
+    mbedtls_sha256_starts(&large_ctx, false);
+    mbedtls_sha256_starts(&late_ctx, false);
+
+    mbedtls_sha256_update(&small_ctx, one_hundred_as, 100);
+    mbedtls_sha256_update(&large_ctx, thousand_bs, 1000);
+    /* smaller than large_ctx's input, doesn't get the engine */
+    mbedtls_sha256_update(&late_ctx, one_hundred_as, 100);
+    for (int i = 1; i < 10; i++) {
+        mbedtls_sha256_update(&small_ctx, one_hundred_as, 100);
+        mbedtls_sha256_update(&late_ctx, one_hundred_as, 100);
+    }
+
+    esp_sha_get_stats(SHA2_256, &stats);
+    TEST_ASSERT_EQUAL(1, stats.handovers);
+    TEST_ASSERT_EQUAL(1 + 15, stats.hardware_blocks);
+    TEST_ASSERT_EQUAL(14 + 15, stats.software_blocks);
+
+    mbedtls_sha256_finish(&small_ctx, sha256);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(sha256_thousand_as, sha256, 32, "SHA256 moved to software");
+    mbedtls_sha256_finish(&late_ctx, sha256);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(sha256_thousand_as, sha256, 32, "SHA256 in software");
+    mbedtls_sha256_finish(&large_ctx, sha256);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(sha256_thousand_bs, sha256, 32, "SHA256 in hardware");
+    mbedtls_sha256_free(&small_ctx);
+    mbedtls_sha256_free(&large_ctx);
+    mbedtls_sha256_free(&late_ctx);
+
+    /* SHA-384 saves the full SHA-512 state */
+    mbedtls_sha512_init(&sha384_small);
+    mbedtls_sha512_init(&sha384_large);
+    mbedtls_sha512_starts(&sha384_small, true);
+    mbedtls_sha512_starts(&sha384_large, true);
+    for (int i = 0; i < 2; i++) {
+        mbedtls_sha512_update(&sha384_small, one_hundred_bs, 100);
+    }
+    mbedtls_sha512_update(&sha384_large, thousand_bs, 1000);
+    for (int i = 2; i < 10; i++) {
+        mbedtls_sha512_update(&sha384_small, one_hundred_bs, 100);
+    }
+    esp_sha_get_stats(SHA2_384, &stats);
+    TEST_ASSERT_EQUAL(1, stats.handovers);
+
+    mbedtls_sha512_finish(&sha384_small, sha384);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(sha384_thousand_bs, sha384, 48, "SHA384 moved to software");
+    mbedtls_sha512_finish(&sha384_large, sha384);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(sha384_thousand_bs, sha384, 48, "SHA384 in hardware");
+    mbedtls_sha512_free(&sha384_small);
+    mbedtls_sha512_free(&sha384_large);
+
+    free(thousand_bs);
+}
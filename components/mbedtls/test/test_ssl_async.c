@@ -0,0 +1,418 @@
+/* mbedTLS TLS server handshakes with the private key operations on the
+   esp_ssl_async.c workers.
+
+   Clients and servers run in the test task and talk through memory.
+*/
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/param.h>
+#include "mbedtls/ssl.h"
+#include "mbedtls/certs.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/esp_ssl_async.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "unity.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_MBEDTLS_SSL_ASYNC_PRIVATE
+
+#define PIPE_SIZE   8192
+
+typedef struct {
+    unsigned char *data;    /* NULL: a sink which discards everything */
+    size_t size;
+    size_t start;
+    size_t len;
+} test_pipe_t;
+
+typedef struct {
+    test_pipe_t *rx;
+    test_pipe_t *tx;
+} test_bio_t;
+
+typedef struct {
+    test_pipe_t c2s, s2c;
+    test_bio_t client_bio, server_bio;
+    mbedtls_ssl_context client, server;
+} test_pair_t;
+
+/* Configurations shared by all the connections of a test */
+typedef struct {
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_x509_crt crt;
+    mbedtls_pk_context key;
+    mbedtls_ssl_config client_conf;
+    mbedtls_ssl_config server_conf;
+    int suites[2];
+} test_tls_t;
+
+/* The done callback holds the worker while 'hold' is set, so the tests can
+   keep the workers busy and fill the queue */
+static struct {
+    SemaphoreHandle_t done;
+    SemaphoreHandle_t release;
+    volatile bool hold;
+} s_async;
+
+static void test_async_done(mbedtls_ssl_context *ssl, void *arg)
+{
+    xSemaphoreGive(s_async.done);
+    if (s_async.hold) {
+        xSemaphoreTake(s_async.release, portMAX_DELAY);
+    }
+}
+
+/* The workers can only be started once */
+static void test_async_start(void)
+{
+    if (s_async.done == NULL) {
+        s_async.done = xSemaphoreCreateCounting(64, 0);
+        s_async.release = xSemaphoreCreateCounting(portNUM_PROCESSORS, 0);
+        TEST_ASSERT_NOT_NULL(s_async.done);
+        TEST_ASSERT_NOT_NULL(s_async.release);
+        TEST_ASSERT_EQUAL(0, mbedtls_esp_ssl_async_init(test_async_done, NULL));
+    }
+    TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_BAD_INPUT_DATA, mbedtls_esp_ssl_async_init(test_async_done, NULL));
+    s_async.hold = false;
+    while (xSemaphoreTake(s_async.done, 0) == pdTRUE) {
+    }
+    mbedtls_esp_ssl_async_reset_stats();
+}
+
+static uint32_t test_async_completed(void)
+{
+    mbedtls_esp_ssl_async_stats_t stats;
+    uint32_t completed = 0;
+
+    mbedtls_esp_ssl_async_get_stats(&stats);
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        completed += stats.completed[i];
+    }
+    return completed;
+}
+
+static int test_pipe_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    test_pipe_t *p = ((test_bio_t *)ctx)->tx;
+
+    if (p->data == NULL) {
+        return len;
+    }
+    if (p->start > 0) {
+        memmove(p->data, p->data + p->start, p->len - p->start);
+        p->len -= p->start;
+        p->start = 0;
+    }
+    len = MIN(len, p->size - p->len);
+    if (len == 0) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    memcpy(p->data + p->len, buf, len);
+    p->len += len;
+    return len;
+}
+
+static int test_pipe_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    test_pipe_t *p = ((test_bio_t *)ctx)->rx;
+
+    len = MIN(len, p->len - p->start);
+    if (len == 0) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    memcpy(buf, p->data + p->start, len);
+    p->start += len;
+    return len;
+}
+
+static void test_tls_init(test_tls_t *tls, int suite)
+{
+    mbedtls_entropy_init(&tls->entropy);
+    mbedtls_ctr_drbg_init(&tls->drbg);
+    mbedtls_x509_crt_init(&tls->crt);
+    mbedtls_pk_init(&tls->key);
+    mbedtls_ssl_config_init(&tls->client_conf);
+    mbedtls_ssl_config_init(&tls->server_conf);
+
+    TEST_ASSERT_EQUAL(0, mbedtls_ctr_drbg_seed(&tls->drbg, mbedtls_entropy_func, &tls->entropy, NULL, 0));
+    TEST_ASSERT_EQUAL(0, mbedtls_x509_crt_parse(&tls->crt, (const unsigned char *)mbedtls_test_srv_crt_rsa,
+                                                mbedtls_test_srv_crt_rsa_len));
+    TEST_ASSERT_EQUAL(0, mbedtls_pk_parse_key(&tls->key, (const unsigned char *)mbedtls_test_srv_key_rsa,
+                                              mbedtls_test_srv_key_rsa_len, NULL, 0));
+
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_config_defaults(&tls->client_conf, MBEDTLS_SSL_IS_CLIENT,
+                                                     MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT));
+    mbedtls_ssl_conf_rng(&tls->client_conf, mbedtls_ctr_drbg_random, &tls->drbg);
+    mbedtls_ssl_conf_authmode(&tls->client_conf, MBEDTLS_SSL_VERIFY_NONE);
+    tls->suites[0] = suite;
+    tls->suites[1] = 0;
+    mbedtls_ssl_conf_ciphersuites(&tls->client_conf, tls->suites);
+
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_config_defaults(&tls->server_conf, MBEDTLS_SSL_IS_SERVER,
+                                                     MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT));
+    mbedtls_ssl_conf_rng(&tls->server_conf, mbedtls_ctr_drbg_random, &tls->drbg);
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_conf_own_cert(&tls->server_conf, &tls->crt, &tls->key));
+    mbedtls_esp_ssl_async_conf(&tls->server_conf);
+}
+
+static void test_tls_free(test_tls_t *tls)
+{
+    mbedtls_ssl_config_free(&tls->client_conf);
+    mbedtls_ssl_config_free(&tls->server_conf);
+    mbedtls_pk_free(&tls->key);
+    mbedtls_x509_crt_free(&tls->crt);
+    mbedtls_ctr_drbg_free(&tls->drbg);
+    mbedtls_entropy_free(&tls->entropy);
+}
+
+static test_pair_t *test_pair_new(test_tls_t *tls)
+{
+    test_pair_t *pair = calloc(1, sizeof(test_pair_t));
+    TEST_ASSERT_NOT_NULL(pair);
+    pair->c2s.data = malloc(PIPE_SIZE);
+    pair->s2c.data = malloc(PIPE_SIZE);
+    TEST_ASSERT_NOT_NULL(pair->c2s.data);
+    TEST_ASSERT_NOT_NULL(pair->s2c.data);
+    pair->c2s.size = pair->s2c.size = PIPE_SIZE;
+    pair->client_bio.rx = &pair->s2c;
+    pair->client_bio.tx = &pair->c2s;
+    pair->server_bio.rx = &pair->c2s;
+    pair->server_bio.tx = &pair->s2c;
+
+    mbedtls_ssl_init(&pair->client);
+    mbedtls_ssl_init(&pair->server);
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_setup(&pair->client, &tls->client_conf));
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_setup(&pair->server, &tls->server_conf));
+    mbedtls_ssl_set_bio(&pair->client, &pair->client_bio, test_pipe_send, test_pipe_recv, NULL);
+    mbedtls_ssl_set_bio(&pair->server, &pair->server_bio, test_pipe_send, test_pipe_recv, NULL);
+    return pair;
+}
+
+static void test_pair_free(test_pair_t *pair)
+{
+    mbedtls_ssl_free(&pair->client);
+    mbedtls_ssl_free(&pair->server);
+    free(pair->c2s.data);
+    free(pair->s2c.data);
+    free(pair);
+}
+
+/* Returns the number of times the server handshake was in progress on a worker */
+static int test_pair_handshake(test_pair_t *pair)
+{
+    int client_ret = -1, server_ret = -1;
+    int in_progress = 0;
+
+    for (int i = 0; i < 100 && (client_ret != 0 || server_ret != 0); i++) {
+        client_ret = mbedtls_ssl_handshake(&pair->client);
+        TEST_ASSERT_TRUE(client_ret == 0 || client_ret == MBEDTLS_ERR_SSL_WANT_READ);
+        server_ret = mbedtls_ssl_handshake(&pair->server);
+        if (server_ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) {
+            in_progress++;
+            TEST_ASSERT_TRUE(xSemaphoreTake(s_async.done, 5000 / portTICK_PERIOD_MS));
+            continue;
+        }
+        TEST_ASSERT_TRUE(server_ret == 0 || server_ret == MBEDTLS_ERR_SSL_WANT_READ);
+    }
+    TEST_ASSERT_EQUAL(0, client_ret);
+    TEST_ASSERT_EQUAL(0, server_ret);
+
+    unsigned char buf[16];
+    TEST_ASSERT_EQUAL(5, mbedtls_ssl_write(&pair->client, (const unsigned char *)"hello", 5));
+    TEST_ASSERT_EQUAL(5, mbedtls_ssl_read(&pair->server, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_MEMORY("hello", buf, 5);
+    return in_progress;
+}
+
+/* A server without a client, which only gets the client's first flight and
+   discards what it sends, to keep many handshakes open with little memory */
+typedef struct {
+    test_pipe_t rx, tx;
+    test_bio_t bio;
+    mbedtls_ssl_context ssl;
+} test_server_t;
+
+static size_t test_client_hello(test_tls_t *tls, unsigned char *buf, size_t size)
+{
+    test_pipe_t rx = { 0 }, tx = { .data = buf, .size = size };
+    test_bio_t bio = { .rx = &rx, .tx = &tx };
+    mbedtls_ssl_context client;
+
+    mbedtls_ssl_init(&client);
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_setup(&client, &tls->client_conf));
+    mbedtls_ssl_set_bio(&client, &bio, test_pipe_send, test_pipe_recv, NULL);
+    TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_WANT_READ, mbedtls_ssl_handshake(&client));
+    mbedtls_ssl_free(&client);
+    return tx.len;
+}
+
+static test_server_t *test_server_new(test_tls_t *tls, const unsigned char *hello, size_t hello_len)
+{
+    test_server_t *server = calloc(1, sizeof(test_server_t));
+    TEST_ASSERT_NOT_NULL(server);
+    server->rx.data = (unsigned char *)hello;
+    server->rx.size = server->rx.len = hello_len;
+    server->bio.rx = &server->rx;
+    server->bio.tx = &server->tx;
+    mbedtls_ssl_init(&server->ssl);
+    TEST_ASSERT_EQUAL(0, mbedtls_ssl_setup(&server->ssl, &tls->server_conf));
+    mbedtls_ssl_set_bio(&server->ssl, &server->bio, test_pipe_send, test_pipe_recv, NULL);
+    return server;
+}
+
+static void test_server_free(test_server_t *server)
+{
+    mbedtls_ssl_free(&server->ssl);
+    free(server);
+}
+
+/* Runs the server handshake from the ClientHello until it waits for a worker or for the client */
+static int test_server_step(test_server_t *server)
+{
+    int ret = mbedtls_ssl_handshake(&server->ssl);
+    TEST_ASSERT_TRUE(ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS || ret == MBEDTLS_ERR_SSL_WANT_READ);
+    return ret;
+}
+
+TEST_CASE("mbedtls TLS server private key operations run on the workers", "[mbedtls][ssl]")
+{
+    static const int suites[] = {
+#ifdef MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED
+        MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,  /* ServerKeyExchange signature */
+#endif
+#ifdef MBEDTLS_KEY_EXCHANGE_RSA_ENABLED
+        MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256,        /* premaster secret decryption */
+#endif
+    };
+    test_tls_t tls;
+
+    test_async_start();
+    for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++) {
+        printf("ciphersuite %s\n", mbedtls_ssl_get_ciphersuite_name(suites[i]));
+        test_tls_init(&tls, suites[i]);
+        test_pair_t *pair = test_pair_new(&tls);
+        uint32_t completed = test_async_completed();
+
+        TEST_ASSERT_EQUAL(1, test_pair_handshake(pair));
+        TEST_ASSERT_EQUAL(completed + 1, test_async_completed());
+
+        test_pair_free(pair);
+        test_tls_free(&tls);
+    }
+
+    mbedtls_esp_ssl_async_stats_t stats;
+    mbedtls_esp_ssl_async_get_stats(&stats);
+    TEST_ASSERT_EQUAL(0, stats.fallbacks);
+    TEST_ASSERT_EQUAL(0, stats.cancelled);
+}
+
+#ifdef MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED
+
+/* One handshake for each worker (held in the done callback), one for each queue entry and one more */
+#define QUEUE_TEST_SERVERS (portNUM_PROCESSORS + CONFIG_MBEDTLS_SSL_ASYNC_QUEUE_LEN + 1)
+
+TEST_CASE("mbedtls TLS server private key operation runs in the handshake task when the queue is full", "[mbedtls][ssl]")
+{
+    test_tls_t tls;
+    test_server_t *servers[QUEUE_TEST_SERVERS];
+    unsigned char hello[1024];
+    mbedtls_esp_ssl_async_stats_t stats;
+
+    test_async_start();
+    test_tls_init(&tls, MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256);
+    size_t hello_len = test_client_hello(&tls, hello, sizeof(hello));
+
+    s_async.hold = true;
+    for (int i = 0; i < QUEUE_TEST_SERVERS; i++) {
+        servers[i] = test_server_new(&tls, hello, hello_len);
+        int ret = test_server_step(servers[i]);
+        if (i < portNUM_PROCESSORS) {
+            /* taken by a worker, which then waits in the done callback */
+            TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, ret);
+            TEST_ASSERT_TRUE(xSemaphoreTake(s_async.done, 5000 / portTICK_PERIOD_MS));
+        } else if (i < QUEUE_TEST_SERVERS - 1) {
+            TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, ret);
+        } else {
+            /* queue full: signed in this task, the server flight is complete */
+            TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_WANT_READ, ret);
+        }
+    }
+    mbedtls_esp_ssl_async_get_stats(&stats);
+    TEST_ASSERT_EQUAL(1, stats.fallbacks);
+
+    s_async.hold = false;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        xSemaphoreGive(s_async.release);
+    }
+    for (int i = portNUM_PROCESSORS; i < QUEUE_TEST_SERVERS - 1; i++) {
+        TEST_ASSERT_TRUE(xSemaphoreTake(s_async.done, 5000 / portTICK_PERIOD_MS));
+    }
+    TEST_ASSERT_EQUAL(QUEUE_TEST_SERVERS - 1, test_async_completed());
+
+    /* the signatures made by the workers complete the server flights */
+    for (int i = 0; i < QUEUE_TEST_SERVERS; i++) {
+        TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_WANT_READ, test_server_step(servers[i]));
+        test_server_free(servers[i]);
+    }
+    test_tls_free(&tls);
+}
+
+TEST_CASE("mbedtls TLS server private key operations are cancelled when the context is freed", "[mbedtls][ssl]")
+{
+    test_tls_t tls;
+    test_server_t *held[portNUM_PROCESSORS];
+    test_server_t *server;
+    unsigned char hello[1024];
+    mbedtls_esp_ssl_async_stats_t stats;
+
+    test_async_start();
+    test_tls_init(&tls, MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256);
+    size_t hello_len = test_client_hello(&tls, hello, sizeof(hello));
+
+    /* given to a worker: if it already started, the free waits for it */
+    server = test_server_new(&tls, hello, hello_len);
+    TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, test_server_step(server));
+    test_server_free(server);
+    mbedtls_esp_ssl_async_get_stats(&stats);
+    TEST_ASSERT_EQUAL(1, stats.cancelled);
+
+    /* queued behind busy workers: the free returns at once, a worker drops it later */
+    s_async.hold = true;
+    while (xSemaphoreTake(s_async.done, 0) == pdTRUE) {
+    }
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        held[i] = test_server_new(&tls, hello, hello_len);
+        TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, test_server_step(held[i]));
+        TEST_ASSERT_TRUE(xSemaphoreTake(s_async.done, 5000 / portTICK_PERIOD_MS));
+    }
+    server = test_server_new(&tls, hello, hello_len);
+    TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS, test_server_step(server));
+    test_server_free(server);
+    mbedtls_esp_ssl_async_get_stats(&stats);
+    TEST_ASSERT_EQUAL(2, stats.cancelled);
+
+    uint32_t completed = test_async_completed();
+    s_async.hold = false;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        xSemaphoreGive(s_async.release);
+    }
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        TEST_ASSERT_EQUAL(MBEDTLS_ERR_SSL_WANT_READ, test_server_step(held[i]));
+        test_server_free(held[i]);
+    }
+    /* the cancelled operation is neither run nor reported */
+    vTaskDelay(100 / portTICK_PERIOD_MS);
+    TEST_ASSERT_EQUAL(completed, test_async_completed());
+    TEST_ASSERT_EQUAL(pdFALSE, xSemaphoreTake(s_async.done, 0));
+    test_tls_free(&tls);
+}
+
+#endif /* MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED */
+
+#endif /* CONFIG_MBEDTLS_SSL_ASYNC_PRIVATE */
@@ -0,0 +1,52 @@
+/* library/gcm.c built under other names, with MBEDTLS_GCM_ALT turned off */
+#include MBEDTLS_CONFIG_FILE
+
+#undef MBEDTLS_GCM_ALT
+/* the comparison is with the portable code, not the x86 carry-less multiply */
+#undef MBEDTLS_AESNI_C
+
+#define mbedtls_gcm_context         gcm_reference_context
+#define mbedtls_gcm_init            gcm_reference_init
+#define mbedtls_gcm_setkey          gcm_reference_setkey
+#define mbedtls_gcm_starts          gcm_reference_starts
+#define mbedtls_gcm_update          gcm_reference_update
+#define mbedtls_gcm_finish          gcm_reference_finish
+#define mbedtls_gcm_crypt_and_tag   gcm_reference_crypt_and_tag_ctx
+#define mbedtls_gcm_auth_decrypt    gcm_reference_auth_decrypt
+#define mbedtls_gcm_free            gcm_reference_free
+#define mbedtls_gcm_self_test       gcm_reference_self_test
+
+#include "../library/gcm.c"
+
+#include <stdlib.h>
+#include "gcm_reference.h"
+
+struct gcm_reference {
+    mbedtls_gcm_context gcm;
+};
+
+gcm_reference_t *gcm_reference_new(mbedtls_cipher_id_t cipher, const unsigned char *key, unsigned int keybits)
+{
+    gcm_reference_t *ref = calloc(1, sizeof(gcm_reference_t));
+    mbedtls_gcm_init(&ref->gcm);
+    if (mbedtls_gcm_setkey(&ref->gcm, cipher, key, keybits) != 0) {
+        gcm_reference_delete(ref);
+        return NULL;
+    }
+    return ref;
+}
+
+int gcm_reference_crypt_and_tag(gcm_reference_t *ref, int mode, size_t length,
+                                const unsigned char *iv, size_t iv_len,
+                                const unsigned char *add, size_t add_len,
+                                const unsigned char *input, unsigned char *output,
+                                size_t tag_len, unsigned char *tag)
+{
+    return mbedtls_gcm_crypt_and_tag(&ref->gcm, mode, length, iv, iv_len, add, add_len, input, output, tag_len, tag);
+}
+
+void gcm_reference_delete(gcm_reference_t *ref)
+{
+    mbedtls_gcm_free(&ref->gcm);
+    free(ref);
+}
@@ -0,0 +1,27 @@
+/* The mbedTLS software GCM (library/gcm.c), built alongside esp_gcm.c for comparison */
+#pragma once
+
+#include <stddef.h>
+#include "mbedtls/cipher.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct gcm_reference gcm_reference_t;
+
+gcm_reference_t *gcm_reference_new(mbedtls_cipher_id_t cipher, const unsigned char *key, unsigned int keybits);
+
+int gcm_reference_crypt_and_tag(gcm_reference_t *ref, int mode, size_t length,
+                                const unsigned char *iv, size_t iv_len,
+                                const unsigned char *add, size_t add_len,
+                                const unsigned char *input, unsigned char *output,
+                                size_t tag_len, unsigned char *tag);
+
+void gcm_reference_delete(gcm_reference_t *ref);
+
+int gcm_reference_self_test(int verbose);
+
+#ifdef __cplusplus
+}
+#endif
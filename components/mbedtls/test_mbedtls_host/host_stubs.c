@@ -0,0 +1,14 @@
+/* Replacements for the parts of the mbedTLS port layer which need the chip */
+#include <stdlib.h>
+#include <string.h>
+#include "mbedtls/entropy_poll.h"
+
+/* Not random, the tests only need repeatable TLS sessions */
+int mbedtls_hardware_poll(void *data, unsigned char *output, size_t len, size_t *olen)
+{
+    for (size_t i = 0; i < len; i++) {
+        output[i] = (unsigned char)rand();
+    }
+    *olen = len;
+    return 0;
+}
@@ -0,0 +1,5 @@
+/* Additions to esp_config.h for the host tests */
+#pragma once
+
+/* lets the tests count heap use */
+#define MBEDTLS_PLATFORM_MEMORY
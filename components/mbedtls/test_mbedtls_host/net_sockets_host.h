@@ -0,0 +1,20 @@
+/* The POSIX headers net_sockets.c gets from lwip/sockets.h on the chip */
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/* lwIP reports the error of the last call in SO_ERROR, which net_sockets.c
+   uses in place of errno. Linux only reports asynchronous errors there */
+static inline int host_getsockopt(int fd, int level, int name, void *val, socklen_t *len)
+{
+    if (level == SOL_SOCKET && name == SO_ERROR) {
+        *(int *)val = errno;
+        return 0;
+    }
+    return getsockopt(fd, level, name, val, len);
+}
+#define getsockopt host_getsockopt
@@ -0,0 +1,7 @@
+/* The host tests are single threaded, the newlib locks of the chip are no-ops */
+#pragma once
+
+typedef int _lock_t;
+
+static inline void _lock_acquire(_lock_t *lock) { (void)lock; }
+static inline void _lock_release(_lock_t *lock) { (void)lock; }
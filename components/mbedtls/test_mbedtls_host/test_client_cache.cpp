@@ -0,0 +1,162 @@
+#include "tls_pair.h"
+#include "mbedtls/esp_ssl_client_cache.h"
+
+#include <time.h>
+
+static const int gcm_suite = MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+
+static const unsigned char key_a[MBEDTLS_ESP_CLIENT_CACHE_KEY_LEN] = { 1, 2, 3 };
+static const unsigned char key_b[MBEDTLS_ESP_CLIENT_CACHE_KEY_LEN] = { 3, 2, 1 };
+
+static void reset_cache(const unsigned char *key, uint32_t max_age)
+{
+    REQUIRE(mbedtls_esp_client_cache_init(key, max_age) == 0);
+    mbedtls_esp_client_cache_clear();
+    mbedtls_esp_client_cache_reset_stats();
+}
+
+TEST_CASE("client cache resumes sessions", "[ssl][client_cache]")
+{
+    for (bool tickets : { true, false }) {
+        INFO("tickets " << tickets);
+        ServerResumption server(tickets);
+        reset_cache(NULL, 3600);
+        unsigned char master[48];
+
+        {
+            TlsPair pair(gcm_suite, MBEDTLS_SSL_MAX_FRAG_LEN_NONE, &server);
+            CHECK(mbedtls_esp_client_cache_resume(&pair.client.ssl, "example.com", 443) == 1);
+            pair.handshake();
+            if (tickets) {
+                CHECK(pair.client.ssl.session->ticket_len > 0);
+            }
+            REQUIRE(mbedtls_esp_client_cache_save(&pair.client.ssl, "example.com", 443) == 0);
+            memcpy(master, pair.client.ssl.session->master, sizeof(master));
+        }
+
+        {
+            TlsPair pair(gcm_suite, MBEDTLS_SSL_MAX_FRAG_LEN_NONE, &server);
+            /* another port is another server */
+            CHECK(mbedtls_esp_client_cache_resume(&pair.client.ssl, "example.com", 8443) == 1);
+            REQUIRE(mbedtls_esp_client_cache_resume(&pair.client.ssl, "example.com", 443) == 0);
+            pair.handshake();
+            CHECK(memcmp(pair.client.ssl.session->master, master, sizeof(master)) == 0);
+            CHECK(memcmp(pair.server.ssl.session->master, master, sizeof(master)) == 0);
+            pair.transfer(pair.client, pair.server, 1000, 1000);
+            REQUIRE(mbedtls_esp_client_cache_save(&pair.client.ssl, "example.com", 443) == 0);
+        }
+
+        mbedtls_esp_client_cache_stats_t stats;
+        mbedtls_esp_client_cache_get_stats(&stats);
+        CHECK(stats.lookups == 3);
+        CHECK(stats.hits == 1);
+        CHECK(stats.resumed == 1);
+        CHECK(stats.evictions == 0);
+    }
+}
+
+TEST_CASE("client cache drops expired sessions and evicts the least recently used", "[ssl][client_cache]")
+{
+    ServerResumption server(true);
+    reset_cache(key_a, 3600);
+    TlsPair pair(gcm_suite, MBEDTLS_SSL_MAX_FRAG_LEN_NONE, &server);
+    pair.handshake();
+    TlsPair lookup(gcm_suite);
+    mbedtls_esp_client_cache_stats_t stats;
+
+    /* full handshake two hours ago */
+    pair.client.ssl.session->start -= 7200;
+    REQUIRE(mbedtls_esp_client_cache_save(&pair.client.ssl, "old.example.com", 443) == 0);
+    CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, "old.example.com", 443) == 1);
+    mbedtls_esp_client_cache_get_stats(&stats);
+    CHECK(stats.expired == 1);
+    pair.client.ssl.session->start += 7200;
+
+    /* the server's ticket lifetime hint is shorter than max_age */
+    pair.client.ssl.session->ticket_lifetime = 60;
+    pair.client.ssl.session->start -= 120;
+    REQUIRE(mbedtls_esp_client_cache_save(&pair.client.ssl, "old.example.com", 443) == 0);
+    CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, "old.example.com", 443) == 1);
+    mbedtls_esp_client_cache_get_stats(&stats);
+    CHECK(stats.expired == 2);
+    pair.client.ssl.session->start += 120;
+    pair.client.ssl.session->ticket_lifetime = 86400;
+
+    const char *hosts[] = { "h0", "h1", "h2", "h3", "h4" };
+    for (int i = 0; i < CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_ENTRIES; i++) {
+        REQUIRE(mbedtls_esp_client_cache_save(&pair.client.ssl, hosts[i], 443) == 0);
+    }
+    /* h0 becomes the most recently used, h1 the least */
+    CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, "h0", 443) == 0);
+    REQUIRE(mbedtls_esp_client_cache_save(&pair.client.ssl, "h4", 443) == 0);
+    mbedtls_esp_client_cache_get_stats(&stats);
+    CHECK(stats.evictions == 1);
+    CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, "h1", 443) == 1);
+    for (const char *host : { "h0", "h2", "h3", "h4" }) {
+        CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, host, 443) == 0);
+    }
+
+    mbedtls_esp_client_cache_remove("h2", 443);
+    CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, "h2", 443) == 1);
+
+    /* oversized tickets aren't cached */
+    pair.client.ssl.session->ticket_len = CONFIG_MBEDTLS_CLIENT_SESSION_CACHE_TICKET_MAX + 1;
+    CHECK(mbedtls_esp_client_cache_save(&pair.client.ssl, "big.example.com", 443) == 1);
+    pair.client.ssl.session->ticket_len = 0;
+    mbedtls_free(pair.client.ssl.session->ticket);
+    pair.client.ssl.session->ticket = NULL;
+    pair.client.ssl.session->id_len = 0;
+    CHECK(mbedtls_esp_client_cache_save(&pair.client.ssl, "none.example.com", 443) == 1);
+}
+
+TEST_CASE("client cache drops sessions sealed with another key", "[ssl][client_cache]")
+{
+    ServerResumption server(true);
+    TlsPair pair(gcm_suite, MBEDTLS_SSL_MAX_FRAG_LEN_NONE, &server);
+    pair.handshake();
+    TlsPair lookup(gcm_suite);
+
+    reset_cache(key_a, 3600);
+    REQUIRE(mbedtls_esp_client_cache_save(&pair.client.ssl, "example.com", 443) == 0);
+    REQUIRE(mbedtls_esp_client_cache_init(key_a, 3600) == 0);
+    CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, "example.com", 443) == 0);
+
+    REQUIRE(mbedtls_esp_client_cache_init(key_b, 3600) == 0);
+    CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, "example.com", 443) == 1);
+    REQUIRE(mbedtls_esp_client_cache_init(key_a, 3600) == 0);
+    CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, "example.com", 443) == 1);
+
+    /* the random key stays the same from one init to the next */
+    REQUIRE(mbedtls_esp_client_cache_init(NULL, 3600) == 0);
+    REQUIRE(mbedtls_esp_client_cache_save(&pair.client.ssl, "example.com", 443) == 0);
+    REQUIRE(mbedtls_esp_client_cache_init(NULL, 3600) == 0);
+    CHECK(mbedtls_esp_client_cache_resume(&lookup.client.ssl, "example.com", 443) == 0);
+}
+
+TEST_CASE("resumed handshake time", "[ssl][client_cache][perf]")
+{
+    const int rounds = 20;
+    ServerResumption server(true);
+    reset_cache(NULL, 3600);
+    double full_ms = 0, resumed_ms = 0;
+
+    for (int i = 0; i < rounds; i++) {
+        for (bool resume : { false, true }) {
+            TlsPair pair(gcm_suite, MBEDTLS_SSL_MAX_FRAG_LEN_NONE, &server);
+            if (resume) {
+                REQUIRE(mbedtls_esp_client_cache_resume(&pair.client.ssl, "example.com", 443) == 0);
+            }
+            clock_t start = clock();
+            pair.handshake();
+            double ms = (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+            (resume ? resumed_ms : full_ms) += ms / rounds;
+            REQUIRE(mbedtls_esp_client_cache_save(&pair.client.ssl, "example.com", 443) == 0);
+        }
+    }
+
+    mbedtls_esp_client_cache_stats_t stats;
+    mbedtls_esp_client_cache_get_stats(&stats);
+    printf("ECDHE-RSA handshake (client and server): full %.2f ms, resumed with a ticket %.2f ms, "
+           "cache hit rate %u/%u\n", full_ms, resumed_ms, stats.hits, stats.lookups);
+    CHECK(stats.resumed == (uint32_t)rounds);
+}
@@ -0,0 +1,213 @@
+#include "tls_pair.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/ecdsa.h"
+
+#include <chrono>
+
+/* Random number source for the EC operations, deterministic within a run */
+struct EcRng {
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+
+    EcRng()
+    {
+        mbedtls_platform_set_calloc_free(counting_calloc, counting_free);
+        mbedtls_ctr_drbg_init(&drbg);
+        mbedtls_entropy_init(&entropy);
+        REQUIRE(mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, NULL, 0) == 0);
+    }
+
+    ~EcRng()
+    {
+        mbedtls_ctr_drbg_free(&drbg);
+        mbedtls_entropy_free(&entropy);
+    }
+};
+
+/* A random scalar, without multiplying the generator as mbedtls_ecp_gen_keypair() does */
+static void random_scalar(const mbedtls_ecp_group *grp, mbedtls_mpi *m, EcRng &rng)
+{
+    REQUIRE(mbedtls_mpi_fill_random(m, 32, mbedtls_ctr_drbg_random, &rng.drbg) == 0);
+    REQUIRE(mbedtls_mpi_mod_mpi(m, m, &grp->N) == 0);
+}
+
+/* Load a group, without its constant comb table if computed is set: the
+   table is then computed at the first multiplication of the generator, as
+   without MBEDTLS_ECP_FIXED_POINT_TABLES */
+static void load_group(mbedtls_ecp_group *grp, bool computed)
+{
+    REQUIRE(mbedtls_ecp_group_load(grp, MBEDTLS_ECP_DP_SECP256R1) == 0);
+    if (computed) {
+        grp->T = NULL;
+    }
+}
+
+#if defined(MBEDTLS_ECP_FIXED_POINT_TABLES)
+
+TEST_CASE("SECP256R1 generator table matches the computed table", "[ecp]")
+{
+    EcRng rng;
+    mbedtls_ecp_group fixed, computed, copy;
+    mbedtls_ecp_point R1, R2;
+    mbedtls_mpi m;
+    mbedtls_ecp_group_init(&fixed);
+    mbedtls_ecp_group_init(&computed);
+    mbedtls_ecp_group_init(&copy);
+    mbedtls_ecp_point_init(&R1);
+    mbedtls_ecp_point_init(&R2);
+    mbedtls_mpi_init(&m);
+
+    load_group(&fixed, false);
+    load_group(&computed, true);
+    REQUIRE(fixed.T != NULL);
+    REQUIRE(fixed.T_size == 0);
+
+    REQUIRE(mbedtls_mpi_lset(&m, 1) == 0);
+    REQUIRE(mbedtls_ecp_mul(&computed, &R2, &m, &computed.G, mbedtls_ctr_drbg_random, &rng.drbg) == 0);
+    REQUIRE(computed.T != NULL);
+    REQUIRE(computed.T_size == 16);
+    for (size_t i = 0; i < computed.T_size; i++) {
+        INFO("point " << i);
+        CHECK(mbedtls_mpi_cmp_mpi(&fixed.T[i].X, &computed.T[i].X) == 0);
+        CHECK(mbedtls_mpi_cmp_mpi(&fixed.T[i].Y, &computed.T[i].Y) == 0);
+        CHECK(mbedtls_mpi_cmp_int(&fixed.T[i].Z, 1) == 0);
+    }
+
+    /* 1, 2, N - 1, N - 2 and random scalars */
+    for (int i = 0; i < 36; i++) {
+        if (i < 4) {
+            REQUIRE(mbedtls_mpi_lset(&m, i % 2 + 1) == 0);
+            if (i >= 2) {
+                REQUIRE(mbedtls_mpi_sub_mpi(&m, &fixed.N, &m) == 0);
+            }
+        } else {
+            random_scalar(&fixed, &m, rng);
+        }
+        REQUIRE(mbedtls_ecp_mul(&fixed, &R1, &m, &fixed.G, mbedtls_ctr_drbg_random, &rng.drbg) == 0);
+        REQUIRE(mbedtls_ecp_mul(&computed, &R2, &m, &computed.G, mbedtls_ctr_drbg_random, &rng.drbg) == 0);
+        CHECK(mbedtls_ecp_point_cmp(&R1, &R2) == 0);
+        CHECK(mbedtls_ecp_check_pubkey(&fixed, &R1) == 0);
+    }
+
+    /* the table stays with the group, also in a copy, and is never freed */
+    REQUIRE(mbedtls_ecp_group_copy(&copy, &fixed) == 0);
+    CHECK(copy.T == fixed.T);
+    REQUIRE(mbedtls_ecp_mul(&copy, &R2, &m, &copy.G, mbedtls_ctr_drbg_random, &rng.drbg) == 0);
+    CHECK(mbedtls_ecp_point_cmp(&R1, &R2) == 0);
+    CHECK(copy.T_size == 0);
+
+    mbedtls_mpi_free(&m);
+    mbedtls_ecp_point_free(&R1);
+    mbedtls_ecp_point_free(&R2);
+    mbedtls_ecp_group_free(&copy);
+    mbedtls_ecp_group_free(&computed);
+    mbedtls_ecp_group_free(&fixed);
+}
+
+#endif /* MBEDTLS_ECP_FIXED_POINT_TABLES */
+
+TEST_CASE("SECP256R1 keys and signatures (RFC 6979 A.2.5)", "[ecp]")
+{
+    static const unsigned char sample[] = "sample";
+    unsigned char hash[32];
+    mbedtls_ecp_group grp;
+    mbedtls_ecp_point Q, U;
+    mbedtls_mpi d, r, s, r_ref, s_ref;
+
+    mbedtls_platform_set_calloc_free(counting_calloc, counting_free);
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_ecp_point_init(&Q);
+    mbedtls_ecp_point_init(&U);
+    for (mbedtls_mpi *X : { &d, &r, &s, &r_ref, &s_ref }) {
+        mbedtls_mpi_init(X);
+    }
+
+    for (bool computed : { false, true }) {
+        load_group(&grp, computed);
+        REQUIRE(mbedtls_mpi_read_string(&d, 16, "C9AFA9D845BA75166B5C215767B1D6934E50C3DB36E89B127B8A622B120F6721") == 0);
+        REQUIRE(mbedtls_mpi_read_string(&U.X, 16, "60FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E60F29FB6") == 0);
+        REQUIRE(mbedtls_mpi_read_string(&U.Y, 16, "7903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177A3C294D4462299") == 0);
+        REQUIRE(mbedtls_mpi_lset(&U.Z, 1) == 0);
+        REQUIRE(mbedtls_mpi_read_string(&r_ref, 16, "EFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3716") == 0);
+        REQUIRE(mbedtls_mpi_read_string(&s_ref, 16, "F7CB1C942D657C41D436C7A1B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA8") == 0);
+
+        REQUIRE(mbedtls_ecp_mul(&grp, &Q, &d, &grp.G, NULL, NULL) == 0);
+        CHECK(mbedtls_ecp_point_cmp(&Q, &U) == 0);
+
+        REQUIRE(mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), sample, sizeof(sample) - 1, hash) == 0);
+        REQUIRE(mbedtls_ecdsa_sign_det(&grp, &r, &s, &d, hash, sizeof(hash), MBEDTLS_MD_SHA256) == 0);
+        CHECK(mbedtls_mpi_cmp_mpi(&r, &r_ref) == 0);
+        CHECK(mbedtls_mpi_cmp_mpi(&s, &s_ref) == 0);
+        CHECK(mbedtls_ecdsa_verify(&grp, hash, sizeof(hash), &Q, &r, &s) == 0);
+        hash[0] ^= 1;
+        CHECK(mbedtls_ecdsa_verify(&grp, hash, sizeof(hash), &Q, &r, &s) == MBEDTLS_ERR_ECP_VERIFY_FAILED);
+
+        mbedtls_ecp_group_free(&grp);
+    }
+
+    for (mbedtls_mpi *X : { &d, &r, &s, &r_ref, &s_ref }) {
+        mbedtls_mpi_free(X);
+    }
+    mbedtls_ecp_point_free(&Q);
+    mbedtls_ecp_point_free(&U);
+}
+
+TEST_CASE("SECP256R1 sign and key generation latency and heap", "[ecp][perf]")
+{
+    const int rounds = 200;
+    EcRng rng;
+    unsigned char hash[32] = { 1, 2, 3 };
+
+    for (bool computed : { false, true }) {
+#if !defined(MBEDTLS_ECP_FIXED_POINT_TABLES)
+        if (!computed) {
+            continue;
+        }
+#endif
+        const char *mode = computed ? "table computed at first use" : "table in ROM";
+
+        /* ECDHE: a new group, a new key pair in each handshake */
+        heap_owner = CLIENT;
+        heap_live[CLIENT] = heap_peak[CLIENT] = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            mbedtls_ecp_keypair key;
+            mbedtls_ecp_keypair_init(&key);
+            load_group(&key.grp, computed);
+            REQUIRE(mbedtls_ecp_gen_keypair(&key.grp, &key.d, &key.Q, mbedtls_ctr_drbg_random, &rng.drbg) == 0);
+            mbedtls_ecp_keypair_free(&key);
+        }
+        double keygen_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+        size_t keygen_peak = heap_peak[CLIENT];
+
+        /* ECDSA: a long lived key, the first signature computes the table */
+        mbedtls_ecdsa_context ecdsa;
+        mbedtls_mpi r, s;
+        mbedtls_ecdsa_init(&ecdsa);
+        mbedtls_mpi_init(&r);
+        mbedtls_mpi_init(&s);
+        load_group(&ecdsa.grp, computed);
+        random_scalar(&ecdsa.grp, &ecdsa.d, rng);
+
+        heap_live[CLIENT] = heap_peak[CLIENT] = 0;
+        start = std::chrono::steady_clock::now();
+        REQUIRE(mbedtls_ecdsa_sign(&ecdsa.grp, &r, &s, &ecdsa.d, hash, sizeof(hash), mbedtls_ctr_drbg_random, &rng.drbg) == 0);
+        double first_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        size_t sign_peak = heap_peak[CLIENT];
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            REQUIRE(mbedtls_ecdsa_sign(&ecdsa.grp, &r, &s, &ecdsa.d, hash, sizeof(hash), mbedtls_ctr_drbg_random, &rng.drbg) == 0);
+        }
+        double sign_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+        mbedtls_mpi_free(&r);
+        mbedtls_mpi_free(&s);
+        size_t kept = heap_live[CLIENT];
+        mbedtls_ecdsa_free(&ecdsa);
+
+        printf("SECP256R1, %s: key generation %.0f us (peak heap %zu bytes), "
+               "first signature %.0f us (peak heap %zu bytes, %zu bytes kept with the key), signature %.0f us\n",
+               mode, keygen_us, keygen_peak, first_us, sign_peak, kept, sign_us);
+    }
+}
@@ -0,0 +1,164 @@
+#include "catch.hpp"
+#include "mbedtls/gcm.h"
+#include "gcm_reference.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <random>
+#include <vector>
+
+typedef std::vector<unsigned char> bytes_t;
+
+static bytes_t random_bytes(std::mt19937 &gen, size_t len)
+{
+    bytes_t res(len);
+    for (size_t i = 0; i < len; i++) {
+        res[i] = gen() & 0xFF;
+    }
+    return res;
+}
+
+TEST_CASE("GCM self-tests pass", "[gcm]")
+{
+    CHECK(mbedtls_gcm_self_test(0) == 0);
+    CHECK(gcm_reference_self_test(0) == 0);
+}
+
+TEST_CASE("GCM matches the mbedTLS software implementation", "[gcm]")
+{
+    std::mt19937 gen(0x6c6d);
+    const size_t iv_lens[] = { 12, 1, 8, 16, 60 };
+    const size_t add_lens[] = { 0, 13, 17, 100 };
+    const size_t lengths[] = { 0, 1, 15, 16, 17, 100, 1000, 16384 + 5 };
+
+    for (mbedtls_cipher_id_t cipher : { MBEDTLS_CIPHER_ID_AES, MBEDTLS_CIPHER_ID_CAMELLIA }) {
+        for (unsigned int keybits : { 128, 192, 256 }) {
+            bytes_t key = random_bytes(gen, keybits / 8);
+            gcm_reference_t *ref = gcm_reference_new(cipher, key.data(), keybits);
+            REQUIRE(ref != NULL);
+            mbedtls_gcm_context gcm;
+            mbedtls_gcm_init(&gcm);
+            REQUIRE(mbedtls_gcm_setkey(&gcm, cipher, key.data(), keybits) == 0);
+
+            for (size_t iv_len : iv_lens) {
+                for (size_t add_len : add_lens) {
+                    for (size_t len : lengths) {
+                        INFO("cipher " << cipher << " key " << keybits << " iv " << iv_len << " add " << add_len << " length " << len);
+                        bytes_t iv = random_bytes(gen, iv_len);
+                        bytes_t add = random_bytes(gen, add_len);
+                        bytes_t plain = random_bytes(gen, len);
+                        bytes_t expected(len + 1), out(len + 1), decrypted(len + 1);
+                        unsigned char expected_tag[16], tag[16];
+
+                        REQUIRE(gcm_reference_crypt_and_tag(ref, MBEDTLS_GCM_ENCRYPT, len, iv.data(), iv_len, add.data(), add_len,
+                                                            plain.data(), expected.data(), 16, expected_tag) == 0);
+                        REQUIRE(mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, len, iv.data(), iv_len, add.data(), add_len,
+                                                          plain.data(), out.data(), 16, tag) == 0);
+                        CHECK(out == expected);
+                        CHECK(memcmp(tag, expected_tag, 16) == 0);
+
+                        REQUIRE(mbedtls_gcm_auth_decrypt(&gcm, len, iv.data(), iv_len, add.data(), add_len, tag, 16,
+                                                         out.data(), decrypted.data()) == 0);
+                        CHECK(bytes_t(decrypted.begin(), decrypted.begin() + len) == plain);
+
+                        /* in place, with a truncated tag, as TLS does it */
+                        bytes_t in_place = plain;
+                        REQUIRE(mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, len, iv.data(), iv_len, add.data(), add_len,
+                                                          in_place.data(), in_place.data(), 8, tag) == 0);
+                        CHECK(in_place == bytes_t(expected.begin(), expected.begin() + len));
+                        CHECK(memcmp(tag, expected_tag, 8) == 0);
+                        REQUIRE(mbedtls_gcm_auth_decrypt(&gcm, len, iv.data(), iv_len, add.data(), add_len, tag, 8,
+                                                         in_place.data(), in_place.data()) == 0);
+                        CHECK(in_place == plain);
+
+                        tag[0] ^= 1;
+                        CHECK(mbedtls_gcm_auth_decrypt(&gcm, len, iv.data(), iv_len, add.data(), add_len, tag, 8,
+                                                       out.data(), decrypted.data()) == MBEDTLS_ERR_GCM_AUTH_FAILED);
+                    }
+                }
+            }
+            mbedtls_gcm_free(&gcm);
+            gcm_reference_delete(ref);
+        }
+    }
+}
+
+TEST_CASE("GCM streaming gives the same result as one shot", "[gcm]")
+{
+    std::mt19937 gen(7);
+    bytes_t key = random_bytes(gen, 16);
+    bytes_t iv = random_bytes(gen, 12);
+    bytes_t add = random_bytes(gen, 13);
+    bytes_t plain = random_bytes(gen, 1000);
+    bytes_t expected(plain.size()), out(plain.size());
+    unsigned char expected_tag[16], tag[16];
+
+    mbedtls_gcm_context gcm;
+    mbedtls_gcm_init(&gcm);
+    REQUIRE(mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key.data(), 128) == 0);
+    REQUIRE(mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, plain.size(), iv.data(), iv.size(), add.data(), add.size(),
+                                      plain.data(), expected.data(), 16, expected_tag) == 0);
+
+    for (size_t chunk : { 16, 64, 992 }) {
+        REQUIRE(mbedtls_gcm_starts(&gcm, MBEDTLS_GCM_ENCRYPT, iv.data(), iv.size(), add.data(), add.size()) == 0);
+        for (size_t pos = 0; pos < plain.size(); pos += chunk) {
+            size_t n = std::min(chunk, plain.size() - pos);
+            REQUIRE(mbedtls_gcm_update(&gcm, n, plain.data() + pos, out.data() + pos) == 0);
+        }
+        REQUIRE(mbedtls_gcm_finish(&gcm, tag, 16) == 0);
+        CHECK(out == expected);
+        CHECK(memcmp(tag, expected_tag, 16) == 0);
+    }
+
+    /* no data at all, the tag is still masked */
+    REQUIRE(mbedtls_gcm_starts(&gcm, MBEDTLS_GCM_ENCRYPT, iv.data(), iv.size(), NULL, 0) == 0);
+    REQUIRE(mbedtls_gcm_finish(&gcm, tag, 16) == 0);
+    gcm_reference_t *ref = gcm_reference_new(MBEDTLS_CIPHER_ID_AES, key.data(), 128);
+    REQUIRE(gcm_reference_crypt_and_tag(ref, MBEDTLS_GCM_ENCRYPT, 0, iv.data(), iv.size(), NULL, 0, NULL, NULL, 16, expected_tag) == 0);
+    CHECK(memcmp(tag, expected_tag, 16) == 0);
+    gcm_reference_delete(ref);
+
+    CHECK(mbedtls_gcm_finish(&gcm, tag, 3) == MBEDTLS_ERR_GCM_BAD_INPUT);
+    CHECK(mbedtls_gcm_starts(&gcm, MBEDTLS_GCM_ENCRYPT, iv.data(), 0, NULL, 0) == MBEDTLS_ERR_GCM_BAD_INPUT);
+    mbedtls_gcm_free(&gcm);
+}
+
+TEST_CASE("GCM record throughput", "[gcm][perf]")
+{
+    std::mt19937 gen(1);
+    bytes_t key = random_bytes(gen, 16);
+    bytes_t iv = random_bytes(gen, 12);
+    bytes_t add = random_bytes(gen, 13);
+    unsigned char tag[16];
+
+    gcm_reference_t *ref = gcm_reference_new(MBEDTLS_CIPHER_ID_AES, key.data(), 128);
+    mbedtls_gcm_context gcm;
+    mbedtls_gcm_init(&gcm);
+    REQUIRE(mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key.data(), 128) == 0);
+
+    for (size_t record_len : { 1024, 16384 }) {
+        const size_t total = 8 * 1024 * 1024;
+        bytes_t record = random_bytes(gen, record_len);
+
+        clock_t start = clock();
+        for (size_t done = 0; done < total; done += record_len) {
+            gcm_reference_crypt_and_tag(ref, MBEDTLS_GCM_ENCRYPT, record_len, iv.data(), iv.size(), add.data(), add.size(),
+                                        record.data(), record.data(), 16, tag);
+        }
+        double ref_s = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        start = clock();
+        for (size_t done = 0; done < total; done += record_len) {
+            mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, record_len, iv.data(), iv.size(), add.data(), add.size(),
+                                      record.data(), record.data(), 16, tag);
+        }
+        double alt_s = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        printf("AES-128-GCM %zu byte records: mbedTLS gcm.c %.1f MB/s, esp_gcm.c %.1f MB/s (software AES)\n",
+               record_len, total / ref_s / 1e6, total / alt_s / 1e6);
+    }
+
+    mbedtls_gcm_free(&gcm);
+    gcm_reference_delete(ref);
+}
@@ -0,0 +1,235 @@
+#include "tls_pair.h"
+#include "mbedtls/esp_net_bio.h"
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+static const int gcm_suite = MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+
+/* A client and a server connected through a non-blocking socket pair, both
+   through the buffered BIO (uncorked, it sends as mbedtls_net_send()) */
+struct SocketTlsPair : TlsPair {
+    mbedtls_esp_net_bio_context bio[2];
+
+    SocketTlsPair(unsigned char mfl = MBEDTLS_SSL_MAX_FRAG_LEN_NONE) : TlsPair(gcm_suite, mfl)
+    {
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        for (Endpoint *e : { &client, &server }) {
+            mbedtls_esp_net_bio_init(&bio[e->side]);
+            bio[e->side].net.fd = fds[e->side];
+            REQUIRE(mbedtls_net_set_nonblock(&bio[e->side].net) == 0);
+            mbedtls_ssl_set_bio(&e->ssl, &bio[e->side], mbedtls_esp_net_bio_send, mbedtls_esp_net_bio_recv, NULL);
+        }
+    }
+
+    ~SocketTlsPair()
+    {
+        for (Endpoint *e : { &client, &server }) {
+            heap_owner = e->side;
+            mbedtls_esp_net_bio_free(&bio[e->side]);
+        }
+    }
+
+    /* As TlsPair::handshake(), the side which sent the last flight flushes it */
+    void handshake()
+    {
+        int ret[2] = { -1, -1 };
+        for (int i = 0; i < 100 && (ret[CLIENT] != 0 || ret[SERVER] != 0); i++) {
+            for (Endpoint *e : { &client, &server }) {
+                heap_owner = e->side;
+                ret[e->side] = mbedtls_ssl_handshake(&e->ssl);
+                INFO("side " << e->side << " ret -0x" << std::hex << -ret[e->side]);
+                REQUIRE((ret[e->side] == 0 || ret[e->side] == MBEDTLS_ERR_SSL_WANT_READ));
+                if (ret[e->side] == 0) {
+                    REQUIRE(mbedtls_esp_net_bio_flush(&bio[e->side]) == 0);
+                }
+            }
+        }
+        REQUIRE(ret[CLIENT] == 0);
+        REQUIRE(ret[SERVER] == 0);
+    }
+
+    /* Send len bytes from one side and flush, read them on the other in pieces of at most read_size bytes */
+    void transfer_flushed(Endpoint &from, Endpoint &to, size_t len, size_t read_size)
+    {
+        std::vector<unsigned char> data(len), got;
+        for (size_t i = 0; i < len; i++) {
+            data[i] = (unsigned char)(i * 7 + len);
+        }
+        heap_owner = from.side;
+        for (size_t sent = 0; sent < len; ) {
+            int ret = mbedtls_ssl_write(&from.ssl, data.data() + sent, len - sent);
+            REQUIRE(ret > 0);
+            sent += ret;
+        }
+        REQUIRE(mbedtls_esp_net_bio_flush(&bio[from.side]) == 0);
+        CHECK(bio[from.side].out_len == 0);
+
+        std::vector<unsigned char> buf(read_size);
+        heap_owner = to.side;
+        for (int i = 0; got.size() < len && i < 10000; i++) {
+            int ret = mbedtls_ssl_read(&to.ssl, buf.data(), buf.size());
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ) {
+                continue;
+            }
+            REQUIRE(ret > 0);
+            got.insert(got.end(), buf.begin(), buf.begin() + ret);
+        }
+        CHECK(got == data);
+    }
+};
+
+TEST_CASE("Buffered BIO: records round trip over a socket", "[ssl][net_bio]")
+{
+    for (unsigned char mfl : { MBEDTLS_SSL_MAX_FRAG_LEN_NONE, MBEDTLS_SSL_MAX_FRAG_LEN_512 }) {
+        for (bool corked : { false, true }) {
+            INFO("max fragment length " << (int)mfl << (corked ? ", corked" : ""));
+            SocketTlsPair pair(mfl);
+            if (corked) {
+                mbedtls_esp_net_bio_cork(&pair.bio[CLIENT]);
+                mbedtls_esp_net_bio_cork(&pair.bio[SERVER]);
+            }
+            pair.handshake();
+
+            for (size_t len : { 1, 100, 1000, 5000, 16384, 40000 }) {
+                pair.transfer_flushed(pair.client, pair.server, len, 16384);
+                pair.transfer_flushed(pair.server, pair.client, len, 100);
+            }
+            CHECK(mbedtls_esp_net_bio_recv_pending(&pair.bio[CLIENT]) == 0);
+            CHECK(mbedtls_esp_net_bio_recv_pending(&pair.bio[SERVER]) == 0);
+        }
+    }
+}
+
+TEST_CASE("Buffered BIO: corked sends gather records", "[ssl][net_bio]")
+{
+    uint32_t handshake_writes[2];
+
+    for (bool corked : { false, true }) {
+        SocketTlsPair pair(MBEDTLS_SSL_MAX_FRAG_LEN_512);
+        mbedtls_esp_net_bio_context *bio = &pair.bio[CLIENT];
+        if (corked) {
+            mbedtls_esp_net_bio_cork(bio);
+        }
+        pair.handshake();
+        handshake_writes[corked] = bio->writes;
+
+        /* 16 records of 512 bytes, 541 bytes with the GCM overhead: three
+           fit in the buffer, the fourth goes out with them */
+        uint32_t writes = bio->writes;
+        pair.transfer_flushed(pair.client, pair.server, 16 * 512, 16384);
+        CHECK(bio->writes - writes == (corked ? 4 : 16));
+
+        /* an uncork sends what was gathered */
+        if (corked) {
+            heap_owner = CLIENT;
+            REQUIRE(mbedtls_ssl_write(&pair.client.ssl, (const unsigned char *)"0123456789", 10) == 10);
+            CHECK(bio->out_len > 10);
+            REQUIRE(mbedtls_esp_net_bio_uncork(bio) == 0);
+            CHECK(bio->out_len == 0);
+            unsigned char buf[10];
+            heap_owner = SERVER;
+            REQUIRE(mbedtls_ssl_read(&pair.server.ssl, buf, sizeof(buf)) == 10);
+            CHECK(memcmp(buf, "0123456789", 10) == 0);
+        }
+    }
+    /* ClientKeyExchange, ChangeCipherSpec and Finished in one write */
+    CHECK(handshake_writes[true] < handshake_writes[false]);
+}
+
+TEST_CASE("Buffered BIO: a read sends the gathered output first", "[ssl][net_bio]")
+{
+    SocketTlsPair pair;
+    mbedtls_esp_net_bio_cork(&pair.bio[CLIENT]);
+    pair.handshake();
+
+    unsigned char buf[10];
+    heap_owner = CLIENT;
+    REQUIRE(mbedtls_ssl_write(&pair.client.ssl, (const unsigned char *)"0123456789", 10) == 10);
+    CHECK(pair.bio[CLIENT].out_len > 0);
+    heap_owner = SERVER;
+    CHECK(mbedtls_ssl_read(&pair.server.ssl, buf, sizeof(buf)) == MBEDTLS_ERR_SSL_WANT_READ);
+
+    /* the client waits for the reply, its request goes out */
+    heap_owner = CLIENT;
+    CHECK(mbedtls_ssl_read(&pair.client.ssl, buf, sizeof(buf)) == MBEDTLS_ERR_SSL_WANT_READ);
+    CHECK(pair.bio[CLIENT].out_len == 0);
+    heap_owner = SERVER;
+    REQUIRE(mbedtls_ssl_read(&pair.server.ssl, buf, sizeof(buf)) == 10);
+    CHECK(memcmp(buf, "0123456789", 10) == 0);
+}
+
+TEST_CASE("Buffered BIO: small reads read ahead", "[ssl][net_bio]")
+{
+    SocketTlsPair pair;
+    pair.handshake();
+
+    /* ten records of 100 bytes, 129 bytes with the GCM overhead */
+    heap_owner = SERVER;
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(mbedtls_ssl_write(&pair.server.ssl, (const unsigned char *)std::string(100, 'a' + i).data(), 100) == 100);
+    }
+
+    unsigned char buf[100];
+    uint32_t reads = pair.bio[CLIENT].reads;
+    heap_owner = CLIENT;
+    REQUIRE(mbedtls_ssl_read(&pair.client.ssl, buf, sizeof(buf)) == 100);
+    CHECK(buf[0] == 'a');
+    /* the socket is empty, the next records are in the buffer */
+    CHECK(mbedtls_esp_net_bio_recv_pending(&pair.bio[CLIENT]) == CONFIG_MBEDTLS_NET_BIO_RECV_BUF - 129);
+    for (int i = 1; i < 10; i++) {
+        REQUIRE(mbedtls_ssl_read(&pair.client.ssl, buf, sizeof(buf)) == 100);
+        CHECK(buf[99] == 'a' + i);
+    }
+    /* a header and a body read for each record without the buffer */
+    CHECK(pair.bio[CLIENT].reads - reads == 2);
+    CHECK(mbedtls_esp_net_bio_recv_pending(&pair.bio[CLIENT]) == 0);
+}
+
+TEST_CASE("Buffered BIO: recv_timeout returns buffered data without waiting", "[net_bio]")
+{
+    int fds[2];
+    unsigned char buf[16];
+    mbedtls_esp_net_bio_context bio;
+
+    mbedtls_platform_set_calloc_free(counting_calloc, counting_free);
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    mbedtls_esp_net_bio_init(&bio);
+    bio.net.fd = fds[0];
+
+    REQUIRE(write(fds[1], "0123456789", 10) == 10);
+    REQUIRE(mbedtls_esp_net_bio_recv_timeout(&bio, buf, 4, 1000) == 4);
+    CHECK(mbedtls_esp_net_bio_recv_pending(&bio) == 6);
+    REQUIRE(mbedtls_esp_net_bio_recv_timeout(&bio, buf + 4, sizeof(buf) - 4, 1000) == 6);
+    CHECK(memcmp(buf, "0123456789", 10) == 0);
+    CHECK(bio.reads == 1);
+    CHECK(mbedtls_esp_net_bio_recv_timeout(&bio, buf, sizeof(buf), 10) == MBEDTLS_ERR_SSL_TIMEOUT);
+
+    /* reads of the buffer size or more go to the caller's buffer */
+    std::vector<unsigned char> big(CONFIG_MBEDTLS_NET_BIO_RECV_BUF);
+    REQUIRE(write(fds[1], "abc", 3) == 3);
+    REQUIRE(mbedtls_esp_net_bio_recv_timeout(&bio, big.data(), big.size(), 1000) == 3);
+    CHECK(mbedtls_esp_net_bio_recv_pending(&bio) == 0);
+
+    mbedtls_esp_net_bio_free(&bio);
+    CHECK(bio.net.fd == -1);
+    close(fds[1]);
+}
+
+TEST_CASE("Buffered BIO: socket calls per 64 KB with a 512 byte fragment length", "[net_bio][perf]")
+{
+    const size_t len = 65536;
+
+    for (bool corked : { false, true }) {
+        SocketTlsPair pair(MBEDTLS_SSL_MAX_FRAG_LEN_512);
+        if (corked) {
+            mbedtls_esp_net_bio_cork(&pair.bio[SERVER]);
+        }
+        pair.handshake();
+        uint32_t writes = pair.bio[SERVER].writes, reads = pair.bio[CLIENT].reads;
+        pair.transfer_flushed(pair.server, pair.client, len, 512);
+        printf("64 KB in 512 byte records, %s: %u socket writes, %u socket reads with read-ahead\n",
+               corked ? "corked" : "not corked", pair.bio[SERVER].writes - writes, pair.bio[CLIENT].reads - reads);
+    }
+}
@@ -0,0 +1,441 @@
+#include "tls_pair.h"
+#include "mbedtls/entropy_poll.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/* Private key operations on worker threads, each with its own copy of the
+   test keys, as esp_ssl_async.c runs them on the chip */
+struct AsyncKeys {
+    struct Job {
+        mbedtls_ssl_context *ssl;
+        bool decrypt;
+        mbedtls_pk_type_t type;
+        mbedtls_md_type_t md_alg;
+        std::vector<unsigned char> input;
+        unsigned char output[MBEDTLS_MPI_MAX_SIZE];
+        size_t output_len;
+        int ret;
+        bool running;
+        bool done;
+        bool cancelled;
+    };
+
+    struct Worker {
+        mbedtls_pk_context rsa;
+        mbedtls_pk_context ec;
+        std::thread thread;
+    };
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<Job *> queue;
+    std::vector<Worker *> workers;
+    bool stop;
+
+    /* Set by the tests */
+    std::atomic<bool> hold;     /* don't start queued jobs */
+    int fallthrough;            /* start calls to refuse */
+    std::atomic<int> result;    /* result of the operations in place of running them, if not 0 */
+
+    /* Counted for the tests */
+    int starts;
+    int decrypts;
+    int cancels;
+
+    AsyncKeys(int threads) : stop(false), hold(false), fallthrough(0), result(0), starts(0), decrypts(0), cancels(0)
+    {
+        mbedtls_platform_set_calloc_free(counting_calloc, counting_free);
+        for (int i = 0; i < threads; i++) {
+            Worker *w = new Worker;
+            mbedtls_pk_init(&w->rsa);
+            mbedtls_pk_init(&w->ec);
+            REQUIRE(mbedtls_pk_parse_key(&w->rsa, (const unsigned char *)mbedtls_test_srv_key_rsa,
+                                         mbedtls_test_srv_key_rsa_len, NULL, 0) == 0);
+            REQUIRE(mbedtls_pk_parse_key(&w->ec, (const unsigned char *)mbedtls_test_srv_key_ec,
+                                         mbedtls_test_srv_key_ec_len, NULL, 0) == 0);
+            w->thread = std::thread(&AsyncKeys::run, this, w);
+            workers.push_back(w);
+        }
+    }
+
+    ~AsyncKeys()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stop = true;
+        }
+        wake.notify_all();
+        for (Worker *w : workers) {
+            w->thread.join();
+            mbedtls_pk_free(&w->rsa);
+            mbedtls_pk_free(&w->ec);
+            delete w;
+        }
+    }
+
+    void configure(mbedtls_ssl_config *conf)
+    {
+        mbedtls_ssl_conf_async_private_cb(conf, sign_start, decrypt_start, resume, cancel, this);
+    }
+
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            hold = false;
+        }
+        wake.notify_all();
+    }
+
+    static int worker_random(void *ctx, unsigned char *buf, size_t len)
+    {
+        size_t olen;
+        return mbedtls_hardware_poll(ctx, buf, len, &olen);
+    }
+
+    void run(Worker *w)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [this] { return stop || (!hold && !queue.empty()); });
+            if (stop) {
+                return;
+            }
+            Job *job = queue.front();
+            queue.pop_front();
+            job->running = true;
+            int result_override = result;
+            guard.unlock();
+
+            mbedtls_pk_context *key = job->type == MBEDTLS_PK_RSA ? &w->rsa : &w->ec;
+            if (result_override != 0) {
+                job->ret = result_override;
+            } else if (job->decrypt) {
+                job->ret = mbedtls_pk_decrypt(key, job->input.data(), job->input.size(), job->output,
+                                              &job->output_len, sizeof(job->output), worker_random, NULL);
+            } else {
+                job->ret = mbedtls_pk_sign(key, job->md_alg, job->input.data(), job->input.size(), job->output,
+                                           &job->output_len, worker_random, NULL);
+            }
+
+            guard.lock();
+            job->running = false;
+            job->done = true;
+            if (job->cancelled) {
+                delete job;
+            }
+        }
+    }
+
+    int start(mbedtls_ssl_context *ssl, mbedtls_pk_context *key, bool decrypt, mbedtls_md_type_t md_alg,
+              const unsigned char *input, size_t input_len)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        starts++;
+        if (fallthrough > 0) {
+            fallthrough--;
+            return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+        }
+        decrypts += decrypt;
+        Job *job = new Job();
+        job->ssl = ssl;
+        job->decrypt = decrypt;
+        job->type = mbedtls_pk_get_type(key) == MBEDTLS_PK_RSA ? MBEDTLS_PK_RSA : MBEDTLS_PK_ECKEY;
+        job->md_alg = md_alg;
+        job->input.assign(input, input + input_len);
+        queue.push_back(job);
+        mbedtls_ssl_set_async_operation_data(ssl, job);
+        wake.notify_one();
+        return 0;
+    }
+
+    static int sign_start(mbedtls_ssl_context *ssl, mbedtls_pk_context *key, mbedtls_md_type_t md_alg,
+                          const unsigned char *hash, size_t hash_len)
+    {
+        AsyncKeys *self = (AsyncKeys *)mbedtls_ssl_conf_get_async_config_data(ssl->conf);
+        return self->start(ssl, key, false, md_alg, hash, hash_len);
+    }
+
+    static int decrypt_start(mbedtls_ssl_context *ssl, mbedtls_pk_context *key,
+                             const unsigned char *input, size_t input_len)
+    {
+        AsyncKeys *self = (AsyncKeys *)mbedtls_ssl_conf_get_async_config_data(ssl->conf);
+        return self->start(ssl, key, true, MBEDTLS_MD_NONE, input, input_len);
+    }
+
+    static int resume(mbedtls_ssl_context *ssl, unsigned char *output, size_t *output_len, size_t output_size)
+    {
+        AsyncKeys *self = (AsyncKeys *)mbedtls_ssl_conf_get_async_config_data(ssl->conf);
+        Job *job = (Job *)mbedtls_ssl_get_async_operation_data(ssl);
+        REQUIRE(job != NULL);
+        REQUIRE(job->ssl == ssl);
+
+        std::lock_guard<std::mutex> guard(self->lock);
+        if (!job->done) {
+            return MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+        }
+        int ret = job->ret;
+        if (ret == 0) {
+            REQUIRE(job->output_len <= output_size);
+            memcpy(output, job->output, job->output_len);
+            *output_len = job->output_len;
+        }
+        delete job;
+        return ret;
+    }
+
+    static void cancel(mbedtls_ssl_context *ssl)
+    {
+        AsyncKeys *self = (AsyncKeys *)mbedtls_ssl_conf_get_async_config_data(ssl->conf);
+        Job *job = (Job *)mbedtls_ssl_get_async_operation_data(ssl);
+        REQUIRE(job != NULL);
+
+        std::lock_guard<std::mutex> guard(self->lock);
+        self->cancels++;
+        if (job->running) {
+            job->cancelled = true;  /* deleted by the worker */
+            return;
+        }
+        for (auto it = self->queue.begin(); it != self->queue.end(); ++it) {
+            if (*it == job) {
+                self->queue.erase(it);
+                break;
+            }
+        }
+        delete job;
+    }
+};
+
+/* Server certificates of both key types */
+struct EcServerCert {
+    mbedtls_x509_crt crt;
+    mbedtls_pk_context key;
+
+    EcServerCert(TlsPair &pair)
+    {
+        mbedtls_x509_crt_init(&crt);
+        mbedtls_pk_init(&key);
+        REQUIRE(mbedtls_x509_crt_parse(&crt, (const unsigned char *)mbedtls_test_srv_crt_ec,
+                                       mbedtls_test_srv_crt_ec_len) == 0);
+        REQUIRE(mbedtls_pk_parse_key(&key, (const unsigned char *)mbedtls_test_srv_key_ec,
+                                     mbedtls_test_srv_key_ec_len, NULL, 0) == 0);
+        REQUIRE(mbedtls_ssl_conf_own_cert(&pair.server.conf, &crt, &key) == 0);
+    }
+
+    ~EcServerCert()
+    {
+        mbedtls_x509_crt_free(&crt);
+        mbedtls_pk_free(&key);
+    }
+};
+
+/* Run one handshake step on each side, returns the server's result */
+static int handshake_round(TlsPair &pair, int ret[2])
+{
+    for (Endpoint *e : { &pair.client, &pair.server }) {
+        if (ret[e->side] == 0) {
+            continue;
+        }
+        heap_owner = e->side;
+        ret[e->side] = mbedtls_ssl_handshake(&e->ssl);
+    }
+    return ret[SERVER];
+}
+
+/* Handshake, the worker threads may be held. Returns the number of
+   MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS results of the server, or -1 on error */
+static int async_handshake(TlsPair &pair, AsyncKeys &keys, int *error = NULL)
+{
+    int ret[2] = { -1, -1 };
+    int in_progress = 0;
+
+    for (int i = 0; i < 100000 && (ret[CLIENT] != 0 || ret[SERVER] != 0); i++) {
+        handshake_round(pair, ret);
+        if (ret[SERVER] == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) {
+            if (++in_progress == 3) {
+                keys.release();
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        for (int side : { CLIENT, SERVER }) {
+            if (ret[side] != 0 && ret[side] != MBEDTLS_ERR_SSL_WANT_READ) {
+                if (error != NULL) {
+                    *error = ret[side];
+                    return -1;
+                }
+                FAIL("side " << side << " ret -0x" << std::hex << -ret[side]);
+            }
+        }
+    }
+    REQUIRE(ret[CLIENT] == 0);
+    REQUIRE(ret[SERVER] == 0);
+    return in_progress;
+}
+
+TEST_CASE("async private key operations complete the handshake", "[ssl][async]")
+{
+    struct {
+        int suite;
+        int minor_ver;
+        bool decrypt;
+    } cases[] = {
+        { MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256, MBEDTLS_SSL_MINOR_VERSION_3, false },
+        { MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256, MBEDTLS_SSL_MINOR_VERSION_3, false },
+        { MBEDTLS_TLS_DHE_RSA_WITH_AES_128_GCM_SHA256, MBEDTLS_SSL_MINOR_VERSION_3, false },
+        { MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256, MBEDTLS_SSL_MINOR_VERSION_3, true },
+        /* MD5+SHA1 signature */
+        { MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA, MBEDTLS_SSL_MINOR_VERSION_2, false },
+        { MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA, MBEDTLS_SSL_MINOR_VERSION_2, false },
+        { MBEDTLS_TLS_RSA_WITH_AES_128_CBC_SHA, MBEDTLS_SSL_MINOR_VERSION_1, true },
+    };
+    AsyncKeys keys(2);
+
+    for (auto &c : cases) {
+        INFO("suite " << mbedtls_ssl_get_ciphersuite_name(c.suite) << " minor version " << c.minor_ver);
+        TlsPair pair(c.suite);
+        EcServerCert ec(pair);
+        mbedtls_ssl_conf_max_version(&pair.client.conf, MBEDTLS_SSL_MAJOR_VERSION_3, c.minor_ver);
+        keys.configure(&pair.server.conf);
+        keys.starts = keys.decrypts = 0;
+        keys.hold = true;
+
+        CHECK(async_handshake(pair, keys) >= 3);
+        CHECK(keys.starts == 1);
+        CHECK(keys.decrypts == (c.decrypt ? 1 : 0));
+        CHECK(pair.server.ssl.minor_ver == c.minor_ver);
+        pair.transfer(pair.client, pair.server, 1000, 1000);
+        pair.transfer(pair.server, pair.client, 1000, 1000);
+    }
+}
+
+TEST_CASE("async private key operations fall back or fail", "[ssl][async]")
+{
+    AsyncKeys keys(1);
+    const int sign_suite = MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+    const int decrypt_suite = MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256;
+
+    for (int suite : { sign_suite, decrypt_suite }) {
+        INFO("suite " << mbedtls_ssl_get_ciphersuite_name(suite));
+        {
+            /* refused by the start callback, done in the handshake */
+            TlsPair pair(suite);
+            keys.configure(&pair.server.conf);
+            keys.starts = 0;
+            keys.fallthrough = 1;
+            CHECK(async_handshake(pair, keys) == 0);
+            CHECK(keys.starts == 1);
+            pair.transfer(pair.client, pair.server, 100, 100);
+        }
+        {
+            TlsPair pair(suite);
+            keys.configure(&pair.server.conf);
+            keys.result = MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+            int error = 0;
+            CHECK(async_handshake(pair, keys, &error) == -1);
+            if (suite == sign_suite) {
+                CHECK(error == MBEDTLS_ERR_PK_BAD_INPUT_DATA);
+            } else {
+                /* no decryption oracle: a random premaster secret is used,
+                   the handshake fails on the client's Finished message */
+                CHECK(error != MBEDTLS_ERR_PK_BAD_INPUT_DATA);
+                CHECK(pair.server.ssl.state >= MBEDTLS_SSL_CLIENT_CHANGE_CIPHER_SPEC);
+            }
+            keys.result = 0;
+        }
+    }
+}
+
+TEST_CASE("async private key operation is cancelled by a session reset", "[ssl][async]")
+{
+    AsyncKeys keys(1);
+    TlsPair pair(MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256);
+    keys.configure(&pair.server.conf);
+
+    keys.hold = true;
+    int ret[2] = { -1, -1 };
+    for (int i = 0; i < 100 && ret[SERVER] != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS; i++) {
+        handshake_round(pair, ret);
+    }
+    REQUIRE(ret[SERVER] == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS);
+    REQUIRE(mbedtls_ssl_get_async_operation_data(&pair.server.ssl) != NULL);
+
+    /* queued job */
+    heap_owner = SERVER;
+    REQUIRE(mbedtls_ssl_session_reset(&pair.server.ssl) == 0);
+    CHECK(keys.cancels == 1);
+    CHECK(mbedtls_ssl_get_async_operation_data(&pair.server.ssl) == NULL);
+    CHECK(pair.server.ssl.handshake->async_in_progress == 0);
+
+    /* a new connection on the reset context */
+    heap_owner = CLIENT;
+    REQUIRE(mbedtls_ssl_session_reset(&pair.client.ssl) == 0);
+    pair.c2s.clear();
+    pair.s2c.clear();
+    keys.hold = true;
+    CHECK(async_handshake(pair, keys) > 0);
+    pair.transfer(pair.client, pair.server, 100, 100);
+
+    /* running job, freeing the context */
+    TlsPair pair2(MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256);
+    keys.configure(&pair2.server.conf);
+    int ret2[2] = { -1, -1 };
+    for (int i = 0; i < 100 && ret2[SERVER] != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS; i++) {
+        handshake_round(pair2, ret2);
+    }
+    REQUIRE(ret2[SERVER] == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS);
+    mbedtls_ssl_free(&pair2.server.ssl);
+    mbedtls_ssl_init(&pair2.server.ssl);
+    CHECK(keys.cancels == 2);
+}
+
+TEST_CASE("async private key operations pipeline concurrent handshakes", "[ssl][async][perf]")
+{
+    const int connections = 16;
+    const int suite = MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+    unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (unsigned workers : { 0u, threads }) {
+        std::unique_ptr<AsyncKeys> keys(workers ? new AsyncKeys(workers) : NULL);
+        std::vector<std::unique_ptr<TlsPair>> pairs;
+        for (int i = 0; i < connections; i++) {
+            pairs.emplace_back(new TlsPair(suite));
+            if (keys) {
+                keys->configure(&pairs.back()->server.conf);
+            }
+        }
+
+        /* one task drives all the handshakes, as a server's accept loop would */
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::array<int, 2>> ret(connections, std::array<int, 2> { { -1, -1 } });
+        bool busy = true;
+        while (busy) {
+            busy = false;
+            for (int i = 0; i < connections; i++) {
+                if (ret[i][CLIENT] == 0 && ret[i][SERVER] == 0) {
+                    continue;
+                }
+                busy = true;
+                handshake_round(*pairs[i], ret[i].data());
+                for (int side : { CLIENT, SERVER }) {
+                    REQUIRE((ret[i][side] == 0 || ret[i][side] == MBEDTLS_ERR_SSL_WANT_READ ||
+                             ret[i][side] == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS));
+                }
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (workers == 0) {
+            printf("%d concurrent TLS handshakes (RSA-2048 server key): %.1f ms with the signatures in the handshake task\n",
+                   connections, ms);
+        } else {
+            printf("%d concurrent TLS handshakes (RSA-2048 server key): %.1f ms with %u signing threads\n",
+                   connections, ms, workers);
+        }
+    }
+}
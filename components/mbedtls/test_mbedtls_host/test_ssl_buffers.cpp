@@ -0,0 +1,83 @@
+#include "tls_pair.h"
+
+static const int gcm_suite = MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256;
+static const int cbc_suite = MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256;
+
+TEST_CASE("TLS records of all sizes round trip", "[ssl]")
+{
+    for (int suite : { gcm_suite, cbc_suite }) {
+        for (unsigned char mfl : { MBEDTLS_SSL_MAX_FRAG_LEN_NONE, MBEDTLS_SSL_MAX_FRAG_LEN_1024 }) {
+            TlsPair pair(suite, mfl);
+            pair.handshake();
+            pair.check_idle(pair.client);
+            pair.check_idle(pair.server);
+
+            for (size_t len : { 1, 100, 1000, 5000, 16384, 40000 }) {
+                pair.transfer(pair.client, pair.server, len, 16384);
+                pair.transfer(pair.server, pair.client, len, 100);
+                pair.check_idle(pair.client);
+                pair.check_idle(pair.server);
+            }
+
+            /* a read leaving part of the record in the buffer keeps it */
+            pair.transfer(pair.server, pair.client, 1000, 1000);
+            heap_owner = SERVER;
+            REQUIRE(mbedtls_ssl_write(&pair.server.ssl, (const unsigned char *)"0123456789", 10) == 10);
+            unsigned char buf[10];
+            heap_owner = CLIENT;
+            REQUIRE(mbedtls_ssl_read(&pair.client.ssl, buf, 4) == 4);
+            CHECK(mbedtls_ssl_get_bytes_avail(&pair.client.ssl) == 6);
+            REQUIRE(mbedtls_ssl_read(&pair.client.ssl, buf + 4, 6) == 6);
+            CHECK(memcmp(buf, "0123456789", 10) == 0);
+            pair.check_idle(pair.client);
+        }
+    }
+}
+
+TEST_CASE("TLS renegotiation after the buffers were shrunk", "[ssl]")
+{
+    TlsPair pair(gcm_suite);
+    pair.handshake();
+    pair.transfer(pair.client, pair.server, 3000, 3000);
+    pair.renegotiate();
+    pair.transfer(pair.server, pair.client, 20000, 20000);
+    pair.transfer(pair.client, pair.server, 20000, 512);
+    pair.check_idle(pair.client);
+    pair.check_idle(pair.server);
+
+    heap_owner = CLIENT;
+    CHECK(mbedtls_ssl_close_notify(&pair.client.ssl) == 0);
+    unsigned char buf[16];
+    heap_owner = SERVER;
+    CHECK(mbedtls_ssl_read(&pair.server.ssl, buf, sizeof(buf)) == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY);
+}
+
+TEST_CASE("TLS connection memory use", "[ssl]")
+{
+    for (unsigned char mfl : { MBEDTLS_SSL_MAX_FRAG_LEN_NONE, MBEDTLS_SSL_MAX_FRAG_LEN_2048 }) {
+        TlsPair pair(gcm_suite, mfl);
+        pair.handshake();
+        size_t after_handshake = heap_live[CLIENT];
+
+        heap_peak[CLIENT] = heap_live[CLIENT];
+        pair.transfer(pair.client, pair.server, 50000, 4096);
+        pair.transfer(pair.server, pair.client, 50000, 4096);
+        size_t transfer_peak = heap_peak[CLIENT];
+        size_t steady = heap_live[CLIENT];
+
+        printf("client connection%s: %zu bytes after setup, peak %zu during handshake, %zu during transfer, "
+               "%zu steady state (fixed buffers: %zu bytes)\n",
+               mfl == MBEDTLS_SSL_MAX_FRAG_LEN_NONE ? "" : " with 2048 byte fragments", pair.setup_live[CLIENT],
+               pair.handshake_peak[CLIENT], transfer_peak, steady, (size_t)2 * MBEDTLS_SSL_BUFFER_LEN);
+
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+        CHECK(steady == after_handshake);
+        CHECK(steady < MBEDTLS_SSL_BUFFER_LEN / 2);
+        if (mfl == MBEDTLS_SSL_MAX_FRAG_LEN_2048) {
+            /* one record each way, plus the small buffers while they are swapped */
+            CHECK(transfer_peak - steady < 2 * (2048 + MBEDTLS_SSL_BUFFER_LEN - MBEDTLS_SSL_MAX_CONTENT_LEN +
+                                                MBEDTLS_SSL_PADDING_ADD));
+        }
+#endif
+    }
+}
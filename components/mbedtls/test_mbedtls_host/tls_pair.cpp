@@ -0,0 +1,60 @@
+#include "tls_pair.h"
+
+#include <mutex>
+
+std::atomic<int> heap_owner;
+size_t heap_live[2];
+size_t heap_peak[2];
+
+static std::mutex heap_lock;
+
+struct alloc_header {
+    size_t size;
+    int owner;
+    long long align;
+};
+
+void *counting_calloc(size_t n, size_t size)
+{
+    alloc_header *h = (alloc_header *)calloc(1, sizeof(alloc_header) + n * size);
+    if (h == NULL) {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> guard(heap_lock);
+    h->size = n * size;
+    h->owner = heap_owner;
+    heap_live[h->owner] += h->size;
+    if (heap_live[h->owner] > heap_peak[h->owner]) {
+        heap_peak[h->owner] = heap_live[h->owner];
+    }
+    return h + 1;
+}
+
+void counting_free(void *ptr)
+{
+    if (ptr != NULL) {
+        alloc_header *h = (alloc_header *)ptr - 1;
+        std::lock_guard<std::mutex> guard(heap_lock);
+        heap_live[h->owner] -= h->size;
+        free(h);
+    }
+}
+
+int pipe_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    Endpoint *e = (Endpoint *)ctx;
+    e->tx->insert(e->tx->end(), buf, buf + len);
+    return (int)len;
+}
+
+int pipe_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    Endpoint *e = (Endpoint *)ctx;
+    if (e->rx->empty()) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    len = std::min(len, e->rx->size());
+    std::copy(e->rx->begin(), e->rx->begin() + len, buf);
+    e->rx->erase(e->rx->begin(), e->rx->begin() + len);
+    return (int)len;
+}
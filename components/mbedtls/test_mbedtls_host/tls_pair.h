@@ -0,0 +1,222 @@
+/* A TLS client and server connected through memory, for the host tests */
+#pragma once
+
+#include "catch.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_internal.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/certs.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+
+/* Heap use is counted separately for the client and the server side.
+   Allocations from other threads are counted for the current owner. */
+enum { CLIENT = 0, SERVER = 1 };
+extern std::atomic<int> heap_owner;
+extern size_t heap_live[2];
+extern size_t heap_peak[2];
+
+void *counting_calloc(size_t n, size_t size);
+void counting_free(void *ptr);
+
+typedef std::deque<unsigned char> pipe_t;
+
+struct Endpoint {
+    int side;
+    pipe_t *rx;
+    pipe_t *tx;
+    mbedtls_ssl_config conf;
+    mbedtls_ssl_context ssl;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+    mbedtls_x509_crt crt;
+    mbedtls_pk_context key;
+};
+
+int pipe_send(void *ctx, const unsigned char *buf, size_t len);
+int pipe_recv(void *ctx, unsigned char *buf, size_t len);
+
+/* Session cache and ticket keys of a server, which outlive one connection */
+struct ServerResumption {
+    mbedtls_ssl_cache_context cache;
+    mbedtls_ssl_ticket_context ticket;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+
+    ServerResumption(bool tickets)
+    {
+        mbedtls_platform_set_calloc_free(counting_calloc, counting_free);
+        mbedtls_ssl_cache_init(&cache);
+        mbedtls_ssl_ticket_init(&ticket);
+        mbedtls_ctr_drbg_init(&drbg);
+        mbedtls_entropy_init(&entropy);
+        REQUIRE(mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, NULL, 0) == 0);
+        use_tickets = tickets;
+        if (tickets) {
+            REQUIRE(mbedtls_ssl_ticket_setup(&ticket, mbedtls_ctr_drbg_random, &drbg,
+                                             MBEDTLS_CIPHER_AES_256_GCM, 86400) == 0);
+        }
+    }
+
+    ~ServerResumption()
+    {
+        mbedtls_ssl_cache_free(&cache);
+        mbedtls_ssl_ticket_free(&ticket);
+        mbedtls_ctr_drbg_free(&drbg);
+        mbedtls_entropy_free(&entropy);
+    }
+
+    void configure(mbedtls_ssl_config *conf)
+    {
+        mbedtls_ssl_conf_session_cache(conf, &cache, mbedtls_ssl_cache_get, mbedtls_ssl_cache_set);
+        if (use_tickets) {
+            mbedtls_ssl_conf_session_tickets_cb(conf, mbedtls_ssl_ticket_write, mbedtls_ssl_ticket_parse, &ticket);
+        }
+    }
+
+    bool use_tickets;
+};
+
+/* A client and a server connected through memory, without certificate verification cost on the client */
+struct TlsPair {
+    pipe_t c2s, s2c;
+    Endpoint client, server;
+    size_t handshake_peak[2];
+    size_t setup_live[2];
+
+    TlsPair(int ciphersuite, unsigned char mfl = MBEDTLS_SSL_MAX_FRAG_LEN_NONE, ServerResumption *resumption = NULL)
+    {
+        static int suites[2];
+        suites[0] = ciphersuite;
+        suites[1] = 0;
+
+        mbedtls_platform_set_calloc_free(counting_calloc, counting_free);
+        init(client, CLIENT, &s2c, &c2s);
+        init(server, SERVER, &c2s, &s2c);
+
+        REQUIRE(mbedtls_x509_crt_parse(&server.crt, (const unsigned char *)mbedtls_test_srv_crt_rsa,
+                                       mbedtls_test_srv_crt_rsa_len) == 0);
+        REQUIRE(mbedtls_pk_parse_key(&server.key, (const unsigned char *)mbedtls_test_srv_key_rsa,
+                                     mbedtls_test_srv_key_rsa_len, NULL, 0) == 0);
+        REQUIRE(mbedtls_ssl_conf_own_cert(&server.conf, &server.crt, &server.key) == 0);
+        mbedtls_ssl_conf_authmode(&client.conf, MBEDTLS_SSL_VERIFY_NONE);
+        mbedtls_ssl_conf_ciphersuites(&client.conf, suites);
+        mbedtls_ssl_conf_renegotiation(&client.conf, MBEDTLS_SSL_RENEGOTIATION_ENABLED);
+        mbedtls_ssl_conf_renegotiation(&server.conf, MBEDTLS_SSL_RENEGOTIATION_ENABLED);
+        REQUIRE(mbedtls_ssl_conf_max_frag_len(&client.conf, mfl) == 0);
+        if (resumption != NULL) {
+            resumption->configure(&server.conf);
+        }
+
+        for (Endpoint *e : { &client, &server }) {
+            heap_owner = e->side;
+            heap_live[e->side] = heap_peak[e->side] = 0;
+            REQUIRE(mbedtls_ssl_setup(&e->ssl, &e->conf) == 0);
+            mbedtls_ssl_set_bio(&e->ssl, e, pipe_send, pipe_recv, NULL);
+            setup_live[e->side] = heap_live[e->side];
+        }
+    }
+
+    ~TlsPair()
+    {
+        for (Endpoint *e : { &client, &server }) {
+            mbedtls_ssl_free(&e->ssl);
+            mbedtls_ssl_config_free(&e->conf);
+            mbedtls_x509_crt_free(&e->crt);
+            mbedtls_pk_free(&e->key);
+            mbedtls_ctr_drbg_free(&e->drbg);
+            mbedtls_entropy_free(&e->entropy);
+        }
+    }
+
+    void init(Endpoint &e, int side, pipe_t *rx, pipe_t *tx)
+    {
+        e.side = side;
+        e.rx = rx;
+        e.tx = tx;
+        mbedtls_ssl_config_init(&e.conf);
+        mbedtls_ssl_init(&e.ssl);
+        mbedtls_ctr_drbg_init(&e.drbg);
+        mbedtls_entropy_init(&e.entropy);
+        mbedtls_x509_crt_init(&e.crt);
+        mbedtls_pk_init(&e.key);
+        REQUIRE(mbedtls_ctr_drbg_seed(&e.drbg, mbedtls_entropy_func, &e.entropy, NULL, 0) == 0);
+        REQUIRE(mbedtls_ssl_config_defaults(&e.conf, side == CLIENT ? MBEDTLS_SSL_IS_CLIENT : MBEDTLS_SSL_IS_SERVER,
+                                            MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) == 0);
+        mbedtls_ssl_conf_rng(&e.conf, mbedtls_ctr_drbg_random, &e.drbg);
+    }
+
+    void handshake()
+    {
+        int ret[2] = { -1, -1 };
+        for (int i = 0; i < 100 && (ret[CLIENT] != 0 || ret[SERVER] != 0); i++) {
+            for (Endpoint *e : { &client, &server }) {
+                heap_owner = e->side;
+                ret[e->side] = mbedtls_ssl_handshake(&e->ssl);
+                INFO("side " << e->side << " ret -0x" << std::hex << -ret[e->side]);
+                REQUIRE((ret[e->side] == 0 || ret[e->side] == MBEDTLS_ERR_SSL_WANT_READ));
+            }
+        }
+        REQUIRE(ret[CLIENT] == 0);
+        REQUIRE(ret[SERVER] == 0);
+        handshake_peak[CLIENT] = heap_peak[CLIENT];
+        handshake_peak[SERVER] = heap_peak[SERVER];
+    }
+
+    /* Send len bytes from one side, read them on the other in pieces of at most read_size bytes */
+    void transfer(Endpoint &from, Endpoint &to, size_t len, size_t read_size)
+    {
+        std::vector<unsigned char> data(len), got;
+        for (size_t i = 0; i < len; i++) {
+            data[i] = (unsigned char)(i * 7 + len);
+        }
+        for (size_t sent = 0; sent < len; ) {
+            heap_owner = from.side;
+            int ret = mbedtls_ssl_write(&from.ssl, data.data() + sent, len - sent);
+            REQUIRE(ret > 0);
+            sent += ret;
+        }
+        std::vector<unsigned char> buf(read_size);
+        while (got.size() < len) {
+            heap_owner = to.side;
+            int ret = mbedtls_ssl_read(&to.ssl, buf.data(), buf.size());
+            REQUIRE(ret > 0);
+            got.insert(got.end(), buf.begin(), buf.begin() + ret);
+        }
+        CHECK(got == data);
+    }
+
+    /* Client initiated renegotiation, the server handles it from mbedtls_ssl_read() */
+    void renegotiate()
+    {
+        unsigned char buf[16];
+        int ret = -1;
+        for (int i = 0; i < 100 && ret != 0; i++) {
+            heap_owner = CLIENT;
+            ret = mbedtls_ssl_renegotiate(&client.ssl);
+            REQUIRE((ret == 0 || ret == MBEDTLS_ERR_SSL_WANT_READ));
+            heap_owner = SERVER;
+            int sret = mbedtls_ssl_read(&server.ssl, buf, sizeof(buf));
+            REQUIRE(sret == MBEDTLS_ERR_SSL_WANT_READ);
+        }
+        REQUIRE(ret == 0);
+    }
+
+    void check_idle(const Endpoint &e)
+    {
+#if defined(MBEDTLS_SSL_DYNAMIC_BUFFERS)
+        CHECK(e.ssl.in_buf_len < 64);
+        CHECK(e.ssl.out_buf_len < 64);
+#endif
+    }
+};
@@ -189,6 +189,10 @@ esp_err_t mdns_service_remove_all(mdns_server_t * server);
  * @param  proto        service protocol or NULL if searching for host
  * @param  timeout      time to wait for answers. If 0, mdns_query_end MUST be called to end the search
  *
+ * @note   Answers received for a query are cached for the TTL of their records.
+ *         If timeout is not 0 and fresh answers to the same query are in the
+ *         cache, they are returned without sending the query.
+ *
  * @return the number of results found
  */
 size_t mdns_query(mdns_server_t * server, const char * service, const char * proto, uint32_t timeout);
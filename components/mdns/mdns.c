@@ -14,6 +14,8 @@
 #include "mdns.h"
 
 #include <string.h>
+#include <stdio.h>
+#include <sys/param.h>
 #ifndef MDNS_TEST_MODE
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
@@ -59,6 +61,8 @@
 #define MDNS_NAME_MAX_LEN           64                      // Maximum string length of hostname, instance, service and proto
 #define MDNS_NAME_BUF_LEN           (MDNS_NAME_MAX_LEN+1)   // Maximum char buffer size to hold hostname, instance, service or proto
 #define MDNS_MAX_PACKET_SIZE        1460                    // Maximum size of mDNS  outgoing packet
+#define MDNS_CACHE_MAX_SIZE         4096                    // Maximum bytes held by the answer cache of each server
+#define MDNS_CACHE_MAX_TTL          4500                    // Cached answers are dropped after this many seconds, whatever their TTL
 
 #define MDNS_ANSWER_PTR_TTL         4500
 #define MDNS_ANSWER_TXT_TTL         4500
@@ -104,6 +108,7 @@ typedef struct {
     uint32_t addr;
     uint8_t addrv6[16];
     uint8_t ptr;
+    uint32_t ttl;
 } mdns_result_temp_t;
 
 typedef struct {
@@ -125,6 +130,7 @@ typedef struct mdns_service_s {
     uint16_t port;
     uint8_t txt_num_items;
     const char ** txt;
+    uint32_t hash;                      // _mdns_hash() of service and proto, to skip most string compares
 } mdns_service_t;
 
 typedef struct mdns_srv_item_s {
@@ -138,6 +144,15 @@ typedef struct mdns_answer_item_s {
     struct mdns_answer_item_s * next;
 } mdns_answer_item_t;
 
+typedef struct mdns_cache_item_s {
+    struct mdns_cache_item_s * next;
+    uint32_t hash;                      // hash of the query the answer was received for
+    uint32_t expires;                   // tick time (in ms) at which the answer goes stale
+    size_t size;                        // bytes counted against MDNS_CACHE_MAX_SIZE
+    const char * key;                   // the query: service type and proto, or host name
+    mdns_result_t result;               // strings are allocated together with the item
+} mdns_cache_item_t;
+
 struct mdns_server_s {
     tcpip_adapter_if_t tcpip_if;
     struct udp_pcb * pcb;
@@ -146,16 +161,20 @@ struct mdns_server_s {
     mdns_srv_item_t * services;
     xSemaphoreHandle lock;
     xQueueHandle queue;
+    mdns_cache_item_t * cache;
+    size_t cache_size;
     struct {
         char host[MDNS_NAME_BUF_LEN];
         char service[MDNS_NAME_BUF_LEN];
         char proto[MDNS_NAME_BUF_LEN];
+        uint32_t hash;
         bool running;
         xSemaphoreHandle lock;
         mdns_result_t * results;
     } search;
 };
 
+#ifndef MDNS_TEST_MODE
 typedef struct {
     struct tcpip_api_call call;
     mdns_server_t *server;
@@ -163,6 +182,7 @@ typedef struct {
     size_t len;
     esp_err_t err;
 } mdns_api_call_t;
+#endif
 
 #define MDNS_MUTEX_LOCK()       xSemaphoreTake(server->lock, portMAX_DELAY)
 #define MDNS_MUTEX_UNLOCK()     xSemaphoreGive(server->lock)
@@ -307,7 +327,6 @@ esp_err_t _mdns_server_deinit(mdns_server_t * server)
     tcpip_api_call(_mdns_server_deinit_api, (struct tcpip_api_call*)&msg);
     return msg.err;
 }
-#endif
 
 /**
  * @brief  send packet over UDP (called in tcpip thread context)
@@ -333,6 +352,7 @@ static err_t _mdns_server_write_api(struct tcpip_api_call *api_call_msg)
 
     return ERR_OK;
 }
+#endif
 
 /**
  * @brief  send packet over UDP
@@ -1213,67 +1233,279 @@ static void _mdns_send_answers(mdns_server_t * server, mdns_answer_item_t * answ
 }
 
 /**
- * @brief  appends search result from query
+ * @brief  FNV-1a hash of a service type and proto, or of a host name
  *
- * @param  server       the server
- * @param  r            the temporary result to copy
+ * @param  name         service type or host name
+ * @param  proto        service proto or NULL
+ *
+ * @return the hash
  */
-static void _mdns_add_result(mdns_server_t * server, mdns_result_temp_t * r)
+static uint32_t _mdns_hash(const char * name, const char * proto)
+{
+    uint32_t hash = 2166136261UL;
+    while (*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619UL;
+    }
+    if (proto) {
+        hash = (hash ^ '.') * 16777619UL;
+        while (*proto) {
+            hash = (hash ^ (uint8_t)*proto++) * 16777619UL;
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief  allocates new search result
+ *
+ * @param  host         host name or NULL
+ * @param  instance     instance name or NULL
+ * @param  txt          txt data or NULL
+ *
+ * @return the result or NULL on error
+ */
+static mdns_result_t * _mdns_alloc_result(const char * host, const char * instance, const char * txt)
 {
     mdns_result_t * n = (mdns_result_t *)malloc(sizeof(mdns_result_t));
     if (!n) {
+        return NULL;
+    }
+    n->host = (host && host[0]) ? strdup(host) : NULL;
+    n->instance = (instance && instance[0]) ? strdup(instance) : NULL;
+    n->txt = (txt && txt[0]) ? strdup(txt) : NULL;
+    if ((host && host[0] && !n->host)
+            || (instance && instance[0] && !n->instance)
+            || (txt && txt[0] && !n->txt)) {
+        free((char *)n->host);
+        free((char *)n->instance);
+        free((char *)n->txt);
+        free(n);
+        return NULL;
+    }
+    return n;
+}
+
+/**
+ * @brief  writes the current query as cache key: "service.proto" or host name
+ *
+ * @param  server       the server
+ * @param  key          buffer of (2 * MDNS_NAME_BUF_LEN) bytes
+ */
+static void _mdns_search_key(mdns_server_t * server, char * key)
+{
+    if (server->search.host[0]) {
+        strlcpy(key, server->search.host, 2 * MDNS_NAME_BUF_LEN);
+    } else {
+        snprintf(key, 2 * MDNS_NAME_BUF_LEN, "%s.%s", server->search.service, server->search.proto);
+    }
+}
+
+/**
+ * @brief  unlinks and frees cached answer
+ *
+ * @param  server       the server
+ * @param  prev         the item before the one to remove or NULL if it is the first
+ * @param  item         the item to remove
+ *
+ * @return the item that followed the removed one
+ */
+static mdns_cache_item_t * _mdns_cache_remove(mdns_server_t * server, mdns_cache_item_t * prev, mdns_cache_item_t * item)
+{
+    mdns_cache_item_t * next = item->next;
+    if (prev) {
+        prev->next = next;
+    } else {
+        server->cache = next;
+    }
+    server->cache_size -= item->size;
+    free(item);
+    return next;
+}
+
+/**
+ * @brief  frees all cached answers
+ *
+ * @param  server       the server
+ */
+static void _mdns_cache_free(mdns_server_t * server)
+{
+    while (server->cache) {
+        _mdns_cache_remove(server, NULL, server->cache);
+    }
+}
+
+/**
+ * @brief  drops stale answers and answers that a goodbye packet (TTL 0) retracts
+ *
+ * @param  server       the server
+ * @param  instance     retracted instance name or NULL
+ * @param  host         retracted host name or NULL
+ */
+static void _mdns_cache_expire(mdns_server_t * server, const char * instance, const char * host)
+{
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    mdns_cache_item_t * prev = NULL;
+    mdns_cache_item_t * c = server->cache;
+    while (c) {
+        if ((int32_t)(c->expires - now) <= 0
+                || (instance && c->result.instance && !strcmp(c->result.instance, instance))
+                || (host && c->result.host && !strcmp(c->result.host, host))) {
+            c = _mdns_cache_remove(server, prev, c);
+        } else {
+            prev = c;
+            c = c->next;
+        }
+    }
+}
+
+/**
+ * @brief  stores search result in the answer cache of the server
+ *
+ *         Answers are cached under the running query. If the cache is over
+ *         MDNS_CACHE_MAX_SIZE, the oldest answers are dropped.
+ *
+ * @param  server       the server
+ * @param  r            the result to store
+ * @param  ttl          the lowest TTL of the records the result was built from
+ */
+static void _mdns_cache_add(mdns_server_t * server, const mdns_result_t * r, uint32_t ttl)
+{
+    char key[2 * MDNS_NAME_BUF_LEN];
+    _mdns_search_key(server, key);
+    size_t klen = strlen(key) + 1;
+    size_t hlen = r->host ? strlen(r->host) + 1 : 0;
+    size_t ilen = r->instance ? strlen(r->instance) + 1 : 0;
+    size_t tlen = r->txt ? strlen(r->txt) + 1 : 0;
+    size_t size = sizeof(mdns_cache_item_t) + klen + hlen + ilen + tlen;
+
+    if (!ttl || size > MDNS_CACHE_MAX_SIZE) {
         return;
     }
-    n->priority = r->priority;
-    n->weight = r->weight;
-    n->port = r->port;
-    n->addr.addr = r->addr;
+    if (ttl > MDNS_CACHE_MAX_TTL) {
+        ttl = MDNS_CACHE_MAX_TTL;
+    }
 
-    size_t hlen = strlen(r->host);
-    if (hlen) {
-        n->host = strdup(r->host);
-        if (!n->host) {
-            free(n);
-            return;
+    //replace the answer if we have it already
+    mdns_cache_item_t * prev = NULL;
+    mdns_cache_item_t * c = server->cache;
+    while (c) {
+        if (c->hash == server->search.hash && !strcmp(c->key, key)
+                && c->result.addr.addr == r->addr.addr
+                && !memcmp(&c->result.addrv6, &r->addrv6, sizeof(ip6_addr_t))
+                && !strcmp(c->result.instance ? c->result.instance : "", r->instance ? r->instance : "")
+                && !strcmp(c->result.host ? c->result.host : "", r->host ? r->host : "")) {
+            c = _mdns_cache_remove(server, prev, c);
+            break;
         }
-    } else {
-        n->host = NULL;
+        prev = c;
+        c = c->next;
     }
 
-    size_t ilen = strlen(r->instance);
-    if (ilen) {
-        n->instance = strdup(r->instance);
-        if (!n->instance) {
-            free((char *)n->host);
-            free(n);
-            return;
+    //make room by dropping the oldest answers from the tail
+    while (server->cache && server->cache_size + size > MDNS_CACHE_MAX_SIZE) {
+        prev = NULL;
+        c = server->cache;
+        while (c->next) {
+            prev = c;
+            c = c->next;
         }
-    } else {
-        n->instance = NULL;
+        _mdns_cache_remove(server, prev, c);
     }
 
-    size_t tlen = strlen(r->txt);
+    c = (mdns_cache_item_t *)malloc(size);
+    if (!c) {
+        return;
+    }
+    char * s = (char *)(c + 1);
+    c->key = memcpy(s, key, klen);
+    s += klen;
+    c->result = *r;
+    c->result.next = NULL;
+    if (hlen) {
+        c->result.host = memcpy(s, r->host, hlen);
+        s += hlen;
+    }
+    if (ilen) {
+        c->result.instance = memcpy(s, r->instance, ilen);
+        s += ilen;
+    }
     if (tlen) {
-        n->txt = strdup(r->txt);
-        if (!n->txt) {
-            free((char *)n->host);
-            free((char *)n->instance);
-            free(n);
-            return;
+        c->result.txt = memcpy(s, r->txt, tlen);
+    }
+    c->hash = server->search.hash;
+    c->expires = xTaskGetTickCount() * portTICK_PERIOD_MS + ttl * 1000;
+    c->size = size;
+    c->next = server->cache;
+    server->cache = c;
+    server->cache_size += size;
+}
+
+/**
+ * @brief  fills the search results with the fresh cached answers to the current query
+ *
+ * @param  server       the server
+ *
+ * @return the number of results added
+ */
+static size_t _mdns_cache_get(mdns_server_t * server)
+{
+    size_t found = 0;
+    char key[2 * MDNS_NAME_BUF_LEN];
+    _mdns_search_key(server, key);
+
+    _mdns_cache_expire(server, NULL, NULL);
+    mdns_cache_item_t * c = server->cache;
+    while (c) {
+        if (c->hash == server->search.hash && !strcmp(c->key, key)) {
+            mdns_result_t * n = _mdns_alloc_result(c->result.host, c->result.instance, c->result.txt);
+            if (!n) {
+                break;
+            }
+            n->priority = c->result.priority;
+            n->weight = c->result.weight;
+            n->port = c->result.port;
+            n->addr = c->result.addr;
+            n->addrv6 = c->result.addrv6;
+            n->next = server->search.results;
+            server->search.results = n;
+            found++;
         }
-    } else {
-        n->txt = NULL;
+        c = c->next;
     }
+    return found;
+}
 
+/**
+ * @brief  appends search result from query
+ *
+ * @param  server       the server
+ * @param  r            the temporary result to copy
+ */
+static void _mdns_add_result(mdns_server_t * server, mdns_result_temp_t * r)
+{
+    mdns_result_t * n = _mdns_alloc_result(r->host, r->instance, r->txt);
+    if (!n) {
+        return;
+    }
+    n->priority = r->priority;
+    n->weight = r->weight;
+    n->port = r->port;
+    n->addr.addr = r->addr;
     memcpy((uint8_t *)n->addrv6.addr, r->addrv6, sizeof(ip6_addr_t));
 
     mdns_result_t * o = server->search.results;
     server->search.results = n;
     n->next = o;
+
+    _mdns_cache_add(server, n, r->ttl);
 }
 
 /**
  * @brief  finds service from given service type
+ *
+ * Still a walk of the service list, which is short; the stored hash only
+ * saves the string compares for services which can't match.
+ *
  * @param  server       the server
  * @param  service      service type to match
  * @param  proto        proto to match
@@ -1282,9 +1514,10 @@ static void _mdns_add_result(mdns_server_t * server, mdns_result_temp_t * r)
  */
 static mdns_srv_item_t * _mdns_get_service_item(mdns_server_t * server, const char * service, const char * proto)
 {
+    uint32_t hash = _mdns_hash(service, proto);
     mdns_srv_item_t * s = server->services;
     while (s) {
-        if (!strcmp(s->service->service, service) && !strcmp(s->service->proto, proto)) {
+        if (s->service->hash == hash && !strcmp(s->service->service, service) && !strcmp(s->service->proto, proto)) {
             return s;
         }
         s = s->next;
@@ -1327,6 +1560,7 @@ static mdns_service_t * _mdns_create_service(const char * service, const char *
         return NULL;
     }
 
+    s->hash = _mdns_hash(s->service, s->proto);
     return s;
 }
 
@@ -1365,6 +1599,18 @@ static inline uint16_t _mdns_read_u16(const uint8_t * packet, uint16_t index)
     return (uint16_t)(packet[index]) << 8 | packet[index + 1];
 }
 
+/**
+ * @brief  read uint32_t from a packet
+ * @param  packet       the packet
+ * @param  index        index in the packet where the value starts
+ *
+ * @return the value
+ */
+static inline uint32_t _mdns_read_u32(const uint8_t * packet, uint16_t index)
+{
+    return (uint32_t)_mdns_read_u16(packet, index) << 16 | _mdns_read_u16(packet, index + 2);
+}
+
 /**
  * @brief  main packet parser
  *
@@ -1465,9 +1711,10 @@ void mdns_parse_packet(mdns_server_t * server, const uint8_t * data, size_t len)
         }
     }
 
-    if (server->search.running && (answers || additional)) {
+    if ((server->search.running || server->cache) && (answers || additional)) {
         mdns_result_temp_t * answer = &a;
         memset(answer, 0, sizeof(mdns_result_temp_t));
+        answer->ttl = UINT32_MAX;
 
         while (content < (data + len)) {
             content = _mdns_parse_fqdn(data, content, name);
@@ -1475,6 +1722,7 @@ void mdns_parse_packet(mdns_server_t * server, const uint8_t * data, size_t len)
                 return;//error
             }
             uint16_t type = _mdns_read_u16(content, MDNS_TYPE_OFFSET);
+            uint32_t ttl = _mdns_read_u32(content, MDNS_TTL_OFFSET);
             uint16_t data_len = _mdns_read_u16(content, MDNS_LEN_OFFSET);
             const uint8_t * data_ptr = content + MDNS_DATA_OFFSET;
 
@@ -1483,6 +1731,22 @@ void mdns_parse_packet(mdns_server_t * server, const uint8_t * data, size_t len)
                 return;
             }
 
+            if (!ttl && server->cache) {
+                //goodbye: forget what we have cached for the instance or host
+                if (type == MDNS_TYPE_PTR) {
+                    if (_mdns_parse_fqdn(data, data_ptr, name)) {
+                        _mdns_cache_expire(server, name->host, NULL);
+                    }
+                } else if (type == MDNS_TYPE_SRV) {
+                    _mdns_cache_expire(server, name->host, NULL);
+                } else if (type == MDNS_TYPE_A || type == MDNS_TYPE_AAAA) {
+                    _mdns_cache_expire(server, NULL, name->host);
+                }
+            }
+            if (!server->search.running) {
+                continue;
+            }
+
             if (type == MDNS_TYPE_PTR) {
                 if (!_mdns_parse_fqdn(data, data_ptr, name)) {
                     continue;//error
@@ -1495,6 +1759,7 @@ void mdns_parse_packet(mdns_server_t * server, const uint8_t * data, size_t len)
                 }
 #endif
                 strlcpy(answer->instance, name->host, MDNS_NAME_BUF_LEN);
+                answer->ttl = MIN(answer->ttl, ttl);
             } else if (type == MDNS_TYPE_SRV) {
 #ifndef MDNS_TEST_MODE
                 if (server->search.host[0] ||
@@ -1527,6 +1792,7 @@ void mdns_parse_packet(mdns_server_t * server, const uint8_t * data, size_t len)
                 } else {
                     strlcpy(answer->host, name->host, MDNS_NAME_BUF_LEN);
                 }
+                answer->ttl = MIN(answer->ttl, ttl);
             } else if (type == MDNS_TYPE_TXT) {
                 uint16_t i = 0, b = 0, y;
                 while (i < data_len) {
@@ -1547,6 +1813,7 @@ void mdns_parse_packet(mdns_server_t * server, const uint8_t * data, size_t len)
                     }
                 }
                 answer->txt[b] = 0;
+                answer->ttl = MIN(answer->ttl, ttl);
             } else if (type == MDNS_TYPE_AAAA) {
                 if (server->search.host[0]) {
 #ifndef MDNS_TEST_MODE
@@ -1560,6 +1827,7 @@ void mdns_parse_packet(mdns_server_t * server, const uint8_t * data, size_t len)
                     continue;//wrong host
                 }
                 memcpy(answer->addrv6, data_ptr, sizeof(ip6_addr_t));
+                answer->ttl = MIN(answer->ttl, ttl);
             } else if (type == MDNS_TYPE_A) {
                 if (server->search.host[0]) {
 #ifndef MDNS_TEST_MODE
@@ -1576,6 +1844,7 @@ void mdns_parse_packet(mdns_server_t * server, const uint8_t * data, size_t len)
                     _mdns_add_result(server, answer);//another IP for our host
                 }
                 IP4_ADDR(answer, data_ptr[0], data_ptr[1], data_ptr[2], data_ptr[3]);
+                answer->ttl = MIN(answer->ttl, ttl);
             }
         }
         if (server->search.running && (server->search.host[0] || answer->ptr) && answer->addr) {
@@ -1622,6 +1891,8 @@ esp_err_t mdns_init(tcpip_adapter_if_t tcpip_if, mdns_server_t ** mdns_server)
     server->hostname = NULL;
     server->instance = NULL;
     server->services = NULL;
+    server->cache = NULL;
+    server->cache_size = 0;
     server->search.host[0] = 0;
     server->search.service[0] = 0;
     server->search.proto[0] = 0;
@@ -1689,6 +1960,7 @@ void mdns_free(mdns_server_t * server)
         mdns_query_end(server);
     }
     mdns_result_free(server);
+    _mdns_cache_free(server);
     vSemaphoreDelete(server->search.lock);
     MDNS_MUTEX_UNLOCK();
     vSemaphoreDelete(server->lock);
@@ -1923,6 +2195,19 @@ size_t mdns_query(mdns_server_t * server, const char * service, const char * pro
         server->search.proto[0] = 0;
         qtype = MDNS_TYPE_A;
     }
+    server->search.hash = _mdns_hash(server->search.host[0] ? server->search.host : server->search.service,
+                                     server->search.host[0] ? NULL : server->search.proto);
+
+    if (timeout && server->cache) {
+        //answer from the cache if we still have fresh answers for this query
+        MDNS_MUTEX_LOCK();
+        size_t found = _mdns_cache_get(server);
+        MDNS_MUTEX_UNLOCK();
+        if (found) {
+            MDNS_SEARCH_UNLOCK();
+            return found;
+        }
+    }
 
     uint8_t hostname_len = strlen(server->search.host);
     uint8_t service_type_len = strlen(server->search.service);
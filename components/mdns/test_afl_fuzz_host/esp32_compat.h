@@ -108,13 +108,13 @@ typedef struct {
     ip4_addr_t gw;
 } tcpip_adapter_ip_info_t;
 
-inline esp_err_t esp_wifi_get_mode(wifi_mode_t * mode)
+static inline esp_err_t esp_wifi_get_mode(wifi_mode_t * mode)
 {
     *mode = WIFI_MODE_APSTA;
     return ESP_OK;
 }
 
-inline uint32_t xTaskGetTickCount()
+static inline uint32_t xTaskGetTickCount()
 {
     struct timeval tv;
     struct timezone tz;
@@ -19,11 +19,74 @@
 #include <unistd.h>
 #include <signal.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "mdns.h"
 
 void mdns_parse_packet(mdns_server_t * server, const uint8_t * data, size_t len);
 
+#ifndef __AFL_LOOP
+#define BENCH_ROUNDS    20000
+#define BENCH_MAX_FILES 64
+
+static uint64_t now_us()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/**
+ * Without AFL, time the parser on the packets given on the command line
+ * and check that repeated queries are answered from the cache
+ */
+static int bench(mdns_server_t * mdns, int count, char ** files)
+{
+    static uint8_t bufs[BENCH_MAX_FILES][1460];
+    size_t lens[BENCH_MAX_FILES];
+    int num = 0;
+
+    for (int i = 0; i < count && num < BENCH_MAX_FILES; i++) {
+        FILE * f = fopen(files[i], "rb");
+        if (!f) {
+            perror(files[i]);
+            return 1;
+        }
+        lens[num] = fread(bufs[num], 1, sizeof(bufs[0]), f);
+        num++;
+        fclose(f);
+    }
+
+    uint64_t start = now_us();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        mdns_query(mdns, "_afpovertcp", "_tcp", 0);
+        for (int i = 0; i < num; i++) {
+            mdns_parse_packet(mdns, bufs[i], lens[i]);
+        }
+        mdns_query_end(mdns);
+    }
+    uint64_t elapsed = now_us() - start;
+    printf("parsed %d packets %d times: %.1f ns/packet\n", num, BENCH_ROUNDS,
+           (double)elapsed * 1000 / ((double)num * BENCH_ROUNDS));
+
+    size_t results = mdns_query(mdns, "_afpovertcp", "_tcp", 1);
+    if (!results) {
+        printf("no cached answers for the query\n");
+        return 0;
+    }
+    start = now_us();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        if (mdns_query(mdns, "_afpovertcp", "_tcp", 1000) != results) {
+            printf("cached answers changed in round %d\n", r);
+            return 1;
+        }
+    }
+    elapsed = now_us() - start;
+    printf("cached query: %zu results, %.1f ns/query\n", results, (double)elapsed * 1000 / BENCH_ROUNDS);
+    return 0;
+}
+#endif
+
 int main(int argc, char** argv)
 {
     const char * mdns_hostname = "minifritz";
@@ -100,6 +163,7 @@ int main(int argc, char** argv)
         abort();
     }
 
+#ifdef __AFL_LOOP
     while (__AFL_LOOP(1000)) {
         memset(buf, 0, 1460);
         size_t len = read(0, buf, 1460);
@@ -108,6 +172,10 @@ int main(int argc, char** argv)
         mdns_query_end(mdns);
     }
     return 0;
+#else
+    (void)buf;
+    return bench(mdns, argc - 1, argv + 1);
+#endif
 }
 
 #endif
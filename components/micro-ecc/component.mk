@@ -1,8 +1,8 @@
 # only compile the micro-ecc/uECC.c source file
 # (SRCDIRS is needed so build system can find the source file)
-COMPONENT_SRCDIRS := micro-ecc
-COMPONENT_OBJS := micro-ecc/uECC.o
+COMPONENT_SRCDIRS := micro-ecc port
+COMPONENT_OBJS := micro-ecc/uECC.o port/esp_uecc_verify.o
 
-COMPONENT_ADD_INCLUDEDIRS := micro-ecc
+COMPONENT_ADD_INCLUDEDIRS := micro-ecc port/include
 
 COMPONENT_SUBMODULES := micro-ecc
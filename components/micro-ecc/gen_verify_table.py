@@ -0,0 +1,97 @@
+#!/usr/bin/env python
+#
+# Precomputed point table for esp_uecc_verify()
+#
+# Writes the odd multiples 1*Q, 3*Q, ... (2^(w-1) - 1)*Q of a secp256r1
+# public key, for the windowed NAF multiplication of the key at signature
+# verification, so the table isn't computed at every boot.
+#
+# Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from __future__ import print_function, division
+import argparse
+import binascii
+import sys
+
+P = 2**256 - 2**224 + 2**192 + 2**96 - 1
+B = 0x5ac635d8aa3a93e7b3ebbd55769886bc651d06b0cc53b0f63bce3c3e27d2604b
+GX = 0x6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296
+GY = 0x4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5
+
+
+def point_add(p1, p2):
+    if p1 is None:
+        return p2
+    if p2 is None:
+        return p1
+    (x1, y1), (x2, y2) = p1, p2
+    if x1 == x2:
+        if (y1 + y2) % P == 0:
+            return None
+        lam = (3 * x1 * x1 - 3) * pow(2 * y1, P - 2, P) % P
+    else:
+        lam = (y2 - y1) * pow(x2 - x1, P - 2, P) % P
+    x3 = (lam * lam - x1 - x2) % P
+    return (x3, (lam * (x1 - x3) - y1) % P)
+
+
+def odd_multiples(point, window):
+    double = point_add(point, point)
+    table = [point]
+    for _ in range(1, 1 << (window - 2)):
+        table.append(point_add(table[-1], double))
+    return table
+
+
+def to_bytes(value):
+    return binascii.unhexlify('%064x' % value)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Precomputed secp256r1 point table for esp_uecc_verify()')
+    parser.add_argument('--window', type=int, default=5, choices=range(2, 7),
+                        help='Window width of the NAF (table of 2^(window-2) points)')
+    parser.add_argument('--c-generator', action='store_true',
+                        help='Print the table of the curve generator as C words, for esp_uecc_verify.c')
+    parser.add_argument('keyfile', nargs='?', type=argparse.FileType('rb'),
+                        help='Public key, 64 bytes X and Y big endian as written by espsecure.py extract_public_key')
+    parser.add_argument('output', nargs='?', type=argparse.FileType('wb'),
+                        help='Table, X and Y of each point big endian')
+    args = parser.parse_args()
+
+    if args.c_generator:
+        for i, (x, y) in enumerate(odd_multiples((GX, GY), args.window)):
+            print('    /* %d G */' % (2 * i + 1))
+            for value, start, end in ((x, '    { { ', ' },'), (y, '      { ', ' } },')):
+                words = ['0x%08x' % ((value >> (32 * j)) & 0xffffffff) for j in range(8)]
+                print(start + ', '.join(words[:4]) + ',')
+                print('        ' + ', '.join(words[4:]) + end)
+        return
+
+    if args.keyfile is None or args.output is None:
+        parser.error('keyfile and output are required')
+    key = args.keyfile.read()
+    if len(key) != 64:
+        raise SystemExit('%s: expected a 64 byte public key, got %d bytes' % (args.keyfile.name, len(key)))
+    x = int(binascii.hexlify(key[:32]), 16)
+    y = int(binascii.hexlify(key[32:]), 16)
+    if x >= P or y >= P or (y * y - x * x * x + 3 * x - B) % P != 0:
+        raise SystemExit('%s: not a secp256r1 point' % args.keyfile.name)
+
+    for (x, y) in odd_multiples((x, y), args.window):
+        args.output.write(to_bytes(x) + to_bytes(y))
+
+
+if __name__ == '__main__':
+    main()
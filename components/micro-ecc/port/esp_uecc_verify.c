@@ -0,0 +1,704 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * ECDSA secp256r1 signature verification for secure boot
+ *
+ * u1*G + u2*Q in one pass over the windowed NAFs of both scalars (Shamir's
+ * trick): about 256 doublings and 2 * 256 / (w + 1) additions of table
+ * points, against two full multiplications in uECC_verify(). The tables
+ * hold the odd multiples of G (here, in flash) and of Q (generated with
+ * the key at build time), in affine coordinates for mixed additions.
+ *
+ * Nothing here is constant time, the inputs are all public.
+ */
+
+#include <string.h>
+#include "esp_uecc_verify.h"
+
+#define NUM_WORDS 8
+
+/* Little endian 32-bit words */
+typedef uint32_t fe_t[NUM_WORDS];
+
+typedef struct {
+    fe_t x;
+    fe_t y;
+} affine_t;
+
+/* Jacobian coordinates, (X / Z^2, Y / Z^3), Z == 0 is the point at infinity */
+typedef struct {
+    fe_t x;
+    fe_t y;
+    fe_t z;
+} jacobian_t;
+
+static const fe_t curve_p = {
+    0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+    0x00000000, 0x00000000, 0x00000001, 0xffffffff
+};
+
+static const fe_t curve_b = {
+    0x27d2604b, 0x3bce3c3e, 0xcc53b0f6, 0x651d06b0,
+    0x769886bc, 0xb3ebbd55, 0xaa3a93e7, 0x5ac635d8
+};
+
+static const fe_t curve_n = {
+    0xfc632551, 0xf3b9cac2, 0xa7179e84, 0xbce6faad,
+    0xffffffff, 0xffffffff, 0x00000000, 0xffffffff
+};
+
+/* 2^512 mod n, into the Montgomery domain mod n */
+static const fe_t n_rr = {
+    0xbe79eea2, 0x83244c95, 0x49bd6fa6, 0x4699799c,
+    0x2b6bec59, 0x2845b239, 0xf3d95620, 0x66e12d94
+};
+
+/* -n^-1 mod 2^32 */
+#define N_INV 0xee00bc4f
+
+/* Odd multiples of the generator, from gen_verify_table.py --c-generator */
+static const affine_t g_table[ESP_UECC_VERIFY_TABLE_POINTS] = {
+    /* 1 G */
+    { { 0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81,
+        0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2 },
+      { 0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357,
+        0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2 } },
+#if ESP_UECC_VERIFY_WINDOW >= 3
+    /* 3 G */
+    { { 0xc6e7fd6c, 0xfb41661b, 0xefada985, 0xe6c6b721,
+        0x1d4bf165, 0xc8f7ef95, 0xa6330a44, 0x5ecbe4d1 },
+      { 0xa27d5032, 0x9a79b127, 0x384fb83d, 0xd82ab036,
+        0x1a64a2ec, 0x374b06ce, 0x4998ff7e, 0x8734640c } },
+#endif
+#if ESP_UECC_VERIFY_WINDOW >= 4
+    /* 5 G */
+    { { 0xc3d033ed, 0x21554a0d, 0x1f5be524, 0xef8c82fd,
+        0x08668fdf, 0xd784c856, 0x515140d2, 0x51590b7a },
+      { 0xfda16da4, 0xd1d0bb44, 0xd4d80888, 0x0d012f00,
+        0xbf8a7926, 0x8ae1bf36, 0x904a727d, 0xe0c17da8 } },
+    /* 7 G */
+    { { 0x3187b2a3, 0x30062870, 0xa80fef5b, 0x7ef9f8b8,
+        0x7c01fb60, 0x25bb3066, 0xa0bf7b46, 0x8e533b6f },
+      { 0xc1f400b4, 0xc55e1a86, 0xcb041b21, 0x53c73633,
+        0xa6f59000, 0x6d069f83, 0xe0331836, 0x73eb1dbd } },
+#endif
+#if ESP_UECC_VERIFY_WINDOW >= 5
+    /* 9 G */
+    { { 0x90949ee0, 0xd79e8a4b, 0x2c6df8b3, 0x9e0acb8c,
+        0x1d71f872, 0x878938d5, 0xfedf0b71, 0xea68d7b6 },
+      { 0x4dd048fa, 0xe85a224a, 0xa4de823f, 0x4d714fea,
+        0x4a8ea0c8, 0x87014a96, 0x72c9fce7, 0x2a2744c9 } },
+    /* 11 G */
+    { { 0x74bc21d1, 0x433391d3, 0x255048bf, 0x16742ed0,
+        0xb0c21cda, 0x0638379d, 0x883b4c59, 0x3ed113b7 },
+      { 0xe82a3740, 0xe2f8eefc, 0x5e9889da, 0x090d04da,
+        0xa4f4c68a, 0x24c843af, 0xccc4c8a2, 0x9099209a } },
+    /* 13 G */
+    { { 0x46072c01, 0x98e15d9d, 0x65ead58a, 0x792e284b,
+        0xd85ee2fc, 0x61805df2, 0xe0ac495a, 0x177c837a },
+      { 0xefc7bfd8, 0x9c43bbe2, 0xa1fb4df3, 0x26ee14c3,
+        0xb40f4e72, 0xa24091ad, 0x4ebea558, 0x63bb58cd } },
+    /* 15 G */
+    { { 0xe59b9d5f, 0x63668c63, 0xde3a0ef1, 0xae03af92,
+        0x99888265, 0xadfb3789, 0x971abae7, 0xf0454dc6 },
+      { 0x0d034f36, 0x47e59cde, 0x75b5fa3f, 0x2a3b21ce,
+        0x1f9643e6, 0x4e6594e5, 0x592e2d1f, 0xb5b93ee3 } },
+#endif
+#if ESP_UECC_VERIFY_WINDOW >= 6
+    /* 17 G */
+    { { 0x4738a73e, 0xba1abce3, 0xf0d64af8, 0x5fa68678,
+        0x6f75301a, 0x9c0984b6, 0xc0f1cc3a, 0x47776904 },
+      { 0x71f1fcdc, 0x32f787ff, 0x28d5733f, 0x81b28044,
+        0x77648e83, 0x62318565, 0xb5b95728, 0xaa005ee6 } },
+    /* 19 G */
+    { { 0xab03ed83, 0xc1fc7b74, 0x57884895, 0x782c4522,
+        0x7108c507, 0xce39b7c1, 0x102c0c25, 0xcb6d2861 },
+      { 0x2bcecdaa, 0xe3915075, 0x30fa3e03, 0xa496716e,
+        0x0d6d6ce4, 0x5c35e710, 0x24d9ef51, 0x58d7614b } },
+    /* 21 G */
+    { { 0x67399e83, 0xfd76364e, 0xf42b1523, 0x3a582139,
+        0xb473bca5, 0x2e4ac86e, 0x86637c7b, 0x3250fcf6 },
+      { 0x71d48c09, 0x15de24a0, 0x3b566a82, 0x897cd3c3,
+        0x1d7eb88c, 0x97b3090d, 0x667d3593, 0x42e7c342 } },
+    /* 23 G */
+    { { 0x45ca7896, 0x672e5730, 0xdf64a4fe, 0x3c0bc0a5,
+        0xd4583fa6, 0xd28a3e39, 0x9c2640d7, 0x0e91c723 },
+      { 0x3140ad55, 0x13804654, 0x75e7a5ae, 0x7e688335,
+        0xb8e0bd6d, 0x1a22733b, 0x550dba22, 0x5df65c3b } },
+    /* 25 G */
+    { { 0xf200d687, 0x84a4dc45, 0xb76f1b24, 0x41652fc5,
+        0x8c07fa84, 0x85f4f52d, 0x4b0c0bb6, 0x3a67e255 },
+      { 0x02f79324, 0xa9ed16b3, 0x35a7618a, 0x8c188af7,
+        0x163afb0d, 0x26daf267, 0x2f1fcf43, 0x27d0f187 } },
+    /* 27 G */
+    { { 0x3b0883d1, 0xf2e20117, 0x683e54ab, 0x576355bd,
+        0x4611f378, 0xdeba2fac, 0x19d80d51, 0x184ffa58 },
+      { 0x60906e6f, 0x20d242c2, 0x63f04916, 0x45bdeccc,
+        0x26cb9995, 0xa4c6d908, 0x6688f359, 0xc0a66e27 } },
+    /* 29 G */
+    { { 0x1c784def, 0xdedd693d, 0x88b58a41, 0xfd8cd1c6,
+        0x90853b8c, 0xa7c36da0, 0xfa195b07, 0xd6d33ade },
+      { 0x93d1bca6, 0x550c1245, 0x4b95eded, 0x09a166ab,
+        0x558a5dcb, 0x3f78245f, 0xee195d7e, 0x84aaba16 } },
+    /* 31 G */
+    { { 0xa1b45b8b, 0x3e3f9aa0, 0x52a95b3e, 0xfac9db7d,
+        0xa7ae9aa0, 0xa85da026, 0x2dc7e05d, 0x301d9e50 },
+      { 0xa17ee267, 0xd58db6ae, 0x6887ca61, 0x298d9ae4,
+        0x6b017d72, 0xe0d23c02, 0xb3061223, 0x6551b6f6 } },
+#endif
+};
+
+static int vli_cmp(const fe_t a, const fe_t b)
+{
+    for (int i = NUM_WORDS - 1; i >= 0; i--) {
+        if (a[i] != b[i]) {
+            return a[i] > b[i] ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+static int vli_is_zero(const fe_t a)
+{
+    uint32_t bits = 0;
+    for (int i = 0; i < NUM_WORDS; i++) {
+        bits |= a[i];
+    }
+    return bits == 0;
+}
+
+static uint32_t vli_add(fe_t r, const fe_t a, const fe_t b)
+{
+    uint64_t carry = 0;
+    for (int i = 0; i < NUM_WORDS; i++) {
+        carry += (uint64_t)a[i] + b[i];
+        r[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    return (uint32_t)carry;
+}
+
+static uint32_t vli_sub(fe_t r, const fe_t a, const fe_t b)
+{
+    int64_t borrow = 0;
+    for (int i = 0; i < NUM_WORDS; i++) {
+        borrow += (int64_t)a[i] - b[i];
+        r[i] = (uint32_t)borrow;
+        borrow >>= 32;
+    }
+    return borrow != 0;
+}
+
+static void bytes_to_fe(fe_t r, const uint8_t *bytes)
+{
+    for (int i = 0; i < NUM_WORDS; i++) {
+        const uint8_t *b = bytes + 4 * (NUM_WORDS - 1 - i);
+        r[i] = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+    }
+}
+
+static void fe_to_bytes(uint8_t *bytes, const fe_t a)
+{
+    for (int i = 0; i < NUM_WORDS; i++) {
+        uint8_t *b = bytes + 4 * (NUM_WORDS - 1 - i);
+        b[0] = a[i] >> 24;
+        b[1] = a[i] >> 16;
+        b[2] = a[i] >> 8;
+        b[3] = a[i];
+    }
+}
+
+/*
+ * Arithmetic mod p
+ */
+static void fp_add(fe_t r, const fe_t a, const fe_t b)
+{
+    if (vli_add(r, a, b) || vli_cmp(r, curve_p) >= 0) {
+        vli_sub(r, r, curve_p);
+    }
+}
+
+static void fp_sub(fe_t r, const fe_t a, const fe_t b)
+{
+    if (vli_sub(r, a, b)) {
+        vli_add(r, r, curve_p);
+    }
+}
+
+/* Reduce a 512-bit product, FIPS 186-4 D.2.3:
+   s1 + 2 s2 + 2 s3 + s4 + s5 - d1 - d2 - d3 - d4, summed for each word */
+static void fp_reduce(fe_t r, const uint32_t c[2 * NUM_WORDS])
+{
+    int64_t acc, carry = 0;
+
+#define FP_WORD(i, sum) do { acc = carry + (sum); r[i] = (uint32_t)acc; carry = acc >> 32; } while (0)
+    FP_WORD(0, (int64_t)c[0] + c[8] + c[9] - c[11] - c[12] - c[13] - c[14]);
+    FP_WORD(1, (int64_t)c[1] + c[9] + c[10] - c[12] - c[13] - c[14] - c[15]);
+    FP_WORD(2, (int64_t)c[2] + c[10] + c[11] - c[13] - c[14] - c[15]);
+    FP_WORD(3, (int64_t)c[3] - c[8] - c[9] + 2 * (int64_t)c[11] + 2 * (int64_t)c[12] + c[13] - c[15]);
+    FP_WORD(4, (int64_t)c[4] - c[9] - c[10] + 2 * (int64_t)c[12] + 2 * (int64_t)c[13] + c[14]);
+    FP_WORD(5, (int64_t)c[5] - c[10] - c[11] + 2 * (int64_t)c[13] + 2 * (int64_t)c[14] + c[15]);
+    FP_WORD(6, (int64_t)c[6] - c[8] - c[9] + c[13] + 3 * (int64_t)c[14] + 2 * (int64_t)c[15]);
+    FP_WORD(7, (int64_t)c[7] + c[8] - c[10] - c[11] - c[12] - c[13] + 3 * (int64_t)c[15]);
+
+    /* Fold the carry back in, 2^256 = 2^224 - 2^192 - 2^96 + 1 (mod p) */
+    while (carry != 0) {
+        int64_t top = carry;
+        carry = 0;
+        FP_WORD(0, (int64_t)r[0] + top);
+        FP_WORD(1, (int64_t)r[1]);
+        FP_WORD(2, (int64_t)r[2]);
+        FP_WORD(3, (int64_t)r[3] - top);
+        FP_WORD(4, (int64_t)r[4]);
+        FP_WORD(5, (int64_t)r[5]);
+        FP_WORD(6, (int64_t)r[6] - top);
+        FP_WORD(7, (int64_t)r[7] + top);
+    }
+#undef FP_WORD
+
+    if (vli_cmp(r, curve_p) >= 0) {
+        vli_sub(r, r, curve_p);
+    }
+}
+
+static void fp_mul(fe_t r, const fe_t a, const fe_t b)
+{
+    uint32_t product[2 * NUM_WORDS];
+
+    memset(product, 0, sizeof(product));
+    for (int i = 0; i < NUM_WORDS; i++) {
+        uint64_t carry = 0;
+        for (int j = 0; j < NUM_WORDS; j++) {
+            carry += (uint64_t)a[i] * b[j] + product[i + j];
+            product[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        product[i + NUM_WORDS] = (uint32_t)carry;
+    }
+    fp_reduce(r, product);
+}
+
+static void fp_sqr(fe_t r, const fe_t a)
+{
+    fp_mul(r, a, a);
+}
+
+#if ESP_UECC_VERIFY_TABLE_POINTS > 1
+/* a^(p - 2), only for the tables computed at run time */
+static void fp_inv(fe_t r, const fe_t a)
+{
+    fe_t e, x;
+
+    memcpy(e, curve_p, sizeof(e));
+    e[0] -= 2;
+    memcpy(x, a, sizeof(x));
+    for (int i = 255 - 1; i >= 0; i--) {
+        fp_sqr(x, x);
+        if ((e[i / 32] >> (i % 32)) & 1) {
+            fp_mul(x, x, a);
+        }
+    }
+    memcpy(r, x, sizeof(x));
+}
+#endif
+
+/*
+ * Points, a = -3
+ */
+static int point_is_valid(const affine_t *q)
+{
+    fe_t lhs, rhs, t;
+
+    if (vli_cmp(q->x, curve_p) >= 0 || vli_cmp(q->y, curve_p) >= 0) {
+        return 0;
+    }
+    /* y^2 == x^3 - 3x + b */
+    fp_sqr(lhs, q->y);
+    fp_sqr(rhs, q->x);
+    fp_mul(rhs, rhs, q->x);
+    fp_add(t, q->x, q->x);
+    fp_add(t, t, q->x);
+    fp_sub(rhs, rhs, t);
+    fp_add(rhs, rhs, curve_b);
+    return vli_cmp(lhs, rhs) == 0;
+}
+
+/* dbl-2001-b, 3M + 5S */
+static void jac_double(jacobian_t *p)
+{
+    fe_t delta, gamma, beta, alpha, t;
+
+    fp_sqr(delta, p->z);
+    fp_sqr(gamma, p->y);
+    fp_mul(beta, p->x, gamma);
+    fp_sub(t, p->x, delta);
+    fp_add(alpha, p->x, delta);
+    fp_mul(alpha, alpha, t);
+    fp_add(t, alpha, alpha);
+    fp_add(alpha, alpha, t);
+
+    /* Z3 = (Y + Z)^2 - gamma - delta */
+    fp_add(p->z, p->y, p->z);
+    fp_sqr(p->z, p->z);
+    fp_sub(p->z, p->z, gamma);
+    fp_sub(p->z, p->z, delta);
+
+    /* X3 = alpha^2 - 8 beta */
+    fp_add(beta, beta, beta);
+    fp_add(beta, beta, beta);
+    fp_sqr(p->x, alpha);
+    fp_add(t, beta, beta);
+    fp_sub(p->x, p->x, t);
+
+    /* Y3 = alpha (4 beta - X3) - 8 gamma^2 */
+    fp_sub(t, beta, p->x);
+    fp_mul(p->y, alpha, t);
+    fp_sqr(gamma, gamma);
+    fp_add(gamma, gamma, gamma);
+    fp_add(gamma, gamma, gamma);
+    fp_add(gamma, gamma, gamma);
+    fp_sub(p->y, p->y, gamma);
+}
+
+/* p += q, or p -= q if negate, madd-2007-bl, 7M + 4S */
+static void jac_add_affine(jacobian_t *p, const affine_t *q, int negate)
+{
+    fe_t z1z1, u2, s2, h, hh, i, j, r, v;
+    const fe_t zero = { 0 };
+
+    if (negate) {
+        fp_sub(s2, zero, q->y);
+    } else {
+        memcpy(s2, q->y, sizeof(s2));
+    }
+
+    if (vli_is_zero(p->z)) {
+        memcpy(p->x, q->x, sizeof(p->x));
+        memcpy(p->y, s2, sizeof(p->y));
+        memset(p->z, 0, sizeof(p->z));
+        p->z[0] = 1;
+        return;
+    }
+
+    fp_sqr(z1z1, p->z);
+    fp_mul(u2, q->x, z1z1);
+    fp_mul(s2, s2, p->z);
+    fp_mul(s2, s2, z1z1);
+    fp_sub(h, u2, p->x);
+    fp_sub(r, s2, p->y);
+    if (vli_is_zero(h)) {
+        if (vli_is_zero(r)) {
+            jac_double(p);
+        } else {
+            memset(p->z, 0, sizeof(p->z));
+        }
+        return;
+    }
+
+    fp_sqr(hh, h);
+    fp_add(i, hh, hh);
+    fp_add(i, i, i);
+    fp_mul(j, h, i);
+    fp_add(r, r, r);
+    fp_mul(v, p->x, i);
+
+    /* Z3 = (Z1 + H)^2 - Z1Z1 - HH */
+    fp_add(p->z, p->z, h);
+    fp_sqr(p->z, p->z);
+    fp_sub(p->z, p->z, z1z1);
+    fp_sub(p->z, p->z, hh);
+
+    /* X3 = r^2 - J - 2 V */
+    fp_sqr(p->x, r);
+    fp_sub(p->x, p->x, j);
+    fp_sub(p->x, p->x, v);
+    fp_sub(p->x, p->x, v);
+
+    /* Y3 = r (V - X3) - 2 Y1 J */
+    fp_sub(v, v, p->x);
+    fp_mul(j, j, p->y);
+    fp_add(j, j, j);
+    fp_mul(p->y, r, v);
+    fp_sub(p->y, p->y, j);
+}
+
+#if ESP_UECC_VERIFY_TABLE_POINTS > 1
+static void jac_to_affine(affine_t *r, const jacobian_t *p, const fe_t z_inv)
+{
+    fe_t t;
+
+    fp_sqr(t, z_inv);
+    fp_mul(r->x, p->x, t);
+    fp_mul(t, t, z_inv);
+    fp_mul(r->y, p->y, t);
+}
+#endif
+
+/* Odd multiples of q, converted to affine with one inversion */
+static void compute_table(affine_t table[ESP_UECC_VERIFY_TABLE_POINTS], const affine_t *q)
+{
+    table[0] = *q;
+#if ESP_UECC_VERIFY_TABLE_POINTS > 1
+    jacobian_t points[ESP_UECC_VERIFY_TABLE_POINTS];
+    fe_t prefix[ESP_UECC_VERIFY_TABLE_POINTS];
+    affine_t q2;
+    fe_t inv;
+
+    /* 2q, no point of the curve has order 2 */
+    memcpy(points[0].x, q->x, sizeof(fe_t));
+    memcpy(points[0].y, q->y, sizeof(fe_t));
+    memset(points[0].z, 0, sizeof(fe_t));
+    points[0].z[0] = 1;
+    jac_double(&points[0]);
+    fp_inv(inv, points[0].z);
+    jac_to_affine(&q2, &points[0], inv);
+
+    /* points[i] = (2i + 1) q, prefix[i] = product of their Z */
+    memcpy(points[1].x, q->x, sizeof(fe_t));
+    memcpy(points[1].y, q->y, sizeof(fe_t));
+    memset(points[1].z, 0, sizeof(fe_t));
+    points[1].z[0] = 1;
+    jac_add_affine(&points[1], &q2, 0);
+    memcpy(prefix[1], points[1].z, sizeof(fe_t));
+#if ESP_UECC_VERIFY_TABLE_POINTS > 2
+    for (int i = 2; i < ESP_UECC_VERIFY_TABLE_POINTS; i++) {
+        points[i] = points[i - 1];
+        jac_add_affine(&points[i], &q2, 0);
+        fp_mul(prefix[i], prefix[i - 1], points[i].z);
+    }
+#endif
+
+    fp_inv(inv, prefix[ESP_UECC_VERIFY_TABLE_POINTS - 1]);
+#if ESP_UECC_VERIFY_TABLE_POINTS > 2
+    for (int i = ESP_UECC_VERIFY_TABLE_POINTS - 1; i > 1; i--) {
+        fe_t z_inv;
+        fp_mul(z_inv, inv, prefix[i - 1]);
+        fp_mul(inv, inv, points[i].z);
+        jac_to_affine(&table[i], &points[i], z_inv);
+    }
+#endif
+    jac_to_affine(&table[1], &points[1], inv);
+#endif
+}
+
+/*
+ * Arithmetic mod n, in the Montgomery domain (R = 2^256)
+ */
+static void mont_mul_n(fe_t r, const fe_t a, const fe_t b)
+{
+    uint32_t t[NUM_WORDS + 2];
+    uint64_t x;
+
+    memset(t, 0, sizeof(t));
+    for (int i = 0; i < NUM_WORDS; i++) {
+        uint64_t carry = 0;
+        for (int j = 0; j < NUM_WORDS; j++) {
+            x = (uint64_t)a[j] * b[i] + t[j] + carry;
+            t[j] = (uint32_t)x;
+            carry = x >> 32;
+        }
+        x = (uint64_t)t[NUM_WORDS] + carry;
+        t[NUM_WORDS] = (uint32_t)x;
+        t[NUM_WORDS + 1] = (uint32_t)(x >> 32);
+
+        uint32_t m = t[0] * N_INV;
+        x = (uint64_t)m * curve_n[0] + t[0];
+        carry = x >> 32;
+        for (int j = 1; j < NUM_WORDS; j++) {
+            x = (uint64_t)m * curve_n[j] + t[j] + carry;
+            t[j - 1] = (uint32_t)x;
+            carry = x >> 32;
+        }
+        x = (uint64_t)t[NUM_WORDS] + carry;
+        t[NUM_WORDS - 1] = (uint32_t)x;
+        t[NUM_WORDS] = t[NUM_WORDS + 1] + (uint32_t)(x >> 32);
+    }
+
+    if (t[NUM_WORDS] || vli_cmp(t, curve_n) >= 0) {
+        vli_sub(t, t, curve_n);
+    }
+    memcpy(r, t, sizeof(fe_t));
+}
+
+/* a^-1 R (mod n), a^(n - 2) */
+static void mont_inv_n(fe_t r, const fe_t a)
+{
+    fe_t e, am, x;
+
+    memcpy(e, curve_n, sizeof(e));
+    e[0] -= 2;
+    mont_mul_n(am, a, n_rr);
+    memcpy(x, am, sizeof(x));
+    for (int i = 255 - 1; i >= 0; i--) {
+        mont_mul_n(x, x, x);
+        if ((e[i / 32] >> (i % 32)) & 1) {
+            mont_mul_n(x, x, am);
+        }
+    }
+    memcpy(r, x, sizeof(x));
+}
+
+/* Width-w NAF of k, least significant digit first, returns the length */
+static int compute_wnaf(int8_t naf[257], const fe_t k_in)
+{
+    uint32_t k[NUM_WORDS + 1];
+    int len = 0;
+
+    memcpy(k, k_in, sizeof(fe_t));
+    k[NUM_WORDS] = 0;
+    while (1) {
+        uint32_t bits = 0;
+        for (int i = 0; i <= NUM_WORDS; i++) {
+            bits |= k[i];
+        }
+        if (bits == 0) {
+            break;
+        }
+
+        int digit = 0;
+        if (k[0] & 1) {
+            digit = k[0] & ((1 << ESP_UECC_VERIFY_WINDOW) - 1);
+            if (digit >= (1 << (ESP_UECC_VERIFY_WINDOW - 1))) {
+                digit -= 1 << ESP_UECC_VERIFY_WINDOW;
+            }
+            /* k -= digit, which clears the low w bits */
+            int64_t carry = -(int64_t)digit;
+            for (int i = 0; i <= NUM_WORDS && carry != 0; i++) {
+                carry += k[i];
+                k[i] = (uint32_t)carry;
+                carry >>= 32;
+            }
+        }
+        naf[len++] = digit;
+
+        for (int i = 0; i < NUM_WORDS; i++) {
+            k[i] = (k[i] >> 1) | (k[i + 1] << 31);
+        }
+        k[NUM_WORDS] >>= 1;
+    }
+    return len;
+}
+
+static void add_digit(jacobian_t *r, const affine_t *table, int digit)
+{
+    if (digit > 0) {
+        jac_add_affine(r, &table[digit >> 1], 0);
+    } else if (digit < 0) {
+        jac_add_affine(r, &table[-digit >> 1], 1);
+    }
+}
+
+static int load_key(affine_t *q, const uint8_t public_key[64])
+{
+    bytes_to_fe(q->x, public_key);
+    bytes_to_fe(q->y, public_key + 32);
+    return point_is_valid(q);
+}
+
+int esp_uecc_verify_table(const uint8_t public_key[64], uint8_t table[ESP_UECC_VERIFY_TABLE_LEN])
+{
+    affine_t q, points[ESP_UECC_VERIFY_TABLE_POINTS];
+
+    if (!load_key(&q, public_key)) {
+        return 0;
+    }
+    compute_table(points, &q);
+    for (int i = 0; i < ESP_UECC_VERIFY_TABLE_POINTS; i++) {
+        fe_to_bytes(table + 64 * i, points[i].x);
+        fe_to_bytes(table + 64 * i + 32, points[i].y);
+    }
+    return 1;
+}
+
+int esp_uecc_verify(const uint8_t public_key[64], const uint8_t *table,
+                    const uint8_t *message_hash, unsigned hash_size, const uint8_t signature[64])
+{
+    affine_t q_table[ESP_UECC_VERIFY_TABLE_POINTS];
+    int8_t naf1[257], naf2[257];
+    fe_t r, s, e, w, u1, u2;
+    uint8_t hash[32];
+    jacobian_t sum;
+
+    bytes_to_fe(r, signature);
+    bytes_to_fe(s, signature + 32);
+    if (vli_is_zero(r) || vli_is_zero(s) || vli_cmp(r, curve_n) >= 0 || vli_cmp(s, curve_n) >= 0) {
+        return 0;
+    }
+
+    if (table != NULL) {
+        if (memcmp(table, public_key, 64) != 0) {
+            return 0;
+        }
+        for (int i = 0; i < ESP_UECC_VERIFY_TABLE_POINTS; i++) {
+            bytes_to_fe(q_table[i].x, table + 64 * i);
+            bytes_to_fe(q_table[i].y, table + 64 * i + 32);
+        }
+        if (!point_is_valid(&q_table[0])) {
+            return 0;
+        }
+    } else {
+        if (!load_key(&q_table[0], public_key)) {
+            return 0;
+        }
+        compute_table(q_table, &q_table[0]);
+    }
+
+    /* e: the leftmost 256 bits of the hash, reduced mod n */
+    if (hash_size > sizeof(hash)) {
+        hash_size = sizeof(hash);
+    }
+    memset(hash, 0, sizeof(hash));
+    memcpy(hash + sizeof(hash) - hash_size, message_hash, hash_size);
+    bytes_to_fe(e, hash);
+    if (vli_cmp(e, curve_n) >= 0) {
+        vli_sub(e, e, curve_n);
+    }
+
+    /* u1 = e / s, u2 = r / s (mod n): (s^-1 R) e R^-1 */
+    mont_inv_n(w, s);
+    mont_mul_n(u1, e, w);
+    mont_mul_n(u2, r, w);
+
+    int len1 = compute_wnaf(naf1, u1);
+    int len2 = compute_wnaf(naf2, u2);
+    memset(&sum, 0, sizeof(sum));
+    for (int i = (len1 > len2 ? len1 : len2) - 1; i >= 0; i--) {
+        if (!vli_is_zero(sum.z)) {
+            jac_double(&sum);
+        }
+        if (i < len1) {
+            add_digit(&sum, g_table, naf1[i]);
+        }
+        if (i < len2) {
+            add_digit(&sum, q_table, naf2[i]);
+        }
+    }
+    if (vli_is_zero(sum.z)) {
+        return 0;
+    }
+
+    /* x(sum) mod n == r, without an inversion: X == r Z^2, or (r + n) Z^2 if r + n < p */
+    fe_t zz, t;
+    fp_sqr(zz, sum.z);
+    fp_mul(t, r, zz);
+    if (vli_cmp(t, sum.x) == 0) {
+        return 1;
+    }
+    if (vli_add(t, r, curve_n) == 0 && vli_cmp(t, curve_p) < 0) {
+        fp_mul(t, t, zz);
+        return vli_cmp(t, sum.x) == 0;
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef _ESP_UECC_VERIFY_H_
+#define _ESP_UECC_VERIFY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/** @brief Window width of the NAF of the scalars, 2 (plain NAF) to 6 */
+#ifndef ESP_UECC_VERIFY_WINDOW
+#ifdef CONFIG_SECURE_BOOT_VERIFY_WINDOW
+#define ESP_UECC_VERIFY_WINDOW CONFIG_SECURE_BOOT_VERIFY_WINDOW
+#else
+#define ESP_UECC_VERIFY_WINDOW 5
+#endif
+#endif
+
+/** @brief Points in a table: the odd multiples 1*Q, 3*Q, ... (2^(w-1) - 1)*Q */
+#define ESP_UECC_VERIFY_TABLE_POINTS (1 << (ESP_UECC_VERIFY_WINDOW - 2))
+
+/** @brief Bytes of a table, X and Y of each point as in a uECC public key */
+#define ESP_UECC_VERIFY_TABLE_LEN (ESP_UECC_VERIFY_TABLE_POINTS * 64)
+
+/** @brief Compute the point table of a secp256r1 public key.
+ *
+ * The same table as gen_verify_table.py writes at build time.
+ *
+ * @param public_key Public key, X and Y big endian (uECC format).
+ * @param table ESP_UECC_VERIFY_TABLE_LEN bytes, filled with the table.
+ *
+ * @return 1 on success, 0 if the key is not a point of the curve.
+ */
+int esp_uecc_verify_table(const uint8_t public_key[64], uint8_t table[ESP_UECC_VERIFY_TABLE_LEN]);
+
+/** @brief Verify an ECDSA secp256r1 signature, as uECC_verify(public_key, ..., uECC_secp256r1()).
+ *
+ * Computes u1*G + u2*Q with one interleaved (Shamir's trick) windowed NAF
+ * multiplication, with a table of multiples of the generator in flash and
+ * a table of multiples of the key Q. This is faster than uECC_verify(), but
+ * not constant time: use it with public data only, as the signature check
+ * of secure boot.
+ *
+ * @param public_key Public key, X and Y big endian (uECC format).
+ * @param table Point table of the key, from gen_verify_table.py or
+ * esp_uecc_verify_table(), or NULL to compute it here. Only the first point
+ * is checked against the key, the table must come from a source as trusted
+ * as the key itself.
+ * @param message_hash Hash of the signed data.
+ * @param hash_size Length of the hash, only the first 32 bytes of a longer
+ * hash are used.
+ * @param signature Signature, r and s big endian (uECC format).
+ *
+ * @return 1 if the signature is valid, 0 if it isn't, or if the key or the
+ * table are invalid.
+ */
+int esp_uecc_verify(const uint8_t public_key[64], const uint8_t *table,
+                    const uint8_t *message_hash, unsigned hash_size, const uint8_t signature[64]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_UECC_VERIFY_H_ */
@@ -0,0 +1,2 @@
+/* esp_uecc_verify.h reads the window width from sdkconfig.h, the Makefile sets it */
+#pragma once
@@ -0,0 +1,270 @@
+#include "catch.hpp"
+
+extern "C" {
+#include "esp_uecc_verify.h"
+#ifdef HAVE_UECC
+#include "uECC.h"
+#endif
+}
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/sha256.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+/* A key pair and signatures from mbedTLS, in the uECC formats */
+struct Signer {
+    mbedtls_ecdsa_context ecdsa;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+    uint8_t public_key[64];
+
+    Signer()
+    {
+        mbedtls_ecdsa_init(&ecdsa);
+        mbedtls_ctr_drbg_init(&drbg);
+        mbedtls_entropy_init(&entropy);
+        REQUIRE(mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, NULL, 0) == 0);
+        new_key();
+    }
+
+    ~Signer()
+    {
+        mbedtls_ecdsa_free(&ecdsa);
+        mbedtls_ctr_drbg_free(&drbg);
+        mbedtls_entropy_free(&entropy);
+    }
+
+    void new_key()
+    {
+        mbedtls_ecdsa_free(&ecdsa);
+        mbedtls_ecdsa_init(&ecdsa);
+        REQUIRE(mbedtls_ecdsa_genkey(&ecdsa, MBEDTLS_ECP_DP_SECP256R1, mbedtls_ctr_drbg_random, &drbg) == 0);
+        REQUIRE(mbedtls_mpi_write_binary(&ecdsa.Q.X, public_key, 32) == 0);
+        REQUIRE(mbedtls_mpi_write_binary(&ecdsa.Q.Y, public_key + 32, 32) == 0);
+    }
+
+    void random(uint8_t *buf, size_t len)
+    {
+        REQUIRE(mbedtls_ctr_drbg_random(&drbg, buf, len) == 0);
+    }
+
+    void sign(uint8_t signature[64], const uint8_t *hash, size_t hash_size)
+    {
+        mbedtls_mpi r, s;
+        mbedtls_mpi_init(&r);
+        mbedtls_mpi_init(&s);
+        REQUIRE(mbedtls_ecdsa_sign(&ecdsa.grp, &r, &s, &ecdsa.d, hash, hash_size, mbedtls_ctr_drbg_random, &drbg) == 0);
+        REQUIRE(mbedtls_mpi_write_binary(&r, signature, 32) == 0);
+        REQUIRE(mbedtls_mpi_write_binary(&s, signature + 32, 32) == 0);
+        mbedtls_mpi_free(&r);
+        mbedtls_mpi_free(&s);
+    }
+
+    bool mbedtls_verify(const uint8_t *hash, size_t hash_size, const uint8_t signature[64])
+    {
+        mbedtls_mpi r, s;
+        mbedtls_mpi_init(&r);
+        mbedtls_mpi_init(&s);
+        REQUIRE(mbedtls_mpi_read_binary(&r, signature, 32) == 0);
+        REQUIRE(mbedtls_mpi_read_binary(&s, signature + 32, 32) == 0);
+        int ret = mbedtls_ecdsa_verify(&ecdsa.grp, hash, hash_size, &ecdsa.Q, &r, &s);
+        mbedtls_mpi_free(&r);
+        mbedtls_mpi_free(&s);
+        return ret == 0;
+    }
+};
+
+static void from_hex(uint8_t *out, const char *hex)
+{
+    for (size_t i = 0; hex[2 * i]; i++) {
+        REQUIRE(sscanf(hex + 2 * i, "%2hhx", &out[i]) == 1);
+    }
+}
+
+/* Valid with the table and without, and as valid as for mbedTLS */
+static bool verify_both(const uint8_t public_key[64], const uint8_t *hash, unsigned hash_size, const uint8_t signature[64])
+{
+    std::vector<uint8_t> table(ESP_UECC_VERIFY_TABLE_LEN);
+    REQUIRE(esp_uecc_verify_table(public_key, table.data()) == 1);
+    int with_table = esp_uecc_verify(public_key, table.data(), hash, hash_size, signature);
+    int computed = esp_uecc_verify(public_key, NULL, hash, hash_size, signature);
+    CHECK(with_table == computed);
+#ifdef HAVE_UECC
+    CHECK(uECC_verify(public_key, hash, hash_size, signature, uECC_secp256r1()) == with_table);
+#endif
+    return with_table == 1;
+}
+
+TEST_CASE("secp256r1 signatures of RFC 6979 A.2.5", "[uecc_verify]")
+{
+    uint8_t public_key[64], signature[64], hash[32];
+
+    from_hex(public_key, "60FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E60F29FB6"
+                         "7903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177A3C294D4462299");
+
+    mbedtls_sha256((const unsigned char *)"sample", 6, hash, 0);
+    from_hex(signature, "EFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3716"
+                        "F7CB1C942D657C41D436C7A1B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA8");
+    CHECK(verify_both(public_key, hash, sizeof(hash), signature));
+    hash[31] ^= 1;
+    CHECK_FALSE(verify_both(public_key, hash, sizeof(hash), signature));
+
+    mbedtls_sha256((const unsigned char *)"test", 4, hash, 0);
+    from_hex(signature, "F1ABB023518351CD71D881567B1EA663ED3EFCF6C5132B354F28D3B0B7D38367"
+                        "019F4113742A2B14BD25926B49C649155F267E60D3814B4C0CC84250E46F0083");
+    CHECK(verify_both(public_key, hash, sizeof(hash), signature));
+    signature[63] ^= 0x80;
+    CHECK_FALSE(verify_both(public_key, hash, sizeof(hash), signature));
+}
+
+TEST_CASE("esp_uecc_verify agrees with mbedtls_ecdsa_verify", "[uecc_verify]")
+{
+    Signer signer;
+    uint8_t hash[64], signature[64];
+
+    for (int i = 0; i < 200; i++) {
+        if (i % 10 == 0) {
+            signer.new_key();
+        }
+        /* SHA-256, and shorter and longer hashes, which are truncated */
+        unsigned hash_size = (i % 4 == 3) ? 20 + i % 45 : 32;
+        signer.random(hash, sizeof(hash));
+        if (i % 8 == 0) {
+            /* the hash is larger than n */
+            memset(hash, 0xff, 32);
+        }
+        signer.sign(signature, hash, hash_size);
+        INFO("signature " << i << ", hash of " << hash_size << " bytes");
+        CHECK(verify_both(signer.public_key, hash, hash_size, signature));
+
+        /* any changed bit makes it invalid */
+        uint8_t bad[64];
+        memcpy(bad, signature, sizeof(bad));
+        bad[i % 64] ^= 1 << (i % 8);
+        CHECK(verify_both(signer.public_key, hash, hash_size, bad) == signer.mbedtls_verify(hash, hash_size, bad));
+        CHECK_FALSE(verify_both(signer.public_key, hash, hash_size, bad));
+        /* the first 32 bytes are used */
+        hash[i % (hash_size < 32 ? hash_size : 32)] ^= 1;
+        CHECK_FALSE(verify_both(signer.public_key, hash, hash_size, signature));
+    }
+}
+
+TEST_CASE("esp_uecc_verify rejects invalid signatures, keys and tables", "[uecc_verify]")
+{
+    Signer signer;
+    uint8_t hash[32] = { 1, 2, 3 }, signature[64], bad[64];
+    std::vector<uint8_t> table(ESP_UECC_VERIFY_TABLE_LEN);
+    static const uint8_t n[32] = {
+        0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xbc, 0xe6, 0xfa, 0xad, 0xa7, 0x17, 0x9e, 0x84, 0xf3, 0xb9, 0xca, 0xc2, 0xfc, 0x63, 0x25, 0x51
+    };
+
+    signer.sign(signature, hash, sizeof(hash));
+    REQUIRE(esp_uecc_verify_table(signer.public_key, table.data()) == 1);
+    REQUIRE(esp_uecc_verify(signer.public_key, table.data(), hash, sizeof(hash), signature) == 1);
+
+    /* r or s zero, or not less than n */
+    for (int half : { 0, 32 }) {
+        memcpy(bad, signature, sizeof(bad));
+        memset(bad + half, 0, 32);
+        CHECK(esp_uecc_verify(signer.public_key, table.data(), hash, sizeof(hash), bad) == 0);
+        memcpy(bad + half, n, 32);
+        CHECK(esp_uecc_verify(signer.public_key, table.data(), hash, sizeof(hash), bad) == 0);
+        memset(bad + half, 0xff, 32);
+        CHECK(esp_uecc_verify(signer.public_key, NULL, hash, sizeof(hash), bad) == 0);
+    }
+
+    /* s and n - s are both valid */
+    mbedtls_mpi s, order;
+    mbedtls_mpi_init(&s);
+    mbedtls_mpi_init(&order);
+    REQUIRE(mbedtls_mpi_read_binary(&s, signature + 32, 32) == 0);
+    REQUIRE(mbedtls_mpi_read_binary(&order, n, 32) == 0);
+    REQUIRE(mbedtls_mpi_sub_mpi(&s, &order, &s) == 0);
+    memcpy(bad, signature, sizeof(bad));
+    REQUIRE(mbedtls_mpi_write_binary(&s, bad + 32, 32) == 0);
+    CHECK(esp_uecc_verify(signer.public_key, table.data(), hash, sizeof(hash), bad) == 1);
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&order);
+
+    /* a key which isn't a point of the curve */
+    uint8_t key[64];
+    memcpy(key, signer.public_key, sizeof(key));
+    key[63] ^= 1;
+    CHECK(esp_uecc_verify_table(key, table.data()) == 0);
+    CHECK(esp_uecc_verify(key, NULL, hash, sizeof(hash), signature) == 0);
+
+    /* the table of another key */
+    std::vector<uint8_t> other(ESP_UECC_VERIFY_TABLE_LEN);
+    Signer signer2;
+    REQUIRE(esp_uecc_verify_table(signer2.public_key, other.data()) == 1);
+    CHECK(esp_uecc_verify(signer.public_key, other.data(), hash, sizeof(hash), signature) == 0);
+}
+
+TEST_CASE("gen_verify_table.py writes the table of esp_uecc_verify_table", "[uecc_verify]")
+{
+    Signer signer;
+    std::vector<uint8_t> table(ESP_UECC_VERIFY_TABLE_LEN), generated(ESP_UECC_VERIFY_TABLE_LEN + 1);
+    char cmd[256];
+
+    REQUIRE(esp_uecc_verify_table(signer.public_key, table.data()) == 1);
+    FILE *f = fopen("key.bin", "wb");
+    REQUIRE(f != NULL);
+    REQUIRE(fwrite(signer.public_key, 1, 64, f) == 64);
+    fclose(f);
+
+    snprintf(cmd, sizeof(cmd), PYTHON " ../gen_verify_table.py --window %d key.bin table.bin", ESP_UECC_VERIFY_WINDOW);
+    REQUIRE(system(cmd) == 0);
+    f = fopen("table.bin", "rb");
+    REQUIRE(f != NULL);
+    CHECK(fread(generated.data(), 1, generated.size(), f) == ESP_UECC_VERIFY_TABLE_LEN);
+    fclose(f);
+    generated.resize(ESP_UECC_VERIFY_TABLE_LEN);
+    CHECK(generated == table);
+}
+
+TEST_CASE("secure boot signature verification time", "[uecc_verify][perf]")
+{
+    const int rounds = 200;
+    Signer signer;
+    uint8_t hash[32], signature[64];
+    std::vector<uint8_t> table(ESP_UECC_VERIFY_TABLE_LEN);
+
+    signer.random(hash, sizeof(hash));
+    signer.sign(signature, hash, sizeof(hash));
+    REQUIRE(esp_uecc_verify_table(signer.public_key, table.data()) == 1);
+
+    auto time_us = [&](const char *name, std::function<bool()> f) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            REQUIRE(f());
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+        printf("secp256r1 verify, %s: %.1f us\n", name, us);
+        return us;
+    };
+
+    printf("NAF window width %d, key table of %d bytes\n", ESP_UECC_VERIFY_WINDOW, ESP_UECC_VERIFY_TABLE_LEN);
+    double fast_us = time_us("esp_uecc_verify, key table at build time", [&] {
+        return esp_uecc_verify(signer.public_key, table.data(), hash, sizeof(hash), signature) == 1;
+    });
+    time_us("esp_uecc_verify, key table computed", [&] {
+        return esp_uecc_verify(signer.public_key, NULL, hash, sizeof(hash), signature) == 1;
+    });
+    double mbedtls_us = time_us("mbedtls_ecdsa_verify", [&] {
+        return signer.mbedtls_verify(hash, sizeof(hash), signature);
+    });
+#ifdef HAVE_UECC
+    double uecc_us = time_us("uECC_verify", [&] {
+        return uECC_verify(signer.public_key, hash, sizeof(hash), signature, uECC_secp256r1()) == 1;
+    });
+    printf("secp256r1 verify, speedup over uECC_verify %.1fx\n", uecc_us / fast_us);
+#endif
+    printf("secp256r1 verify, speedup over mbedtls_ecdsa_verify %.1fx\n", mbedtls_us / fast_us);
+}
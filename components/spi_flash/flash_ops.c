@@ -36,6 +36,10 @@
 #include "esp_flash_partitions.h"
 #include "esp_ota_ops.h"
 #include "cache_utils.h"
+#if CONFIG_SPI_FLASH_ERASE_SUSPEND
+#include "soc/spi_reg.h"
+#include "rom/ets_sys.h"
+#endif
 
 /* bytes erased by SPIEraseBlock() ROM function */
 #define BLOCK_ERASE_SIZE 65536
@@ -48,28 +52,57 @@
 
 static const char *TAG __attribute__((unused)) = "spi_flash";
 
+/* Timing of one spi_flash_* call, kept on the caller's stack while it runs */
+typedef struct {
+    uint32_t ts_begin;      // CPU cycle count when the operation started
+    uint32_t guard_begin;   // CPU cycle count when the guard was last taken
+    uint32_t guard_time;    // total cycles with the guard held (caches disabled)
+    uint32_t guard_max;     // longest single period with the guard held, in cycles
+    uint32_t bytes;
+} op_timing_t;
+
 #if CONFIG_SPI_FLASH_ENABLE_COUNTERS
-static spi_flash_counters_t s_flash_stats;
+static DRAM_ATTR spi_flash_counters_t s_flash_stats;
+static DRAM_ATTR spi_flash_counters_t s_client_stats[SPI_FLASH_CLIENT_MAX];
+
+/* Flash regions attributed to clients, partitions are added when the partition table is loaded */
+#define MAX_CLIENT_REGIONS 16
+
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    spi_flash_client_t client;
+} client_region_t;
+
+static DRAM_ATTR client_region_t s_client_regions[MAX_CLIENT_REGIONS];
+static DRAM_ATTR int s_client_region_count;
 
-#define COUNTER_START()     uint32_t ts_begin = xthal_get_ccount()
-#define COUNTER_STOP(counter)  \
-    do{ \
-        s_flash_stats.counter.count++; \
-        s_flash_stats.counter.time += (xthal_get_ccount() - ts_begin) / (esp_clk_cpu_freq() / 1000000); \
+#define COUNTER_START()     op_timing_t op_timing = { .ts_begin = xthal_get_ccount() }
+#define COUNTER_STOP(counter, addr)  \
+    do { \
+        spi_flash_client_t client = client_for_address(addr); \
+        counter_record(&s_flash_stats.counter, &s_client_stats[client].counter, &op_timing); \
     } while(0)
 
 #define COUNTER_ADD_BYTES(counter, size) \
     do { \
-        s_flash_stats.counter.bytes += size; \
+        op_timing.bytes += size; \
     } while (0)
 
+#define OP_TIMING           (&op_timing)
+
 #else
 #define COUNTER_START()
-#define COUNTER_STOP(counter)
+#define COUNTER_STOP(counter, addr)
 #define COUNTER_ADD_BYTES(counter, size)
+#define OP_TIMING           NULL
 
 #endif //CONFIG_SPI_FLASH_ENABLE_COUNTERS
 
+/* Take and release the guard, accounting the time caches are disabled to the current operation */
+#define GUARD_START()       op_guard_start(OP_TIMING)
+#define GUARD_END()         op_guard_end(OP_TIMING)
+
 static esp_err_t spi_flash_translate_rc(esp_rom_spiflash_result_t rc);
 
 const DRAM_ATTR spi_flash_guard_funcs_t g_flash_guard_default_ops = {
@@ -170,6 +203,77 @@ static inline void IRAM_ATTR spi_flash_guard_op_unlock()
     }
 }
 
+static inline void IRAM_ATTR op_guard_start(op_timing_t *timing)
+{
+    spi_flash_guard_start();
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    timing->guard_begin = xthal_get_ccount();
+#endif
+}
+
+static inline void IRAM_ATTR op_guard_end(op_timing_t *timing)
+{
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+    uint32_t held = xthal_get_ccount() - timing->guard_begin;
+    timing->guard_time += held;
+    if (held > timing->guard_max) {
+        timing->guard_max = held;
+    }
+#endif
+    spi_flash_guard_end();
+}
+
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+
+static spi_flash_client_t IRAM_ATTR client_for_address(uint32_t addr)
+{
+    for (int i = 0; i < s_client_region_count; i++) {
+        if (addr >= s_client_regions[i].start && addr < s_client_regions[i].end) {
+            return s_client_regions[i].client;
+        }
+    }
+    return SPI_FLASH_CLIENT_OTHER;
+}
+
+static inline int IRAM_ATTR latency_bucket(uint32_t time_us)
+{
+    if (time_us < SPI_FLASH_LATENCY_BUCKET_LIMIT(0)) {
+        return 0;
+    }
+    /* bucket n holds times in [8 << n, 16 << n) */
+    int bucket = 31 - __builtin_clz(time_us) - 3;
+    return MIN(bucket, SPI_FLASH_LATENCY_BUCKETS - 1);
+}
+
+static void IRAM_ATTR counter_add(spi_flash_counter_t *counter, uint32_t time_us, uint32_t bytes,
+                                  uint32_t guard_time_us, uint32_t guard_max_us, int bucket)
+{
+    counter->count++;
+    counter->time += time_us;
+    counter->bytes += bytes;
+    counter->cache_disabled_time += guard_time_us;
+    if (guard_max_us > counter->cache_disabled_max) {
+        counter->cache_disabled_max = guard_max_us;
+    }
+    counter->latency[bucket]++;
+}
+
+static void IRAM_ATTR counter_record(spi_flash_counter_t *total, spi_flash_counter_t *client, const op_timing_t *timing)
+{
+    const uint32_t cycles_per_us = esp_clk_cpu_freq() / 1000000;
+    uint32_t time_us = (xthal_get_ccount() - timing->ts_begin) / cycles_per_us;
+    uint32_t guard_time_us = timing->guard_time / cycles_per_us;
+    uint32_t guard_max_us = timing->guard_max / cycles_per_us;
+    int bucket = latency_bucket(time_us);
+
+    spi_flash_guard_op_lock();
+    counter_add(total, time_us, timing->bytes, guard_time_us, guard_max_us, bucket);
+    counter_add(client, time_us, timing->bytes, guard_time_us, guard_max_us, bucket);
+    spi_flash_guard_op_unlock();
+}
+
+#endif //CONFIG_SPI_FLASH_ENABLE_COUNTERS
+
 static esp_rom_spiflash_result_t IRAM_ATTR spi_flash_unlock()
 {
     static bool unlocked = false;
@@ -185,6 +289,153 @@ static esp_rom_spiflash_result_t IRAM_ATTR spi_flash_unlock()
     return ESP_ROM_SPIFLASH_RESULT_OK;
 }
 
+#if CONFIG_SPI_FLASH_ERASE_SUSPEND
+
+/* Status bit which is set while an erase is suspended */
+#define FLASH_SUS_FLAG BIT(CONFIG_SPI_FLASH_ERASE_SUSPEND_STATUS_BIT)
+
+/* Longest time the chip may take to enter the suspended state after the suspend command */
+#define ERASE_SUSPEND_TIMEOUT_US 1000
+
+/* Gap between slices, rounded up to whole ticks */
+#define ERASE_SUSPEND_GAP_TICKS ((CONFIG_SPI_FLASH_ERASE_SUSPEND_GAP_US + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000))
+
+/* Cleared if the chip doesn't respond to the suspend command, erases then fall back to running in one go */
+static DRAM_ATTR bool s_erase_suspend_supported = true;
+
+static DRAM_ATTR uint32_t s_erase_max_blocking_time;
+
+/* Send a single byte command with no address or data phase on SPI1 */
+static void IRAM_ATTR spi_flash_send_cmd(uint8_t command)
+{
+    uint32_t user = READ_PERI_REG(SPI_USER_REG(1));
+    uint32_t user2 = READ_PERI_REG(SPI_USER2_REG(1));
+    WRITE_PERI_REG(SPI_USER_REG(1), (user & ~(SPI_USR_ADDR | SPI_USR_DUMMY | SPI_USR_MISO | SPI_USR_MOSI)) | SPI_USR_COMMAND);
+    WRITE_PERI_REG(SPI_USER2_REG(1), (7 << SPI_USR_COMMAND_BITLEN_S) | command);
+    WRITE_PERI_REG(PERIPHS_SPI_FLASH_CMD, SPI_USR);
+    while (READ_PERI_REG(PERIPHS_SPI_FLASH_CMD) != 0);
+    WRITE_PERI_REG(SPI_USER_REG(1), user);
+    WRITE_PERI_REG(SPI_USER2_REG(1), user2);
+}
+
+/* Read the status register once, unlike esp_rom_spiflash_read_status() which waits for the chip to be idle */
+static bool IRAM_ATTR spi_flash_is_busy()
+{
+    WRITE_PERI_REG(PERIPHS_SPI_FLASH_STATUS, 0);
+    WRITE_PERI_REG(PERIPHS_SPI_FLASH_CMD, SPI_FLASH_RDSR);
+    while (READ_PERI_REG(PERIPHS_SPI_FLASH_CMD) != 0);
+    return (READ_PERI_REG(PERIPHS_SPI_FLASH_STATUS) & ESP_ROM_SPIFLASH_BUSY_FLAG) != 0;
+}
+
+/* Wait up to 'cycles' CPU cycles for the chip to become idle */
+static bool IRAM_ATTR spi_flash_wait_idle_for(uint32_t cycles)
+{
+    uint32_t start = xthal_get_ccount();
+    while (spi_flash_is_busy()) {
+        if (xthal_get_ccount() - start > cycles) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Write enable, then start erasing the sector or block at 'addr' without waiting for it to finish */
+static esp_rom_spiflash_result_t IRAM_ATTR spi_flash_erase_start(uint32_t addr, bool block)
+{
+    uint32_t status = 0;
+
+    REG_CLR_BIT(PERIPHS_SPI_FLASH_USRREG, SPI_USR_DUMMY);
+    REG_SET_FIELD(PERIPHS_SPI_FLASH_USRREG1, SPI_USR_ADDR_BITLEN, ESP_ROM_SPIFLASH_W_SIO_ADDR_BITSLEN);
+
+    esp_rom_spiflash_wait_idle(&g_rom_flashchip);
+    WRITE_PERI_REG(PERIPHS_SPI_FLASH_CMD, SPI_FLASH_WREN);
+    while (READ_PERI_REG(PERIPHS_SPI_FLASH_CMD) != 0);
+    while ((status & ESP_ROM_SPIFLASH_WRENABLE_FLAG) == 0) {
+        if (esp_rom_spiflash_read_status(&g_rom_flashchip, &status) != ESP_ROM_SPIFLASH_RESULT_OK) {
+            return ESP_ROM_SPIFLASH_RESULT_ERR;
+        }
+    }
+
+    WRITE_PERI_REG(PERIPHS_SPI_FLASH_ADDR, addr & 0xffffff);
+    WRITE_PERI_REG(PERIPHS_SPI_FLASH_CMD, block ? SPI_FLASH_BE : SPI_FLASH_SE);
+    while (READ_PERI_REG(PERIPHS_SPI_FLASH_CMD) != 0);
+    return ESP_ROM_SPIFLASH_RESULT_OK;
+}
+
+/* Erase one sector or block, holding the guard for at most CONFIG_SPI_FLASH_ERASE_SUSPEND_SLICE_US
+   at a time. In between, the erase is suspended so the caches can be re-enabled and the other CPU
+   (and tasks on this one) can run from flash.
+
+   Caller holds the flash op lock for the whole erase, so no other flash operation can start
+   while the chip is suspended.
+*/
+static esp_rom_spiflash_result_t IRAM_ATTR spi_flash_erase_suspendable(uint32_t addr, bool block, op_timing_t *timing)
+{
+    const uint32_t cycles_per_us = esp_clk_cpu_freq() / 1000000;
+    const uint32_t slice_cycles = CONFIG_SPI_FLASH_ERASE_SUSPEND_SLICE_US * cycles_per_us;
+    const uint32_t suspend_cycles = ERASE_SUSPEND_TIMEOUT_US * cycles_per_us;
+    esp_rom_spiflash_result_t rc;
+    bool started = false;
+    bool done = false;
+
+    while (!done) {
+        uint32_t ts_begin = xthal_get_ccount();
+        op_guard_start(timing);
+        if (!started) {
+            rc = spi_flash_erase_start(addr, block);
+            if (rc != ESP_ROM_SPIFLASH_RESULT_OK) {
+                op_guard_end(timing);
+                return rc;
+            }
+            started = true;
+        } else {
+            spi_flash_send_cmd(CONFIG_SPI_FLASH_ERASE_RESUME_CMD);
+        }
+
+        done = spi_flash_wait_idle_for(slice_cycles);
+        if (!done) {
+            spi_flash_send_cmd(CONFIG_SPI_FLASH_ERASE_SUSPEND_CMD);
+            if (spi_flash_wait_idle_for(suspend_cycles)) {
+                uint32_t status = 0;
+                esp_rom_spiflash_read_user_cmd(&status, CONFIG_SPI_FLASH_ERASE_SUSPEND_STATUS_CMD);
+                /* if the erase completed before the suspend command arrived, there is nothing to resume */
+                done = (status & FLASH_SUS_FLAG) == 0;
+            } else {
+                /* chip ignored the suspend command, let this erase run to completion */
+                s_erase_suspend_supported = false;
+                esp_rom_spiflash_wait_idle(&g_rom_flashchip);
+                done = true;
+            }
+        }
+        op_guard_end(timing);
+
+        uint32_t blocking_time = (xthal_get_ccount() - ts_begin) / cycles_per_us;
+        if (blocking_time > s_erase_max_blocking_time) {
+            s_erase_max_blocking_time = blocking_time;
+        }
+        if (!done) {
+            /* in single core mode the op lock keeps the scheduler suspended, only interrupts can run */
+            if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+                vTaskDelay(ERASE_SUSPEND_GAP_TICKS);
+            } else {
+                ets_delay_us(CONFIG_SPI_FLASH_ERASE_SUSPEND_GAP_US);
+            }
+        }
+    }
+    return ESP_ROM_SPIFLASH_RESULT_OK;
+}
+
+uint32_t spi_flash_erase_get_max_blocking_time(bool reset)
+{
+    uint32_t result = s_erase_max_blocking_time;
+    if (reset) {
+        s_erase_max_blocking_time = 0;
+    }
+    return result;
+}
+
+#endif // CONFIG_SPI_FLASH_ERASE_SUSPEND
+
 esp_err_t IRAM_ATTR spi_flash_erase_sector(size_t sec)
 {
     CHECK_WRITE_ADDRESS(sec * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE);
@@ -209,9 +460,33 @@ esp_err_t IRAM_ATTR spi_flash_erase_range(uint32_t start_addr, uint32_t size)
     COUNTER_START();
     esp_rom_spiflash_result_t rc;
     rc = spi_flash_unlock();
+#if CONFIG_SPI_FLASH_ERASE_SUSPEND
+    /* Suspending only helps when there is another CPU or task to run in the gaps. Panic handler
+       and startup code use the no_os guard, and keep erasing in one go.
+    */
+    if (rc == ESP_ROM_SPIFLASH_RESULT_OK && s_erase_suspend_supported
+            && s_flash_guard_ops == &g_flash_guard_default_ops
+            && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+        spi_flash_guard_op_lock();
+        for (size_t sector = start; sector != end && rc == ESP_ROM_SPIFLASH_RESULT_OK; ) {
+            if (sector % sectors_per_block == 0 && end - sector > sectors_per_block) {
+                rc = spi_flash_erase_suspendable(sector * SPI_FLASH_SEC_SIZE, true, OP_TIMING);
+                sector += sectors_per_block;
+                COUNTER_ADD_BYTES(erase, sectors_per_block * SPI_FLASH_SEC_SIZE);
+            } else {
+                rc = spi_flash_erase_suspendable(sector * SPI_FLASH_SEC_SIZE, false, OP_TIMING);
+                ++sector;
+                COUNTER_ADD_BYTES(erase, SPI_FLASH_SEC_SIZE);
+            }
+        }
+        spi_flash_guard_op_unlock();
+        COUNTER_STOP(erase, start_addr);
+        return spi_flash_translate_rc(rc);
+    }
+#endif
     if (rc == ESP_ROM_SPIFLASH_RESULT_OK) {
         for (size_t sector = start; sector != end && rc == ESP_ROM_SPIFLASH_RESULT_OK; ) {
-            spi_flash_guard_start();
+            GUARD_START();
             if (sector % sectors_per_block == 0 && end - sector > sectors_per_block) {
                 rc = esp_rom_spiflash_erase_block(sector / sectors_per_block);
                 sector += sectors_per_block;
@@ -221,10 +496,10 @@ esp_err_t IRAM_ATTR spi_flash_erase_range(uint32_t start_addr, uint32_t size)
                 ++sector;
                 COUNTER_ADD_BYTES(erase, SPI_FLASH_SEC_SIZE);
             }
-            spi_flash_guard_end();
+            GUARD_END();
         }
     }
-    COUNTER_STOP(erase);
+    COUNTER_STOP(erase, start_addr);
     return spi_flash_translate_rc(rc);
 }
 
@@ -338,9 +613,9 @@ esp_err_t IRAM_ATTR spi_flash_write(size_t dst, const void *srcv, size_t size)
     if (left_size > 0) {
         uint32_t t = 0xffffffff;
         memcpy(((uint8_t *) &t) + (dst - left_off), srcc, left_size);
-        spi_flash_guard_start();
+        GUARD_START();
         rc = spi_flash_write_inner(left_off, &t, 4);
-        spi_flash_guard_end();
+        GUARD_END();
         if (rc != ESP_ROM_SPIFLASH_RESULT_OK) {
             goto out;
         }
@@ -365,9 +640,9 @@ esp_err_t IRAM_ATTR spi_flash_write(size_t dst, const void *srcv, size_t size)
                 memcpy(write_buf, write_src, write_size);
                 write_src = (const uint8_t *)write_buf;
             }
-            spi_flash_guard_start();
+            GUARD_START();
             rc = spi_flash_write_inner(dst + mid_off, (const uint32_t *) write_src, write_size);
-            spi_flash_guard_end();
+            GUARD_END();
             COUNTER_ADD_BYTES(write, write_size);
             mid_size -= write_size;
             mid_off += write_size;
@@ -380,16 +655,16 @@ esp_err_t IRAM_ATTR spi_flash_write(size_t dst, const void *srcv, size_t size)
     if (right_size > 0) {
         uint32_t t = 0xffffffff;
         memcpy(&t, srcc + right_off, right_size);
-        spi_flash_guard_start();
+        GUARD_START();
         rc = spi_flash_write_inner(dst + right_off, &t, 4);
-        spi_flash_guard_end();
+        GUARD_END();
         if (rc != ESP_ROM_SPIFLASH_RESULT_OK) {
             goto out;
         }
         COUNTER_ADD_BYTES(write, 4);
     }
 out:
-    COUNTER_STOP(write);
+    COUNTER_STOP(write, dst);
 
     spi_flash_guard_op_lock();
     spi_flash_mark_modified_region(dst, size);
@@ -445,9 +720,9 @@ esp_err_t IRAM_ATTR spi_flash_write_encrypted(size_t dest_addr, const void *src,
                 memcpy(encrypt_buf, ssrc + i, 32);
             }
 
-            spi_flash_guard_start();
+            GUARD_START();
             rc = esp_rom_spiflash_write_encrypted(row_addr, (uint32_t *)encrypt_buf, 32);
-            spi_flash_guard_end();
+            GUARD_END();
             if (rc != ESP_ROM_SPIFLASH_RESULT_OK) {
                 break;
             }
@@ -455,7 +730,7 @@ esp_err_t IRAM_ATTR spi_flash_write_encrypted(size_t dest_addr, const void *src,
         bzero(encrypt_buf, sizeof(encrypt_buf));
     }
     COUNTER_ADD_BYTES(write, size);
-    COUNTER_STOP(write);
+    COUNTER_STOP(write, dest_addr);
 
     spi_flash_guard_op_lock();
     spi_flash_mark_modified_region(dest_addr, size);
@@ -477,7 +752,7 @@ esp_err_t IRAM_ATTR spi_flash_read(size_t src, void *dstv, size_t size)
 
     esp_rom_spiflash_result_t rc = ESP_ROM_SPIFLASH_RESULT_OK;
     COUNTER_START();
-    spi_flash_guard_start();
+    GUARD_START();
     /* To simplify boundary checks below, we handle small reads separately. */
     if (size < 16) {
         uint32_t t[6]; /* Enough for 16 bytes + 4 on either side for padding. */
@@ -544,13 +819,13 @@ esp_err_t IRAM_ATTR spi_flash_read(size_t src, void *dstv, size_t size)
             mid_remaining -= read_size;
             mid_read += read_size;
             if (!direct_read) {
-                spi_flash_guard_end();
+                GUARD_END();
                 memcpy(read_dst_final, read_buf, read_size);
-                spi_flash_guard_start();
+                GUARD_START();
             } else if (mid_remaining > 0) {
                 /* Drop guard momentarily, allows other tasks to preempt */
-                spi_flash_guard_end();
-                spi_flash_guard_start();
+                GUARD_END();
+                GUARD_START();
             }
         }
         COUNTER_ADD_BYTES(read, mid_size);
@@ -561,11 +836,11 @@ esp_err_t IRAM_ATTR spi_flash_read(size_t src, void *dstv, size_t size)
          */
         if (src_mid_off != dst_mid_off) {
             if (!direct_read) {
-                spi_flash_guard_end();
+                GUARD_END();
             }
             memmove(dstc + src_mid_off, dstc + dst_mid_off, mid_size);
             if (!direct_read) {
-                spi_flash_guard_start();
+                GUARD_START();
             }
         }
     }
@@ -577,11 +852,11 @@ esp_err_t IRAM_ATTR spi_flash_read(size_t src, void *dstv, size_t size)
         }
         COUNTER_ADD_BYTES(read, 4);
         if (!direct_read) {
-            spi_flash_guard_end();
+            GUARD_END();
         }
         memcpy(dstc, ((uint8_t *) &t) + (4 - pad_left_size), pad_left_size);
         if (!direct_read) {
-            spi_flash_guard_start();
+            GUARD_START();
         }
     }
     if (pad_right_size > 0) {
@@ -593,16 +868,16 @@ esp_err_t IRAM_ATTR spi_flash_read(size_t src, void *dstv, size_t size)
         }
         COUNTER_ADD_BYTES(read, read_size);
         if (!direct_read) {
-            spi_flash_guard_end();
+            GUARD_END();
         }
         memcpy(dstc + pad_right_off, t, pad_right_size);
         if (!direct_read) {
-            spi_flash_guard_start();
+            GUARD_START();
         }
     }
 out:
-    spi_flash_guard_end();
-    COUNTER_STOP(read);
+    GUARD_END();
+    COUNTER_STOP(read, src);
     return spi_flash_translate_rc(rc);
 }
 
@@ -646,10 +921,43 @@ static esp_err_t IRAM_ATTR spi_flash_translate_rc(esp_rom_spiflash_result_t rc)
 
 #if CONFIG_SPI_FLASH_ENABLE_COUNTERS
 
+static const char *const s_client_names[SPI_FLASH_CLIENT_MAX] = {
+    [SPI_FLASH_CLIENT_OTHER]     = "other",
+    [SPI_FLASH_CLIENT_APP]       = "app",
+    [SPI_FLASH_CLIENT_NVS]       = "nvs",
+    [SPI_FLASH_CLIENT_FAT]       = "fat",
+    [SPI_FLASH_CLIENT_SPIFFS]    = "spiffs",
+    [SPI_FLASH_CLIENT_COREDUMP]  = "coredump",
+    [SPI_FLASH_CLIENT_PARTITION] = "partition",
+};
+
 static inline void dump_counter(spi_flash_counter_t *counter, const char *name)
 {
-    ESP_LOGI(TAG, "%s  count=%8d  time=%8dus  bytes=%8d\n", name,
-             counter->count, counter->time, counter->bytes);
+    if (counter->count == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "%s  count=%8d  time=%8dus  bytes=%8d  cache disabled=%8dus  max=%6dus", name,
+             counter->count, counter->time, counter->bytes,
+             counter->cache_disabled_time, counter->cache_disabled_max);
+}
+
+static void dump_latency(spi_flash_counter_t *counter, const char *name)
+{
+    char line[SPI_FLASH_LATENCY_BUCKETS * 20];
+    int len = 0;
+    for (int i = 0; i < SPI_FLASH_LATENCY_BUCKETS; i++) {
+        if (counter->latency[i] == 0) {
+            continue;
+        }
+        if (i < SPI_FLASH_LATENCY_BUCKETS - 1) {
+            len += snprintf(line + len, sizeof(line) - len, " <%dus:%d", SPI_FLASH_LATENCY_BUCKET_LIMIT(i), counter->latency[i]);
+        } else {
+            len += snprintf(line + len, sizeof(line) - len, " >=%dus:%d", SPI_FLASH_LATENCY_BUCKET_LIMIT(i - 1), counter->latency[i]);
+        }
+    }
+    if (len > 0) {
+        ESP_LOGI(TAG, "%s  latency%s", name, line);
+    }
 }
 
 const spi_flash_counters_t *spi_flash_get_counters()
@@ -657,9 +965,45 @@ const spi_flash_counters_t *spi_flash_get_counters()
     return &s_flash_stats;
 }
 
+const spi_flash_counters_t *spi_flash_get_client_counters(spi_flash_client_t client)
+{
+    if (client < 0 || client >= SPI_FLASH_CLIENT_MAX) {
+        return NULL;
+    }
+    return &s_client_stats[client];
+}
+
+esp_err_t spi_flash_counters_set_client_region(size_t start, size_t size, spi_flash_client_t client)
+{
+    if (client < 0 || client >= SPI_FLASH_CLIENT_MAX || size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    spi_flash_guard_op_lock();
+    /* extend the previous region if contiguous, so consecutive partitions of the same kind share a slot */
+    client_region_t *last = (s_client_region_count > 0) ? &s_client_regions[s_client_region_count - 1] : NULL;
+    if (last != NULL && last->client == client && last->end == start) {
+        last->end = start + size;
+    } else if (s_client_region_count < MAX_CLIENT_REGIONS) {
+        s_client_regions[s_client_region_count] = (client_region_t) {
+            .start = start,
+            .end = start + size,
+            .client = client,
+        };
+        s_client_region_count++;
+    } else {
+        err = ESP_ERR_NO_MEM;
+    }
+    spi_flash_guard_op_unlock();
+    return err;
+}
+
 void spi_flash_reset_counters()
 {
+    spi_flash_guard_op_lock();
     memset(&s_flash_stats, 0, sizeof(s_flash_stats));
+    memset(s_client_stats, 0, sizeof(s_client_stats));
+    spi_flash_guard_op_unlock();
 }
 
 void spi_flash_dump_counters()
@@ -667,6 +1011,18 @@ void spi_flash_dump_counters()
     dump_counter(&s_flash_stats.read,  "read ");
     dump_counter(&s_flash_stats.write, "write");
     dump_counter(&s_flash_stats.erase, "erase");
+    dump_latency(&s_flash_stats.read,  "read ");
+    dump_latency(&s_flash_stats.write, "write");
+    dump_latency(&s_flash_stats.erase, "erase");
+    for (int i = 0; i < SPI_FLASH_CLIENT_MAX; i++) {
+        if (s_client_stats[i].read.count + s_client_stats[i].write.count + s_client_stats[i].erase.count == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "client %s:", s_client_names[i]);
+        dump_counter(&s_client_stats[i].read,  "read ");
+        dump_counter(&s_client_stats[i].write, "write");
+        dump_counter(&s_client_stats[i].erase, "erase");
+    }
 }
 
 #endif //CONFIG_SPI_FLASH_ENABLE_COUNTERS
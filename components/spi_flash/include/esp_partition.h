@@ -131,11 +131,26 @@ esp_partition_iterator_t esp_partition_find(esp_partition_type_t type, esp_parti
  * @param label (optional) Partition label. Set this value if looking
  *             for partition with a specific name. Pass NULL otherwise.
  *
+ * This function doesn't allocate memory.
+ *
  * @return pointer to esp_partition_t structure, or NULL if no partition is found.
  *         This pointer is valid for the lifetime of the application.
  */
 const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label);
 
+/**
+ * @brief Find partition by label, regardless of type
+ *
+ * Labels are looked up in a hash table built when the partition table is loaded.
+ * This function doesn't allocate memory.
+ *
+ * @param label Partition label. Must be non-NULL.
+ *
+ * @return pointer to esp_partition_t structure of the first partition with this label,
+ *         or NULL if no partition is found. This pointer is valid for the lifetime of the application.
+ */
+const esp_partition_t* esp_partition_find_by_label(const char* label);
+
 /**
  * @brief Get esp_partition_t structure for given partition
  *
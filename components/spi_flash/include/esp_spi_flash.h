@@ -346,8 +346,35 @@ extern const spi_flash_guard_funcs_t g_flash_guard_default_ops;
  */
 extern const spi_flash_guard_funcs_t g_flash_guard_no_os_ops;
 
+#if CONFIG_SPI_FLASH_ERASE_SUSPEND
+
+/**
+ * @brief  Return the longest time a single erase slice blocked flash cache access
+ *
+ * With CONFIG_SPI_FLASH_ERASE_SUSPEND enabled, erases disable the flash cache
+ * (and stall the other CPU) for one slice at a time. This is the longest such
+ * slice measured since boot or the last reset, including the time taken to
+ * suspend the erase.
+ *
+ * @param reset  If true, reset the stored value after returning it
+ *
+ * @return  time in microseconds
+ */
+uint32_t spi_flash_erase_get_max_blocking_time(bool reset);
+
+#endif //CONFIG_SPI_FLASH_ERASE_SUSPEND
+
 #if CONFIG_SPI_FLASH_ENABLE_COUNTERS
 
+/** Number of buckets in the latency histogram of each operation type */
+#define SPI_FLASH_LATENCY_BUCKETS 16
+
+/**
+ * Upper bound (exclusive), in microseconds, of latency histogram bucket i.
+ * The last bucket counts all operations slower than the bucket before it.
+ */
+#define SPI_FLASH_LATENCY_BUCKET_LIMIT(i) (16 << (i))
+
 /**
  * Structure holding statistics for one type of operation
  */
@@ -355,6 +382,9 @@ typedef struct {
     uint32_t count;     // number of times operation was executed
     uint32_t time;      // total time taken, in microseconds
     uint32_t bytes;     // total number of bytes
+    uint32_t cache_disabled_time;   // total time flash cache was disabled for, in microseconds
+    uint32_t cache_disabled_max;    // longest single period flash cache was disabled for, in microseconds
+    uint32_t latency[SPI_FLASH_LATENCY_BUCKETS];    // histogram of time taken, see SPI_FLASH_LATENCY_BUCKET_LIMIT
 } spi_flash_counter_t;
 
 typedef struct {
@@ -363,6 +393,22 @@ typedef struct {
     spi_flash_counter_t erase;
 } spi_flash_counters_t;
 
+/**
+ * Kind of flash region an operation was made on. Operations are attributed
+ * by their start address, regions are registered automatically for each partition
+ * when the partition table is loaded.
+ */
+typedef enum {
+    SPI_FLASH_CLIENT_OTHER = 0,     //!< Outside any known region
+    SPI_FLASH_CLIENT_APP,           //!< App partitions (OTA updates)
+    SPI_FLASH_CLIENT_NVS,           //!< NVS partitions
+    SPI_FLASH_CLIENT_FAT,           //!< FAT (wear levelling) partitions
+    SPI_FLASH_CLIENT_SPIFFS,        //!< SPIFFS partitions
+    SPI_FLASH_CLIENT_COREDUMP,      //!< Core dump partition
+    SPI_FLASH_CLIENT_PARTITION,     //!< Any other partition
+    SPI_FLASH_CLIENT_MAX,
+} spi_flash_client_t;
+
 /**
  * @brief  Reset SPI flash operation counters
  */
@@ -381,6 +427,32 @@ void spi_flash_dump_counters();
  */
 const spi_flash_counters_t* spi_flash_get_counters();
 
+/**
+ * @brief  Return SPI flash operation counters for one client
+ *
+ * @param  client  kind of flash region
+ *
+ * @return  pointer to the spi_flash_counters_t structure holding values
+ *          of the operation counters, or NULL if client is out of range
+ */
+const spi_flash_counters_t* spi_flash_get_client_counters(spi_flash_client_t client);
+
+/**
+ * @brief  Attribute operations on a region of flash to a client
+ *
+ * Partitions are registered when the partition table is loaded. This function
+ * can be used to attribute other regions, earlier registrations take precedence
+ * for overlapping regions.
+ *
+ * @param  start   flash address of the region
+ * @param  size    size of the region, in bytes
+ * @param  client  client operations in this region are attributed to
+ *
+ * @return  ESP_OK on success, ESP_ERR_INVALID_ARG if client or size is invalid,
+ *          ESP_ERR_NO_MEM if too many regions have been registered
+ */
+esp_err_t spi_flash_counters_set_client_region(size_t start, size_t size, spi_flash_client_t client);
+
 #endif //CONFIG_SPI_FLASH_ENABLE_COUNTERS
 
 #ifdef __cplusplus
@@ -23,122 +23,239 @@
 #include "esp_spi_flash.h"
 #include "esp_partition.h"
 #include "esp_flash_encrypt.h"
+#include "esp_flash_partitions.h"
 #include "esp_log.h"
 
 
-#ifndef NDEBUG
-// Enable built-in checks in queue.h in debug builds
-#define INVARIANTS
-#endif
-#include "rom/queue.h"
-
+/* Matches partitions of any type, only used internally for lookups by label (0xff is not a valid type) */
+#define PARTITION_TYPE_ANY ((esp_partition_type_t) 0xff)
 
-typedef struct partition_list_item_ {
+/* Partition table entry, with the label hash used for lookups by label */
+typedef struct {
     esp_partition_t info;
-    SLIST_ENTRY(partition_list_item_) next;
-} partition_list_item_t;
+    uint32_t label_hash;
+} partition_entry_t;
 
 typedef struct esp_partition_iterator_opaque_ {
     esp_partition_type_t type;                  // requested type
-    esp_partition_subtype_t subtype;               // requested subtype
+    esp_partition_subtype_t subtype;            // requested subtype
     const char* label;                          // requested label (can be NULL)
-    partition_list_item_t* next_item;     // next item to iterate to
-    esp_partition_t* info;                // pointer to info (it is redundant, but makes code more readable)
+    uint32_t label_hash;                        // hash of label, if not NULL
+    bool by_type;                               // iterating s_by_type (true) or the table in order (false)
+    size_t next_pos;                            // next position to look at
+    esp_partition_t* info;                      // pointer to info of the current match
 } esp_partition_iterator_opaque_t;
 
 
-static esp_partition_iterator_opaque_t* iterator_create(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label);
 static esp_err_t load_partitions();
+static void iterator_init(esp_partition_iterator_opaque_t* it, esp_partition_type_t type,
+        esp_partition_subtype_t subtype, const char* label);
+static bool iterator_advance(esp_partition_iterator_opaque_t* it);
 
 
-static SLIST_HEAD(partition_list_head_, partition_list_item_) s_partition_list =
-        SLIST_HEAD_INITIALIZER(s_partition_list);
+/* The partition index is built once, the first time it is needed, and not modified afterwards.
+   Lookups don't take the lock or allocate memory once s_partitions_loaded is set. The flag is
+   stored with release and read with acquire ordering, so a CPU which sees it set also sees the index.
+*/
+static partition_entry_t* s_partitions;        // in partition table order
+static size_t s_partition_count;
+static uint8_t* s_by_type;                      // indices into s_partitions sorted by type, subtype, table order
+static uint8_t* s_by_label;                     // open addressing hash table of (index + 1), 0 is an empty slot
+static size_t s_by_label_size;                  // power of 2
+static bool s_partitions_loaded;
 static _lock_t s_partition_list_lock;
 
 
-esp_partition_iterator_t esp_partition_find(esp_partition_type_t type,
-        esp_partition_subtype_t subtype, const char* label)
+static bool ensure_partitions_loaded()
 {
-    if (SLIST_EMPTY(&s_partition_list)) {
-        // only lock if list is empty (and check again after acquiring lock)
+    if (!__atomic_load_n(&s_partitions_loaded, __ATOMIC_ACQUIRE)) {
         _lock_acquire(&s_partition_list_lock);
         esp_err_t err = ESP_OK;
-        if (SLIST_EMPTY(&s_partition_list)) {
+        if (!__atomic_load_n(&s_partitions_loaded, __ATOMIC_RELAXED)) {
             err = load_partitions();
         }
         _lock_release(&s_partition_list_lock);
         if (err != ESP_OK) {
-            return NULL;
+            return false;
         }
     }
-    // create an iterator pointing to the start of the list
-    // (next item will be the first one)
-    esp_partition_iterator_t it = iterator_create(type, subtype, label);
-    // advance iterator to the next item which matches constraints
-    it = esp_partition_next(it);
-    // if nothing found, it == NULL and iterator has been released
-    return it;
+    return true;
 }
 
-esp_partition_iterator_t esp_partition_next(esp_partition_iterator_t it)
+esp_partition_iterator_t esp_partition_find(esp_partition_type_t type,
+        esp_partition_subtype_t subtype, const char* label)
 {
-    assert(it);
-    // iterator reached the end of linked list?
-    if (it->next_item == NULL) {
-        esp_partition_iterator_release(it);
+    if (!ensure_partitions_loaded()) {
         return NULL;
     }
-    _lock_acquire(&s_partition_list_lock);
-    for (; it->next_item != NULL; it->next_item = SLIST_NEXT(it->next_item, next)) {
-        esp_partition_t* p = &it->next_item->info;
-        if (it->type != p->type) {
-            continue;
-        }
-        if (it->subtype != 0xff && it->subtype != p->subtype) {
-            continue;
-        }
-        if (it->label != NULL && strcmp(it->label, p->label) != 0) {
-            continue;
-        }
-        // all constraints match, bail out
-        break;
+    esp_partition_iterator_opaque_t it;
+    iterator_init(&it, type, subtype, label);
+    if (!iterator_advance(&it)) {
+        return NULL;
     }
-    _lock_release(&s_partition_list_lock);
-    if (it->next_item == NULL) {
+    esp_partition_iterator_opaque_t* res =
+            (esp_partition_iterator_opaque_t*) malloc(sizeof(esp_partition_iterator_opaque_t));
+    if (res == NULL) {
+        return NULL;
+    }
+    *res = it;
+    return res;
+}
+
+esp_partition_iterator_t esp_partition_next(esp_partition_iterator_t it)
+{
+    assert(it);
+    if (!iterator_advance(it)) {
         esp_partition_iterator_release(it);
         return NULL;
     }
-    it->info = &it->next_item->info;
-    it->next_item = SLIST_NEXT(it->next_item, next);
     return it;
 }
 
 const esp_partition_t* esp_partition_find_first(esp_partition_type_t type,
         esp_partition_subtype_t subtype, const char* label)
 {
-    esp_partition_iterator_t it = esp_partition_find(type, subtype, label);
-    if (it == NULL) {
+    if (!ensure_partitions_loaded()) {
         return NULL;
     }
-    const esp_partition_t* res = esp_partition_get(it);
-    esp_partition_iterator_release(it);
-    return res;
+    esp_partition_iterator_opaque_t it;
+    iterator_init(&it, type, subtype, label);
+    return iterator_advance(&it) ? it.info : NULL;
+}
+
+const esp_partition_t* esp_partition_find_by_label(const char* label)
+{
+    assert(label != NULL);
+    if (!ensure_partitions_loaded()) {
+        return NULL;
+    }
+    esp_partition_iterator_opaque_t it;
+    iterator_init(&it, PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, label);
+    return iterator_advance(&it) ? it.info : NULL;
+}
+
+// FNV-1a
+static uint32_t label_hash(const char* label)
+{
+    uint32_t hash = 2166136261u;
+    for (; *label != 0; label++) {
+        hash = (hash ^ (uint8_t) *label) * 16777619u;
+    }
+    return hash;
+}
+
+// Index of the first partition (in table order) with this label, or s_partition_count if there is none
+static size_t find_label(const char* label, uint32_t hash)
+{
+    for (size_t slot = hash & (s_by_label_size - 1); s_by_label[slot] != 0; slot = (slot + 1) & (s_by_label_size - 1)) {
+        const partition_entry_t* p = &s_partitions[s_by_label[slot] - 1];
+        if (p->label_hash == hash && strcmp(p->info.label, label) == 0) {
+            return s_by_label[slot] - 1;
+        }
+    }
+    return s_partition_count;
+}
+
+static int compare_type(const partition_entry_t* p, esp_partition_type_t type, esp_partition_subtype_t subtype)
+{
+    if (p->info.type != type) {
+        return (p->info.type < type) ? -1 : 1;
+    }
+    if (p->info.subtype != subtype) {
+        return (p->info.subtype < subtype) ? -1 : 1;
+    }
+    return 0;
 }
 
-static esp_partition_iterator_opaque_t* iterator_create(esp_partition_type_t type,
+// Position in s_by_type of the first partition with this type and subtype (or where it would be)
+static size_t lower_bound_type(esp_partition_type_t type, esp_partition_subtype_t subtype)
+{
+    size_t lo = 0;
+    size_t hi = s_partition_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (compare_type(&s_partitions[s_by_type[mid]], type, subtype) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void iterator_init(esp_partition_iterator_opaque_t* it, esp_partition_type_t type,
         esp_partition_subtype_t subtype, const char* label)
 {
-    esp_partition_iterator_opaque_t* it =
-            (esp_partition_iterator_opaque_t*) malloc(sizeof(esp_partition_iterator_opaque_t));
     it->type = type;
     it->subtype = subtype;
     it->label = label;
-    it->next_item = SLIST_FIRST(&s_partition_list);
     it->info = NULL;
-    return it;
+    if (label != NULL) {
+        // labels are close to unique, start from the first partition with this label
+        it->label_hash = label_hash(label);
+        it->by_type = false;
+        it->next_pos = find_label(label, it->label_hash);
+    } else if (subtype != ESP_PARTITION_SUBTYPE_ANY && type != PARTITION_TYPE_ANY) {
+        it->by_type = true;
+        it->next_pos = lower_bound_type(type, subtype);
+    } else {
+        it->by_type = false;
+        it->next_pos = 0;
+    }
 }
 
-// Create linked list of partition_list_item_t structures.
+// Move to the next partition matching the iterator, returns false if there are no more
+static bool iterator_advance(esp_partition_iterator_opaque_t* it)
+{
+    for (; it->next_pos < s_partition_count; it->next_pos++) {
+        partition_entry_t* p = &s_partitions[it->by_type ? s_by_type[it->next_pos] : it->next_pos];
+        if (it->by_type && compare_type(p, it->type, it->subtype) != 0) {
+            // past the range of this type and subtype
+            it->next_pos = s_partition_count;
+            break;
+        }
+        if (it->type != PARTITION_TYPE_ANY && it->type != p->info.type) {
+            continue;
+        }
+        if (it->subtype != ESP_PARTITION_SUBTYPE_ANY && it->subtype != p->info.subtype) {
+            continue;
+        }
+        if (it->label != NULL && (it->label_hash != p->label_hash || strcmp(it->label, p->info.label) != 0)) {
+            continue;
+        }
+        // all constraints match
+        it->info = &p->info;
+        it->next_pos++;
+        return true;
+    }
+    return false;
+}
+
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+static spi_flash_client_t counters_client(const esp_partition_t* p)
+{
+    if (p->type == ESP_PARTITION_TYPE_APP) {
+        return SPI_FLASH_CLIENT_APP;
+    }
+    if (p->type != ESP_PARTITION_TYPE_DATA) {
+        return SPI_FLASH_CLIENT_PARTITION;
+    }
+    switch (p->subtype) {
+    case ESP_PARTITION_SUBTYPE_DATA_NVS:
+        return SPI_FLASH_CLIENT_NVS;
+    case ESP_PARTITION_SUBTYPE_DATA_FAT:
+        return SPI_FLASH_CLIENT_FAT;
+    case ESP_PARTITION_SUBTYPE_DATA_SPIFFS:
+        return SPI_FLASH_CLIENT_SPIFFS;
+    case ESP_PARTITION_SUBTYPE_DATA_COREDUMP:
+        return SPI_FLASH_CLIENT_COREDUMP;
+    default:
+        return SPI_FLASH_CLIENT_PARTITION;
+    }
+}
+#endif
+
+// Build the partition index from the partition table in flash.
 // This function is called only once, with s_partition_list_lock taken.
 static esp_err_t load_partitions()
 {
@@ -151,42 +268,74 @@ static esp_err_t load_partitions()
         return err;
     }
     // calculate partition address within mmap-ed region
-    const esp_partition_info_t* it = (const esp_partition_info_t*)
+    const esp_partition_info_t* table = (const esp_partition_info_t*)
             (ptr + (ESP_PARTITION_TABLE_ADDR & 0xffff) / sizeof(*ptr));
-    const esp_partition_info_t* end = it + SPI_FLASH_SEC_SIZE / sizeof(*it);
-    // tail of the linked list of partitions
-    partition_list_item_t* last = NULL;
-    for (; it != end; ++it) {
-        if (it->magic != ESP_PARTITION_MAGIC) {
-            break;
-        }
-        // allocate new linked list item and populate it with data from partition table
-        partition_list_item_t* item = (partition_list_item_t*) malloc(sizeof(partition_list_item_t));
-        item->info.address = it->pos.offset;
-        item->info.size = it->pos.size;
-        item->info.type = it->type;
-        item->info.subtype = it->subtype;
-        item->info.encrypted = it->flags & PART_FLAG_ENCRYPTED;
+    size_t count = 0;
+    while (count < ESP_PARTITION_TABLE_MAX_ENTRIES && table[count].magic == ESP_PARTITION_MAGIC) {
+        ++count;
+    }
+
+    // allocate the entries and both indices in one block, it is never freed
+    size_t label_size = 4;
+    while (label_size < count * 2) {
+        label_size *= 2;
+    }
+    uint8_t* block = calloc(1, count * sizeof(partition_entry_t) + count + label_size);
+    if (block == NULL) {
+        spi_flash_munmap(handle);
+        return ESP_ERR_NO_MEM;
+    }
+    partition_entry_t* entries = (partition_entry_t*) block;
+    uint8_t* by_type = block + count * sizeof(partition_entry_t);
+    uint8_t* by_label = by_type + count;
+
+    for (size_t i = 0; i < count; ++i) {
+        const esp_partition_info_t* it = &table[i];
+        esp_partition_t* info = &entries[i].info;
+        info->address = it->pos.offset;
+        info->size = it->pos.size;
+        info->type = it->type;
+        info->subtype = it->subtype;
+        info->encrypted = it->flags & PART_FLAG_ENCRYPTED;
         if (esp_flash_encryption_enabled() && (
                 it->type == PART_TYPE_APP
                 || (it->type == PART_TYPE_DATA && it->subtype == PART_SUBTYPE_DATA_OTA))) {
             /* If encryption is turned on, all app partitions and OTA data
                are always encrypted */
-            item->info.encrypted = true;
+            info->encrypted = true;
         }
 
         // it->label may not be zero-terminated
-        strncpy(item->info.label, (const char*) it->label, sizeof(it->label));
-        item->info.label[sizeof(it->label)] = 0;
-        // add it to the list
-        if (last == NULL) {
-            SLIST_INSERT_HEAD(&s_partition_list, item, next);
-        } else {
-            SLIST_INSERT_AFTER(last, item, next);
+        memcpy(info->label, it->label, sizeof(it->label));
+        info->label[sizeof(it->label)] = 0;
+        entries[i].label_hash = label_hash(info->label);
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+        spi_flash_counters_set_client_region(info->address, info->size, counters_client(info));
+#endif
+
+        // insertion sort by type and subtype, stable so equal entries stay in table order
+        size_t pos = i;
+        while (pos > 0 && compare_type(&entries[by_type[pos - 1]], info->type, info->subtype) > 0) {
+            by_type[pos] = by_type[pos - 1];
+            --pos;
         }
-        last = item;
+        by_type[pos] = i;
+
+        // entries are inserted in table order, so a lookup finds the first partition with a label
+        size_t slot = entries[i].label_hash & (label_size - 1);
+        while (by_label[slot] != 0) {
+            slot = (slot + 1) & (label_size - 1);
+        }
+        by_label[slot] = i + 1;
     }
     spi_flash_munmap(handle);
+
+    s_partitions = entries;
+    s_partition_count = count;
+    s_by_type = by_type;
+    s_by_label = by_label;
+    s_by_label_size = label_size;
+    __atomic_store_n(&s_partitions_loaded, true, __ATOMIC_RELEASE);
     return ESP_OK;
 }
 
@@ -205,22 +354,21 @@ const esp_partition_t* esp_partition_get(esp_partition_iterator_t iterator)
 const esp_partition_t *esp_partition_verify(const esp_partition_t *partition)
 {
     assert(partition != NULL);
+    if (!ensure_partitions_loaded()) {
+        return NULL;
+    }
     const char *label = (strlen(partition->label) > 0) ? partition->label : NULL;
-    esp_partition_iterator_t it = esp_partition_find(partition->type,
-                                                     partition->subtype,
-                                                     label);
-    while (it != NULL) {
-        const esp_partition_t *p = esp_partition_get(it);
+    esp_partition_iterator_opaque_t it;
+    iterator_init(&it, partition->type, partition->subtype, label);
+    while (iterator_advance(&it)) {
+        const esp_partition_t *p = it.info;
         /* Can't memcmp() whole structure here as padding contents may be different */
         if (p->address == partition->address
             && partition->size == p->size
             && partition->encrypted == p->encrypted) {
-            esp_partition_iterator_release(it);
             return p;
         }
-        it = esp_partition_next(it);
     }
-    esp_partition_iterator_release(it);
     return NULL;
 }
 
@@ -24,6 +24,7 @@
 #include <test_utils.h>
 #include <esp_partition.h>
 #include <esp_attr.h>
+#include "esp_heap_caps.h"
 
 TEST_CASE("Test erase partition", "[spi_flash]")
 {
@@ -66,3 +67,65 @@ TEST_CASE("Test erase partition", "[spi_flash]")
         }
     }
 }
+
+#if CONFIG_SPI_FLASH_ENABLE_COUNTERS
+TEST_CASE("Operation counters are attributed to partition clients", "[spi_flash]")
+{
+    const esp_partition_t *part = get_test_data_partition();
+    TEST_ASSERT_EQUAL(ESP_PARTITION_SUBTYPE_DATA_FAT, part->subtype);
+    char buf[64] = { 0 };
+
+    spi_flash_reset_counters();
+    ESP_ERROR_CHECK( esp_partition_erase_range(part, 0, SPI_FLASH_SEC_SIZE) );
+    ESP_ERROR_CHECK( esp_partition_write(part, 0, buf, sizeof(buf)) );
+    ESP_ERROR_CHECK( esp_partition_read(part, 0, buf, sizeof(buf)) );
+    spi_flash_dump_counters();
+
+    const spi_flash_counters_t *total = spi_flash_get_counters();
+    const spi_flash_counters_t *fat = spi_flash_get_client_counters(SPI_FLASH_CLIENT_FAT);
+    TEST_ASSERT_NOT_NULL(fat);
+    TEST_ASSERT_NULL(spi_flash_get_client_counters(SPI_FLASH_CLIENT_MAX));
+
+    TEST_ASSERT_EQUAL(1, fat->erase.count);
+    TEST_ASSERT_EQUAL(SPI_FLASH_SEC_SIZE, fat->erase.bytes);
+    TEST_ASSERT_EQUAL(1, fat->write.count);
+    TEST_ASSERT_EQUAL(sizeof(buf), fat->write.bytes);
+    TEST_ASSERT_EQUAL(1, fat->read.count);
+    TEST_ASSERT_EQUAL(total->erase.count, fat->erase.count);
+
+    /* an erase can't complete faster than the time caches were disabled for it */
+    TEST_ASSERT(fat->erase.cache_disabled_max > 0);
+    TEST_ASSERT(fat->erase.cache_disabled_max <= fat->erase.cache_disabled_time);
+    TEST_ASSERT(fat->erase.cache_disabled_time <= fat->erase.time);
+
+    uint32_t histogram_total = 0;
+    for (int i = 0; i < SPI_FLASH_LATENCY_BUCKETS; i++) {
+        histogram_total += total->erase.latency[i];
+    }
+    TEST_ASSERT_EQUAL(total->erase.count, histogram_total);
+}
+#endif
+
+TEST_CASE("Partition lookups by label and type agree with iteration", "[spi_flash]")
+{
+    esp_partition_iterator_t it = esp_partition_find(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, NULL);
+    TEST_ASSERT_NOT_NULL(it);
+    for (; it != NULL; it = esp_partition_next(it)) {
+        const esp_partition_t *p = esp_partition_get(it);
+        TEST_ASSERT_EQUAL_PTR(p, esp_partition_find_by_label(p->label));
+        TEST_ASSERT_EQUAL_PTR(p, esp_partition_find_first(p->type, p->subtype, p->label));
+        TEST_ASSERT_EQUAL_PTR(p, esp_partition_verify(p));
+    }
+    TEST_ASSERT_NULL(esp_partition_find_by_label("no such label"));
+    TEST_ASSERT_NULL(esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_NVS, "no such label"));
+
+    const esp_partition_t *test_part = get_test_data_partition();
+    TEST_ASSERT_EQUAL_PTR(test_part, esp_partition_find_by_label("flash_test"));
+
+    /* find_first doesn't allocate */
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    for (int i = 0; i < 100; i++) {
+        esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, NULL);
+    }
+    TEST_ASSERT_EQUAL(free_before, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+}
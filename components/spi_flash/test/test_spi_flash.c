@@ -8,6 +8,8 @@
 #include <esp_attr.h>
 #include "driver/timer.h"
 #include "esp_intr_alloc.h"
+#include "esp_timer.h"
+#include "test_utils.h"
 
 struct flash_test_ctx {
     uint32_t offset;
@@ -167,3 +169,68 @@ TEST_CASE("spi flash functions can run along with IRAM interrupts", "[spi_flash]
     free(read_arg.buf);
 }
 
+
+#if defined(CONFIG_SPI_FLASH_ERASE_SUSPEND) && !defined(CONFIG_FREERTOS_UNICORE)
+
+typedef struct {
+    volatile bool stop;
+    int64_t max_gap;
+    SemaphoreHandle_t done;
+} cache_gap_task_arg_t;
+
+/* Runs from flash, so measures how long the cache was unavailable on this CPU */
+static void cache_gap_task(void *varg)
+{
+    cache_gap_task_arg_t *arg = (cache_gap_task_arg_t *) varg;
+    int64_t last = esp_timer_get_time();
+    while (!arg->stop) {
+        int64_t now = esp_timer_get_time();
+        if (now - last > arg->max_gap) {
+            arg->max_gap = now - last;
+        }
+        last = now;
+    }
+    xSemaphoreGive(arg->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("suspended erase bounds time other CPU is blocked", "[spi_flash]")
+{
+    const esp_partition_t *part = get_test_data_partition();
+    const uint32_t block_size = 65536;
+    uint32_t start = (part->address + block_size - 1) & ~(block_size - 1);
+    /* one block erase, plus one sector erase */
+    const uint32_t size = block_size + SPI_FLASH_SEC_SIZE;
+    TEST_ASSERT(start + size <= part->address + part->size);
+
+    uint32_t val = 0x5a5aa5a5;
+    TEST_ESP_OK(spi_flash_write(start + block_size / 2, &val, sizeof(val)));
+
+    cache_gap_task_arg_t arg = {
+        .done = xSemaphoreCreateBinary()
+    };
+    xTaskCreatePinnedToCore(cache_gap_task, "gap", 2048, &arg, UNITY_FREERTOS_PRIORITY + 1, NULL, !xPortGetCoreID());
+    vTaskDelay(2);
+
+    spi_flash_erase_get_max_blocking_time(true);
+    int64_t t_start = esp_timer_get_time();
+    TEST_ESP_OK(spi_flash_erase_range(start, size));
+    int64_t t_erase = esp_timer_get_time() - t_start;
+
+    arg.stop = true;
+    xSemaphoreTake(arg.done, portMAX_DELAY);
+    vSemaphoreDelete(arg.done);
+
+    uint32_t max_blocking = spi_flash_erase_get_max_blocking_time(false);
+    printf("erase took %d us, max blocking time %d us, max gap on other CPU %d us\n",
+           (int) t_erase, max_blocking, (int) arg.max_gap);
+
+    TEST_ESP_OK(spi_flash_read(start + block_size / 2, &val, sizeof(val)));
+    TEST_ASSERT_EQUAL_HEX32(0xffffffff, val);
+
+    /* a block erase takes 150ms or more, slices should be several times shorter */
+    TEST_ASSERT_LESS_THAN(CONFIG_SPI_FLASH_ERASE_SUSPEND_SLICE_US + 2000, max_blocking);
+    TEST_ASSERT_LESS_THAN(CONFIG_SPI_FLASH_ERASE_SUSPEND_SLICE_US + 2000, arg.max_gap);
+}
+
+#endif // CONFIG_SPI_FLASH_ERASE_SUSPEND && !CONFIG_FREERTOS_UNICORE
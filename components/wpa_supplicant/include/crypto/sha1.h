@@ -30,4 +30,7 @@ int sha1_t_prf(const u8 *key, size_t key_len, const char *label,
 //			 u8 *out, size_t outlen);
 int pbkdf2_sha1(const char *passphrase, const char *ssid, size_t ssid_len,
 		int iterations, u8 *buf, size_t buflen);
+int fast_pbkdf2_sha1_f(const uint8_t *k_ipad, const uint8_t *k_opad,
+		       const uint8_t *ssid, size_t ssid_len, int iterations,
+		       unsigned int count, uint8_t *digest);
 #endif /* SHA1_H */
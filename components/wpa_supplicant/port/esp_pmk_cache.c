@@ -0,0 +1,234 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_ESP32_WIFI_PMK_CACHE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/lock.h>
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/crypto.h"
+#include "esp_pmk_cache.h"
+
+#if defined(CONFIG_ESP32_WIFI_PMK_CACHE_RTC)
+#include "esp_attr.h"
+#elif defined(CONFIG_ESP32_WIFI_PMK_CACHE_NVS)
+#include "nvs.h"
+#endif
+
+#define PMK_CACHE_ENTRIES CONFIG_ESP32_WIFI_PMK_CACHE_ENTRIES
+
+typedef struct {
+    uint8_t id[16];                     /* truncated SHA-256 of the derivation parameters */
+    uint32_t last_used;                 /* LRU sequence number, 0 if the slot is empty */
+    uint8_t len;
+    uint8_t key[ESP_PMK_CACHE_KEY_MAX];
+} pmk_slot_t;
+
+typedef struct {
+    uint32_t sequence;
+    esp_pmk_cache_stats_t stats;
+    pmk_slot_t slots[PMK_CACHE_ENTRIES];
+} pmk_store_t;
+
+/* With RTC storage the whole store (including the counters) is kept
+   over deep sleep, and is zeroed on power-on reset */
+#if defined(CONFIG_ESP32_WIFI_PMK_CACHE_RTC)
+static RTC_DATA_ATTR pmk_store_t s_store;
+#else
+static pmk_store_t s_store;
+#endif
+
+#if defined(CONFIG_ESP32_WIFI_PMK_CACHE_NVS)
+static const char *NVS_NAMESPACE = "wifi_pmk";
+static nvs_handle s_nvs;
+static bool s_nvs_open;
+#endif
+
+static _lock_t s_lock;
+
+/* Implementation that should never be optimized out by the compiler */
+static void pmk_zeroize(void *v, size_t n)
+{
+    volatile uint8_t *p = v;
+    while (n--) {
+        *p++ = 0;
+    }
+}
+
+static void slot_id(const char *passphrase, const uint8_t *ssid, size_t ssid_len,
+                    int iterations, size_t buflen, uint8_t id[16])
+{
+    uint8_t params[9], digest[32];
+    const uint8_t *addr[3] = { params, ssid, (const uint8_t *)passphrase };
+    size_t len[3] = { sizeof(params), ssid_len, strlen(passphrase) };
+
+    WPA_PUT_BE32(params, iterations);
+    WPA_PUT_BE32(params + 4, buflen);
+    params[8] = ssid_len;
+    sha256_vector(3, addr, len, digest);
+    memcpy(id, digest, 16);
+}
+
+#if defined(CONFIG_ESP32_WIFI_PMK_CACHE_NVS)
+/* Without NVS (nvs_flash_init() not called), the cache works from RAM */
+static void nvs_load(void)
+{
+    if (s_nvs_open || nvs_open(NVS_NAMESPACE, NVS_READWRITE, &s_nvs) != ESP_OK) {
+        return;
+    }
+    s_nvs_open = true;
+
+    for (int i = 0; i < PMK_CACHE_ENTRIES; i++) {
+        char key[8];
+        size_t len = sizeof(pmk_slot_t);
+        snprintf(key, sizeof(key), "pmk%d", i);
+        /* a blob of another size was written by a build with other settings */
+        if (nvs_get_blob(s_nvs, key, &s_store.slots[i], &len) != ESP_OK || len != sizeof(pmk_slot_t)) {
+            memset(&s_store.slots[i], 0, sizeof(pmk_slot_t));
+        }
+        if (s_store.slots[i].last_used > s_store.sequence) {
+            s_store.sequence = s_store.slots[i].last_used;
+        }
+    }
+}
+#endif
+
+/* Write the slot through to the backing storage, if there is one */
+static void slot_persist(int index)
+{
+#if defined(CONFIG_ESP32_WIFI_PMK_CACHE_NVS)
+    char key[8];
+    if (!s_nvs_open) {
+        return;
+    }
+    snprintf(key, sizeof(key), "pmk%d", index);
+    if (s_store.slots[index].last_used == 0) {
+        nvs_erase_key(s_nvs, key);
+    } else {
+        nvs_set_blob(s_nvs, key, &s_store.slots[index], sizeof(pmk_slot_t));
+    }
+    nvs_commit(s_nvs);
+#endif
+}
+
+static int slot_find(const uint8_t id[16])
+{
+    for (int i = 0; i < PMK_CACHE_ENTRIES; i++) {
+        if (s_store.slots[i].last_used != 0 && memcmp(s_store.slots[i].id, id, 16) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int esp_pmk_cache_get(const char *passphrase, const uint8_t *ssid, size_t ssid_len,
+                      int iterations, uint8_t *buf, size_t buflen)
+{
+    uint8_t id[16];
+    int ret = -1;
+
+    if (buflen > ESP_PMK_CACHE_KEY_MAX || ssid_len > 255) {
+        return -1;
+    }
+    slot_id(passphrase, ssid, ssid_len, iterations, buflen, id);
+
+    _lock_acquire(&s_lock);
+#if defined(CONFIG_ESP32_WIFI_PMK_CACHE_NVS)
+    nvs_load();
+#endif
+    s_store.stats.lookups++;
+    int index = slot_find(id);
+    if (index >= 0 && s_store.slots[index].len == buflen) {
+        memcpy(buf, s_store.slots[index].key, buflen);
+        /* not written through to NVS, it's saved with the next key */
+        s_store.slots[index].last_used = ++s_store.sequence;
+        s_store.stats.hits++;
+        ret = 0;
+    }
+    _lock_release(&s_lock);
+    return ret;
+}
+
+void esp_pmk_cache_put(const char *passphrase, const uint8_t *ssid, size_t ssid_len,
+                       int iterations, const uint8_t *buf, size_t buflen)
+{
+    uint8_t id[16];
+
+    if (buflen > ESP_PMK_CACHE_KEY_MAX || ssid_len > 255) {
+        return;
+    }
+    slot_id(passphrase, ssid, ssid_len, iterations, buflen, id);
+
+    _lock_acquire(&s_lock);
+#if defined(CONFIG_ESP32_WIFI_PMK_CACHE_NVS)
+    nvs_load();
+#endif
+    int index = slot_find(id);
+    if (index < 0) {
+        /* an empty slot, or the least recently used one */
+        index = 0;
+        for (int i = 1; i < PMK_CACHE_ENTRIES && s_store.slots[index].last_used != 0; i++) {
+            if (s_store.slots[i].last_used < s_store.slots[index].last_used) {
+                index = i;
+            }
+        }
+        if (s_store.slots[index].last_used != 0) {
+            s_store.stats.evictions++;
+        }
+    }
+    pmk_slot_t *slot = &s_store.slots[index];
+    memcpy(slot->id, id, sizeof(slot->id));
+    memcpy(slot->key, buf, buflen);
+    slot->len = buflen;
+    slot->last_used = ++s_store.sequence;
+    slot_persist(index);
+    _lock_release(&s_lock);
+}
+
+void esp_pmk_cache_clear(void)
+{
+    _lock_acquire(&s_lock);
+#if defined(CONFIG_ESP32_WIFI_PMK_CACHE_NVS)
+    nvs_load();
+#endif
+    for (int i = 0; i < PMK_CACHE_ENTRIES; i++) {
+        if (s_store.slots[i].last_used != 0) {
+            pmk_zeroize(&s_store.slots[i], sizeof(pmk_slot_t));
+            slot_persist(i);
+        }
+    }
+    _lock_release(&s_lock);
+}
+
+void esp_pmk_cache_get_stats(esp_pmk_cache_stats_t *stats)
+{
+    _lock_acquire(&s_lock);
+    *stats = s_store.stats;
+    _lock_release(&s_lock);
+}
+
+void esp_pmk_cache_reset_stats(void)
+{
+    _lock_acquire(&s_lock);
+    memset(&s_store.stats, 0, sizeof(s_store.stats));
+    _lock_release(&s_lock);
+}
+
+#endif /* CONFIG_ESP32_WIFI_PMK_CACHE */
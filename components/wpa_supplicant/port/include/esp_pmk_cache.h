@@ -0,0 +1,88 @@
+// Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef _ESP_PMK_CACHE_H_
+#define _ESP_PMK_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+/** @brief Longest key kept in the PMK cache (a WPA2 PMK) */
+#define ESP_PMK_CACHE_KEY_MAX 32
+
+#ifdef CONFIG_ESP32_WIFI_PMK_CACHE
+
+/** @brief PMK cache counters */
+typedef struct {
+    uint32_t lookups;   /*!< keys requested from pbkdf2_sha1() */
+    uint32_t hits;      /*!< keys found in the cache, the others were derived */
+    uint32_t evictions; /*!< keys dropped to make room for another network (least recently used) */
+} esp_pmk_cache_stats_t;
+
+/** @brief Drop all cached keys, for example when the device leaves its owner.
+ *
+ * The cached keys give access to the networks, like the passphrases.
+ */
+void esp_pmk_cache_clear(void);
+
+/** @brief Read the cache counters.
+ *
+ * @param stats Filled with the counters since power-on (RTC storage) or
+ * since boot (RAM and NVS storage), or since esp_pmk_cache_reset_stats().
+ */
+void esp_pmk_cache_get_stats(esp_pmk_cache_stats_t *stats);
+
+/** @brief Reset the cache counters. */
+void esp_pmk_cache_reset_stats(void);
+
+/** @brief Look up a key derived earlier with the same parameters.
+ *
+ * Called by pbkdf2_sha1().
+ *
+ * @return 0 if the key was found and copied to buf, -1 if it has to be derived.
+ */
+int esp_pmk_cache_get(const char *passphrase, const uint8_t *ssid, size_t ssid_len,
+                      int iterations, uint8_t *buf, size_t buflen);
+
+/** @brief Keep a derived key, in place of the least recently used one if the cache is full.
+ *
+ * Called by pbkdf2_sha1(). Keys longer than ESP_PMK_CACHE_KEY_MAX aren't kept.
+ */
+void esp_pmk_cache_put(const char *passphrase, const uint8_t *ssid, size_t ssid_len,
+                       int iterations, const uint8_t *buf, size_t buflen);
+
+#else
+
+static inline int esp_pmk_cache_get(const char *passphrase, const uint8_t *ssid, size_t ssid_len,
+                                    int iterations, uint8_t *buf, size_t buflen)
+{
+    return -1;
+}
+
+static inline void esp_pmk_cache_put(const char *passphrase, const uint8_t *ssid, size_t ssid_len,
+                                     int iterations, const uint8_t *buf, size_t buflen)
+{
+}
+
+#endif /* CONFIG_ESP32_WIFI_PMK_CACHE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_PMK_CACHE_H_ */
@@ -15,25 +15,49 @@
 #include "crypto/includes.h"
 #include "crypto/common.h"
 #include "crypto/sha1.h"
+#include "crypto/sha1_i.h"
 #include "crypto/md5.h"
 #include "crypto/crypto.h"
+#include "esp_pmk_cache.h"
 
-static int 
-pbkdf2_sha1_f(const char *passphrase, const char *ssid,
-			 size_t ssid_len, int iterations, unsigned int count,
-			 u8 *digest)
+/*
+ * Each iteration hashes 20 bytes after the 64 byte key block, which is one
+ * SHA1 block with its padding: U || 0x80 || 0 ... || (64 + 20) * 8 bits
+ */
+static void
+pbkdf2_sha1_pad(u8 block[64])
 {
-	unsigned char tmp[SHA1_MAC_LEN], tmp2[SHA1_MAC_LEN];
-	int i, j;
-	unsigned char count_buf[4];
-	const u8 *addr[2];
-	size_t len[2];
-	size_t passphrase_len = os_strlen(passphrase);
+	os_memset(block + SHA1_MAC_LEN, 0, 64 - SHA1_MAC_LEN);
+	block[SHA1_MAC_LEN] = 0x80;
+	WPA_PUT_BE32(block + 60, (64 + SHA1_MAC_LEN) * 8);
+}
+
 
-	addr[0] = (u8 *) ssid;
-	len[0] = ssid_len;
-	addr[1] = count_buf;
-	len[1] = 4;
+static void
+pbkdf2_sha1_hash(const u32 key_state[5], u8 block[64])
+{
+	u32 state[5];
+	int i;
+
+	os_memcpy(state, key_state, sizeof(state));
+	SHA1Transform(state, block);
+	for (i = 0; i < 5; i++)
+		WPA_PUT_BE32(block + 4 * i, state[i]);
+}
+
+
+/*
+ * F(P, S, c, i) with the SHA1 states after the HMAC key blocks
+ * (K XOR ipad, K XOR opad) computed once for all iterations
+ */
+static void
+pbkdf2_sha1_f(const u32 istate[5], const u32 ostate[5], const char *ssid,
+	      size_t ssid_len, int iterations, unsigned int count, u8 *digest)
+{
+	struct SHA1Context ctx;
+	u8 block[64];
+	unsigned char count_buf[4];
+	int i, j;
 
 	/* F(P, S, c, i) = U1 xor U2 xor ... Uc
 	 * U1 = PRF(P, S || i)
@@ -41,25 +65,25 @@ pbkdf2_sha1_f(const char *passphrase, const char *ssid,
 	 * Uc = PRF(P, Uc-1)
 	 */
 
-	count_buf[0] = (count >> 24) & 0xff;
-	count_buf[1] = (count >> 16) & 0xff;
-	count_buf[2] = (count >> 8) & 0xff;
-	count_buf[3] = count & 0xff;
-	if (hmac_sha1_vector((u8 *) passphrase, passphrase_len, 2, addr, len,
-			     tmp))
-		return -1;
-	os_memcpy(digest, tmp, SHA1_MAC_LEN);
+	WPA_PUT_BE32(count_buf, count);
+	os_memcpy(ctx.state, istate, sizeof(ctx.state));
+	ctx.count[0] = 64 * 8;
+	ctx.count[1] = 0;
+	SHA1Update(&ctx, ssid, ssid_len);
+	SHA1Update(&ctx, count_buf, 4);
+	SHA1Final(block, &ctx);
+	pbkdf2_sha1_pad(block);
+	pbkdf2_sha1_hash(ostate, block);
+	os_memcpy(digest, block, SHA1_MAC_LEN);
 
 	for (i = 1; i < iterations; i++) {
-		if (hmac_sha1((u8 *) passphrase, passphrase_len, tmp,
-			      SHA1_MAC_LEN, tmp2))
-			return -1;
-		os_memcpy(tmp, tmp2, SHA1_MAC_LEN);
+		pbkdf2_sha1_hash(istate, block);
+		pbkdf2_sha1_hash(ostate, block);
 		for (j = 0; j < SHA1_MAC_LEN; j++)
-			digest[j] ^= tmp2[j];
+			digest[j] ^= block[j];
 	}
 
-	return 0;
+	os_memset(block, 0, sizeof(block));
 }
 
 
@@ -76,6 +100,10 @@ pbkdf2_sha1_f(const char *passphrase, const char *ssid,
  * This function is used to derive PSK for WPA-PSK. For this protocol,
  * iterations is set to 4096 and buflen to 32. This function is described in
  * IEEE Std 802.11-2004, Clause H.4. The main construction is from PKCS#5 v2.0.
+ *
+ * Runs on the hardware SHA engine when it is free. With the PMK cache
+ * enabled, a key derived earlier from the same parameters is returned
+ * from the cache.
  */
 int 
 pbkdf2_sha1(const char *passphrase, const char *ssid, size_t ssid_len,
@@ -85,17 +113,63 @@ pbkdf2_sha1(const char *passphrase, const char *ssid, size_t ssid_len,
 	unsigned char *pos = buf;
 	size_t left = buflen, plen;
 	unsigned char digest[SHA1_MAC_LEN];
+	u32 k_ipad[16], k_opad[16]; /* word aligned for the SHA engine */
+	u32 istate[5], ostate[5];
+	struct SHA1Context ctx;
+	const u8 *key = (const u8 *) passphrase;
+	size_t key_len = os_strlen(passphrase);
+	u8 tk[SHA1_MAC_LEN];
+	int i;
+
+	if (esp_pmk_cache_get(passphrase, (const u8 *) ssid, ssid_len,
+			      iterations, buf, buflen) == 0)
+		return 0;
+
+	/* if key is longer than 64 bytes reset it to key = SHA1(key) */
+	if (key_len > 64) {
+		if (sha1_vector(1, &key, &key_len, tk))
+			return -1;
+		key = tk;
+		key_len = SHA1_MAC_LEN;
+	}
+
+	os_memset(k_ipad, 0, sizeof(k_ipad));
+	os_memcpy(k_ipad, key, key_len);
+	os_memcpy(k_opad, k_ipad, sizeof(k_opad));
+	for (i = 0; i < 64; i++) {
+		((u8 *) k_ipad)[i] ^= 0x36;
+		((u8 *) k_opad)[i] ^= 0x5c;
+	}
+
+	SHA1Init(&ctx);
+	SHA1Transform(ctx.state, (u8 *) k_ipad);
+	os_memcpy(istate, ctx.state, sizeof(istate));
+	SHA1Init(&ctx);
+	SHA1Transform(ctx.state, (u8 *) k_opad);
+	os_memcpy(ostate, ctx.state, sizeof(ostate));
 
 	while (left > 0) {
 		count++;
-		if (pbkdf2_sha1_f(passphrase, ssid, ssid_len, iterations,
-				  count, digest))
-			return -1;
+		/* in software if the SHA engine is busy */
+		if (fast_pbkdf2_sha1_f((u8 *) k_ipad, (u8 *) k_opad,
+				       (const u8 *) ssid, ssid_len,
+				       iterations, count, digest))
+			pbkdf2_sha1_f(istate, ostate, ssid, ssid_len,
+				      iterations, count, digest);
 		plen = left > SHA1_MAC_LEN ? SHA1_MAC_LEN : left;
 		os_memcpy(pos, digest, plen);
 		pos += plen;
 		left -= plen;
 	}
 
+	esp_pmk_cache_put(passphrase, (const u8 *) ssid, ssid_len,
+			  iterations, buf, buflen);
+
+	os_memset(k_ipad, 0, sizeof(k_ipad));
+	os_memset(k_opad, 0, sizeof(k_opad));
+	os_memset(istate, 0, sizeof(istate));
+	os_memset(ostate, 0, sizeof(ostate));
+	os_memset(digest, 0, sizeof(digest));
+
 	return 0;
 }
@@ -0,0 +1,93 @@
+// Hardware crypto support Copyright 2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/sha1.h"
+#include "hwcrypto/sha.h"
+
+/* S || i, the 0x80 byte and the 64 bit length must fit in one block */
+#define FAST_PBKDF2_SSID_MAX (64 - 4 - 1 - 8)
+
+/* Pad a message of len bytes which follows a 64 byte key block */
+static void fast_pbkdf2_sha1_pad(uint32_t block[16], size_t len)
+{
+    uint8_t *b = (uint8_t *)block;
+
+    os_memset(b + len, 0, 64 - len);
+    b[len] = 0x80;
+    WPA_PUT_BE32(b + 60, (64 + len) * 8);
+}
+
+/* SHA1(key block || message block), the digest replaces the first 20 bytes of block */
+static void fast_pbkdf2_sha1_hash(const uint8_t *key_block, uint32_t block[16])
+{
+    uint32_t state[5];
+
+    esp_sha_block(SHA1, key_block, true);
+    esp_sha_block(SHA1, block, false);
+    esp_sha_read_digest_state(SHA1, state);
+    for (int i = 0; i < 5; i++) {
+        WPA_PUT_BE32((uint8_t *)block + 4 * i, state[i]);
+    }
+}
+
+/**
+ * fast_pbkdf2_sha1_f - One block of PBKDF2-SHA1 output, on the SHA engine
+ * @k_ipad: HMAC key XOR ipad (64 bytes, word aligned)
+ * @k_opad: HMAC key XOR opad (64 bytes, word aligned)
+ * @ssid: SSID (the PBKDF2 salt)
+ * @ssid_len: SSID length in bytes
+ * @iterations: Number of iterations to run
+ * @count: Index of the output block, from 1
+ * @digest: Buffer for the output block (20 bytes)
+ * Returns: 0 on success, -1 if the SHA engine is in use (or the SSID is
+ * too long), the caller then computes the block in software
+ *
+ * The engine can't be loaded with the precomputed key block states, each
+ * HMAC runs the key blocks again: 4 engine blocks per iteration, which is
+ * still much faster than 2 blocks in software.
+ */
+int fast_pbkdf2_sha1_f(const uint8_t *k_ipad, const uint8_t *k_opad,
+                       const uint8_t *ssid, size_t ssid_len, int iterations,
+                       unsigned int count, uint8_t *digest)
+{
+    uint32_t block[16];
+
+    if (ssid_len > FAST_PBKDF2_SSID_MAX || !esp_sha_try_lock_engine(SHA1)) {
+        return -1;
+    }
+
+    /* U1 = PRF(P, S || i) */
+    os_memcpy(block, ssid, ssid_len);
+    WPA_PUT_BE32((uint8_t *)block + ssid_len, count);
+    fast_pbkdf2_sha1_pad(block, ssid_len + 4);
+    fast_pbkdf2_sha1_hash(k_ipad, block);
+    fast_pbkdf2_sha1_pad(block, SHA1_MAC_LEN);
+    fast_pbkdf2_sha1_hash(k_opad, block);
+    os_memcpy(digest, block, SHA1_MAC_LEN);
+
+    /* Uc = PRF(P, Uc-1), the padding after the 20 bytes stays in place */
+    for (int i = 1; i < iterations; i++) {
+        fast_pbkdf2_sha1_hash(k_ipad, block);
+        fast_pbkdf2_sha1_hash(k_opad, block);
+        for (int j = 0; j < SHA1_MAC_LEN; j++) {
+            digest[j] ^= ((uint8_t *)block)[j];
+        }
+    }
+
+    esp_sha_unlock_engine(SHA1);
+    os_memset(block, 0, sizeof(block));
+    return 0;
+}
@@ -0,0 +1,2 @@
+/* Host stub, os.h maps the allocations to the C library */
+#pragma once
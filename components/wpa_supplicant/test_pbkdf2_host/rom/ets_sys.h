@@ -0,0 +1,2 @@
+/* Host stub, the code under test uses nothing of the ROM functions */
+#pragma once
@@ -0,0 +1,6 @@
+/* Configuration for the host tests of the PBKDF2 and the PMK cache */
+#pragma once
+
+#define CONFIG_ESP32_WIFI_PMK_CACHE 1
+#define CONFIG_ESP32_WIFI_PMK_CACHE_RTC 1
+#define CONFIG_ESP32_WIFI_PMK_CACHE_ENTRIES 2
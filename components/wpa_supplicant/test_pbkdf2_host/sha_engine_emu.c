@@ -0,0 +1,44 @@
+/* The SHA1 engine of the chip, emulated with the software SHA1 transform */
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/sha1_i.h"
+#include "hwcrypto/sha.h"
+#include "sha_engine_emu.h"
+
+static bool s_locked;
+static u32 s_state[5];
+
+bool sha_engine_emu_busy;
+unsigned sha_engine_emu_blocks;
+
+bool esp_sha_try_lock_engine(esp_sha_type sha_type)
+{
+    if (sha_type != SHA1 || s_locked || sha_engine_emu_busy) {
+        return false;
+    }
+    s_locked = true;
+    return true;
+}
+
+void esp_sha_unlock_engine(esp_sha_type sha_type)
+{
+    s_locked = false;
+}
+
+void esp_sha_block(esp_sha_type sha_type, const void *data_block, bool is_first_block)
+{
+    if (is_first_block) {
+        s_state[0] = 0x67452301;
+        s_state[1] = 0xEFCDAB89;
+        s_state[2] = 0x98BADCFE;
+        s_state[3] = 0x10325476;
+        s_state[4] = 0xC3D2E1F0;
+    }
+    SHA1Transform(s_state, data_block);
+    sha_engine_emu_blocks++;
+}
+
+void esp_sha_read_digest_state(esp_sha_type sha_type, void *digest_state)
+{
+    memcpy(digest_state, s_state, sizeof(s_state));
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Set to make the engine look in use by another digest, PBKDF2 then runs in software */
+extern bool sha_engine_emu_busy;
+/* Blocks run on the engine */
+extern unsigned sha_engine_emu_blocks;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,230 @@
+#include "catch.hpp"
+
+extern "C" {
+#include "crypto/includes.h"
+#include "crypto/common.h"
+#include "crypto/sha1.h"
+#include "esp_pmk_cache.h"
+}
+#include "sha_engine_emu.h"
+
+#include <string.h>
+#include <string>
+#include <random>
+#include <chrono>
+#include <functional>
+
+/* The derivation before the precomputed HMAC states, with a complete
+   hmac_sha1_vector() for each PRF: the reference, and the benchmark baseline */
+static void ref_pbkdf2_sha1(const char *passphrase, const uint8_t *ssid, size_t ssid_len,
+                            int iterations, uint8_t *buf, size_t buflen)
+{
+    size_t passphrase_len = strlen(passphrase);
+    unsigned int count = 0;
+
+    while (buflen > 0) {
+        uint8_t count_buf[4], tmp[SHA1_MAC_LEN], digest[SHA1_MAC_LEN];
+        const uint8_t *addr[2] = { ssid, count_buf };
+        size_t len[2] = { ssid_len, 4 };
+
+        count++;
+        WPA_PUT_BE32(count_buf, count);
+        REQUIRE(hmac_sha1_vector((const uint8_t *)passphrase, passphrase_len, 2, addr, len, tmp) == 0);
+        memcpy(digest, tmp, SHA1_MAC_LEN);
+        for (int i = 1; i < iterations; i++) {
+            REQUIRE(hmac_sha1((const uint8_t *)passphrase, passphrase_len, tmp, SHA1_MAC_LEN, tmp) == 0);
+            for (int j = 0; j < SHA1_MAC_LEN; j++) {
+                digest[j] ^= tmp[j];
+            }
+        }
+        size_t plen = buflen > SHA1_MAC_LEN ? SHA1_MAC_LEN : buflen;
+        memcpy(buf, digest, plen);
+        buf += plen;
+        buflen -= plen;
+    }
+}
+
+/* pbkdf2_sha1() on the emulated engine, or in software, without the cache */
+static std::string derive(const char *passphrase, const char *ssid, size_t ssid_len,
+                          int iterations, size_t buflen, bool engine)
+{
+    uint8_t buf[64];
+    char hex[2 * sizeof(buf) + 1] = "";
+
+    esp_pmk_cache_clear();
+    sha_engine_emu_busy = !engine;
+    sha_engine_emu_blocks = 0;
+    REQUIRE(buflen <= sizeof(buf));
+    REQUIRE(pbkdf2_sha1(passphrase, ssid, ssid_len, iterations, buf, buflen) == 0);
+    sha_engine_emu_busy = false;
+    if (engine && ssid_len <= 64 - 4 - 1 - 8) {
+        CHECK(sha_engine_emu_blocks == (buflen + SHA1_MAC_LEN - 1) / SHA1_MAC_LEN * iterations * 4);
+    } else {
+        CHECK(sha_engine_emu_blocks == 0);
+    }
+    for (size_t i = 0; i < buflen; i++) {
+        sprintf(hex + 2 * i, "%02x", buf[i]);
+    }
+    return hex;
+}
+
+TEST_CASE("PBKDF2-SHA1 test vectors (RFC 6070, IEEE 802.11i)", "[pbkdf2]")
+{
+    for (bool engine : { true, false }) {
+        INFO((engine ? "SHA engine" : "software"));
+        /* RFC 6070 vector 4 (16777216 iterations) is left out for the run
+           time, vector 6 has a NUL in the password, which pbkdf2_sha1() can't take */
+        CHECK(derive("password", "salt", 4, 1, 20, engine) == "0c60c80f961f0e71f3a9b524af6012062fe037a6");
+        CHECK(derive("password", "salt", 4, 2, 20, engine) == "ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957");
+        CHECK(derive("password", "salt", 4, 4096, 20, engine) == "4b007901b765489abead49d926f721d065a429c1");
+        CHECK(derive("passwordPASSWORDpassword", "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096, 25, engine) ==
+              "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038");
+
+        /* IEEE Std 802.11-2004, H.4.2 */
+        CHECK(derive("password", "IEEE", 4, 4096, 32, engine) ==
+              "f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e");
+        CHECK(derive("ThisIsAPassword", "ThisIsASSID", 11, 4096, 32, engine) ==
+              "0dc0d6eb90555ed6419756b9a15ec3e3209b63df707dd508d14581f8982721af");
+    }
+}
+
+TEST_CASE("PBKDF2-SHA1 matches the reference", "[pbkdf2]")
+{
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> byte(1, 255);
+
+    for (int n = 0; n < 300; n++) {
+        /* passphrases longer than 64 bytes are hashed first, SSIDs longer
+           than 51 bytes don't fit in one engine block */
+        std::string passphrase(gen() % 80 + 1, 'x'), ssid(gen() % 64, 'x');
+        int iterations = gen() % 40 + 1;
+        size_t buflen = gen() % 64 + 1;
+        uint8_t ref[64], out[64];
+
+        for (char &c : passphrase) {
+            c = byte(gen);
+        }
+        for (char &c : ssid) {
+            c = byte(gen);
+        }
+        INFO("passphrase " << passphrase.size() << ", SSID " << ssid.size() << ", iterations " << iterations << ", key " << buflen);
+
+        ref_pbkdf2_sha1(passphrase.c_str(), (const uint8_t *)ssid.data(), ssid.size(), iterations, ref, buflen);
+        for (bool engine : { true, false }) {
+            esp_pmk_cache_clear();
+            sha_engine_emu_busy = !engine;
+            REQUIRE(pbkdf2_sha1(passphrase.c_str(), ssid.data(), ssid.size(), iterations, out, buflen) == 0);
+            sha_engine_emu_busy = false;
+            CHECK(memcmp(ref, out, buflen) == 0);
+        }
+    }
+}
+
+TEST_CASE("PMK cache", "[pbkdf2][pmk_cache]")
+{
+    uint8_t pmk[32], ref[32];
+    esp_pmk_cache_stats_t stats;
+
+    esp_pmk_cache_clear();
+    esp_pmk_cache_reset_stats();
+
+    ref_pbkdf2_sha1("password", (const uint8_t *)"IEEE", 4, 4096, ref, sizeof(ref));
+    REQUIRE(pbkdf2_sha1("password", "IEEE", 4, 4096, pmk, sizeof(pmk)) == 0);
+    CHECK(memcmp(pmk, ref, sizeof(ref)) == 0);
+
+    /* the same network again: no SHA1 at all */
+    sha_engine_emu_blocks = 0;
+    memset(pmk, 0, sizeof(pmk));
+    REQUIRE(pbkdf2_sha1("password", "IEEE", 4, 4096, pmk, sizeof(pmk)) == 0);
+    CHECK(memcmp(pmk, ref, sizeof(ref)) == 0);
+    CHECK(sha_engine_emu_blocks == 0);
+    esp_pmk_cache_get_stats(&stats);
+    CHECK(stats.lookups == 2);
+    CHECK(stats.hits == 1);
+
+    SECTION("any other parameter is another key") {
+        sha_engine_emu_blocks = 0;
+        REQUIRE(pbkdf2_sha1("passwore", "IEEE", 4, 4096, pmk, sizeof(pmk)) == 0);
+        REQUIRE(pbkdf2_sha1("password", "IEEF", 4, 4096, pmk, sizeof(pmk)) == 0);
+        REQUIRE(pbkdf2_sha1("password", "IEEE", 3, 4096, pmk, sizeof(pmk)) == 0);
+        REQUIRE(pbkdf2_sha1("password", "IEEE", 4, 4095, pmk, sizeof(pmk)) == 0);
+        REQUIRE(pbkdf2_sha1("password", "IEEE", 4, 4096, pmk, 20) == 0);
+        CHECK(memcmp(pmk, ref, 20) == 0);
+        CHECK(sha_engine_emu_blocks > 0);
+        esp_pmk_cache_get_stats(&stats);
+        CHECK(stats.hits == 1);
+    }
+
+    SECTION("the least recently used key is replaced") {
+        REQUIRE(pbkdf2_sha1("password", "net2", 4, 4096, pmk, sizeof(pmk)) == 0);
+        /* IEEE is used again, net2 is then the least recently used */
+        REQUIRE(pbkdf2_sha1("password", "IEEE", 4, 4096, pmk, sizeof(pmk)) == 0);
+        REQUIRE(pbkdf2_sha1("password", "net3", 4, 4096, pmk, sizeof(pmk)) == 0);
+        esp_pmk_cache_get_stats(&stats);
+        CHECK(stats.hits == 2);
+        CHECK(stats.evictions == 1);
+
+        esp_pmk_cache_reset_stats();
+        REQUIRE(pbkdf2_sha1("password", "IEEE", 4, 4096, pmk, sizeof(pmk)) == 0);
+        CHECK(memcmp(pmk, ref, sizeof(ref)) == 0);
+        REQUIRE(pbkdf2_sha1("password", "net3", 4, 4096, pmk, sizeof(pmk)) == 0);
+        REQUIRE(pbkdf2_sha1("password", "net2", 4, 4096, pmk, sizeof(pmk)) == 0);
+        esp_pmk_cache_get_stats(&stats);
+        CHECK(stats.lookups == 3);
+        CHECK(stats.hits == 2);
+    }
+
+    SECTION("keys longer than a PMK aren't kept") {
+        uint8_t key[40];
+        REQUIRE(pbkdf2_sha1("password", "long", 4, 2, key, sizeof(key)) == 0);
+        REQUIRE(pbkdf2_sha1("password", "long", 4, 2, key, sizeof(key)) == 0);
+        esp_pmk_cache_get_stats(&stats);
+        CHECK(stats.hits == 1);
+    }
+
+    SECTION("clear") {
+        esp_pmk_cache_clear();
+        sha_engine_emu_blocks = 0;
+        REQUIRE(pbkdf2_sha1("password", "IEEE", 4, 4096, pmk, sizeof(pmk)) == 0);
+        CHECK(memcmp(pmk, ref, sizeof(ref)) == 0);
+        CHECK(sha_engine_emu_blocks == 2 * 4096 * 4);
+        esp_pmk_cache_get_stats(&stats);
+        CHECK(stats.hits == 1);
+    }
+
+    esp_pmk_cache_clear();
+}
+
+TEST_CASE("WPA2-PSK PMK derivation time", "[pbkdf2][perf]")
+{
+    const int rounds = 20;
+    uint8_t pmk[32];
+    auto time_us = [&](const char *name, std::function<void()> f) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            f();
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+        printf("PMK derivation, %s: %.1f us\n", name, us);
+        return us;
+    };
+
+    double ref_us = time_us("HMAC per PRF (previous)", [&] {
+        ref_pbkdf2_sha1("ThisIsAPassword", (const uint8_t *)"ThisIsASSID", 11, 4096, pmk, sizeof(pmk));
+    });
+    double sw_us = time_us("precomputed HMAC key states", [&] {
+        esp_pmk_cache_clear();
+        sha_engine_emu_busy = true;
+        pbkdf2_sha1("ThisIsAPassword", "ThisIsASSID", 11, 4096, pmk, sizeof(pmk));
+        sha_engine_emu_busy = false;
+    });
+    sha_engine_emu_blocks = 0;
+    esp_pmk_cache_clear();
+    pbkdf2_sha1("ThisIsAPassword", "ThisIsASSID", 11, 4096, pmk, sizeof(pmk));
+    printf("PMK derivation, SHA engine: %u engine blocks (the engine runs a block in 80 cycles)\n", sha_engine_emu_blocks);
+    time_us("PMK cache hit", [&] {
+        pbkdf2_sha1("ThisIsAPassword", "ThisIsASSID", 11, 4096, pmk, sizeof(pmk));
+    });
+    printf("PMK derivation, software speedup %.1fx\n", ref_us / sw_us);
+    esp_pmk_cache_clear();
+}